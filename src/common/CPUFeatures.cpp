@@ -27,6 +27,7 @@
 
 #ifdef _MSC_VER
 #include <intrin.h>
+#include <immintrin.h>
 #endif
 
 #ifdef _WIN32
@@ -169,6 +170,66 @@ bool hasAVX()
 #endif
 }
 
+#if (WINDOWS || LINUX) && !ARM_NEON
+/*
+ * The wider registers are only usable if the OS saves them on a context switch, which is what
+ * the XCR0 bits say.
+ */
+static bool osSavesState(unsigned int xcr0Mask)
+{
+    int info[4];
+    cpuid(info, 1);
+    if ((info[2] & ((int)1 << 27)) == 0) // OSXSAVE
+        return false;
+
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+    return (xcr0 & xcr0Mask) == xcr0Mask;
+}
+
+static int extendedFeatures()
+{
+    int info[4];
+    cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+
+    cpuid(info, 7);
+    return info[1];
+}
+#endif
+
+bool hasAVX2()
+{
+#if ARM_NEON
+    return false;
+#elif MAC
+    int v = 0;
+    size_t sz = sizeof(v);
+    return sysctlbyname("hw.optional.avx2_0", &v, &sz, nullptr, 0) == 0 && v;
+#else
+    return (extendedFeatures() & ((int)1 << 5)) != 0 && osSavesState(0x6);
+#endif
+}
+
+bool hasAVX512F()
+{
+#if ARM_NEON
+    return false;
+#elif MAC
+    int v = 0;
+    size_t sz = sizeof(v);
+    return sysctlbyname("hw.optional.avx512f", &v, &sz, nullptr, 0) == 0 && v;
+#else
+    return (extendedFeatures() & ((int)1 << 16)) != 0 && osSavesState(0xe6);
+#endif
+}
+
 FPUStateGuard::FPUStateGuard()
 {
 #ifndef ARM_NEON
@@ -27,6 +27,8 @@ bool isArm();
 bool isX86();
 bool hasSSE2();
 bool hasAVX();
+bool hasAVX2();
+bool hasAVX512F();
 
 struct FPUStateGuard
 {
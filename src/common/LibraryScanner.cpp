@@ -0,0 +1,320 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "LibraryScanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "filesystem/import.h"
+
+namespace Surge
+{
+namespace Storage
+{
+namespace
+{
+const char *manifestTag = "surge-library-manifest";
+const int manifestVersion = 1;
+
+// Scans in one process read, merge and rewrite the manifest one at a time
+std::mutex manifestMutex;
+
+LibraryScanner::Tree readManifest(const std::string &manifestPath)
+{
+    LibraryScanner::Tree res;
+    if (manifestPath.empty())
+        return res;
+
+    std::ifstream ifs(string_to_path(manifestPath), std::ios::binary);
+    if (!ifs)
+        return res;
+
+    std::string line;
+    if (!std::getline(ifs, line))
+        return res;
+    std::ostringstream expected;
+    expected << manifestTag << " " << manifestVersion;
+    if (line != expected.str())
+        return res;
+
+    /*
+     * "d <mtime> <path>" starts a directory and "s <name>" and "f <name>" add a subdirectory or a
+     * file to it. Anything else means the file isn't one of ours, and we start from nothing.
+     */
+    LibraryScanner::Directory *current = nullptr;
+    while (std::getline(ifs, line))
+    {
+        if (line.size() < 2 || line[1] != ' ')
+            return {};
+
+        auto rest = line.substr(2);
+        switch (line[0])
+        {
+        case 'd':
+        {
+            auto sp = rest.find(' ');
+            if (sp == std::string::npos)
+                return {};
+            current = &res[rest.substr(sp + 1)];
+            current->mtime = std::strtoll(rest.substr(0, sp).c_str(), nullptr, 10);
+            break;
+        }
+        case 's':
+            if (!current)
+                return {};
+            current->subdirs.push_back(rest);
+            break;
+        case 'f':
+            if (!current)
+                return {};
+            current->files.push_back(rest);
+            break;
+        default:
+            return {};
+        }
+    }
+    return res;
+}
+
+void writeManifest(const std::string &manifestPath, const LibraryScanner::Tree &tree)
+{
+    std::error_code ec;
+    auto dest = string_to_path(manifestPath);
+    fs::create_directories(dest.parent_path(), ec);
+
+    // Whole files only, for whoever reads it next; see WavetableMipmapCache::write
+    std::ostringstream tn;
+    tn << manifestPath << "." << std::hash<std::thread::id>()(std::this_thread::get_id())
+       << ".tmp";
+    auto temp = string_to_path(tn.str());
+
+    {
+        std::ofstream ofs(temp, std::ios::binary | std::ios::trunc);
+        if (!ofs)
+            return;
+
+        ofs << manifestTag << " " << manifestVersion << "\n";
+        for (auto &d : tree)
+        {
+            ofs << "d " << d.second.mtime << " " << d.first << "\n";
+            for (auto &s : d.second.subdirs)
+                ofs << "s " << s << "\n";
+            for (auto &f : d.second.files)
+                ofs << "f " << f << "\n";
+        }
+        ofs.close();
+
+        if (!ofs)
+        {
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+
+    fs::rename(temp, dest, ec);
+    if (ec)
+        fs::remove(temp, ec);
+}
+
+bool isUnder(const std::string &path, const std::string &root)
+{
+    if (path.compare(0, root.size(), root) != 0)
+        return false;
+    if (path.size() == root.size())
+        return true;
+    auto c = root.empty() ? 0 : root.back();
+    return c == '/' || c == '\\' || path[root.size()] == '/' || path[root.size()] == '\\';
+}
+
+std::string withoutTrailingSeparators(std::string s)
+{
+    while (s.size() > 1 && (s.back() == '/' || s.back() == '\\'))
+        s.pop_back();
+    return s;
+}
+
+int64_t modificationTime(const fs::path &p)
+{
+    std::error_code ec;
+    auto t = fs::last_write_time(p, ec);
+    if (ec)
+        return 0;
+    return (int64_t)t.time_since_epoch().count();
+}
+
+LibraryScanner::Directory listDirectory(const fs::path &p, int64_t mtime)
+{
+    LibraryScanner::Directory res;
+    res.mtime = mtime;
+
+    std::error_code ec;
+    for (auto it = fs::directory_iterator(p, ec); !ec && it != fs::directory_iterator();
+         it.increment(ec))
+    {
+        std::error_code dec;
+        if (fs::is_directory(it->path(), dec))
+        {
+            res.subdirs.push_back(path_to_string(it->path().filename()));
+        }
+        else if (LibraryScanner::isLibraryExtension(path_to_string(it->path().extension())))
+        {
+            res.files.push_back(path_to_string(it->path().filename()));
+        }
+    }
+
+    std::sort(res.subdirs.begin(), res.subdirs.end());
+    std::sort(res.files.begin(), res.files.end());
+    return res;
+}
+} // namespace
+
+bool LibraryScanner::isLibraryExtension(const std::string &xtn)
+{
+    auto l = xtn;
+    std::transform(l.begin(), l.end(), l.begin(), [](char c) { return std::tolower(c); });
+    return l == ".fxp" || l == ".wt" || l == ".wav";
+}
+
+LibraryScanner::Tree LibraryScanner::scan(const std::vector<std::string> &roots,
+                                          const std::string &manifestPath,
+                                          const std::vector<std::string> &skip, Stats *stats)
+{
+    Tree previous;
+    {
+        std::lock_guard<std::mutex> g(manifestMutex);
+        previous = readManifest(manifestPath);
+    }
+
+    std::vector<std::string> skipDirs;
+    for (auto &s : skip)
+        if (!s.empty())
+            skipDirs.push_back(withoutTrailingSeparators(s));
+
+    Tree result;
+    Stats counts;
+    std::deque<std::string> work;
+    int outstanding = 0;
+    std::mutex m;
+    std::condition_variable cv;
+
+    for (auto &r : roots)
+    {
+        std::error_code ec;
+        if (fs::is_directory(string_to_path(r), ec))
+        {
+            work.push_back(r);
+            outstanding++;
+        }
+    }
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lk(m);
+        while (true)
+        {
+            cv.wait(lk, [&]() { return !work.empty() || outstanding == 0; });
+            if (work.empty())
+                return;
+
+            auto path = work.front();
+            work.pop_front();
+            lk.unlock();
+
+            auto p = string_to_path(path);
+            auto mtime = modificationTime(p);
+            auto prior = previous.find(path);
+            bool reuse = mtime != 0 && prior != previous.end() && prior->second.mtime == mtime;
+            auto dir = reuse ? prior->second : listDirectory(p, mtime);
+
+            // Skipped directories are left out of the walk and out of the lists
+            std::vector<std::string> children;
+            auto &sd = dir.subdirs;
+            for (auto it = sd.begin(); it != sd.end();)
+            {
+                auto child = path_to_string(p / string_to_path(*it));
+                if (std::find(skipDirs.begin(), skipDirs.end(), child) != skipDirs.end())
+                {
+                    it = sd.erase(it);
+                }
+                else
+                {
+                    children.push_back(child);
+                    ++it;
+                }
+            }
+
+            lk.lock();
+            if (reuse)
+                counts.reused++;
+            else
+                counts.listed++;
+            result[path] = std::move(dir);
+            for (auto &c : children)
+                work.push_back(c);
+            outstanding += (int)children.size() - 1;
+            cv.notify_all();
+        }
+    };
+
+    auto nThreads = std::min(8u, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < nThreads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &t : threads)
+        t.join();
+
+    bool vanished = false;
+    for (auto &p : previous)
+    {
+        for (auto &r : roots)
+        {
+            if (isUnder(p.first, r) && result.find(p.first) == result.end())
+                vanished = true;
+        }
+    }
+
+    if (!manifestPath.empty() && (counts.listed > 0 || vanished))
+    {
+        // Someone else may have written theirs since we read it, so merge into the latest
+        std::lock_guard<std::mutex> g(manifestMutex);
+        auto merged = readManifest(manifestPath);
+        for (auto it = merged.begin(); it != merged.end();)
+        {
+            bool ours = false;
+            for (auto &r : roots)
+                ours = ours || isUnder(it->first, r);
+            if (ours)
+                it = merged.erase(it);
+            else
+                ++it;
+        }
+        for (auto &d : result)
+            merged[d.first] = d.second;
+        writeManifest(manifestPath, merged);
+    }
+
+    if (stats)
+        *stats = counts;
+    return result;
+}
+} // namespace Storage
+} // namespace Surge
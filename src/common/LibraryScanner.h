@@ -0,0 +1,68 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_LIBRARYSCANNER_H
+#define SURGE_XT_LIBRARYSCANNER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Surge
+{
+namespace Storage
+{
+/*
+ * Walks the patch and wavetable directories for SurgeStorage's lists.
+ *
+ * Directories are listed in parallel on a few threads. What each one held is remembered in a
+ * manifest along with its modification time, which changes whenever an entry is added, removed
+ * or renamed inside it, so on the next scan a directory whose time still matches is taken from
+ * the manifest without being listed again. Only files which may go into a list (.fxp, .wt, .wav)
+ * are remembered.
+ */
+struct LibraryScanner
+{
+    struct Directory
+    {
+        int64_t mtime = 0;
+        std::vector<std::string> subdirs; // names, sorted
+        std::vector<std::string> files;   // names of library files, sorted
+    };
+
+    // Every directory found, by full path. The paths are built by appending names to a root.
+    typedef std::map<std::string, Directory> Tree;
+
+    struct Stats
+    {
+        size_t listed = 0, reused = 0;
+    };
+
+    /*
+     * Walk everything under roots, skipping the directories in skip and their contents. The
+     * manifest at manifestPath is read and, if anything had to be listed, written back with the
+     * entries under roots replaced. An empty manifestPath scans without one. Unreadable
+     * directories come back empty; this never throws.
+     */
+    static Tree scan(const std::vector<std::string> &roots, const std::string &manifestPath,
+                     const std::vector<std::string> &skip = {}, Stats *stats = nullptr);
+
+    static bool isLibraryExtension(const std::string &xtn);
+};
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_XT_LIBRARYSCANNER_H
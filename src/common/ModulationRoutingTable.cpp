@@ -0,0 +1,53 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "ModulationRoutingTable.h"
+
+namespace Surge
+{
+namespace Storage
+{
+ModulationRoutingTable::ModulationRoutingTable()
+{
+    // so publishing from the audio thread (FX and patch loads) doesn't allocate in practice
+    for (auto &s : sets)
+    {
+        s.global.reserve(VoiceModulationPlan::initialCapacity);
+        for (auto &sc : s.scenes)
+        {
+            sc.scene.reserve(VoiceModulationPlan::initialCapacity);
+            sc.voice.reserve(VoiceModulationPlan::initialCapacity);
+        }
+    }
+}
+
+void ModulationRoutingTable::publish(const SurgePatch &patch)
+{
+    auto &s = sets[back];
+
+    s.global = patch.modulation_global;
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        s.scenes[sc].scene = patch.scene[sc].modulation_scene;
+        s.scenes[sc].voice = patch.scene[sc].modulation_voice;
+        s.scenes[sc].voicePlan.compile(s.scenes[sc].voice);
+    }
+
+    // the set the audio thread gave back last time (or a stale one it never took) is ours now
+    back = middle.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+    publishCount++;
+}
+} // namespace Storage
+} // namespace Surge
@@ -0,0 +1,97 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_MODULATIONROUTINGTABLE_H
+#define SURGE_XT_MODULATIONROUTINGTABLE_H
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "SurgeStorage.h"
+#include "VoiceModulationPlan.h"
+
+namespace Surge
+{
+namespace Storage
+{
+/*
+ * A copy of every modulation routing in the patch, as the audio thread sees it for a block.
+ */
+struct ModulationRoutingSet
+{
+    std::vector<ModulationRouting> global;
+
+    struct Scene
+    {
+        std::vector<ModulationRouting> scene, voice;
+        VoiceModulationPlan voicePlan; // voice, compiled for SurgeVoice::calc_ctrldata
+    } scenes[n_scenes];
+};
+
+/*
+ * Hands the patch's modulation routings to the audio thread without a lock.
+ *
+ * The routing vectors in SurgePatch still belong to the editors (the GUI, the host, patch
+ * loads), which change them under modRoutingMutex as before and then publish(). publish()
+ * copies them into a spare ModulationRoutingSet and swaps it in as the newest one. At the top
+ * of every block the audio thread calls acquire(), which takes the newest set if there is
+ * one, and then it (and the voices, on whatever thread they render) only read current() for
+ * the rest of the block.
+ *
+ * It is a triple buffer: one set the audio thread reads, one the writer fills and one in the
+ * middle which they trade through a single atomic. Neither side ever waits for the other, and a
+ * set is never written while the audio thread can see it.
+ */
+class ModulationRoutingTable
+{
+  public:
+    ModulationRoutingTable();
+
+    ModulationRoutingTable(const ModulationRoutingTable &) = delete;
+    ModulationRoutingTable &operator=(const ModulationRoutingTable &) = delete;
+
+    /*
+     * Copy the patch's routings and make them the newest set. Call with modRoutingMutex held,
+     * which keeps writers from racing each other; the audio thread doesn't take it.
+     */
+    void publish(const SurgePatch &patch);
+
+    /*
+     * Audio thread only, once per block: pick up the newest published set.
+     */
+    const ModulationRoutingSet &acquire()
+    {
+        if (middle.load(std::memory_order_relaxed) & fresh)
+            front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+        return sets[front];
+    }
+
+    // The set the audio thread is using this block
+    const ModulationRoutingSet &current() const { return sets[front]; }
+
+    std::atomic<int> publishCount{0};
+
+  private:
+    static constexpr int fresh = 4;
+
+    std::array<ModulationRoutingSet, 3> sets;
+    int front = 0, back = 1;
+    std::atomic<int> middle{2};
+};
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_XT_MODULATIONROUTINGTABLE_H
@@ -141,6 +141,7 @@ void loadPresetFrom(const fs::path &location, SurgeStorage *s, int scene, int lf
         return;
     }
     lfo->shape.val.i = lfotype;
+    lfo->shape.markDirty();
 
     auto params = TINYXML_SAFE_TO_ELEMENT(lfox->FirstChildElement("params"));
     if (!params)
@@ -180,6 +181,7 @@ void loadPresetFrom(const fs::path &location, SurgeStorage *s, int scene, int lf
                     curr->val.i = q;
                 }
             }
+            curr->markDirty();
 
             if (valNode->QueryIntAttribute("temposync", &q) == TIXML_SUCCESS)
                 curr->temposync = q;
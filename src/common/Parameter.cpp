@@ -1732,6 +1732,7 @@ void Parameter::bound_value(bool force_integer)
         break;
     }
     };
+    markDirty();
 }
 
 bool Parameter::supportsDynamicName()
@@ -1810,6 +1811,7 @@ void Parameter::set_storage_value(int i)
         break;
     }
     }
+    markDirty();
 }
 void Parameter::set_storage_value(float f)
 {
@@ -1821,6 +1823,7 @@ void Parameter::set_storage_value(float f)
         break;
     }
     }
+    markDirty();
 }
 
 float Parameter::get_extended(float f)
@@ -3555,6 +3558,13 @@ void Parameter::set_value_f01(float v, bool force_integer)
     bound_value(force_integer);
 }
 
+void Parameter::markDirty()
+{
+    // a patch's own parameters are set up before the storage has its patch
+    if (storage && storage->_patch)
+        storage->getPatch().markParameterDirty(id);
+}
+
 float Parameter::get_modulation_f01(float mod) const
 {
     if (ctrltype == ct_none)
@@ -3728,7 +3738,12 @@ bool Parameter::can_setvalue_from_string()
     return false;
 }
 
-bool Parameter::set_value_from_string(std::string s) { return set_value_from_string_onto(s, val); }
+bool Parameter::set_value_from_string(std::string s)
+{
+    auto res = set_value_from_string_onto(s, val);
+    markDirty();
+    return res;
+}
 
 bool Parameter::set_value_from_string_onto(std::string s, pdata &onto)
 {
@@ -425,6 +425,13 @@ class Parameter
     float calculate_modulation_value_from_string(const std::string &s, bool &valid);
 
     void bound_value(bool force_integer = false);
+
+    /*
+     * Tell the patch val changed, so the engine copies it into scenedata or globaldata on the
+     * next block. The setters and bound_value do this themselves; anything else writing val has
+     * to call it (or SurgePatch::markParameterDirty) too.
+     */
+    void markDirty();
     std::string tempoSyncNotationValue(float f);
     float quantize_modulation(float modvalue); // given a mod-value hand it back rounded to a
                                                // 'reasonable' step size (used in ctrl-drag)
@@ -0,0 +1,88 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "ProcessProfiler.h"
+
+namespace Surge
+{
+namespace Profiling
+{
+const char *ProcessProfiler::stageName(int s)
+{
+    switch (s)
+    {
+    case stage_patch:
+        return "patch";
+    case stage_input:
+        return "input";
+    case stage_control:
+        return "control";
+    case stage_voices:
+        return "voices";
+    case stage_scene_out:
+        return "scene_out";
+    case stage_insert_fx:
+        return "insert_fx";
+    case stage_send_fx:
+        return "send_fx";
+    case stage_global_fx:
+        return "global_fx";
+    case stage_output:
+        return "output";
+    }
+    return "unknown";
+}
+
+ProcessProfiler::Counters ProcessProfiler::poll() const
+{
+    auto r = [](const std::atomic<uint64_t> &c) { return c.load(std::memory_order_relaxed); };
+
+    Counters res;
+    res.blocks = r(blocks);
+    res.blockTicks = r(blockTicks);
+    res.blockNS = r(blockNS);
+    for (int i = 0; i < n_stages; ++i)
+        res.stageTicks[i] = r(stageTicks[i]);
+    for (int i = 0; i < n_fx_slots; ++i)
+        res.fxSlotTicks[i] = r(fxSlotTicks[i]);
+    for (int i = 0; i < n_osc_types; ++i)
+    {
+        res.oscTicks[i] = r(oscTicks[i]);
+        res.oscBlocks[i] = r(oscBlocks[i]);
+    }
+    res.filterChainTicks = r(filterChainTicks);
+    return res;
+}
+
+ProcessProfiler::Counters ProcessProfiler::Counters::since(const Counters &earlier) const
+{
+    Counters res;
+    res.blocks = blocks - earlier.blocks;
+    res.blockTicks = blockTicks - earlier.blockTicks;
+    res.blockNS = blockNS - earlier.blockNS;
+    for (int i = 0; i < n_stages; ++i)
+        res.stageTicks[i] = stageTicks[i] - earlier.stageTicks[i];
+    for (int i = 0; i < n_fx_slots; ++i)
+        res.fxSlotTicks[i] = fxSlotTicks[i] - earlier.fxSlotTicks[i];
+    for (int i = 0; i < n_osc_types; ++i)
+    {
+        res.oscTicks[i] = oscTicks[i] - earlier.oscTicks[i];
+        res.oscBlocks[i] = oscBlocks[i] - earlier.oscBlocks[i];
+    }
+    res.filterChainTicks = filterChainTicks - earlier.filterChainTicks;
+    return res;
+}
+} // namespace Profiling
+} // namespace Surge
@@ -0,0 +1,163 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_PROCESSPROFILER_H
+#define SURGE_XT_PROCESSPROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "SurgeStorage.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define SURGE_PROFILER_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SURGE_PROFILER_HAS_TSC 1
+#endif
+
+namespace Surge
+{
+namespace Profiling
+{
+/*
+ * Where the time in SurgeSynthesizer::process goes, by stage, by FX slot, by oscillator type and,
+ * within the voices, in the filter chain. Always on; the audio side is a cycle counter read at
+ * each boundary and a relaxed atomic add, so it costs a few tens of nanoseconds per stage, per
+ * running oscillator and per filter chain run.
+ *
+ * Stages are timed in TSC ticks where we have them (steady_clock elsewhere) and each whole block
+ * is also timed in steady_clock nanoseconds, which gives the tick length without calibrating.
+ * Counters only ever grow; poll() them from any thread and diff two polls for an interval. A poll
+ * taken mid block may see some of that block's counters and not others.
+ *
+ * Voice and stage time is summed over whichever threads did the work, so with multithreaded
+ * scenes or voice threads the stages can add up to more than the wall time of the blocks.
+ */
+class ProcessProfiler
+{
+  public:
+    enum Stage
+    {
+        stage_patch = 0,   // patch switching: fades, shadow patch commits
+        stage_input,       // audio input clipping and upsampling, buffer clears
+        stage_control,     // processControl: modulators, MIDI smoothing, parameter targets
+        stage_voices,      // voice modulators, oscillators and filterChainTicks
+        stage_scene_out,   // per scene halfband decimation, low cut and clipping
+        stage_insert_fx,   // includes the scene insert slots in fxSlotTicks
+        stage_send_fx,     // send mixing and the send slots
+        stage_global_fx,   // the global slots
+        stage_output,      // scene sum, master gain, VU and hard clip
+        n_stages
+    };
+
+    static const char *stageName(int s);
+
+    struct Counters
+    {
+        uint64_t blocks = 0;
+        uint64_t blockTicks = 0, blockNS = 0;
+        uint64_t stageTicks[n_stages] = {};
+        uint64_t fxSlotTicks[n_fx_slots] = {};
+        uint64_t oscTicks[n_osc_types] = {};
+        uint64_t oscBlocks[n_osc_types] = {}; // one per oscillator per voice per block
+        // The QuadFilterChain over every voice quad, or wide group of them, including its mixing
+        uint64_t filterChainTicks = 0;
+
+        double nsPerTick() const { return blockTicks ? 1.0 * blockNS / blockTicks : 0; }
+        double toNS(uint64_t ticks) const { return ticks * nsPerTick(); }
+
+        // What happened between earlier and this
+        Counters since(const Counters &earlier) const;
+    };
+
+    Counters poll() const;
+
+    static inline uint64_t now()
+    {
+#if SURGE_PROFILER_HAS_TSC
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    /*
+     * Called at the top of a block and, if the block runs to the end, at its end. Between them
+     * lap() charges the time since mark to a stage and moves mark on.
+     */
+    struct Block
+    {
+        uint64_t startTicks;
+        std::chrono::steady_clock::time_point start;
+        uint64_t mark;
+    };
+
+    Block beginBlock() const
+    {
+        auto t = now();
+        return {t, std::chrono::steady_clock::now(), t};
+    }
+
+    void endBlock(const Block &b)
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - b.start)
+                      .count();
+        add(blockTicks, now() - b.startTicks);
+        add(blockNS, ns);
+        add(blocks, 1);
+    }
+
+    void lap(Stage s, uint64_t &mark)
+    {
+        auto t = now();
+        add(stageTicks[s], t - mark);
+        mark = t;
+    }
+
+    void addFxSlot(int slot, uint64_t since) { add(fxSlotTicks[slot], now() - since); }
+
+    void addFilterChain(uint64_t since) { add(filterChainTicks, now() - since); }
+
+    void addOscillator(int type, uint64_t since)
+    {
+        if (type < 0 || type >= n_osc_types)
+            return;
+        add(oscTicks[type], now() - since);
+        add(oscBlocks[type], 1);
+    }
+
+  private:
+    static void add(std::atomic<uint64_t> &c, uint64_t v)
+    {
+        c.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> blocks{0}, blockTicks{0}, blockNS{0};
+    std::atomic<uint64_t> stageTicks[n_stages] = {};
+    std::atomic<uint64_t> fxSlotTicks[n_fx_slots] = {};
+
+    // Voice threads add these, so keep them off the line the audio thread writes
+    alignas(64) std::atomic<uint64_t> oscTicks[n_osc_types] = {};
+    std::atomic<uint64_t> oscBlocks[n_osc_types] = {};
+    std::atomic<uint64_t> filterChainTicks{0};
+};
+} // namespace Profiling
+} // namespace Surge
+
+#endif // SURGE_XT_PROCESSPROFILER_H
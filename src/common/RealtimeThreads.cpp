@@ -0,0 +1,232 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "RealtimeThreads.h"
+#include "globals.h"
+
+#include <chrono>
+
+#if MAC || LINUX
+#include <pthread.h>
+#if LINUX
+#include <sched.h>
+#endif
+#else
+#include <windows.h>
+#endif
+
+namespace Surge
+{
+namespace Threading
+{
+namespace
+{
+/*
+ * Spin politely. Every so often give the core away in case whoever we wait on shares it,
+ * which matters on machines with fewer cores than threads.
+ */
+inline void spinPause(int &spins)
+{
+    if (++spins & 255)
+        _mm_pause();
+    else
+        std::this_thread::yield();
+}
+} // namespace
+
+void raiseToRealtimePriority()
+{
+#if MAC || LINUX
+    sched_param params;
+    params.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &params);
+#else
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+}
+
+RealtimeWorker::RealtimeWorker(std::function<void()> j) : job(std::move(j))
+{
+    thread = std::thread([this]() { this->loop(); });
+}
+
+RealtimeWorker::~RealtimeWorker()
+{
+    {
+        std::lock_guard<std::mutex> g(parkLock);
+        keepRunning = false;
+    }
+    parkCV.notify_one();
+    thread.join();
+}
+
+void RealtimeWorker::start()
+{
+    posted++;
+
+    /*
+     * The worker sets parked under the lock and then re-checks posted before it sleeps, so
+     * either it sees this job already or we see it parked and wake it.
+     */
+    if (parked)
+    {
+        std::lock_guard<std::mutex> g(parkLock);
+        parkCV.notify_one();
+    }
+}
+
+void RealtimeWorker::wait()
+{
+    auto target = posted.load();
+    int spins = 0;
+    while (finished.load() != target)
+        spinPause(spins);
+}
+
+void RealtimeWorker::loop()
+{
+    raiseToRealtimePriority();
+
+    uint32_t seen = 0;
+    int spins = 0;
+    auto lastJob = std::chrono::steady_clock::now();
+
+    while (keepRunning)
+    {
+        auto p = posted.load();
+        if (p != seen)
+        {
+            seen = p;
+            job();
+            finished = seen;
+            lastJob = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() - lastJob <
+            std::chrono::microseconds(spinMicroseconds))
+        {
+            spinPause(spins);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> g(parkLock);
+        parked = true;
+        parkCV.wait(g, [this, seen]() { return !keepRunning || posted.load() != seen; });
+        parked = false;
+        lastJob = std::chrono::steady_clock::now();
+    }
+}
+
+WorkStealingPool::WorkStealingPool(int nThreads)
+{
+    // participant 0 is whoever calls run()
+    for (int i = 1; i < nThreads; ++i)
+        threads.emplace_back([this]() { this->loop(); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> g(parkLock);
+        keepRunning = false;
+    }
+    parkCV.notify_all();
+    for (auto &t : threads)
+        t.join();
+}
+
+void WorkStealingPool::runImpl(int nTasks, void (*fn)(void *, int), void *ctx)
+{
+    assert(nTasks <= maxTasks);
+
+    if (nTasks <= 0)
+        return;
+
+    if (threads.empty())
+    {
+        for (int t = 0; t < nTasks; ++t)
+            fn(ctx, t);
+        return;
+    }
+
+    /*
+     * Publish the job before any task can be seen; pushing releases it to the thieves. A
+     * worker still on its way out of the last batch may steal one of these, which is fine
+     * since it will run it against this job and count it off.
+     */
+    job = fn;
+    jobContext = ctx;
+    remaining = nTasks;
+
+    // push in reverse so we pop from the front of the batch and thieves take from the back
+    for (int t = nTasks - 1; t >= 0; --t)
+        tasks.push(t);
+
+    if (parkedCount > 0)
+    {
+        std::lock_guard<std::mutex> g(parkLock);
+        parkCV.notify_all();
+    }
+
+    int t;
+    while (tasks.pop(t))
+        runTask(t);
+
+    int spins = 0;
+    while (remaining > 0)
+        spinPause(spins);
+}
+
+void WorkStealingPool::runTask(int t)
+{
+    job.load()(jobContext.load(), t);
+    remaining--;
+}
+
+void WorkStealingPool::loop()
+{
+    // Left to the scheduler, and so to whatever affinity the host gave the process
+    raiseToRealtimePriority();
+
+    int spins = 0;
+    auto lastJob = std::chrono::steady_clock::now();
+
+    while (keepRunning)
+    {
+        int t;
+        if (remaining > 0 && tasks.steal(t))
+        {
+            runTask(t);
+            lastJob = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        if (remaining > 0 || std::chrono::steady_clock::now() - lastJob <
+                                 std::chrono::microseconds(spinMicroseconds))
+        {
+            spinPause(spins);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> g(parkLock);
+        parkedCount++;
+        parkCV.wait(g, [this]() { return !keepRunning || remaining > 0; });
+        parkedCount--;
+        lastJob = std::chrono::steady_clock::now();
+    }
+}
+} // namespace Threading
+} // namespace Surge
@@ -0,0 +1,190 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_REALTIMETHREADS_H
+#define SURGE_XT_REALTIMETHREADS_H
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Surge
+{
+namespace Threading
+{
+/*
+ * Ask the OS to run the calling thread at a (low) real-time priority. This usually needs
+ * privileges we don't have, in which case the thread just stays a normal thread.
+ */
+void raiseToRealtimePriority();
+
+/*
+ * A persistent helper thread which runs one fixed job each time the audio thread asks for it.
+ *
+ * Between jobs the worker spins for a short while, since the next block is usually less than
+ * a millisecond away, and only parks on a condition variable once the audio thread has been
+ * quiet for longer than that. So while audio is running, start() and wait() are a couple of
+ * atomic operations and never lock or allocate; the lock is only taken to wake a parked
+ * worker after a pause.
+ *
+ * start() and wait() must be called from the one thread which owns the worker, in pairs.
+ */
+class RealtimeWorker
+{
+  public:
+    explicit RealtimeWorker(std::function<void()> job);
+    ~RealtimeWorker();
+
+    RealtimeWorker(const RealtimeWorker &) = delete;
+    RealtimeWorker &operator=(const RealtimeWorker &) = delete;
+
+    void start();
+    void wait();
+
+    // how long to keep spinning after a job before parking
+    static constexpr int spinMicroseconds = 2000;
+
+  private:
+    void loop();
+
+    std::function<void()> job;
+
+    std::atomic<uint32_t> posted{0}, finished{0};
+    std::atomic<bool> parked{false}, keepRunning{true};
+    std::mutex parkLock;
+    std::condition_variable parkCV;
+
+    std::thread thread;
+};
+
+/*
+ * A fixed capacity Chase-Lev deque of task indices. The owner pushes and pops at the bottom,
+ * thieves take from the top. Indices only grow, so there is no reset between runs.
+ */
+template <int capacity> struct WorkStealingDeque
+{
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    void push(int t)
+    {
+        auto b = bottom.load(std::memory_order_relaxed);
+        assert(b - top.load(std::memory_order_relaxed) < capacity);
+        tasks[b & (capacity - 1)].store(t, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    bool pop(int &t)
+    {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto tp = top.load(std::memory_order_relaxed);
+
+        if (tp > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        t = tasks[b & (capacity - 1)].load(std::memory_order_relaxed);
+        if (tp == b)
+        {
+            // the last task; race any thief for it
+            bool won = top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(int &t)
+    {
+        auto tp = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+
+        if (tp >= b)
+            return false;
+
+        t = tasks[tp & (capacity - 1)].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed);
+    }
+
+    std::atomic<int64_t> top{0}, bottom{0};
+    std::array<std::atomic<int>, capacity> tasks;
+};
+
+/*
+ * A small pool of real-time threads which, together with the calling thread, run a
+ * batch of independent tasks and return once all of them are done.
+ *
+ * run() pushes the batch onto the caller's own deque and then works through it from the
+ * bottom while the workers steal from the top, so nobody waits on a lock and a slow task
+ * (a voice with a heavy oscillator, say) just means the others steal more. Workers spin,
+ * then park, between batches just like RealtimeWorker, so a steady stream of batches costs
+ * no locks or allocation. Only one thread may call run() at a time.
+ */
+class WorkStealingPool
+{
+  public:
+    // threads counts the caller, so a pool of 1 runs everything inline
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int size() const { return (int)threads.size() + 1; }
+
+    static constexpr int maxTasks = 64;
+
+    template <typename F> void run(int nTasks, F &f)
+    {
+        runImpl(
+            nTasks, [](void *ctx, int t) { (*(F *)ctx)(t); }, (void *)&f);
+    }
+
+    static constexpr int spinMicroseconds = RealtimeWorker::spinMicroseconds;
+
+  private:
+    void runImpl(int nTasks, void (*fn)(void *, int), void *ctx);
+    void runTask(int t);
+    void loop();
+
+    WorkStealingDeque<maxTasks> tasks;
+    std::vector<std::thread> threads;
+
+    std::atomic<void (*)(void *, int)> job{nullptr};
+    std::atomic<void *> jobContext{nullptr};
+    std::atomic<int> remaining{0};
+
+    std::atomic<int> parkedCount{0};
+    std::atomic<bool> keepRunning{true};
+    std::mutex parkLock;
+    std::condition_variable parkCV;
+};
+} // namespace Threading
+} // namespace Surge
+
+#endif // SURGE_XT_REALTIMETHREADS_H
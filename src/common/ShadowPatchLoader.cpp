@@ -0,0 +1,231 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "ShadowPatchLoader.h"
+#include "SurgeSynthesizer.h"
+#include "EffectLoader.h"
+
+#include <cstdlib>
+
+namespace Surge
+{
+namespace Storage
+{
+ShadowPatchLoader::ShadowPatchLoader(SurgeSynthesizer *s) : synth(s), storage(&s->storage)
+{
+    worker = std::thread([this]() { this->workerLoop(); });
+}
+
+ShadowPatchLoader::~ShadowPatchLoader()
+{
+    keepRunning = false;
+    workerCV.notify_all();
+    worker.join();
+}
+
+void ShadowPatchLoader::poke()
+{
+    int expected = IDLE;
+    if (state.compare_exchange_strong(expected, REQUESTED))
+    {
+        requestedAt = std::chrono::high_resolution_clock::now();
+        workerCV.notify_one();
+    }
+}
+
+bool ShadowPatchLoader::isReady()
+{
+    if (state != READY)
+        return false;
+
+    if (builtGeneration != generation)
+    {
+        // built before something else replaced the patch; just tidy it away
+        state = COMMITTED;
+        workerCV.notify_one();
+        return false;
+    }
+
+    return true;
+}
+
+void ShadowPatchLoader::committed()
+{
+    auto latency = std::chrono::duration<float, std::milli>(
+                       std::chrono::high_resolution_clock::now() - requestedAt)
+                       .count();
+    lastSwitchLatencyMS = latency;
+    if (latency > maxSwitchLatencyMS)
+        maxSwitchLatencyMS = latency;
+    switchesCompleted++;
+
+    state = COMMITTED;
+    workerCV.notify_one();
+}
+
+void ShadowPatchLoader::discardPendingLoads() { generation++; }
+
+void ShadowPatchLoader::requestOscillatorBlocks()
+{
+    blocksRequested++;
+    workerCV.notify_one();
+}
+
+void ShadowPatchLoader::waitForPendingLoads()
+{
+    while (state == REQUESTED || state == BUILDING || state == COMMITTED)
+    {
+        std::unique_lock<std::mutex> g(workerLock);
+        workerCV.wait_for(g, std::chrono::milliseconds(5));
+    }
+}
+
+bool ShadowPatchLoader::build()
+{
+    // a DAW state restore takes precedence over a patch picked from the browser
+    void *state = nullptr;
+    int stateSize = 0;
+    std::string path, name;
+    int cat = -1, id = -1;
+    restoringState = synth->takeEnqueuedState(state, stateSize);
+    if (!restoringState &&
+        !(synth->getGaplessPatchSwitching() && synth->takeQueuedPatch(path, cat, name, id)))
+        return false;
+
+    builtGeneration = generation;
+
+    // the shadow is only ever needed once something loads through here
+    if (!shadowPatch)
+    {
+        shadowPatch = std::make_unique<SurgePatch>(storage);
+        shadowPatch->deferStorageSettings = true;
+    }
+    auto &sp = *shadowPatch;
+
+    if (restoringState)
+    {
+        // this is loadRaw with preset = false; the state carries its own name and category
+        sp.init_default_values();
+        sp.load_patch(state, stateSize, false);
+        free(state);
+
+        id = -1;
+        cat = synth->current_category_id;
+        storage->ensurePatchListLoaded();
+        for (int p = 0; p < storage->patch_list.size(); ++p)
+        {
+            if (storage->patch_list[p].name == sp.name &&
+                storage->patch_category[storage->patch_list[p].category].name == sp.category)
+            {
+                id = p;
+                cat = storage->patch_list[p].category;
+                break;
+            }
+        }
+    }
+    else
+    {
+        std::unique_ptr<char[]> data;
+        int size = 0;
+        if (!synth->readPatchFile(path.c_str(), name.c_str(), data, size))
+            return false;
+
+        /*
+         * This is loadPatchByPath and loadRaw, up to where they touch the engine; what the XML
+         * says about the storage itself (hardclip modes, the tuning application mode) waits in
+         * the shadow for the commit. A preset keeps the volume and FX bypass already playing, so
+         * start from those.
+         */
+        auto &live = storage->getPatch();
+        sp.init_default_values();
+        sp.volume.val = live.volume.val;
+        sp.fx_bypass.val = live.fx_bypass.val;
+        sp.comment = "";
+        sp.author = "";
+        if (cat >= 0)
+            sp.category = storage->patch_category[cat].name;
+        else
+            sp.category = "Drag & Drop";
+        sp.name = name;
+
+        sp.load_patch(data.get(), size, true);
+    }
+
+    sp.update_controls(false, nullptr, true);
+
+    /*
+     * What applyTuningFromPatch or loadFromDawExtraState would do, for the tuning application
+     * mode the patch brings. A user tuning the editor sets in the meantime is overwritten by the
+     * commit, as it would be by a synchronous load a moment later.
+     */
+    storage->captureTuning(tuning);
+    tuning.mode = (SurgeStorage::TuningApplicationMode)sp.storageSettings.tuningApplicationMode;
+    if (restoringState)
+        storage->prepareTuningFromDawExtraState(sp, tuning);
+    else
+        storage->prepareTuningFromPatch(sp, tuning);
+    storage->buildTuning(tuning);
+
+    storage->reserveOscillatorBlocks(sp);
+
+    for (int s = 0; s < n_fx_slots; s++)
+    {
+        effects[s].reset(Surge::FX::EffectLoader::buildEffect(storage, sp.fx[s], effectData[s],
+                                                              false));
+        if (effects[s])
+            effects[s]->updateAfterReload();
+    }
+
+    patchid = id;
+    categoryId = cat;
+    return true;
+}
+
+void ShadowPatchLoader::workerLoop()
+{
+    while (keepRunning)
+    {
+        int expected = REQUESTED;
+        if (state.compare_exchange_strong(expected, BUILDING))
+        {
+            state = build() ? READY : IDLE;
+            workerCV.notify_all();
+        }
+
+        if (state == COMMITTED)
+        {
+            // the shadow now holds the old patch. Effects left here are from a discarded build.
+            for (auto &e : effects)
+                e.reset();
+            state = IDLE;
+            workerCV.notify_all();
+        }
+
+        auto requested = blocksRequested.load();
+        if (requested != blocksReserved)
+        {
+            storage->reserveOscillatorBlocks();
+            blocksReserved = requested;
+        }
+
+        std::unique_lock<std::mutex> g(workerLock);
+        workerCV.wait_for(g, std::chrono::milliseconds(50), [this]() {
+            return !keepRunning || state == REQUESTED || state == COMMITTED ||
+                   blocksRequested != blocksReserved;
+        });
+    }
+}
+} // namespace Storage
+} // namespace Surge
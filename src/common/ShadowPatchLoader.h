@@ -0,0 +1,126 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_SHADOWPATCHLOADER_H
+#define SURGE_XT_SHADOWPATCHLOADER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "SurgeStorage.h"
+#include "Effect.h"
+
+class SurgeSynthesizer;
+
+namespace Surge
+{
+namespace Storage
+{
+/*
+ * Builds the next patch while the current one keeps playing. It serves both DAW state restores
+ * (SurgeSynthesizer::enqueuePatchForLoad) and, when it is switched on, gapless patch switching
+ * (see SurgeSynthesizer::setGaplessPatchSwitching).
+ *
+ * When the audio thread sees an enqueued state or a queued patch it pokes the loader. The
+ * loader's thread takes the request, reads the file if there is one and loads it into a shadow
+ * SurgePatch of its own: the XML, the embedded wavetables, the oscillator and FX control types.
+ * It also builds the new patch's effects and reserves oscillator memory for it. Then it marks
+ * itself ready, and SurgeSynthesizer::commitShadowPatch adopts the shadow into the live patch
+ * between two blocks, along with the DAW extra state of a restore. The tuning the patch or the
+ * session brings is parsed and its tables built here too, asking about replacing a user tuning
+ * if need be, so the commit only swaps it in. The shadow comes back holding the old patch's data,
+ * and the loader tidies up after the commit on its own thread.
+ */
+struct ShadowPatchLoader
+{
+    explicit ShadowPatchLoader(SurgeSynthesizer *synth);
+    ~ShadowPatchLoader();
+
+    ShadowPatchLoader(const ShadowPatchLoader &) = delete;
+    ShadowPatchLoader &operator=(const ShadowPatchLoader &) = delete;
+
+    // Audio thread: a state or patch is queued; start on it if we aren't busy with another one
+    void poke();
+
+    // Audio thread: a patch is built and waiting to be committed
+    bool isReady();
+
+    // Audio thread, from commitShadowPatch: hand the shadow back once it has been adopted
+    void committed();
+
+    // Forget a patch built or being built, because something else replaced the patch
+    void discardPendingLoads();
+
+    // Block until the loader has nothing in flight; for tests and the headless harness
+    void waitForPendingLoads();
+
+    /*
+     * Any thread: the live patch's oscillator types or poly limit changed, so reserve oscillator
+     * pool blocks for it on the loader's thread. oscillatorBlocksReserved() turns true again
+     * once that has run; the synth holds a queued large oscillator type back until then.
+     */
+    void requestOscillatorBlocks();
+    bool oscillatorBlocksReserved() const { return blocksReserved == blocksRequested; }
+
+    // What commitShadowPatch takes over. Only touch these while isReady().
+    SurgePatch &shadow() { return *shadowPatch; }
+    std::array<std::unique_ptr<Effect>, n_fx_slots> effects;
+    SurgeStorage::PreparedTuning tuning;
+    int patchid = -1, categoryId = -1;
+    bool isRestoringState() const { return restoringState; }
+
+    // From the audio thread first seeing the queued state or patch to the commit, in milliseconds
+    std::atomic<float> lastSwitchLatencyMS{0.f}, maxSwitchLatencyMS{0.f};
+    std::atomic<int> switchesCompleted{0};
+
+  private:
+    enum State
+    {
+        IDLE,
+        REQUESTED,
+        BUILDING,
+        READY,
+        COMMITTED
+    };
+
+    bool build();
+    void workerLoop();
+
+    SurgeSynthesizer *synth;
+    SurgeStorage *storage;
+    std::unique_ptr<SurgePatch> shadowPatch;
+    pdata effectData[n_fx_slots][n_global_params];
+
+    std::atomic<int> state{IDLE};
+    int builtGeneration = 0;
+    bool restoringState = false;
+    std::atomic<int> generation{0};
+    std::atomic<int> blocksRequested{0}, blocksReserved{0};
+    std::chrono::high_resolution_clock::time_point requestedAt;
+
+    std::thread worker;
+    std::mutex workerLock;
+    std::condition_variable workerCV;
+    std::atomic<bool> keepRunning{true};
+};
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_XT_SHADOWPATCHLOADER_H
@@ -0,0 +1,140 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_SURGEMEMORYPOOLS_H
+#define SURGE_XT_SURGEMEMORYPOOLS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "globals.h"
+
+namespace Surge
+{
+namespace Memory
+{
+/*
+ * A fixed capacity pool of equally sized, 16 byte aligned memory blocks. Blocks are created
+ * with reserve() off the audio thread and handed out and taken back with getBlock() and
+ * returnBlock() on the audio thread without locking or allocating. If the pool runs dry
+ * getBlock() returns nullptr, and the caller has to cope without one; we count that so tests
+ * and debug builds can tell the reservation was too small.
+ *
+ * A free block lives in one of the slots; a null slot is either empty or lent out. Since
+ * blocks are never freed until the pool goes away, the scan-and-exchange is safe against
+ * concurrent reserve() calls.
+ */
+template <size_t capacity> struct BlockPool
+{
+    explicit BlockPool(size_t blockSize) : blockSize(blockSize)
+    {
+        for (auto &s : slots)
+            s = nullptr;
+        for (auto &a : allocated)
+            a = nullptr;
+    }
+
+    ~BlockPool()
+    {
+        auto n = std::min(created.load(), capacity);
+        for (size_t i = 0; i < n; ++i)
+            delete[] allocated[i];
+    }
+
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    unsigned char *getBlock()
+    {
+        for (auto &s : slots)
+        {
+            auto b = s.exchange(nullptr);
+            if (b)
+                return b;
+        }
+        exhaustedRequests++;
+        return nullptr;
+    }
+
+    void returnBlock(unsigned char *b)
+    {
+        if (!b)
+            return;
+
+        for (auto &s : slots)
+        {
+            unsigned char *expected = nullptr;
+            if (s.compare_exchange_strong(expected, b))
+                return;
+        }
+    }
+
+    /*
+     * Make sure at least n blocks exist. Never call this from the audio thread.
+     */
+    void reserve(size_t n)
+    {
+        n = std::min(n, capacity);
+        while (created.load() < n)
+        {
+            auto b = createBlock();
+            if (!b)
+                break;
+            returnBlock(b);
+        }
+    }
+
+    size_t blocksCreated() const { return created.load(); }
+
+    const size_t blockSize;
+    std::atomic<size_t> exhaustedRequests{0};
+
+  private:
+    unsigned char *createBlock()
+    {
+        auto idx = created.fetch_add(1);
+        if (idx >= capacity)
+        {
+            created--;
+            return nullptr;
+        }
+
+        // new[] only promises 8 byte alignment on some 32 bit targets, so over-allocate and
+        // align by hand. The raw pointer is what we delete.
+        auto raw = new unsigned char[blockSize + 16];
+        allocated[idx] = raw;
+        auto aligned = (unsigned char *)(((uintptr_t)raw + 15) & ~(uintptr_t)15);
+        return aligned;
+    }
+
+    std::array<std::atomic<unsigned char *>, capacity> slots;
+    std::array<unsigned char *, capacity> allocated;
+    std::atomic<size_t> created{0};
+};
+
+/*
+ * Oscillators which are too large for the per-voice buffer (see oscillator_buffer_size) borrow
+ * one of these. At most every oscillator of every voice in both scenes can be large.
+ */
+static constexpr size_t max_large_oscillators = 2 * MAX_VOICES * 3;
+typedef BlockPool<max_large_oscillators> OscillatorBlockPool;
+
+} // namespace Memory
+} // namespace Surge
+
+#endif // SURGE_XT_SURGEMEMORYPOOLS_H
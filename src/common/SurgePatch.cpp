@@ -25,6 +25,7 @@
 #include "StringOps.h"
 #include "SkinModel.h"
 #include "UserDefaults.h"
+#include "WavetableLoader.h"
 #include "version.h"
 
 using namespace std;
@@ -33,6 +34,7 @@ SurgePatch::SurgePatch(SurgeStorage *storage)
 {
     this->storage = storage;
     patchptr = nullptr;
+    markAllParametersDirty();
 
     ParameterIDCounter p_id;
     {
@@ -622,16 +624,16 @@ void SurgePatch::init_default_values()
              * wavetable load is pointless. So unless there's no wavetable at
              * all ever loaded, keep what's there.
              *
-             * We need to do something if there's nothing otherwise swapping
-             * to the wavetable oscilltor will core you out
+             * We need to do something if there's nothing, otherwise the
+             * wavetable oscillators stay silent until one is loaded
              */
+            osc.wt.queue_id = -1;
+            osc.wt.queue_from_list = false;
+            osc.wt.queue_filename[0] = 0;
             if (!osc.wt.everBuilt)
             {
-                osc.wt.queue_id = 0;
+                storage->queue_wt(&osc.wt, 0);
             }
-            else
-                osc.wt.queue_id = -1;
-            osc.wt.queue_filename[0] = 0;
         }
         scene[sc].fm_depth.val.f = -24.f;
         scene[sc].portamento.val.f = scene[sc].portamento.val_min.f;
@@ -756,6 +758,79 @@ void SurgePatch::copy_globaldata(pdata *d)
 }
 // pdata scenedata[n_scenes][n_scene_params];
 
+void SurgePatch::markAllParametersDirty()
+{
+    for (auto &w : dirtyParams)
+        w.store(~0ull, std::memory_order_release);
+}
+
+bool SurgePatch::sync_param(int id, int sceneMask)
+{
+    auto v = param_ptr[id]->val.i;
+
+    if (id < n_global_params)
+    {
+        auto changed = globaldata[id].i != v;
+        globaldata[id].i = v;
+        return changed;
+    }
+
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        auto i = id - scene_start[sc];
+        if (i >= 0 && i < n_scene_params)
+        {
+            if (!(sceneMask & (1 << sc)))
+                return false;
+
+            auto changed = scenedata[sc][i].i != v;
+            scenedata[sc][i].i = v;
+            return changed;
+        }
+    }
+    return false;
+}
+
+void SurgePatch::sync_paramdata(int sceneMask)
+{
+    for (int w = 0; w < (int)dirtyParams.size(); w++)
+    {
+        if (!dirtyParams[w].load(std::memory_order_relaxed))
+            continue;
+
+        // take the marks first, so a mark made while we copy survives to the next block
+        auto bits = dirtyParams[w].exchange(0, std::memory_order_acquire);
+        uint64_t silent = 0;
+
+        for (int bit = 0; bit < 64; bit++)
+        {
+            int id = (w << 6) + bit;
+            if (!(bits & (1ull << bit)) || id >= n_total_params)
+                continue;
+
+            // leave a silent scene's marks for when it plays again
+            for (int sc = 0; sc < n_scenes; sc++)
+                if (!(sceneMask & (1 << sc)) && id >= scene_start[sc] &&
+                    id < scene_start[sc] + n_scene_params)
+                    silent |= 1ull << bit;
+
+            if (!(silent & (1ull << bit)))
+                sync_param(id, sceneMask);
+        }
+
+        if (silent)
+            dirtyParams[w].fetch_or(silent, std::memory_order_relaxed);
+    }
+
+    // Everything marked is in place now, so a difference here is a write nobody marked
+    for (int i = 0; i < paramResyncPerBlock; i++)
+    {
+        if (sync_param(paramResyncCursor, sceneMask))
+            unmarkedParameterWrites.fetch_add(1, std::memory_order_relaxed);
+        paramResyncCursor = (paramResyncCursor + 1) % n_total_params;
+    }
+}
+
 void SurgePatch::update_controls(
     bool init,
     void *init_osc,     // init_osc is the pointer to the data structure of a particular osc to init
@@ -801,6 +876,100 @@ void SurgePatch::update_controls(
             }
         }
     }
+
+    // init_default_values and the streaming fixups above write val directly
+    markAllParametersDirty();
+}
+
+/*
+ * Parameters can point at objects inside the patch which owns them (the filter selector mapper,
+ * an oscillator's storage as the wavetable counted set). A copied pointer into from is moved to
+ * the same object in to; anything else (the static handlers, the storage) is kept.
+ */
+template <typename T> static T *rebasePointer(T *p, const SurgePatch &from, SurgePatch &to)
+{
+    auto c = (const char *)p;
+    auto b = (const char *)&from;
+    if (c < b || c >= b + sizeof(SurgePatch))
+        return p;
+    return (T *)((char *)&to + (c - b));
+}
+
+void SurgePatch::adoptFrom(SurgePatch &other)
+{
+    assert(param_ptr.size() == other.param_ptr.size());
+
+    for (int i = 0; i < param_ptr.size(); i++)
+    {
+        auto *p = param_ptr[i];
+        *p = *other.param_ptr[i];
+        p->user_data = rebasePointer(p->user_data, other, *this);
+        p->dynamicName = rebasePointer(p->dynamicName, other, *this);
+        p->dynamicDeactivation = rebasePointer(p->dynamicDeactivation, other, *this);
+        p->dynamicBipolar = rebasePointer(p->dynamicBipolar, other, *this);
+    }
+
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        auto &to = scene[sc], &from = other.scene[sc];
+
+        for (int o = 0; o < n_oscs; o++)
+        {
+            auto &ot = to.osc[o], &of = from.osc[o];
+
+            ot.wt.SwapData(&of.wt);
+            ot.wt.current_id = of.wt.current_id;
+            ot.wt.queue_id = of.wt.queue_id;
+            ot.wt.queue_from_list = of.wt.queue_from_list;
+            strxcpy(ot.wt.queue_filename, of.wt.queue_filename, sizeof(ot.wt.queue_filename));
+            ot.wt.refresh_display = true;
+            strxcpy(ot.wavetable_display_name, of.wavetable_display_name,
+                    WAVETABLE_DISPLAY_NAME_SIZE);
+            std::swap(ot.wavetable_formula, of.wavetable_formula);
+            ot.wavetable_formula_res_base = of.wavetable_formula_res_base;
+            ot.wavetable_formula_nframes = of.wavetable_formula_nframes;
+            ot.extraConfig = of.extraConfig;
+        }
+
+        std::swap(to.modulation_scene, from.modulation_scene);
+        std::swap(to.modulation_voice, from.modulation_voice);
+        to.monoVoicePriorityMode = from.monoVoicePriorityMode;
+
+        for (int l = 0; l < n_lfos; l++)
+        {
+            stepsequences[sc][l] = other.stepsequences[sc][l];
+            std::swap(msegs[sc][l], other.msegs[sc][l]);
+            std::swap(formulamods[sc][l], other.formulamods[sc][l]);
+        }
+    }
+
+    std::swap(modulation_global, other.modulation_global);
+
+    std::swap(patchTuning, other.patchTuning);
+    std::swap(dawExtraState, other.dawExtraState);
+    std::swap(name, other.name);
+    std::swap(category, other.category);
+    std::swap(author, other.author);
+    std::swap(comment, other.comment);
+    memcpy(CustomControllerLabel, other.CustomControllerLabel, sizeof(CustomControllerLabel));
+
+    streamingRevision = other.streamingRevision;
+    currentSynthStreamingRevision = other.currentSynthStreamingRevision;
+    correctlyTuneCombFilter = other.correctlyTuneCombFilter;
+    storageSettings = other.storageSettings;
+
+    markAllParametersDirty();
+}
+
+void SurgePatch::applyStorageSettings(bool withTuningMode)
+{
+    auto &ss = storageSettings;
+    if (withTuningMode)
+        storage->setTuningApplicationMode(
+            (SurgeStorage::TuningApplicationMode)ss.tuningApplicationMode);
+    storage->hardclipMode = (SurgeStorage::HardClipMode)ss.hardclipMode;
+    for (int sc = 0; sc < n_scenes; ++sc)
+        storage->sceneHardclipMode[sc] = (SurgeStorage::HardClipMode)ss.sceneHardclipMode[sc];
 }
 
 void SurgePatch::do_morph()
@@ -988,20 +1157,60 @@ unsigned int SurgePatch::save_patch(void **data)
     memcpy(header.tag, "sub3", 4);
     size_t xmlsize = save_xml(&xmldata);
     header.xmlsize = vt_write_int32LE(xmlsize);
+
+    /*
+     * An oscillator whose first table is still on its way from the loader saves the table it
+     * is about to get: the loader's finished build, or the queued file read here when the audio
+     * thread hasn't posted it yet. The data lock keeps a finished build from being applied
+     * (or the table from changing) while we copy it out.
+     */
+    std::unique_ptr<Wavetable> readHere[n_scenes][n_oscs];
+    bool isLivePatch = storage->wavetableLoader && this == &storage->getPatch();
+    if (isLivePatch)
+        storage->wavetableLoader->waitForPendingLoads();
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        for (int osc = 0; osc < n_oscs; osc++)
+        {
+            auto &wt = scene[sc].osc[osc].wt;
+            if (uses_wavetabledata(scene[sc].osc[osc].type.val.i) && !wt.everBuilt &&
+                wt.queue_filename[0])
+            {
+                std::string fn = wt.queue_filename;
+                readHere[sc][osc] = std::make_unique<Wavetable>();
+                if (!storage->load_wt(fn, readHere[sc][osc].get(), nullptr))
+                    readHere[sc][osc].reset();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> wtLock(storage->waveTableDataMutex);
+    const Wavetable *tables[n_scenes][n_oscs];
     wt_header wth[n_scenes][n_oscs];
     for (int sc = 0; sc < n_scenes; sc++)
     {
         for (int osc = 0; osc < n_oscs; osc++)
         {
-            if (uses_wavetabledata(scene[sc].osc[osc].type.val.i))
+            auto &wt = scene[sc].osc[osc].wt;
+            tables[sc][osc] = &wt;
+            if (!wt.everBuilt)
             {
+                tables[sc][osc] = nullptr;
+                if (readHere[sc][osc])
+                    tables[sc][osc] = readHere[sc][osc].get();
+                else if (isLivePatch)
+                    tables[sc][osc] = storage->wavetableLoader->finishedLoad(sc, osc);
+            }
+
+            if (uses_wavetabledata(scene[sc].osc[osc].type.val.i) && tables[sc][osc])
+            {
+                auto t = tables[sc][osc];
                 memset(wth[sc][osc].tag, 0, 4);
-                wth[sc][osc].n_samples = scene[sc].osc[osc].wt.size;
-                wth[sc][osc].n_tables = scene[sc].osc[osc].wt.n_tables;
-                wth[sc][osc].flags = scene[sc].osc[osc].wt.flags | wtf_int16;
+                wth[sc][osc].n_samples = t->size;
+                wth[sc][osc].n_tables = t->n_tables;
+                wth[sc][osc].flags = t->flags | wtf_int16;
                 unsigned int wtsize =
-                    wth[sc][osc].n_samples * scene[sc].osc[osc].wt.n_tables * sizeof(short) +
-                    sizeof(wt_header);
+                    wth[sc][osc].n_samples * t->n_tables * sizeof(short) + sizeof(wt_header);
                 header.wtsize[sc][osc] = vt_write_int32LE(wtsize);
                 psize += wtsize;
             }
@@ -1041,9 +1250,9 @@ unsigned int SurgePatch::save_patch(void **data)
 
                 for (int j = 0; j < n_tables; j++)
                 {
-                    vt_copyblock_W_LE(
-                        &fp[j * n_samples],
-                        &scene[sc].osc[osc].wt.TableI16WeakPointers[0][j][FIRoffsetI16], n_samples);
+                    vt_copyblock_W_LE(&fp[j * n_samples],
+                                      &tables[sc][osc]->TableI16WeakPointers[0][j][FIRoffsetI16],
+                                      n_samples);
                 }
                 dw += wtsize;
             }
@@ -1396,22 +1605,24 @@ void SurgePatch::load_xml(const void *data, int datasize, bool is_preset)
 
     TiXmlElement *nonparamconfig = TINYXML_SAFE_TO_ELEMENT(patch->FirstChild("nonparamconfig"));
 
+    auto &pss = storageSettings;
+
     // Set the default for TAM before 16
     if (revision <= 15)
     {
-        storage->setTuningApplicationMode(SurgeStorage::RETUNE_ALL);
+        pss.tuningApplicationMode = SurgeStorage::RETUNE_ALL;
     }
     else
     {
         // We shouldn't need this since all 16s will stream it, but just in case
-        storage->setTuningApplicationMode(SurgeStorage::RETUNE_MIDI_ONLY);
+        pss.tuningApplicationMode = SurgeStorage::RETUNE_MIDI_ONLY;
     }
 
     // Default hardclip value
-    storage->hardclipMode = SurgeStorage::HARDCLIP_TO_18DBFS;
+    pss.hardclipMode = SurgeStorage::HARDCLIP_TO_18DBFS;
     for (int sc = 0; sc < n_scenes; ++sc)
     {
-        storage->sceneHardclipMode[sc] = SurgeStorage::HARDCLIP_TO_18DBFS;
+        pss.sceneHardclipMode[sc] = SurgeStorage::HARDCLIP_TO_18DBFS;
     }
 
     if (nonparamconfig)
@@ -1420,15 +1631,14 @@ void SurgePatch::load_xml(const void *data, int datasize, bool is_preset)
         {
             std::string mvname = "monoVoicePrority_" + std::to_string(sc);
             auto *mv1 = TINYXML_SAFE_TO_ELEMENT(nonparamconfig->FirstChild(mvname.c_str()));
-            storage->getPatch().scene[sc].monoVoicePriorityMode = ALWAYS_LATEST;
+            scene[sc].monoVoicePriorityMode = ALWAYS_LATEST;
             if (mv1)
             {
                 // Get value
                 int mvv;
                 if (mv1->QueryIntAttribute("v", &mvv) == TIXML_SUCCESS)
                 {
-                    storage->getPatch().scene[sc].monoVoicePriorityMode =
-                        (MonoVoicePriorityMode)mvv;
+                    scene[sc].monoVoicePriorityMode = (MonoVoicePriorityMode)mvv;
                 }
             }
         }
@@ -1438,7 +1648,7 @@ void SurgePatch::load_xml(const void *data, int datasize, bool is_preset)
             int tv;
             if (tam->QueryIntAttribute("v", &tv) == TIXML_SUCCESS)
             {
-                storage->setTuningApplicationMode((SurgeStorage::TuningApplicationMode)(tv));
+                pss.tuningApplicationMode = tv;
             }
         }
         auto *hcs = TINYXML_SAFE_TO_ELEMENT(nonparamconfig->FirstChild("hardclipmodes"));
@@ -1447,19 +1657,22 @@ void SurgePatch::load_xml(const void *data, int datasize, bool is_preset)
             int tv;
             if (hcs->QueryIntAttribute("global", &tv) == TIXML_SUCCESS)
             {
-                storage->hardclipMode = (SurgeStorage::HardClipMode)tv;
+                pss.hardclipMode = tv;
             }
             for (int sc = 0; sc < n_scenes; ++sc)
             {
                 auto an = std::string("sc") + std::to_string(sc);
                 if (hcs->QueryIntAttribute(an.c_str(), &tv) == TIXML_SUCCESS)
                 {
-                    storage->sceneHardclipMode[sc] = (SurgeStorage::HardClipMode)tv;
+                    pss.sceneHardclipMode[sc] = tv;
                 }
             }
         }
     }
 
+    if (!deferStorageSettings)
+        applyStorageSettings();
+
     if (revision < 1)
     {
         for (int sc = 0; sc < n_scenes; sc++)
@@ -53,6 +53,15 @@
 #include "MSEGModulationHelper.h"
 // FIXME
 
+#include "Oscillator.h"
+#include "WavetableLoader.h"
+#include "WavetableCache.h"
+#include "WavetableMipmapCache.h"
+#include "ModulationRoutingTable.h"
+#include "ProcessProfiler.h"
+#include "FormulaModulationHelper.h"
+#include "StringOps.h"
+
 #if __cplusplus < 201703L
 constexpr float MSEGStorage::minimumDuration;
 #endif
@@ -97,6 +106,10 @@ std::string getDLLPath()
 }
 #endif
 
+#if STORAGE_USES_INDEPENDENT_RNG
+thread_local SurgeStorage::RNGGen *SurgeStorage::threadRngGen = nullptr;
+#endif
+
 SurgeStorage::SurgeStorage(std::string suppliedDataPath) : otherscene_clients(0)
 {
     if (samplerate == 0)
@@ -119,6 +132,19 @@ SurgeStorage::SurgeStorage(std::string suppliedDataPath) : otherscene_clients(0)
 
     _patch.reset(new SurgePatch(this));
 
+    oscillatorBlockPool =
+        std::make_unique<Surge::Memory::OscillatorBlockPool>(osc_pool_block_size());
+    wavetableLoader = std::make_unique<Surge::Storage::WavetableLoader>(this);
+    modRoutingTable = std::make_unique<Surge::Storage::ModulationRoutingTable>();
+    processProfiler = std::make_unique<Surge::Profiling::ProcessProfiler>();
+    formulaEvaluator = std::make_unique<Surge::Formula::EvaluatorSupport>();
+
+#if STORAGE_USES_INDEPENDENT_RNG
+    // the scene generators were all clock seeded at about the same instant; spread them out
+    for (auto &sr : sceneRngGen)
+        sr.g.seed(rngGen.u32(rngGen.g));
+#endif
+
     float cutoff = 0.455f;
     float cutoff1X = 0.85f;
     float cutoffI16 = 1.0f;
@@ -469,6 +495,16 @@ bailOnPortable:
 
     userMidiMappingsPath = Surge::Storage::appendDirectory(userDataPath, "MIDIMappings");
 
+    if (Surge::Storage::getUserDefaultValue(this, Surge::Storage::CacheWavetableMipmaps, 1))
+    {
+        userWavetableCachePath = Surge::Storage::appendDirectory(userDataPath, "WavetableCache");
+        userWavetableCacheMaxBytes =
+            (uint64_t)Surge::Storage::getUserDefaultValue(
+                this, Surge::Storage::WavetableMipmapCacheMaxMB,
+                Surge::Storage::WavetableMipmapCache::defaultMaxMegabytes) *
+            1024 * 1024;
+    }
+
     /*
     const auto snapshotmenupath{string_to_path(datapath + "configuration.xml")};
 
@@ -501,12 +537,26 @@ bailOnPortable:
     if (loadWtAndPatch)
     {
         refresh_wtlist();
-        refresh_patchlist();
+
+        // Nothing in here needs the patches, so only wait for them once someone asks
+        patchListReady = false;
+        auto scan = libraryScan(patchLibraryRoots());
+        pendingPatchScan = std::async(std::launch::async, [this, scan]() {
+            auto tree = scan();
+            patchScanFinished.store(true, std::memory_order_release);
+            return tree;
+        });
     }
 #endif
 
+    /*
+     * Give every oscillator the first table now, off the audio thread; after the first they all
+     * share the one built copy. Then a patch only waits on the loader for tables it changes.
+     */
     getPatch().scene[0].osc[0].wt.dt = 1.0f / 512.f;
-    load_wt(0, &getPatch().scene[0].osc[0].wt, &getPatch().scene[0].osc[0]);
+    for (auto &sc : getPatch().scene)
+        for (auto &osc : sc.osc)
+            load_wt(0, &osc.wt, &osc);
 
     // WindowWT is a WaveTable which now has a constructor so don't do this
     // memset(&WindowWT, 0, sizeof(WindowWT));
@@ -648,6 +698,10 @@ bailOnPortable:
 
 void SurgeStorage::initializePatchDb()
 {
+    if (patchDB)
+        return;
+
+    ensurePatchListLoaded();
     patchDB = std::make_unique<Surge::PatchStorage::PatchDB>(this);
     for (auto p : patch_list)
     {
@@ -657,22 +711,110 @@ void SurgeStorage::initializePatchDb()
 
 SurgePatch &SurgeStorage::getPatch() { return *_patch.get(); }
 
+void SurgeStorage::reserveOscillatorBlocks() { reserveOscillatorBlocks(getPatch()); }
+
+void SurgeStorage::reserveOscillatorBlocks(const SurgePatch &patch)
+{
+    /*
+     * A large oscillator slot can be live in every voice of its scene up to the poly limit,
+     * plus the handful of voices past the limit which are still being released.
+     */
+    size_t perSlot = std::min(MAX_VOICES, patch.polylimit.val.i + 4);
+    size_t n = 0;
+
+    for (int s = 0; s < n_scenes; ++s)
+    {
+        for (int o = 0; o < n_oscs; ++o)
+        {
+            auto &osc = patch.scene[s].osc[o];
+            if (osc_needs_pool_block(osc.type.val.i) ||
+                (osc.queue_type >= 0 && osc_needs_pool_block(osc.queue_type)))
+            {
+                n += perSlot;
+            }
+        }
+    }
+
+    oscillatorBlockPool->reserve(n);
+}
+
 struct PEComparer
 {
     bool operator()(const Patch &a, const Patch &b) { return a.name.compare(b.name) < 0; }
 };
 
+std::string SurgeStorage::libraryRoot(bool userDir, const std::string &subdir) const
+{
+    fs::path res = string_to_path(userDir ? userDataPath : datapath);
+    if (!subdir.empty())
+        res /= string_to_path(subdir);
+    return path_to_string(res);
+}
+
+std::vector<std::string> SurgeStorage::patchLibraryRoots() const
+{
+    return {libraryRoot(false, "patches_factory"), libraryRoot(false, "patches_3rdparty"),
+            libraryRoot(true, "")};
+}
+
+std::vector<std::string> SurgeStorage::wavetableLibraryRoots() const
+{
+    return {libraryRoot(false, "wavetables"), libraryRoot(false, "wavetables_3rdparty"),
+            libraryRoot(true, "")};
+}
+
+std::string SurgeStorage::libraryManifestPath() const
+{
+    return path_to_string(string_to_path(userDataPath) / "SurgeLibrary.manifest");
+}
+
+std::function<Surge::Storage::LibraryScanner::Tree()>
+SurgeStorage::libraryScan(const std::vector<std::string> &roots) const
+{
+    auto manifest = libraryManifestPath();
+    std::vector<std::string> skip = {userWavetableCachePath};
+    return [roots, manifest, skip]() {
+        return Surge::Storage::LibraryScanner::scan(roots, manifest, skip);
+    };
+}
+
 void SurgeStorage::refresh_patchlist()
+{
+    std::lock_guard<std::mutex> g(patchListMutex);
+
+    // whatever the constructor's scan would have found, this one is newer
+    if (pendingPatchScan.valid())
+        pendingPatchScan.wait();
+    pendingPatchScan = {};
+
+    buildPatchList(libraryScan(patchLibraryRoots())());
+    patchListReady.store(true, std::memory_order_release);
+}
+
+void SurgeStorage::ensurePatchListLoaded()
+{
+    if (isPatchListReady())
+        return;
+
+    std::lock_guard<std::mutex> g(patchListMutex);
+    if (isPatchListReady())
+        return;
+
+    buildPatchList(pendingPatchScan.get());
+    patchListReady.store(true, std::memory_order_release);
+}
+
+void SurgeStorage::buildPatchList(const Surge::Storage::LibraryScanner::Tree &tree)
 {
     patch_category.clear();
     patch_list.clear();
 
-    refreshPatchlistAddDir(false, "patches_factory");
+    refreshPatchlistAddDir(tree, false, "patches_factory");
     firstThirdPartyCategory = patch_category.size();
 
-    refreshPatchlistAddDir(false, "patches_3rdparty");
+    refreshPatchlistAddDir(tree, false, "patches_3rdparty");
     firstUserCategory = patch_category.size();
-    refreshPatchlistAddDir(true, "");
+    refreshPatchlistAddDir(tree, true, "");
 
     patchOrdering = std::vector<int>(patch_list.size());
     std::iota(patchOrdering.begin(), patchOrdering.end(), 0);
@@ -709,14 +851,17 @@ void SurgeStorage::refresh_patchlist()
     }
 }
 
-void SurgeStorage::refreshPatchlistAddDir(bool userDir, string subdir)
+void SurgeStorage::refreshPatchlistAddDir(const Surge::Storage::LibraryScanner::Tree &tree,
+                                          bool userDir, string subdir)
 {
     refreshPatchOrWTListAddDir(
-        userDir, subdir, [](std::string s) -> bool { return _stricmp(s.c_str(), ".fxp") == 0; },
-        patch_list, patch_category);
+        tree, userDir, subdir,
+        [](std::string s) -> bool { return _stricmp(s.c_str(), ".fxp") == 0; }, patch_list,
+        patch_category);
 }
 
-void SurgeStorage::refreshPatchOrWTListAddDir(bool userDir, string subdir,
+void SurgeStorage::refreshPatchOrWTListAddDir(const Surge::Storage::LibraryScanner::Tree &tree,
+                                              bool userDir, string subdir,
                                               std::function<bool(std::string)> filterOp,
                                               std::vector<Patch> &items,
                                               std::vector<PatchCategory> &categories)
@@ -728,36 +873,33 @@ void SurgeStorage::refreshPatchOrWTListAddDir(bool userDir, string subdir,
 
     try
     {
-        fs::path patchpath = string_to_path(userDir ? userDataPath : datapath);
-        if (!subdir.empty())
-            patchpath /= string_to_path(subdir);
+        auto root = libraryRoot(userDir, subdir);
+        fs::path patchpath = string_to_path(root);
 
-        if (!fs::is_directory(patchpath))
+        if (tree.find(root) == tree.end())
         {
             return;
         }
 
         /*
-        ** std::filesystem has a recursive_directory_iterator, but between the
-        ** hand rolled ipmmlementation on mac, expermiental on windows, and
-        ** ostensibly standard on linux it isn't consistent enough to warrant
-        ** using yet, so build my own recursive directory traversal with a simple
-        ** stack
+        ** The scan already walked the tree; lay its directories out breadth first, which
+        ** is the order we have always numbered categories in
         */
-        std::vector<fs::path> alldirs;
-        std::deque<fs::path> workStack;
-        workStack.push_back(patchpath);
+        std::vector<std::string> alldirs;
+        std::deque<std::string> workStack;
+        workStack.push_back(root);
         while (!workStack.empty())
         {
             auto top = workStack.front();
             workStack.pop_front();
-            for (auto &d : fs::directory_iterator(top))
+            auto entry = tree.find(top);
+            if (entry == tree.end())
+                continue;
+            for (auto &sd : entry->second.subdirs)
             {
-                if (fs::is_directory(d))
-                {
-                    alldirs.push_back(d);
-                    workStack.push_back(d);
-                }
+                auto d = path_to_string(string_to_path(top) / string_to_path(sd));
+                alldirs.push_back(d);
+                workStack.push_back(d);
             }
         }
 
@@ -773,19 +915,21 @@ void SurgeStorage::refreshPatchOrWTListAddDir(bool userDir, string subdir,
         for (auto &p : alldirs)
         {
             PatchCategory c;
-            c.name = path_to_string(p).substr(patchpathSubstrLength);
+            c.name = p.substr(patchpathSubstrLength);
             c.internalid = category;
 
             c.numberOfPatchesInCatgory = 0;
-            for (auto &f : fs::directory_iterator(p))
+            // every directory alldirs holds came out of the tree
+            for (auto &fn : tree.at(p).files)
             {
-                std::string xtn = path_to_string(f.path().extension());
+                auto fp = string_to_path(p) / string_to_path(fn);
+                std::string xtn = path_to_string(fp.extension());
                 if (filterOp(xtn))
                 {
                     Patch e;
                     e.category = category;
-                    e.path = f.path();
-                    e.name = path_to_string(f.path().filename());
+                    e.path = fp;
+                    e.name = fn;
                     e.name = e.name.substr(0, e.name.size() - xtn.length());
                     items.push_back(e);
 
@@ -886,10 +1030,14 @@ void SurgeStorage::refreshPatchOrWTListAddDir(bool userDir, string subdir,
 
 void SurgeStorage::refresh_wtlist()
 {
+    auto tree = libraryScan(wavetableLibraryRoots())();
+
+    std::lock_guard<std::mutex> g(wtListMutex);
+
     wt_category.clear();
     wt_list.clear();
 
-    refresh_wtlistAddDir(false, "wavetables");
+    refresh_wtlistAddDir(tree, false, "wavetables");
 
     if (wt_category.size() == 0 || wt_list.size() == 0)
     {
@@ -900,9 +1048,9 @@ void SurgeStorage::refresh_wtlist()
     }
 
     firstThirdPartyWTCategory = wt_category.size();
-    refresh_wtlistAddDir(false, "wavetables_3rdparty");
+    refresh_wtlistAddDir(tree, false, "wavetables_3rdparty");
     firstUserWTCategory = wt_category.size();
-    refresh_wtlistAddDir(true, "");
+    refresh_wtlistAddDir(tree, true, "");
 
     wtCategoryOrdering = std::vector<int>(wt_category.size());
     std::iota(wtCategoryOrdering.begin(), wtCategoryOrdering.end(), 0);
@@ -959,14 +1107,15 @@ void SurgeStorage::refresh_wtlist()
         wt_list[wtOrdering[i]].order = i;
 }
 
-void SurgeStorage::refresh_wtlistAddDir(bool userDir, std::string subdir)
+void SurgeStorage::refresh_wtlistAddDir(const Surge::Storage::LibraryScanner::Tree &tree,
+                                        bool userDir, std::string subdir)
 {
     std::vector<std::string> supportedTableFileTypes;
     supportedTableFileTypes.push_back(".wt");
     supportedTableFileTypes.push_back(".wav");
 
     refreshPatchOrWTListAddDir(
-        userDir, subdir,
+        tree, userDir, subdir,
         [supportedTableFileTypes](std::string in) -> bool {
             for (auto q : supportedTableFileTypes)
             {
@@ -980,43 +1129,44 @@ void SurgeStorage::refresh_wtlistAddDir(bool userDir, std::string subdir)
 
 void SurgeStorage::perform_queued_wtloads()
 {
-    SurgePatch &patch =
-        getPatch(); // Change here is for performance and ease of debugging, simply not calling
-                    // getPatch so many times. Code should behave identically.
-    for (int sc = 0; sc < n_scenes; sc++)
+    /*
+     * Called at the top of every block. Reading and mipmapping a wavetable can take a good
+     * while, so the loader posts the queued ids and filenames to its thread and swaps finished
+     * tables in at a later block while the old table keeps playing.
+     */
+    wavetableLoader->processQueuedLoads();
+}
+
+void SurgeStorage::queue_wt(Wavetable *wt, int id)
+{
+    std::lock_guard<std::mutex> g(wtListMutex);
+
+    if (id < 0 || id >= wt_list.size())
+        return;
+
+    wt->queue_id = id;
+    wt->queue_from_list = true;
+    strxcpy(wt->queue_filename, path_to_string(wt_list[id].path).c_str(),
+            sizeof(wt->queue_filename));
+}
+
+void SurgeStorage::queue_wt(Wavetable *wt, const std::string &filename)
+{
+    std::lock_guard<std::mutex> g(wtListMutex);
+
+    int wtidx = -1, ct = 0;
+    for (const auto &wti : wt_list)
     {
-        for (int o = 0; o < n_oscs; o++)
+        if (path_to_string(wti.path) == filename)
         {
-            if (patch.scene[sc].osc[o].wt.queue_id != -1)
-            {
-                load_wt(patch.scene[sc].osc[o].wt.queue_id, &patch.scene[sc].osc[o].wt,
-                        &patch.scene[sc].osc[o]);
-                patch.scene[sc].osc[o].wt.refresh_display = true;
-            }
-            else if (patch.scene[sc].osc[o].wt.queue_filename[0])
-            {
-                if (!(patch.scene[sc].osc[o].type.val.i == ot_wavetable ||
-                      patch.scene[sc].osc[o].type.val.i == ot_window))
-                {
-                    patch.scene[sc].osc[o].queue_type = ot_wavetable;
-                }
-                int wtidx = -1, ct = 0;
-                for (const auto &wti : wt_list)
-                {
-                    if (path_to_string(wti.path) == patch.scene[sc].osc[0].wt.queue_filename)
-                    {
-                        wtidx = ct;
-                    }
-                    ct++;
-                }
-
-                patch.scene[sc].osc[o].wt.current_id = wtidx;
-                load_wt(patch.scene[sc].osc[o].wt.queue_filename, &patch.scene[sc].osc[o].wt,
-                        &patch.scene[sc].osc[o]);
-                patch.scene[sc].osc[o].wt.refresh_display = true;
-            }
+            wtidx = ct;
         }
+        ct++;
     }
+
+    wt->queue_id = wtidx;
+    wt->queue_from_list = false;
+    strxcpy(wt->queue_filename, filename.c_str(), sizeof(wt->queue_filename));
 }
 
 void SurgeStorage::load_wt(int id, Wavetable *wt, OscillatorStorage *osc)
@@ -1039,17 +1189,49 @@ void SurgeStorage::load_wt(int id, Wavetable *wt, OscillatorStorage *osc)
     }
 }
 
-void SurgeStorage::load_wt(string filename, Wavetable *wt, OscillatorStorage *osc)
+bool SurgeStorage::load_wt(string filename, Wavetable *wt, OscillatorStorage *osc)
 {
     wt->queue_filename[0] = 0;
     string extension = filename.substr(filename.find_last_of('.'), filename.npos);
     for (unsigned int i = 0; i < extension.length(); i++)
         extension[i] = tolower(extension[i]);
     bool loaded = false;
-    if (extension.compare(".wt") == 0)
-        loaded = load_wt_wt(filename, wt);
-    else if (extension.compare(".wav") == 0)
-        loaded = load_wt_wav_portable(filename, wt);
+    if (extension.compare(".wt") == 0 || extension.compare(".wav") == 0)
+    {
+        auto key = Surge::Storage::WavetableCache::keyForFile(filename);
+
+        /*
+         * A table built in an earlier run is mapped back in from the mipmap cache; otherwise
+         * we build it and leave it there for next time.
+         */
+        auto build = [this, &filename, &extension, &key](Wavetable *into) {
+            using Surge::Storage::WavetableMipmapCache;
+            if (WavetableMipmapCache::read(userWavetableCachePath, filename, key, into))
+                return true;
+
+            bool res = extension.compare(".wt") == 0 ? load_wt_wt(filename, into)
+                                                      : load_wt_wav_portable(filename, into);
+            if (res && WavetableMipmapCache::write(userWavetableCachePath, filename, key, into))
+                WavetableMipmapCache::trim(userWavetableCachePath, userWavetableCacheMaxBytes);
+            return res;
+        };
+
+        /*
+         * Every oscillator in the process which loads this file as it is on disk now reads the
+         * one built copy, so it is only read and mipmapped once.
+         */
+        if (key.empty())
+        {
+            loaded = build(wt);
+        }
+        else if (auto shared = Surge::Storage::WavetableCache::get(key, build))
+        {
+            waveTableDataMutex.lock();
+            wt->ShareData(shared);
+            waveTableDataMutex.unlock();
+            loaded = true;
+        }
+    }
     else
     {
         std::ostringstream oss;
@@ -1069,6 +1251,7 @@ void SurgeStorage::load_wt(string filename, Wavetable *wt, OscillatorStorage *os
             strncpy(osc->wavetable_display_name, fnnoext.c_str(), 256);
         }
     }
+    return loaded;
 }
 
 bool SurgeStorage::load_wt_wt(string filename, Wavetable *wt)
@@ -1400,6 +1583,7 @@ void SurgeStorage::clipboard_paste(int type, int scene, int entry)
             getPatch().param_ptr[pid]->porta_retrigger = p.porta_retrigger;
             getPatch().param_ptr[pid]->porta_curve = p.porta_curve;
             getPatch().param_ptr[pid]->deform_type = p.deform_type;
+            getPatch().param_ptr[pid]->markDirty();
         }
 
         switch (type)
@@ -1474,9 +1658,16 @@ void SurgeStorage::clipboard_paste(int type, int scene, int entry)
         }
     }
 
+    publishModulationRouting();
     modRoutingMutex.unlock();
 }
 
+void SurgeStorage::publishModulationRouting()
+{
+    std::lock_guard<std::recursive_mutex> g(modRoutingMutex);
+    modRoutingTable->publish(getPatch());
+}
+
 TiXmlElement *SurgeStorage::getSnapshotSection(const char *name)
 {
     TiXmlElement *e = TINYXML_SAFE_TO_ELEMENT(snapshotloader.FirstChild(name));
@@ -1613,7 +1804,14 @@ void SurgeStorage::load_midi_controllers()
     }
 }
 
-SurgeStorage::~SurgeStorage() { deinitialize_oddsound(); }
+SurgeStorage::~SurgeStorage()
+{
+    // stop the loader thread before the lists and tables it reads go away
+    wavetableLoader.reset();
+    if (pendingPatchScan.valid())
+        pendingPatchScan.wait();
+    deinitialize_oddsound();
+}
 
 double shafted_tanh(double x) { return (exp(x) - exp(-x * 1.2)) / (exp(x) + exp(-x)); }
 
@@ -1828,6 +2026,45 @@ float envelope_rate_linear_nowrap(float x)
     return (1 - a) * table_envrate_linear[e & 0x1ff] + a * table_envrate_linear[(e + 1) & 0x1ff];
 }
 
+static inline __m128 lookup_interpolated_ps(const float *table, __m128i e, int mask, __m128 a)
+{
+    int ei alignas(16)[4];
+    float t0 alignas(16)[4], t1 alignas(16)[4];
+    _mm_store_si128((__m128i *)ei, e);
+    for (int i = 0; i < 4; ++i)
+    {
+        t0[i] = table[ei[i] & mask];
+        t1[i] = table[(ei[i] + 1) & mask];
+    }
+    return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.f), a), _mm_load_ps(t0)),
+                      _mm_mul_ps(a, _mm_load_ps(t1)));
+}
+
+__m128 lookup_waveshape_warp_ps(int entry, __m128 x)
+{
+    x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(256.f)), _mm_set1_ps(512.f));
+
+    __m128i e = _mm_cvttps_epi32(x);
+    __m128 a = _mm_sub_ps(x, _mm_cvtepi32_ps(e));
+
+    return lookup_interpolated_ps(waveshapers[entry], e, 0x3ff, a);
+}
+
+__m128 envelope_rate_linear_nowrap_ps(__m128 x)
+{
+    x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(16.f)), _mm_set1_ps(256.f));
+
+    // limit_range((int)x, 0, 0x1ff - 1) without the SSE4.1 integer min and max
+    const __m128i hi = _mm_set1_epi32(0x1ff - 1);
+    __m128i e = _mm_cvttps_epi32(x);
+    e = _mm_andnot_si128(_mm_cmplt_epi32(e, _mm_setzero_si128()), e);
+    __m128i over = _mm_cmpgt_epi32(e, hi);
+    e = _mm_or_si128(_mm_and_si128(over, hi), _mm_andnot_si128(over, e));
+    __m128 a = _mm_sub_ps(x, _mm_cvtepi32_ps(e));
+
+    return lookup_interpolated_ps(table_envrate_linear, e, 0x1ff, a);
+}
+
 // this function is only valid for x = {0, 1}
 float glide_exp(float x)
 {
@@ -1848,6 +2085,18 @@ float glide_log(float x)
     return (1 - a) * table_glide_log[e & 0x1ff] + a * table_glide_log[(e + 1) & 0x1ff];
 }
 
+static void fillTuningTables(const Tunings::Tuning &t, float *pitch, float *pitchInv,
+                             float (*omega)[SurgeStorage::tuning_table_size])
+{
+    for (int i = 0; i < SurgeStorage::tuning_table_size; ++i)
+    {
+        pitch[i] = t.frequencyForMidiNoteScaledByMidi0(i - 256);
+        pitchInv[i] = 1.f / pitch[i];
+        omega[0][i] = (float)sin(2 * M_PI * min(0.5, 440 * pitch[i] * dsamplerate_os_inv));
+        omega[1][i] = (float)cos(2 * M_PI * min(0.5, 440 * pitch[i] * dsamplerate_os_inv));
+    }
+}
+
 bool SurgeStorage::resetToCurrentScaleAndMapping()
 {
     currentTuning = Tunings::Tuning(currentScale, currentMapping);
@@ -1866,16 +2115,156 @@ bool SurgeStorage::resetToCurrentScaleAndMapping()
         tuningPitchInv = 1.0 / tuningPitch;
     }
 
-    for (int i = 0; i < 512; ++i)
+    fillTuningTables(t, table_pitch, table_pitch_inv, table_note_omega);
+    return true;
+}
+
+void SurgeStorage::captureTuning(PreparedTuning &p)
+{
+    p.scale = currentScale;
+    p.mapping = currentMapping;
+    p.isStandardTuning = isStandardTuning;
+    p.isStandardScale = isStandardScale;
+    p.isStandardMapping = isStandardMapping;
+    p.mode = tuningApplicationMode;
+}
+
+void SurgeStorage::prepareTuningFromPatch(const SurgePatch &patch, PreparedTuning &p)
+{
+    auto &pt = patch.patchTuning;
+    if (!pt.tuningStoredInPatch)
+        return;
+
+    if (!p.isStandardTuning)
     {
-        table_pitch[i] = t.frequencyForMidiNoteScaledByMidi0(i - 256);
-        table_pitch_inv[i] = 1.f / table_pitch[i];
-        table_note_omega[0][i] =
-            (float)sin(2 * M_PI * min(0.5, 440 * table_pitch[i] * dsamplerate_os_inv));
-        table_note_omega[1][i] =
-            (float)cos(2 * M_PI * min(0.5, 440 * table_pitch[i] * dsamplerate_os_inv));
+        auto okc = okCancelProvider(
+            std::string("Loaded patch contains a custom tuning, but there is ") +
+                "already a user-selected tuning in place. Do you want to replace the currently "
+                "loaded tuning " +
+                "with the tuning stored in the patch? (The rest of the patch will load "
+                "normally.)",
+            "Replace Tuning", SurgeStorage::CANCEL);
+        if (okc != SurgeStorage::OK)
+            return;
     }
-    return true;
+
+    try
+    {
+        if (pt.scaleContents.size() > 1)
+            p.retuneToScale(Tunings::parseSCLData(pt.scaleContents));
+        else
+            p.retuneTo12TETScale();
+
+        if (pt.mappingContents.size() > 1)
+        {
+            auto kb = Tunings::parseKBMData(pt.mappingContents);
+            if (pt.mappingName.size() > 1)
+                kb.name = pt.mappingName;
+            else
+                kb.name = guessAtKBMName(kb);
+            p.remapToKeyboard(kb);
+        }
+        else
+        {
+            p.remapToConcertCKeyboard();
+        }
+    }
+    catch (Tunings::TuningError &e)
+    {
+        reportError(e.what(), "Error Restoring Tuning");
+        p.retuneTo12TETScaleC261Mapping();
+    }
+}
+
+void SurgeStorage::prepareTuningFromDawExtraState(const SurgePatch &patch, PreparedTuning &p)
+{
+    auto &ds = patch.dawExtraState;
+    if (!ds.isPopulated)
+        return;
+
+    if (ds.hasScale)
+    {
+        try
+        {
+            p.retuneToScale(Tunings::parseSCLData(ds.scaleContents));
+        }
+        catch (Tunings::TuningError &e)
+        {
+            reportError(e.what(), "Unable to restore tuning!");
+            p.retuneTo12TETScale();
+        }
+    }
+    else
+    {
+        p.retuneTo12TETScale();
+    }
+
+    if (ds.hasMapping)
+    {
+        try
+        {
+            auto kb = Tunings::parseKBMData(ds.mappingContents);
+            if (ds.mappingName.size() > 1)
+                kb.name = ds.mappingName;
+            else
+                kb.name = guessAtKBMName(kb);
+            p.remapToKeyboard(kb);
+        }
+        catch (Tunings::TuningError &e)
+        {
+            reportError(e.what(), "Unable to restore mapping!");
+            p.remapToConcertCKeyboard();
+        }
+    }
+    else
+    {
+        p.remapToConcertCKeyboard();
+    }
+}
+
+void SurgeStorage::buildTuning(PreparedTuning &p)
+{
+    try
+    {
+        p.tuning = Tunings::Tuning(p.scale, p.mapping);
+    }
+    catch (Tunings::TuningError &e)
+    {
+        reportError(e.what(), "Error Restoring Tuning");
+        p.retuneTo12TETScaleC261Mapping();
+        p.tuning = Tunings::Tuning(p.scale, p.mapping);
+    }
+
+    if (p.mode == RETUNE_MIDI_ONLY)
+    {
+        p.tuningPitch = 32.0;
+        p.tuningPitchInv = 1.0 / 32.0;
+        fillTuningTables(twelveToneStandardMapping, p.table_pitch, p.table_pitch_inv,
+                         p.table_note_omega);
+    }
+    else
+    {
+        p.tuningPitch = p.mapping.tuningFrequency / Tunings::MIDI_0_FREQ;
+        p.tuningPitchInv = 1.0 / p.tuningPitch;
+        fillTuningTables(p.tuning, p.table_pitch, p.table_pitch_inv, p.table_note_omega);
+    }
+}
+
+void SurgeStorage::adoptTuning(PreparedTuning &p)
+{
+    // all swaps of what the two already hold, so nothing is parsed, built or allocated here
+    std::swap(currentScale, p.scale);
+    std::swap(currentMapping, p.mapping);
+    std::swap(currentTuning, p.tuning);
+    std::swap(isStandardTuning, p.isStandardTuning);
+    std::swap(isStandardScale, p.isStandardScale);
+    std::swap(isStandardMapping, p.isStandardMapping);
+    std::swap(tuningApplicationMode, p.mode);
+    std::swap(tuningPitch, p.tuningPitch);
+    std::swap(tuningPitchInv, p.tuningPitchInv);
+    std::swap(table_pitch, p.table_pitch);
+    std::swap(table_pitch_inv, p.table_pitch_inv);
+    std::swap(table_note_omega, p.table_note_omega);
 }
 
 void SurgeStorage::setTuningApplicationMode(const TuningApplicationMode m)
@@ -22,6 +22,7 @@
 #include "tinyxml/tinyxml.h"
 #include "filesystem/import.h"
 
+#include <array>
 #include <vector>
 #include <memory>
 #include <mutex>
@@ -40,6 +41,9 @@
 #include "PatchDB.h"
 #include <unordered_set>
 #include "UserDefaults.h"
+#include "SurgeMemoryPools.h"
+#include "LibraryScanner.h"
+#include <future>
 
 #if WINDOWS
 #define PATH_SEPARATOR '\\'
@@ -664,6 +668,9 @@ struct MSEGStorage
     float durationToLoopEnd;
     float durationLoopStartToLoopEnd;
     float envelopeModeDuration = -1, envelopeModeNV1 = -2; // -2 as sentinel since NV1 is -1/1
+    // n_activeSegments if segmentStart and segmentEnd are both in order, so a time can be found
+    // by bisection, and -1 if they have to be scanned
+    int indexedSegments = -1;
 
     /*
      * These "UI" type things we decided, late in 1.8, are actually a critical part of
@@ -783,6 +790,30 @@ class SurgePatch
     void copy_scenedata(pdata *, int scene);
     void copy_globaldata(pdata *);
 
+    /*
+     * scenedata and globaldata hold this block's parameter values for the DSP. Copying all of
+     * them every block means chasing a pointer to each of the n_total_params Parameters, so
+     * instead whoever changes a value marks it and sync_paramdata only copies what was marked.
+     * The Parameter setters mark themselves, anything writing val directly calls
+     * Parameter::markDirty, and anything which rewrites parameters wholesale (a patch load, an
+     * oscillator or FX type change) marks everything.
+     *
+     * Writing val without a mark still works, just late: each block also re-copies a rolling
+     * window of paramResyncPerBlock parameters, so an unmarked write lands within
+     * n_total_params / paramResyncPerBlock blocks. Each one it catches is counted in
+     * unmarkedParameterWrites, which is how a missing mark shows up.
+     */
+    void markParameterDirty(int id)
+    {
+        if (id >= 0 && id < n_total_params)
+            dirtyParams[id >> 6].fetch_or(1ull << (id & 63), std::memory_order_release);
+    }
+    void markAllParametersDirty();
+    // bit s of sceneMask says whether scene s is playing; other scenes keep their marks
+    void sync_paramdata(int sceneMask);
+    static constexpr int paramResyncPerBlock = 32;
+    std::atomic<uint64_t> unmarkedParameterWrites{0};
+
     // load/save
     // void load_xml();
     // void save_xml();
@@ -801,6 +832,31 @@ class SurgePatch
     void load_patch(const void *data, int size, bool preset);
     unsigned int save_patch(void **data);
 
+    /*
+     * Take over everything a patch load sets from other, a SurgePatch of the same storage which
+     * a patch was loaded into off the audio thread. Parameters are copied; wavetables, routings,
+     * modulator data and strings are swapped, so this doesn't allocate and other ends up holding
+     * what this patch had. Runtime state (modsources, the wavetable queue type, scene and global
+     * data) is left alone, and everything is marked dirty.
+     */
+    void adoptFrom(SurgePatch &other);
+
+    /*
+     * What a patch says about settings which live on the storage: the tuning application mode
+     * and the hardclip modes, as load_xml last read them. load_xml hands them to the storage
+     * with applyStorageSettings unless deferStorageSettings is set, as it is for the shadow
+     * patch, which loads while the audio thread reads the storage; its commit applies them.
+     */
+    struct StorageSettings
+    {
+        int tuningApplicationMode = 0;
+        int hardclipMode = 0;
+        int sceneHardclipMode[n_scenes] = {};
+    } storageSettings;
+    bool deferStorageSettings = false;
+    // withTuningMode = false leaves the tuning application mode, and the tables made for it, alone
+    void applyStorageSettings(bool withTuningMode = true);
+
     // data
     SurgeSceneStorage scene[n_scenes], morphscene;
     FxStorage fx[n_fx_slots];
@@ -827,6 +883,15 @@ class SurgePatch
     pdata scenedata[n_scenes][n_scene_params];
     pdata globaldata[n_global_params];
     void *patchptr;
+
+  private:
+    // returns whether the copy changed anything
+    bool sync_param(int id, int sceneMask);
+
+    std::array<std::atomic<uint64_t>, (n_total_params + 63) / 64> dirtyParams;
+    int paramResyncCursor = 0;
+
+  public:
     SurgeStorage *storage;
 
     // metadata
@@ -885,6 +950,23 @@ enum surge_copysource
 
 class MTSClient;
 
+namespace Surge
+{
+namespace Storage
+{
+struct WavetableLoader;
+class ModulationRoutingTable;
+} // namespace Storage
+namespace Profiling
+{
+class ProcessProfiler;
+}
+namespace Formula
+{
+struct EvaluatorSupport;
+}
+} // namespace Surge
+
 /* storage layer */
 
 class alignas(16) SurgeStorage
@@ -950,12 +1032,21 @@ class alignas(16) SurgeStorage
     ~SurgeStorage();
 
     std::unique_ptr<Surge::PatchStorage::PatchDB> patchDB;
+    // Waits for the patch list; does nothing once there is a DB. Call from the message thread.
     void initializePatchDb();
 
     std::unique_ptr<SurgePatch> _patch;
 
     SurgePatch &getPatch();
 
+    // Backing blocks for oscillators too large for a voice's own oscillator buffer
+    std::unique_ptr<Surge::Memory::OscillatorBlockPool> oscillatorBlockPool;
+    void reserveOscillatorBlocks();
+    void reserveOscillatorBlocks(const SurgePatch &patch);
+
+    // Builds queued wavetable loads off the audio thread; see perform_queued_wtloads
+    std::unique_ptr<Surge::Storage::WavetableLoader> wavetableLoader;
+
     float pitch_bend;
 
     float vu_falloff;
@@ -974,19 +1065,48 @@ class alignas(16) SurgeStorage
     void setSamplerate(float sr);
 
     void refresh_wtlist();
-    void refresh_wtlistAddDir(bool userDir, std::string subdir);
+    void refresh_wtlistAddDir(const Surge::Storage::LibraryScanner::Tree &tree, bool userDir,
+                              std::string subdir);
     void refresh_patchlist();
-    void refreshPatchlistAddDir(bool userDir, std::string subdir);
+    void refreshPatchlistAddDir(const Surge::Storage::LibraryScanner::Tree &tree, bool userDir,
+                                std::string subdir);
+
+    /*
+     * The constructor scans the patch library on another thread so the synth can be built and
+     * play before that finishes. Anything which reads patch_list, patch_category or their
+     * orderings calls ensurePatchListLoaded() first, which waits for the scan if it is still going
+     * and publishes its lists. isPatchListReady() says whether the lists are published already,
+     * and isPatchScanFinished() whether ensurePatchListLoaded() would publish them without
+     * waiting, so something polling for the list knows when to call it.
+     */
+    void ensurePatchListLoaded();
+    bool isPatchListReady() const { return patchListReady.load(std::memory_order_acquire); }
+    bool isPatchScanFinished() const
+    {
+        return isPatchListReady() || patchScanFinished.load(std::memory_order_acquire);
+    }
+    // What the last scan found, so the next only lists directories which have changed since
+    std::string libraryManifestPath() const;
 
-    void refreshPatchOrWTListAddDir(bool userDir, std::string subdir,
+    void refreshPatchOrWTListAddDir(const Surge::Storage::LibraryScanner::Tree &tree,
+                                    bool userDir, std::string subdir,
                                     std::function<bool(std::string)> filterOp,
                                     std::vector<Patch> &items,
                                     std::vector<PatchCategory> &categories);
 
     void perform_queued_wtloads();
 
+    /*
+     * Queue a load of wt_list[id], or of a file, for the loader to pick up. The id and the
+     * path are resolved against wt_list here, on the calling thread, so the loader's worker only
+     * ever sees a path. wtListMutex makes that safe from threads other than the one which runs
+     * refresh_wtlist (a gapless patch build queues its default table on the loader thread).
+     */
+    void queue_wt(Wavetable *wt, int id);
+    void queue_wt(Wavetable *wt, const std::string &filename);
+
     void load_wt(int id, Wavetable *wt, OscillatorStorage *);
-    void load_wt(std::string filename, Wavetable *wt, OscillatorStorage *);
+    bool load_wt(std::string filename, Wavetable *wt, OscillatorStorage *);
     bool load_wt_wt(std::string filename, Wavetable *wt);
     bool load_wt_wt_mem(const char *data, const size_t dataSize, Wavetable *wt);
     // void load_wt_wav(std::string filename, Wavetable* wt);
@@ -1006,7 +1126,8 @@ class alignas(16) SurgeStorage
     std::vector<int> patchOrdering;
     std::vector<int> patchCategoryOrdering;
 
-    // The in-memory wavetable database.
+    // The in-memory wavetable database. refresh_wtlist holds wtListMutex while it rebuilds it.
+    std::mutex wtListMutex;
     std::vector<Patch> wt_list;
     std::vector<PatchCategory> wt_category;
     int firstThirdPartyWTCategory;
@@ -1020,6 +1141,9 @@ class alignas(16) SurgeStorage
     std::string userDefaultFilePath;
     std::string userFXPath;
     std::string installedPath;
+    // Where finished wavetables are kept between runs; empty if that's switched off
+    std::string userWavetableCachePath;
+    uint64_t userWavetableCacheMaxBytes = 0;
 
     std::string userMidiMappingsPath;
     std::map<std::string, TiXmlDocument> userMidiMappingsXMLByName;
@@ -1030,6 +1154,20 @@ class alignas(16) SurgeStorage
     // float table_sin[512],table_sin_offset[512];
     std::mutex waveTableDataMutex;
     std::recursive_mutex modRoutingMutex;
+
+    /*
+     * The audio thread reads routings from here rather than from the patch, so it never needs
+     * modRoutingMutex. Anything which changes the patch's routing vectors calls
+     * publishModulationRouting() when it is done.
+     */
+    std::unique_ptr<Surge::Storage::ModulationRoutingTable> modRoutingTable;
+    void publishModulationRouting();
+
+    // Time spent in each part of SurgeSynthesizer::process, for whoever wants to poll it
+    std::unique_ptr<Surge::Profiling::ProcessProfiler> processProfiler;
+
+    // The lua_State this synth's formula modulators run in, which nothing else touches
+    std::unique_ptr<Surge::Formula::EvaluatorSupport> formulaEvaluator;
     Wavetable WindowWT;
 
     // hardclip
@@ -1157,6 +1295,70 @@ class alignas(16) SurgeStorage
     // Critically this does not touch the "isStandard" variables at all
     bool resetToCurrentScaleAndMapping();
 
+    /*
+     * A whole tuning state with the tables it makes, worked out off the audio thread: the
+     * parsing, any question about replacing a user tuning and the tables are done by the time
+     * adoptTuning swaps it in, which neither parses nor allocates. The retune and remap members
+     * mirror the storage's own but only set the scale, mapping and flags; buildTuning makes the
+     * rest. ShadowPatchLoader prepares one with each patch, and the synchronous loads use the
+     * same path.
+     */
+    struct PreparedTuning
+    {
+        Tunings::Scale scale;
+        Tunings::KeyboardMapping mapping;
+        Tunings::Tuning tuning;
+        bool isStandardTuning = true, isStandardScale = true, isStandardMapping = true;
+        TuningApplicationMode mode = RETUNE_MIDI_ONLY;
+        float tuningPitch = 32.0f, tuningPitchInv = 0.03125f;
+        float table_pitch alignas(16)[tuning_table_size];
+        float table_pitch_inv alignas(16)[tuning_table_size];
+        float table_note_omega alignas(16)[2][tuning_table_size];
+
+        void retuneToScale(const Tunings::Scale &s)
+        {
+            scale = s;
+            isStandardTuning = false;
+            isStandardScale = false;
+        }
+        void retuneTo12TETScale()
+        {
+            scale = Tunings::evenTemperament12NoteScale();
+            isStandardScale = true;
+            isStandardTuning = isStandardMapping;
+        }
+        void retuneTo12TETScaleC261Mapping()
+        {
+            scale = Tunings::evenTemperament12NoteScale();
+            mapping = Tunings::KeyboardMapping();
+            isStandardTuning = true;
+            isStandardScale = true;
+            isStandardMapping = true;
+        }
+        void remapToKeyboard(const Tunings::KeyboardMapping &k)
+        {
+            mapping = k;
+            isStandardMapping = false;
+            isStandardTuning = false;
+        }
+        void remapToConcertCKeyboard()
+        {
+            mapping = Tunings::KeyboardMapping();
+            isStandardMapping = true;
+            isStandardTuning = isStandardScale;
+        }
+    };
+
+    // Start p from the tuning in place now, including the application mode
+    void captureTuning(PreparedTuning &p);
+    // What the tuning stored in patch, or its session state, makes of p. May ask or report.
+    void prepareTuningFromPatch(const SurgePatch &patch, PreparedTuning &p);
+    void prepareTuningFromDawExtraState(const SurgePatch &patch, PreparedTuning &p);
+    // Make p's tuning and tables for p.mode
+    void buildTuning(PreparedTuning &p);
+    // Swap p in. Safe between blocks on the audio thread; p is left holding the old state.
+    void adoptTuning(PreparedTuning &p);
+
     inline int scaleConstantNote()
     {
         if (tuningApplicationMode == RETUNE_ALL)
@@ -1250,6 +1452,18 @@ class alignas(16) SurgeStorage
     char clipboard_wt_names[n_oscs][256];
     MonoVoicePriorityMode clipboard_primode = NOTE_ON_LATEST_RETRIGGER_HIGHEST;
 
+    std::vector<std::string> patchLibraryRoots() const;
+    std::vector<std::string> wavetableLibraryRoots() const;
+    // A scan of roots which only holds copies of what it needs, so it can run anywhere
+    std::function<Surge::Storage::LibraryScanner::Tree()>
+    libraryScan(const std::vector<std::string> &roots) const;
+    std::string libraryRoot(bool userDir, const std::string &subdir) const;
+    void buildPatchList(const Surge::Storage::LibraryScanner::Tree &tree);
+
+    std::future<Surge::Storage::LibraryScanner::Tree> pendingPatchScan;
+    std::atomic<bool> patchListReady{true}, patchScanFinished{false};
+    std::mutex patchListMutex;
+
   public:
     // whether to skip loading, desired while exporting manifests. Only used by LV2 currently.
     static bool skipLoadWtAndPatch;
@@ -1294,32 +1508,55 @@ class alignas(16) SurgeStorage
 #define runningOnAudioThread() (void *)0;
 #endif
     /*
-     * These API points are only thread safe on the AUDIO thread.
-     * If you want to have an independent RNG on another thread, manage
+     * With independentSceneRngs set, each scene renders with its own generator (see
+     * SurgeSynthesizer::renderScene, which points threadRngGen at it for the duration) so that
+     * the numbers a scene draws don't depend on which thread renders it or on what the other
+     * scene drew first. Multithreaded scenes turn it on. Otherwise both scenes draw from rngGen
+     * in the order they always have, so a seeded serial render is what it always was.
+     */
+    bool independentSceneRngs = false;
+    RNGGen sceneRngGen[n_scenes];
+    // Likewise each voice with its own (SurgeVoice::rngGen); the voice thread pool turns it on
+    bool independentVoiceRngs = false;
+    static thread_local RNGGen *threadRngGen;
+    inline RNGGen &activeRngGen() { return threadRngGen ? *threadRngGen : rngGen; }
+
+    /*
+     * These API points are only thread safe on the AUDIO thread (or a thread rendering a scene
+     * on its behalf). If you want to have an independent RNG on another thread, manage
      * your lifecycle yourself or if you want make a new instance of the
      * Storage::RNGGen utility class above
      */
     inline int rand()
     {
         runningOnAudioThread();
-        return rngGen.d(rngGen.g);
+        auto &r = activeRngGen();
+        return r.d(r.g);
     }
     inline uint32_t rand_u32()
     {
         runningOnAudioThread();
-        return rngGen.u32(rngGen.g);
+        auto &r = activeRngGen();
+        return r.u32(r.g);
     }
     inline float rand_pm1()
     {
         runningOnAudioThread();
-        return rngGen.pm1(rngGen.g);
+        auto &r = activeRngGen();
+        return r.pm1(r.g);
     }
     inline float rand_01()
     {
         runningOnAudioThread();
-        return rngGen.z1(rngGen.g);
+        auto &r = activeRngGen();
+        return r.z1(r.g);
+    }
+    void seed_rand(int s)
+    {
+        rngGen.g.seed(s);
+        for (int i = 0; i < n_scenes; ++i)
+            sceneRngGen[i].g.seed(s + 1 + i);
     }
-    // void seed_rand(int s) { rngGen.g.seed(s); }
 #else
     inline int rand() { return std::rand(); }
     inline uint32_t rand_u32() { return (uint32_t)(rand_01() * (float)(0xFFFFFFFF)); }
@@ -1337,6 +1574,10 @@ float envelope_rate_linear_nowrap(float);
 float glide_log(float);
 float glide_exp(float);
 
+// Four of the above at once, bit-identical to calling them one lane at a time
+__m128 lookup_waveshape_warp_ps(int, __m128);
+__m128 envelope_rate_linear_nowrap_ps(__m128);
+
 namespace Surge
 {
 namespace Storage
@@ -25,6 +25,8 @@
 #endif
 
 #include "SurgeParamConfig.h"
+#include "ModulationRoutingTable.h"
+#include "ProcessProfiler.h"
 
 #include "UserDefaults.h"
 #include "filesystem/import.h"
@@ -68,8 +70,12 @@ SurgeSynthesizer::SurgeSynthesizer(PluginLayer *parent, std::string suppliedData
         memcpy((void *)&fxsync[i], (void *)&storage.getPatch().fx[i], sizeof(FxStorage));
         fx_reload[i] = false;
         fx_reload_mod[i] = false;
+        fx_reload_defaults[i] = false;
     }
 
+    effectLoader = std::make_unique<Surge::FX::EffectLoader>(&storage);
+    shadowPatchLoader = std::make_unique<Surge::Storage::ShadowPatchLoader>(this);
+
     allNotesOff();
 
     for (int i = 0; i < MAX_VOICES; i++)
@@ -226,23 +232,28 @@ SurgeSynthesizer::SurgeSynthesizer(PluginLayer *parent, std::string suppliedData
         (float)Surge::Storage::getUserDefaultValue(&storage, Surge::Storage::MPEPitchBendRange, 48);
     mpeGlobalPitchBendRange = 0;
 
-    int pid = 0;
-    for (auto p : storage.patch_list)
+    /*
+     * Start on the Init Saw template. It is read straight from its file, so building a synth
+     * doesn't wait for the patch list to be scanned; findCurrentPatchInList places it in the
+     * list once something needs that.
+     */
+    auto initSaw =
+        string_to_path(storage.datapath) / "patches_factory" / "Templates" / "Init Saw.fxp";
+    std::error_code ec;
+    if (fs::exists(initSaw, ec) &&
+        loadPatchByPath(path_to_string(initSaw).c_str(), -1, "Init Saw"))
     {
-        if (p.name == "Init Saw" && storage.patch_category[p.category].name == "Templates")
-        {
-            patchid_queue = pid;
-            break;
-        }
-        pid++;
-    }
-    if (patchid_queue >= 0)
+        storage.getPatch().category = "Templates";
         processThreadunsafeOperations(true); // DANGER MODE IS ON
+    }
     patchid_queue = -1;
 }
 
 SurgeSynthesizer::~SurgeSynthesizer()
 {
+    shadowPatchLoader.reset();
+    effectLoader.reset();
+
     allNotesOff();
 
     for (int sc = 0; sc < n_scenes; sc++)
@@ -397,7 +408,7 @@ void SurgeSynthesizer::playNote(char channel, char key, char velocity, char detu
 
 void SurgeSynthesizer::softkillVoice(int s)
 {
-    list<SurgeVoice *>::iterator iter, max_playing, max_released;
+    ActiveVoiceTable::iterator iter, max_playing, max_released;
     int max_age = 0, max_age_release = 0;
     iter = voices[s].begin();
 
@@ -432,7 +443,7 @@ void SurgeSynthesizer::softkillVoice(int s)
 // only allow 'margin' number of voices to be softkilled simultaneously
 void SurgeSynthesizer::enforcePolyphonyLimit(int s, int margin)
 {
-    list<SurgeVoice *>::iterator iter;
+    ActiveVoiceTable::iterator iter;
 
     if (voices[s].size() > (storage.getPatch().polylimit.val.i + margin))
     {
@@ -462,7 +473,7 @@ int SurgeSynthesizer::getNonUltrareleaseVoices(int s)
 {
     int count = 0;
 
-    list<SurgeVoice *>::iterator iter;
+    ActiveVoiceTable::iterator iter;
     iter = voices[s].begin();
     while (iter != voices[s].end())
     {
@@ -480,7 +491,7 @@ int SurgeSynthesizer::getNonReleasedVoices(int s)
 {
     int count = 0;
 
-    list<SurgeVoice *>::iterator iter;
+    ActiveVoiceTable::iterator iter;
     iter = voices[s].begin();
     while (iter != voices[s].end())
     {
@@ -509,15 +520,12 @@ SurgeVoice *SurgeSynthesizer::getUnusedVoice(int scene)
 
 void SurgeSynthesizer::freeVoice(SurgeVoice *v)
 {
-    for (int i = 0; i < MAX_VOICES; i++)
+    // Only look at v's own scene; the other scene may be rendering on another thread
+    for (int sc = 0; sc < n_scenes; sc++)
     {
-        if (voices_usedby[0][i] && (v == &voices_array[0][i]))
+        if (v >= &voices_array[sc][0] && v < &voices_array[sc][0] + MAX_VOICES)
         {
-            voices_usedby[0][i] = 0;
-        }
-        if (voices_usedby[1][i] && (v == &voices_array[1][i]))
-        {
-            voices_usedby[1][i] = 0;
+            voices_usedby[sc][v - &voices_array[sc][0]] = 0;
         }
     }
     v->freeAllocatedElements();
@@ -535,6 +543,9 @@ int SurgeSynthesizer::getMpeMainChannel(int voiceChannel, int key)
 
 void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocity, char detune)
 {
+    // the new voice applies its modulation right away, so don't hand it last block's routings
+    storage.modRoutingTable->acquire();
+
     if (getNonReleasedVoices(scene) == 0)
     {
         for (int l = 0; l < n_lfos_scene; l++)
@@ -601,7 +612,7 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
     case pm_mono_fp:
     case pm_latch:
     {
-        list<SurgeVoice *>::const_iterator iter;
+        ActiveVoiceTable::const_iterator iter;
         bool glide = false;
 
         int primode = storage.getPatch().scene[scene].monoVoicePriorityMode;
@@ -725,7 +736,7 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
 
         if (createVoice)
         {
-            list<SurgeVoice *>::const_iterator iter;
+            ActiveVoiceTable::const_iterator iter;
             for (iter = voices[scene].begin(); iter != voices[scene].end(); iter++)
             {
                 SurgeVoice *v = *iter;
@@ -797,7 +808,7 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
 
 void SurgeSynthesizer::releaseScene(int s)
 {
-    list<SurgeVoice *>::const_iterator iter;
+    ActiveVoiceTable::const_iterator iter;
     for (iter = voices[s].begin(); iter != voices[s].end(); iter++)
     {
         freeVoice(*iter);
@@ -905,7 +916,7 @@ void SurgeSynthesizer::releaseNote(char channel, char key, char velocity)
 void SurgeSynthesizer::releaseNotePostHoldCheck(int scene, char channel, char key, char velocity)
 {
     channelState[channel].keyState[key].keystate = 0;
-    list<SurgeVoice *>::const_iterator iter;
+    ActiveVoiceTable::const_iterator iter;
     for (int s = 0; s < n_scenes; s++)
     {
         bool do_switch = false;
@@ -1718,7 +1729,7 @@ void SurgeSynthesizer::allNotesOff()
 
     for (int s = 0; s < n_scenes; s++)
     {
-        list<SurgeVoice *>::const_iterator iter;
+        ActiveVoiceTable::const_iterator iter;
         for (iter = voices[s].begin(); iter != voices[s].end(); iter++)
         {
             freeVoice(*iter);
@@ -1879,6 +1890,7 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
         oldval.i = storage.getPatch().param_ptr[index]->val.i;
 
         storage.getPatch().param_ptr[index]->set_value_f01(value, force_integer);
+        storage.getPatch().markParameterDirty(index);
         if (storage.getPatch().param_ptr[index]->affect_other_parameters)
         {
             storage.getPatch().update_controls();
@@ -1926,6 +1938,7 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
                  * ctor */
                 subtypep->val.i =
                     storage.subtypeMemory[typep->scene - 1][typep->ctrlgroup_entry][typep->val.i];
+                storage.getPatch().markParameterDirty(subtypep->id);
             }
             refresh_editor = true;
             break;
@@ -1947,6 +1960,10 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
                             storage.getPatch().param_ptr[index]->val.i;
                     }
                 }
+
+                // This can be the audio thread, so the loader's thread makes room for the new
+                // type in the oscillator pool; loadOscalgos holds the type back until it has
+                shadowPatchLoader->requestOscillatorBlocks();
             }
             /*
              * Since we are setting a Queue, we don't need to toggle controls
@@ -1956,6 +1973,10 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
             refresh_editor = true;
             break;
         }
+        case ct_polylimit:
+            if (storage.getPatch().param_ptr[index]->val.i != oldval.i)
+                shadowPatchLoader->requestOscillatorBlocks();
+            break;
         case ct_wstype:
         case ct_bool_mute:
         case ct_bool_fm:
@@ -1973,6 +1994,7 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
                     subp->val.i = 0;
                 else
                     subp->val.i = std::min(maxIVal - 1, subp->val.i);
+                subp->markDirty();
                 storage.subtypeMemory[subp->scene - 1][subp->ctrlgroup_entry][filterType] =
                     subp->val.i;
 
@@ -1991,17 +2013,13 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
                 fxsync[cge].type.val.i = p->val.i;
                 p->val.i = oldval.i; // so funnily we want to set the value *back* so the loadFX
                                      // picks up the change in fxsync
-                Effect *t_fx = spawn_effect(fxsync[cge].type.val.i, &storage, &fxsync[cge], 0);
-                if (t_fx)
-                {
-                    t_fx->init_ctrltypes();
-                    t_fx->init_default_values();
-                    delete t_fx;
-                }
+                p->markDirty();
 
+                // the defaults come from the new effect itself, once the loader has built it
                 switch_toggled_queued = true;
                 load_fx_needed = true;
                 fx_reload[cge] = true;
+                fx_reload_defaults[cge] = true;
             }
             break;
         }
@@ -2022,6 +2040,11 @@ bool SurgeSynthesizer::setParameter01(long index, float value, bool external, bo
                     polarity * storage.getPatch().scene[s].filterunit[0].envmod.val.f;
                 storage.getPatch().scene[s].filterunit[1].keytrack.val.f +=
                     polarity * storage.getPatch().scene[s].filterunit[0].keytrack.val.f;
+
+                for (auto *fp : {&storage.getPatch().scene[s].filterunit[1].cutoff,
+                                 &storage.getPatch().scene[s].filterunit[1].envmod,
+                                 &storage.getPatch().scene[s].filterunit[1].keytrack})
+                    storage.getPatch().markParameterDirty(fp->id);
             }
 
             if (down)
@@ -2090,7 +2113,7 @@ void SurgeSynthesizer::switch_toggled()
 {
     for (int s = 0; s < n_scenes; s++)
     {
-        list<SurgeVoice *>::iterator iter;
+        ActiveVoiceTable::iterator iter;
         for (iter = voices[s].begin(); iter != voices[s].end(); iter++)
         {
             SurgeVoice *v = *iter;
@@ -2102,12 +2125,41 @@ void SurgeSynthesizer::switch_toggled()
 bool SurgeSynthesizer::loadFx(bool initp, bool force_reload_all)
 {
     load_fx_needed = false;
+
+    if (force_reload_all)
+    {
+        // every slot is rebuilt right here, so anything still in flight or fading is moot
+        effectLoader->discardPendingLoads();
+        for (auto &f : fxFade)
+        {
+            effectLoader->retire(std::move(f.outgoing));
+            f.blocksLeft = 0;
+        }
+    }
+
     for (int s = 0; s < n_fx_slots; s++)
     {
         bool something_changed = false;
-        if ((fxsync[s].type.val.i != storage.getPatch().fx[s].type.val.i) || force_reload_all)
+        if ((fxsync[s].type.val.i != storage.getPatch().fx[s].type.val.i) && !force_reload_all)
+        {
+            // built off the audio thread and swapped in by applyLoadedFx
+            if (effectLoader->post(s, fxsync[s], initp || fx_reload_defaults[s]))
+            {
+                fx_reload[s] = false;
+                fx_reload_defaults[s] = false;
+            }
+            else
+            {
+                // the slot is still busy with the previous change; try again next block
+                load_fx_needed = true;
+            }
+        }
+        else if ((fxsync[s].type.val.i != storage.getPatch().fx[s].type.val.i) ||
+                 force_reload_all)
         {
             fx_reload[s] = false;
+            fx_reload_defaults[s] = false;
+            storage.getPatch().markAllParametersDirty();
 
             fx[s].reset();
             /*if (!force_reload_all)*/ storage.getPatch().fx[s].type.val.i = fxsync[s].type.val.i;
@@ -2139,37 +2191,7 @@ bool SurgeSynthesizer::loadFx(bool initp, bool force_reload_all)
                 if (initp)
                     fx[s]->init_default_values();
                 else
-                {
-                    for (int j = 0; j < n_fx_params; j++)
-                    {
-                        auto p = &(storage.getPatch().fx[s].p[j]);
-                        if (p->ctrltype != ct_none)
-                        {
-                            if (p->valtype == vt_float)
-                            {
-                                if (p->val.f < p->val_min.f)
-                                {
-                                    p->val.f = p->val_min.f;
-                                }
-                                if (p->val.f > p->val_max.f)
-                                {
-                                    p->val.f = p->val_max.f;
-                                }
-                            }
-                            else if (p->valtype == vt_int)
-                            {
-                                if (p->val.i < p->val_min.i)
-                                {
-                                    p->val.i = p->val_min.i;
-                                }
-                                if (p->val.i > p->val_max.i)
-                                {
-                                    p->val.i = p->val_max.i;
-                                }
-                            }
-                        }
-                    }
-                }
+                    Surge::FX::EffectLoader::boundParameters(storage.getPatch().fx[s]);
                 /*for(int j=0; j<n_fx_params; j++)
                 {
                     storage.getPatch().globaldata[storage.getPatch().fx[s].p[j].id].f =
@@ -2237,6 +2259,7 @@ bool SurgeSynthesizer::loadFx(bool initp, bool force_reload_all)
             }
             fx_reload[s] = false;
             fx_reload_mod[s] = false;
+            storage.getPatch().markAllParametersDirty();
             refresh_editor = true;
             something_changed = true;
         }
@@ -2251,6 +2274,161 @@ bool SurgeSynthesizer::loadFx(bool initp, bool force_reload_all)
     return true;
 }
 
+void SurgeSynthesizer::applyLoadedFx()
+{
+    std::unique_lock<std::mutex> spawnLock(fxSpawnMutex, std::defer_lock);
+
+    for (int s = 0; s < n_fx_slots; s++)
+    {
+        if (!effectLoader->isReady(s))
+            continue;
+
+        // the editor is looking at fx[] right now; the effect will keep until the next block
+        if (!spawnLock.owns_lock() && !spawnLock.try_lock())
+            return;
+
+        std::unique_ptr<Effect> incoming;
+        auto *loaded = effectLoader->collect(s, incoming);
+        if (!loaded)
+            continue;
+
+        auto &patch = storage.getPatch();
+        auto &fade = fxFade[s];
+
+        // a fade still running on this slot is cut short
+        effectLoader->retire(std::move(fade.outgoing));
+        memcpy((void *)&fxFadeStorage[s], (void *)&patch.fx[s], sizeof(FxStorage));
+        memcpy((void *)fxFadeData[s], (void *)patch.globaldata, sizeof(fxFadeData[s]));
+        fade.outgoing = std::move(fx[s]);
+        if (fade.outgoing)
+            fade.outgoing->rebind(&fxFadeStorage[s], fxFadeData[s]);
+        fade.blocksLeft = fade.length = fxFadeBlocks;
+        fade.tail = false;
+
+        patch.fx[s].type.val.i = loaded->type.val.i;
+        memcpy((void *)&patch.fx[s].p, (void *)&loaded->p, sizeof(Parameter) * n_fx_params);
+        for (int j = 0; j < n_fx_params; j++)
+            patch.globaldata[patch.fx[s].p[j].id] = patch.fx[s].p[j].val;
+        patch.markAllParametersDirty();
+
+        fx[s] = std::move(incoming);
+        if (fx[s])
+            fx[s]->rebind(&patch.fx[s], patch.globaldata);
+
+        // unless fxsync has moved on since, it should now agree with the patch
+        if (!fx_reload[s] && fxsync[s].type.val.i == loaded->type.val.i)
+            memcpy((void *)&fxsync[s].p, (void *)&loaded->p, sizeof(Parameter) * n_fx_params);
+
+        effectLoader->release(s);
+
+        // as in loadFx, modulation onto the old effect's parameters means nothing now. #2036
+        for (int j = 0; j < n_fx_params; j++)
+        {
+            auto p = &(patch.fx[s].p[j]);
+            for (int ms = 1; ms < n_modsources; ms++)
+            {
+                clearModulation(p->id, (modsources)ms, true);
+            }
+        }
+
+        if (fx[s])
+        {
+            if (fx_reload_mod[s])
+            {
+                for (auto &t : fxmodsync[s])
+                {
+                    setModulation(patch.fx[s].p[std::get<1>(t)].id, (modsources)std::get<0>(t),
+                                  std::get<2>(t));
+                }
+                fxmodsync[s].clear();
+                fx_reload_mod[s] = false;
+            }
+
+            fx[s]->updateAfterReload();
+        }
+
+        refresh_editor = true;
+
+        // the type changed again while this one was being built
+        if (fxsync[s].type.val.i != patch.fx[s].type.val.i)
+            load_fx_needed = true;
+    }
+}
+
+bool SurgeSynthesizer::processFxSlot(int slot, float *dataL, float *dataR, bool indata_present,
+                                     bool silentWhenOff)
+{
+    auto t0 = Surge::Profiling::ProcessProfiler::now();
+    auto &fade = fxFade[slot];
+    if (fade.blocksLeft == 0)
+    {
+        auto out = fx[slot]->process_ringout(dataL, dataR, indata_present);
+        storage.processProfiler->addFxSlot(slot, t0);
+        return out;
+    }
+
+    float oldL alignas(16)[BLOCK_SIZE], oldR alignas(16)[BLOCK_SIZE];
+    if (fade.tail)
+    {
+        clear_block(oldL, BLOCK_SIZE_QUAD);
+        clear_block(oldR, BLOCK_SIZE_QUAD);
+    }
+    else
+    {
+        copy_block(dataL, oldL, BLOCK_SIZE_QUAD);
+        copy_block(dataR, oldR, BLOCK_SIZE_QUAD);
+    }
+
+    bool out = false;
+    auto run = [&](Effect *e, float *L, float *R, bool in) {
+        if (e)
+            return e->process_ringout(L, R, in);
+        if (silentWhenOff)
+        {
+            clear_block(L, BLOCK_SIZE_QUAD);
+            clear_block(R, BLOCK_SIZE_QUAD);
+            return false;
+        }
+        return in;
+    };
+    bool oldOut = run(fade.outgoing.get(), oldL, oldR, indata_present && !fade.tail);
+    out |= run(fx[slot].get(), dataL, dataR, indata_present);
+
+    // a linear ramp from the old effect to the new one over the whole fade
+    float g0 = (float)fade.blocksLeft / fade.length;
+    float dg = -1.f / (fade.length * BLOCK_SIZE);
+    if (fade.tail)
+    {
+        for (int k = 0; k < BLOCK_SIZE; k++)
+        {
+            float g = g0 + dg * (k + 1);
+            dataL[k] += g * oldL[k];
+            dataR[k] += g * oldR[k];
+        }
+
+        // nothing left to ring out
+        if (!oldOut)
+            fade.blocksLeft = 1;
+        out |= oldOut;
+    }
+    else
+    {
+        for (int k = 0; k < BLOCK_SIZE; k++)
+        {
+            float g = g0 + dg * (k + 1);
+            dataL[k] += g * (oldL[k] - dataL[k]);
+            dataR[k] += g * (oldR[k] - dataR[k]);
+        }
+        out |= oldOut;
+    }
+
+    if (--fade.blocksLeft == 0)
+        effectLoader->retire(std::move(fade.outgoing));
+
+    storage.processProfiler->addFxSlot(slot, t0);
+    return out;
+}
+
 bool SurgeSynthesizer::loadOscalgos()
 {
     for (int s = 0; s < n_scenes; s++)
@@ -2258,8 +2436,16 @@ bool SurgeSynthesizer::loadOscalgos()
         for (int i = 0; i < n_oscs; i++)
         {
             bool resend = false;
+            auto queuedType = storage.getPatch().scene[s].osc[i].queue_type;
+
+            // A type which borrows from the oscillator pool waits until the pool has room for it
+            if (queuedType > -1 && osc_needs_pool_block(queuedType) &&
+                !shadowPatchLoader->oscillatorBlocksReserved())
+            {
+                queuedType = -1;
+            }
 
-            if (storage.getPatch().scene[s].osc[i].queue_type > -1)
+            if (queuedType > -1)
             {
                 // clear assigned modulation if we change osc type, see issue #2224
                 if (storage.getPatch().scene[s].osc[i].queue_type !=
@@ -2333,6 +2519,7 @@ bool SurgeSynthesizer::loadOscalgos()
                     refresh_editor = true;
                 }
                 storage.getPatch().scene[s].osc[i].queue_xmldata = 0;
+                storage.getPatch().markAllParametersDirty();
             }
         }
     }
@@ -2553,20 +2740,22 @@ void SurgeSynthesizer::prepareModsourceDoProcess(int scenemask)
                 storage.getPatch().scene[scene].modsource_doprocess[i] = setTo;
             }
 
+            auto &routing = storage.modRoutingTable->current();
+
             for (int j = 0; j < 3; j++)
             {
-                vector<ModulationRouting> *modlist;
+                const vector<ModulationRouting> *modlist;
 
                 switch (j)
                 {
                 case 0:
-                    modlist = &storage.getPatch().modulation_global;
+                    modlist = &routing.global;
                     break;
                 case 1:
-                    modlist = &storage.getPatch().scene[scene].modulation_scene;
+                    modlist = &routing.scenes[scene].scene;
                     break;
                 case 2:
-                    modlist = &storage.getPatch().scene[scene].modulation_voice;
+                    modlist = &routing.scenes[scene].voice;
                     break;
                 }
 
@@ -2617,9 +2806,13 @@ void SurgeSynthesizer::muteModulation(long ptag, modsources modsource, bool mute
     if (!isValidModulation(ptag, modsource))
         return;
 
+    std::lock_guard<std::recursive_mutex> g(storage.modRoutingMutex);
     ModulationRouting *r = getModRouting(ptag, modsource);
     if (r)
+    {
         r->muted = mute;
+        storage.publishModulationRouting();
+    }
 }
 
 void SurgeSynthesizer::clear_osc_modulation(int scene, int entry)
@@ -2648,6 +2841,7 @@ void SurgeSynthesizer::clear_osc_modulation(int scene, int entry)
         else
             iter++;
     }
+    storage.publishModulationRouting();
     storage.modRoutingMutex.unlock();
 }
 
@@ -2683,6 +2877,7 @@ void SurgeSynthesizer::clearModulation(long ptag, modsources modsource, bool cle
         {
             storage.modRoutingMutex.lock();
             modlist->erase(modlist->begin() + i);
+            storage.publishModulationRouting();
             storage.modRoutingMutex.unlock();
             return;
         }
@@ -2749,6 +2944,7 @@ bool SurgeSynthesizer::setModulation(long ptag, modsources modsource, float val)
             modlist->at(found_id).depth = value;
         }
     }
+    storage.publishModulationRouting();
     storage.modRoutingMutex.unlock();
 
     return true;
@@ -3063,6 +3259,7 @@ DWORD WINAPI loadPatchInBackgroundThread(LPVOID lpParam)
         synth->has_patchid_file = false;
         synth->allNotesOff();
 
+        synth->storage.ensurePatchListLoaded();
         int ptid = -1, ct = 0;
         for (const auto &pti : synth->storage.patch_list)
         {
@@ -3100,8 +3297,14 @@ void SurgeSynthesizer::processThreadunsafeOperations(bool dangerMode)
         }
 
         if (load_fx_needed)
+        {
             loadFx(false, false);
 
+            // nothing is running process() to pick up a changed effect, so wait for it here
+            effectLoader->waitForPendingLoads();
+            applyLoadedFx();
+        }
+
         loadOscalgos();
     }
 }
@@ -3167,6 +3370,7 @@ void SurgeSynthesizer::processControl()
             bool cont = mc->process_block_until_close(0.001f);
             int id = mc->id;
             storage.getPatch().param_ptr[id]->set_value_f01(mc->output);
+            storage.getPatch().markParameterDirty(id);
             if (!cont)
             {
                 mControlInterpolatorUsed[i] = false;
@@ -3174,15 +3378,8 @@ void SurgeSynthesizer::processControl()
         }
     }
 
-    storage.getPatch().copy_globaldata(
-        storage.getPatch()
-            .globaldata); // Drains a great deal of CPU while in Debug mode.. optimize?
-
     // TODO: FIX SCENE ASSUMPTION
-    if (playA)
-        storage.getPatch().copy_scenedata(storage.getPatch().scenedata[0], 0); // -""-
-    if (playB)
-        storage.getPatch().copy_scenedata(storage.getPatch().scenedata[1], 1);
+    storage.getPatch().sync_paramdata((playA ? 1 : 0) | (playB ? 2 : 0));
 
     //	if(sm == sm_morph) storage.getPatch().do_morph();
 
@@ -3226,17 +3423,21 @@ void SurgeSynthesizer::processControl()
             // for(int i=0; i<n_lfos_scene; i++)
             // storage.getPatch().scene[s].modsources[ms_slfo1+i]->process_block();
 
-            int n = storage.getPatch().scene[s].modulation_scene.size();
+            auto &modulation_scene = storage.modRoutingTable->current().scenes[s].scene;
+            int n = modulation_scene.size();
             for (int i = 0; i < n; i++)
             {
-                int src_id = storage.getPatch().scene[s].modulation_scene[i].source_id;
+                int src_id = modulation_scene[i].source_id;
                 if (storage.getPatch().scene[s].modsources[src_id])
                 {
-                    int dst_id = storage.getPatch().scene[s].modulation_scene[i].destination_id;
-                    float depth = storage.getPatch().scene[s].modulation_scene[i].depth;
+                    int dst_id = modulation_scene[i].destination_id;
+                    float depth = modulation_scene[i].depth;
                     storage.getPatch().scenedata[s][dst_id].f +=
                         depth * storage.getPatch().scene[s].modsources[src_id]->output *
-                        (1.0 - storage.getPatch().scene[s].modulation_scene[i].muted);
+                        (1.0 - modulation_scene[i].muted);
+                    // so the next block starts over from the unmodulated value
+                    storage.getPatch().markParameterDirty(storage.getPatch().scene_start[s] +
+                                                          dst_id);
                 }
             }
 
@@ -3247,15 +3448,17 @@ void SurgeSynthesizer::processControl()
 
     loadOscalgos();
 
-    int n = storage.getPatch().modulation_global.size();
+    auto &modulation_global = storage.modRoutingTable->current().global;
+    int n = modulation_global.size();
     for (int i = 0; i < n; i++)
     {
-        int src_id = storage.getPatch().modulation_global[i].source_id;
-        int dst_id = storage.getPatch().modulation_global[i].destination_id;
-        float depth = storage.getPatch().modulation_global[i].depth;
+        int src_id = modulation_global[i].source_id;
+        int dst_id = modulation_global[i].destination_id;
+        float depth = modulation_global[i].depth;
         storage.getPatch().globaldata[dst_id].f +=
             depth * storage.getPatch().scene[0].modsources[src_id]->output *
-            (1 - storage.getPatch().modulation_global[i].muted);
+            (1 - modulation_global[i].muted);
+        storage.getPatch().markParameterDirty(dst_id);
     }
 
     if (switch_toggled_queued)
@@ -3264,6 +3467,8 @@ void SurgeSynthesizer::processControl()
         switch_toggled_queued = false;
     }
 
+    applyLoadedFx();
+
     if (load_fx_needed)
         loadFx(false, false);
 
@@ -3296,6 +3501,375 @@ void SurgeSynthesizer::processControl()
     }
 }
 
+void SurgeSynthesizer::prepareVoiceQuad(int s, int q, int n)
+{
+    int e0 = q << 2;
+    int units = std::min(n - e0, 4);
+
+    for (int i = 0; i < units; ++i)
+    {
+        SurgeVoice *v = voices[s][e0 + i];
+        assert(v);
+
+#if STORAGE_USES_INDEPENDENT_RNG
+        if (storage.independentVoiceRngs)
+            SurgeStorage::threadRngGen = &v->rngGen;
+#endif
+        bool resume = v->process_block(FBQ[s][q], i);
+        voiceAlive[s][e0 + i] = resume;
+
+        if (!resume)
+            freeVoice(v);
+    }
+#if STORAGE_USES_INDEPENDENT_RNG
+    SurgeStorage::threadRngGen = storage.independentSceneRngs ? &storage.sceneRngGen[s] : nullptr;
+#endif
+
+    for (int i = units; i < 4; i++)
+    {
+        FBQ[s][q].FU[0].active[i] = 0;
+        FBQ[s][q].FU[1].active[i] = 0;
+        FBQ[s][q].FU[2].active[i] = 0;
+        FBQ[s][q].FU[3].active[i] = 0;
+    }
+}
+
+void SurgeSynthesizer::finishVoiceQuad(int s, int q, int n)
+{
+    int e0 = q << 2;
+    int units = std::min(n - e0, 4);
+
+    for (int i = 0; i < units; ++i)
+    {
+        // save filter state in voices after quad processing is done
+        if (voiceAlive[s][e0 + i])
+            voices[s][e0 + i]->GetQFB();
+    }
+}
+
+void SurgeSynthesizer::renderVoiceQuad(int s, int q, int n, fbq_global &g, FBQFPtr ProcessQuadFB,
+                                       float *outL, float *outR)
+{
+    prepareVoiceQuad(s, q, n);
+    auto t0 = Surge::Profiling::ProcessProfiler::now();
+    ProcessQuadFB(FBQ[s][q], g, outL, outR);
+    storage.processProfiler->addFilterChain(t0);
+    finishVoiceQuad(s, q, n);
+}
+
+void SurgeSynthesizer::renderVoiceGroup(int s, int q0, int quads, int n, wide_fbq_global &g,
+                                        WideFBQFPtr ProcessWideFB, float **outL, float **outR)
+{
+    for (int q = q0; q < q0 + quads; ++q)
+        prepareVoiceQuad(s, q, n);
+    auto t0 = Surge::Profiling::ProcessProfiler::now();
+    ProcessWideFB(&FBQ[s][q0], g, outL, outR);
+    storage.processProfiler->addFilterChain(t0);
+    for (int q = q0; q < q0 + quads; ++q)
+        finishVoiceQuad(s, q, n);
+}
+
+bool SurgeSynthesizer::voicesUseFormulaModulators(int s)
+{
+    // All the voices of both scenes evaluate formulas in the storage's one Lua state, so only one
+    // thread may run them
+    for (int l = 0; l < n_lfos_voice; ++l)
+    {
+        if (storage.getPatch().scene[s].lfo[l].shape.val.i == lt_formula)
+            return true;
+    }
+    return false;
+}
+
+void SurgeSynthesizer::setVoiceThreads(int n)
+{
+#if STORAGE_USES_INDEPENDENT_RNG
+    storage.independentVoiceRngs = n > 1;
+#endif
+
+    if (n > 1)
+        voicePool = std::make_unique<Surge::Threading::WorkStealingPool>(n);
+    else
+        voicePool.reset();
+}
+
+void SurgeSynthesizer::setFilterChainLanes(int lanes)
+{
+    lanes = lanes >= 16 ? 16 : (lanes >= 8 ? 8 : 4);
+    filterChainLanes = std::min(lanes, GetWideFilterLanesAvailable());
+}
+
+void SurgeSynthesizer::renderScene(int s)
+{
+#if STORAGE_USES_INDEPENDENT_RNG
+    if (storage.independentSceneRngs)
+        SurgeStorage::threadRngGen = &storage.sceneRngGen[s];
+#endif
+
+    typedef Surge::Profiling::ProcessProfiler prof_t;
+    auto &profiler = *storage.processProfiler;
+    auto mark = profiler.now();
+
+    bool play_scene = (!voices[s].empty());
+
+    fbq_global g;
+    g.FU1ptr = GetQFPtrFilterUnit(storage.getPatch().scene[s].filterunit[0].type.val.i,
+                                  storage.getPatch().scene[s].filterunit[0].subtype.val.i);
+    g.FU2ptr = GetQFPtrFilterUnit(storage.getPatch().scene[s].filterunit[1].type.val.i,
+                                  storage.getPatch().scene[s].filterunit[1].subtype.val.i);
+    g.WSptr = GetQFPtrWaveshaper(storage.getPatch().scene[s].wsunit.type.val.i);
+
+    FBQFPtr ProcessQuadFB =
+        GetFBQPointer(storage.getPatch().scene[s].filterblock_configuration.val.i,
+                      g.FU1ptr != 0, g.WSptr != 0, g.FU2ptr != 0);
+
+    int n = voices[s].size();
+    int nquads = (n + 3) >> 2;
+
+    if (batchedModulators && SurgeVoice::process_modulators_batch(voices[s].begin(), n))
+        batchedModulatorBlocks++;
+
+    /*
+     * Split the quads into groups which run through one filter chain call: as many 16 and then
+     * 8 lane groups as the CPU, the filters in use and the voice count allow, then single quads.
+     */
+    struct VoiceGroup
+    {
+        int q0, quads;
+        WideFBQFPtr ProcessWideFB;
+        wide_fbq_global *wg;
+    } groups[MAX_VOICES >> 2];
+    wide_fbq_global wg[2]; // 16 and 8 lanes
+    int ngroups = 0, q0 = 0;
+
+    for (int lanes = filterChainLanes; lanes > 4; lanes >>= 1)
+    {
+        int quads = lanes >> 2;
+        auto &w = wg[lanes == 16 ? 0 : 1];
+        if (nquads - q0 < quads ||
+            !GetWideFBQGlobal(lanes, storage.getPatch().scene[s].filterunit[0].type.val.i,
+                              storage.getPatch().scene[s].filterunit[0].subtype.val.i,
+                              storage.getPatch().scene[s].filterunit[1].type.val.i,
+                              storage.getPatch().scene[s].filterunit[1].subtype.val.i,
+                              storage.getPatch().scene[s].wsunit.type.val.i, w))
+            continue;
+
+        auto ProcessWideFB =
+            GetWideFBQPointer(lanes, storage.getPatch().scene[s].filterblock_configuration.val.i,
+                              g.FU1ptr != 0, g.WSptr != 0, g.FU2ptr != 0);
+        for (; nquads - q0 >= quads; q0 += quads)
+            groups[ngroups++] = {q0, quads, ProcessWideFB, &w};
+    }
+    for (; q0 < nquads; ++q0)
+        groups[ngroups++] = {q0, 1, nullptr, nullptr};
+
+    if (voicePool && ngroups > 1 && !voicesUseFormulaModulators(s))
+    {
+        /*
+         * Each quad renders into its own buffer, which we then sum in quad order. Since the
+         * quads add into a cleared buffer, that is exactly the sum the serial path makes.
+         */
+        auto groupJob = [this, s, n, &g, ProcessQuadFB, &groups](int i) {
+            auto &gr = groups[i];
+            float *outL[4], *outR[4];
+            for (int j = 0; j < gr.quads; ++j)
+            {
+                outL[j] = quadout[s][gr.q0 + j][0];
+                outR[j] = quadout[s][gr.q0 + j][1];
+                clear_block(outL[j], BLOCK_SIZE_OS_QUAD);
+                clear_block(outR[j], BLOCK_SIZE_OS_QUAD);
+            }
+
+            if (gr.ProcessWideFB)
+                renderVoiceGroup(s, gr.q0, gr.quads, n, *gr.wg, gr.ProcessWideFB, outL, outR);
+            else
+                renderVoiceQuad(s, gr.q0, n, g, ProcessQuadFB, outL[0], outR[0]);
+        };
+        voicePool->run(ngroups, groupJob);
+        voicePoolRuns++;
+
+        for (int q = 0; q < nquads; ++q)
+        {
+            accumulate_block(quadout[s][q][0], sceneout[s][0], BLOCK_SIZE_OS_QUAD);
+            accumulate_block(quadout[s][q][1], sceneout[s][1], BLOCK_SIZE_OS_QUAD);
+        }
+    }
+    else
+    {
+        // a wide group adds its quads into the scene one after the other, like the quad loop
+        float *outL[4], *outR[4];
+        for (int j = 0; j < 4; ++j)
+        {
+            outL[j] = sceneout[s][0];
+            outR[j] = sceneout[s][1];
+        }
+
+        for (int i = 0; i < ngroups; ++i)
+        {
+            auto &gr = groups[i];
+            if (gr.ProcessWideFB)
+                renderVoiceGroup(s, gr.q0, gr.quads, n, *gr.wg, gr.ProcessWideFB, outL, outR);
+            else
+                renderVoiceQuad(s, gr.q0, n, g, ProcessQuadFB, sceneout[s][0], sceneout[s][1]);
+        }
+    }
+
+    /*
+     * Voices which finished this block still rendered their lane above, but the survivors
+     * are slid down over them now so next block's lanes are packed.
+     */
+    int alive = 0;
+    for (int e = 0; e < n; ++e)
+    {
+        if (voiceAlive[s][e])
+            voices[s][alive++] = voices[s][e];
+    }
+    voices[s].truncate(alive);
+    sceneVoiceCount[s] = n;
+
+    if (s == 0 && storage.otherscene_clients > 0)
+    {
+        // Make available for scene B
+        copy_block(sceneout[0][0], storage.audio_otherscene[0], BLOCK_SIZE_OS_QUAD);
+        copy_block(sceneout[0][1], storage.audio_otherscene[1], BLOCK_SIZE_OS_QUAD);
+    }
+
+    profiler.lap(prof_t::stage_voices, mark);
+
+    // TODO: FIX SCENE ASSUMPTION
+    auto &halfband = (s == 0) ? halfbandA : halfbandB;
+    auto &hp = (s == 0) ? hpA : hpB;
+
+    if (play_scene)
+    {
+        switch (storage.sceneHardclipMode[s])
+        {
+        case SurgeStorage::HARDCLIP_TO_18DBFS:
+            hardclip_block8(sceneout[s][0], BLOCK_SIZE_OS_QUAD);
+            hardclip_block8(sceneout[s][1], BLOCK_SIZE_OS_QUAD);
+            break;
+        case SurgeStorage::HARDCLIP_TO_0DBFS:
+            hardclip_block(sceneout[s][0], BLOCK_SIZE_OS_QUAD);
+            hardclip_block(sceneout[s][1], BLOCK_SIZE_OS_QUAD);
+            break;
+        case SurgeStorage::BYPASS_HARDCLIP:
+            break;
+        }
+
+        halfband.process_block_D2(sceneout[s][0], sceneout[s][1]);
+    }
+
+    if (storage.getPatch().scene[s].lowcut.deactivated == false)
+    {
+        auto freq =
+            storage.getPatch().scenedata[s][storage.getPatch().scene[s].lowcut.param_id_in_scene].f;
+
+        hp.coeff_HP(hp.calc_omega(freq / 12.0), 0.4);    // var 0.707
+        hp.process_block(sceneout[s][0], sceneout[s][1]); // TODO: quadify
+    }
+
+    switch (storage.sceneHardclipMode[s])
+    {
+    case SurgeStorage::HARDCLIP_TO_18DBFS:
+        hardclip_block8(sceneout[s][0], BLOCK_SIZE_QUAD);
+        hardclip_block8(sceneout[s][1], BLOCK_SIZE_QUAD);
+        break;
+    case SurgeStorage::HARDCLIP_TO_0DBFS:
+        hardclip_block(sceneout[s][0], BLOCK_SIZE_QUAD);
+        hardclip_block(sceneout[s][1], BLOCK_SIZE_QUAD);
+        break;
+    default:
+        break;
+    }
+
+    profiler.lap(prof_t::stage_scene_out, mark);
+
+    // apply insert effects
+    bool sc_state = play_scene;
+    int fx_bypass = storage.getPatch().fx_bypass.val.i;
+
+    if (fx_bypass != fxb_no_fx)
+    {
+        // TODO: FIX SCENE ASSUMPTION
+        int slots[2] = {fxslot_ains1, fxslot_ains2};
+        if (s == 1)
+        {
+            slots[0] = fxslot_bins1;
+            slots[1] = fxslot_bins2;
+        }
+
+        for (auto slot : slots)
+        {
+            if (fxSlotActive(slot) && !(storage.getPatch().fx_disable.val.i & (1 << slot)))
+            {
+                sc_state = processFxSlot(slot, sceneout[s][0], sceneout[s][1], sc_state, false);
+            }
+        }
+    }
+    profiler.lap(prof_t::stage_insert_fx, mark);
+
+    switch (storage.sceneHardclipMode[s])
+    {
+    case SurgeStorage::HARDCLIP_TO_18DBFS:
+        hardclip_block8(sceneout[s][0], BLOCK_SIZE_QUAD);
+        hardclip_block8(sceneout[s][1], BLOCK_SIZE_QUAD);
+        break;
+    case SurgeStorage::HARDCLIP_TO_0DBFS:
+        hardclip_block(sceneout[s][0], BLOCK_SIZE_QUAD);
+        hardclip_block(sceneout[s][1], BLOCK_SIZE_QUAD);
+        break;
+    default:
+        break;
+    }
+
+    sceneRingout[s] = sc_state;
+    profiler.lap(prof_t::stage_scene_out, mark);
+
+#if STORAGE_USES_INDEPENDENT_RNG
+    SurgeStorage::threadRngGen = nullptr;
+#endif
+}
+
+void SurgeSynthesizer::setMultithreadedScenes(bool b)
+{
+#if STORAGE_USES_INDEPENDENT_RNG
+    storage.independentSceneRngs = b;
+#endif
+
+    if (b && !sceneWorker)
+    {
+        sceneWorker =
+            std::make_unique<Surge::Threading::RealtimeWorker>([this]() { renderScene(1); });
+    }
+    else if (!b)
+    {
+        sceneWorker.reset();
+    }
+}
+
+bool SurgeSynthesizer::canRenderScenesInParallel()
+{
+    // An audio input oscillator in scene B listens to scene A, so that has to come first
+    if (storage.otherscene_clients > 0)
+        return false;
+
+    // With a voice pool the pool already has the cores, so the scenes take turns using it
+    if (voicePool)
+        return false;
+
+    /*
+     * Voice LFOs running formulas evaluate in the storage's one Lua state, which must not be
+     * entered from two threads at once. One scene using them is fine; both is not.
+     */
+    auto sceneUsesFormulas = [this](int s) {
+        for (int l = 0; l < n_lfos_voice; ++l)
+            if (storage.getPatch().scene[s].lfo[l].shape.val.i == lt_formula)
+                return true;
+        return false;
+    };
+    return !(sceneUsesFormulas(0) && sceneUsesFormulas(1));
+}
+
 void SurgeSynthesizer::process()
 {
 #if DEBUG_RNG_THREADING
@@ -3310,7 +3884,12 @@ void SurgeSynthesizer::process()
         clear_block(output[1], BLOCK_SIZE_QUAD);
         return;
     }
-    else if (patchid_queue >= 0 || has_patchid_file)
+
+    typedef Surge::Profiling::ProcessProfiler prof_t;
+    auto &profiler = *storage.processProfiler;
+    auto block = profiler.beginBlock();
+
+    if (!gaplessPatchSwitching && (patchid_queue >= 0 || has_patchid_file))
     {
         masterfade = max(0.f, masterfade - 0.05f);
         mfade = masterfade * masterfade;
@@ -3358,6 +3937,26 @@ void SurgeSynthesizer::process()
             return;
         }
     }
+    else
+    {
+        // play on while a restored state or (gapless) the next patch builds, then dip just long
+        // enough to swap it in
+        if (patchid_queue >= 0 || has_patchid_file)
+            shadowPatchLoader->poke();
+
+        if (shadowPatchLoader->isReady())
+        {
+            masterfade = max(0.f, masterfade - 1.f / patchSwitchDipBlocks);
+            if (masterfade <= 0.f)
+                commitShadowPatch();
+        }
+        else if (masterfade < 1.f)
+        {
+            masterfade = min(1.f, masterfade + 1.f / patchSwitchDipBlocks);
+        }
+        mfade = masterfade * masterfade;
+    }
+    profiler.lap(prof_t::stage_patch, block.mark);
 
     // process inputs (upsample & halfrate)
     if (process_input)
@@ -3378,7 +3977,6 @@ void SurgeSynthesizer::process()
 
     // TODO: FIX SCENE ASSUMPTION
     float fxsendout alignas(16)[2][2][BLOCK_SIZE];
-    bool play_scene[n_scenes];
 
     {
         clear_block_antidenormalnoise(sceneout[0][0], BLOCK_SIZE_OS_QUAD);
@@ -3392,7 +3990,10 @@ void SurgeSynthesizer::process()
         clear_block_antidenormalnoise(fxsendout[1][1], BLOCK_SIZE_QUAD);
     }
 
-    storage.modRoutingMutex.lock();
+    profiler.lap(prof_t::stage_input, block.mark);
+
+    // the routings for this block; editors publish new ones rather than locking us out
+    storage.modRoutingTable->acquire();
     processControl();
 
     amp.set_target_smoothed(db_to_linear(storage.getPatch().volume.val.f));
@@ -3402,7 +4003,7 @@ void SurgeSynthesizer::process()
 
     if (fx_bypass == fxb_all_fx)
     {
-        if (fx[fxslot_send1])
+        if (fxSlotActive(fxslot_send1))
         {
             FX1.set_target_smoothed(
                 amp_to_linear(storage.getPatch()
@@ -3417,7 +4018,7 @@ void SurgeSynthesizer::process()
                     .scenedata[1][storage.getPatch().scene[1].send_level[0].param_id_in_scene]
                     .f));
         }
-        if (fx[fxslot_send2])
+        if (fxSlotActive(fxslot_send2))
         {
             FX2.set_target_smoothed(
                 amp_to_linear(storage.getPatch()
@@ -3434,211 +4035,33 @@ void SurgeSynthesizer::process()
         }
     }
 
-    list<SurgeVoice *>::iterator iter;
+    profiler.lap(prof_t::stage_control, block.mark);
 
-    for (int sc = 0; sc < n_scenes; sc++)
+    if (sceneWorker && canRenderScenesInParallel())
     {
-        play_scene[sc] = (!voices[sc].empty());
+        // scene B renders on the worker while we do scene A
+        sceneWorker->start();
+        renderScene(0);
+        sceneWorker->wait();
+        sceneWorkerBlocks++;
     }
-
-    int FBentry[n_scenes];
-    int vcount = 0;
-
-    for (int s = 0; s < n_scenes; s++)
-    {
-        FBentry[s] = 0;
-        iter = voices[s].begin();
-        while (iter != voices[s].end())
-        {
-            SurgeVoice *v = *iter;
-            assert(v);
-            bool resume = v->process_block(FBQ[s][FBentry[s] >> 2], FBentry[s] & 3);
-            FBentry[s]++;
-
-            vcount++;
-
-            if (!resume)
-            {
-                freeVoice(v);
-                iter = voices[s].erase(iter);
-            }
-            else
-                iter++;
-        }
-
-        storage.modRoutingMutex.unlock();
-
-        fbq_global g;
-        g.FU1ptr = GetQFPtrFilterUnit(storage.getPatch().scene[s].filterunit[0].type.val.i,
-                                      storage.getPatch().scene[s].filterunit[0].subtype.val.i);
-        g.FU2ptr = GetQFPtrFilterUnit(storage.getPatch().scene[s].filterunit[1].type.val.i,
-                                      storage.getPatch().scene[s].filterunit[1].subtype.val.i);
-        g.WSptr = GetQFPtrWaveshaper(storage.getPatch().scene[s].wsunit.type.val.i);
-
-        FBQFPtr ProcessQuadFB =
-            GetFBQPointer(storage.getPatch().scene[s].filterblock_configuration.val.i,
-                          g.FU1ptr != 0, g.WSptr != 0, g.FU2ptr != 0);
-
-        for (int e = 0; e < FBentry[s]; e += 4)
-        {
-            int units = FBentry[s] - e;
-            for (int i = units; i < 4; i++)
-            {
-                FBQ[s][e >> 2].FU[0].active[i] = 0;
-                FBQ[s][e >> 2].FU[1].active[i] = 0;
-                FBQ[s][e >> 2].FU[2].active[i] = 0;
-                FBQ[s][e >> 2].FU[3].active[i] = 0;
-            }
-            ProcessQuadFB(FBQ[s][e >> 2], g, sceneout[s][0], sceneout[s][1]);
-        }
-
-        if (s == 0 && storage.otherscene_clients > 0)
-        {
-            // Make available for scene B
-            copy_block(sceneout[0][0], storage.audio_otherscene[0], BLOCK_SIZE_OS_QUAD);
-            copy_block(sceneout[0][1], storage.audio_otherscene[1], BLOCK_SIZE_OS_QUAD);
-        }
-
-        iter = voices[s].begin();
-        while (iter != voices[s].end())
-        {
-            SurgeVoice *v = *iter;
-            assert(v);
-            v->GetQFB(); // save filter state in voices after quad processing is done
-            iter++;
-        }
-        storage.modRoutingMutex.lock();
-    }
-
-    storage.modRoutingMutex.unlock();
-    polydisplay = vcount;
-
-    // TODO: FIX SCENE ASSUMPTION
-    if (play_scene[0])
-    {
-        switch (storage.sceneHardclipMode[0])
-        {
-        case SurgeStorage::HARDCLIP_TO_18DBFS:
-            hardclip_block8(sceneout[0][0], BLOCK_SIZE_OS_QUAD);
-            hardclip_block8(sceneout[0][1], BLOCK_SIZE_OS_QUAD);
-            break;
-        case SurgeStorage::HARDCLIP_TO_0DBFS:
-            hardclip_block(sceneout[0][0], BLOCK_SIZE_OS_QUAD);
-            hardclip_block(sceneout[0][1], BLOCK_SIZE_OS_QUAD);
-            break;
-        case SurgeStorage::BYPASS_HARDCLIP:
-            break;
-        }
-
-        halfbandA.process_block_D2(sceneout[0][0], sceneout[0][1]);
-    }
-
-    if (play_scene[1])
-    {
-        switch (storage.sceneHardclipMode[1])
-        {
-        case SurgeStorage::HARDCLIP_TO_18DBFS:
-            hardclip_block8(sceneout[1][0], BLOCK_SIZE_OS_QUAD);
-            hardclip_block8(sceneout[1][1], BLOCK_SIZE_OS_QUAD);
-            break;
-        case SurgeStorage::HARDCLIP_TO_0DBFS:
-            hardclip_block(sceneout[1][0], BLOCK_SIZE_OS_QUAD);
-            hardclip_block(sceneout[1][1], BLOCK_SIZE_OS_QUAD);
-            break;
-        case SurgeStorage::BYPASS_HARDCLIP:
-            break;
-        }
-
-        halfbandB.process_block_D2(sceneout[1][0], sceneout[1][1]);
-    }
-
-    // TODO: FIX SCENE ASSUMPTION
-    if (storage.getPatch().scene[0].lowcut.deactivated == false)
+    else
     {
-        auto freq =
-            storage.getPatch().scenedata[0][storage.getPatch().scene[0].lowcut.param_id_in_scene].f;
-
-        hpA.coeff_HP(hpA.calc_omega(freq / 12.0), 0.4);    // var 0.707
-        hpA.process_block(sceneout[0][0], sceneout[0][1]); // TODO: quadify
+        for (int s = 0; s < n_scenes; s++)
+            renderScene(s);
     }
 
-    if (storage.getPatch().scene[1].lowcut.deactivated == false)
-    {
-        auto freq =
-            storage.getPatch().scenedata[1][storage.getPatch().scene[1].lowcut.param_id_in_scene].f;
+    // renderScene charges its own stages
+    block.mark = profiler.now();
 
-        hpB.coeff_HP(hpB.calc_omega(freq / 12.0), 0.4);
-        hpB.process_block(sceneout[1][0], sceneout[1][1]);
-    }
-
-    for (int cls = 0; cls < n_scenes; ++cls)
-    {
-        switch (storage.sceneHardclipMode[cls])
-        {
-        case SurgeStorage::HARDCLIP_TO_18DBFS:
-            hardclip_block8(sceneout[cls][0], BLOCK_SIZE_QUAD);
-            hardclip_block8(sceneout[cls][1], BLOCK_SIZE_QUAD);
-            break;
-        case SurgeStorage::HARDCLIP_TO_0DBFS:
-            hardclip_block(sceneout[cls][0], BLOCK_SIZE_QUAD);
-            hardclip_block(sceneout[cls][1], BLOCK_SIZE_QUAD);
-            break;
-        default:
-            break;
-        }
-    }
+    polydisplay = sceneVoiceCount[0] + sceneVoiceCount[1];
 
     // TODO: FIX SCENE ASSUMPTION
     bool sc_state[n_scenes];
 
     for (int i = 0; i < n_scenes; i++)
     {
-        sc_state[i] = play_scene[i];
-    }
-
-    // apply insert effects
-    if (fx_bypass != fxb_no_fx)
-    {
-        if (fx[fxslot_ains1] && !(storage.getPatch().fx_disable.val.i & (1 << 0)))
-        {
-            sc_state[0] =
-                fx[fxslot_ains1]->process_ringout(sceneout[0][0], sceneout[0][1], sc_state[0]);
-        }
-
-        if (fx[fxslot_ains2] && !(storage.getPatch().fx_disable.val.i & (1 << 1)))
-        {
-            sc_state[0] =
-                fx[fxslot_ains2]->process_ringout(sceneout[0][0], sceneout[0][1], sc_state[0]);
-        }
-
-        if (fx[fxslot_bins1] && !(storage.getPatch().fx_disable.val.i & (1 << 2)))
-        {
-            sc_state[1] =
-                fx[fxslot_bins1]->process_ringout(sceneout[1][0], sceneout[1][1], sc_state[1]);
-        }
-
-        if (fx[fxslot_bins2] && !(storage.getPatch().fx_disable.val.i & (1 << 3)))
-        {
-            sc_state[1] =
-                fx[fxslot_bins2]->process_ringout(sceneout[1][0], sceneout[1][1], sc_state[1]);
-        }
-    }
-
-    for (int cls = 0; cls < n_scenes; ++cls)
-    {
-        switch (storage.sceneHardclipMode[cls])
-        {
-        case SurgeStorage::HARDCLIP_TO_18DBFS:
-            hardclip_block8(sceneout[cls][0], BLOCK_SIZE_QUAD);
-            hardclip_block8(sceneout[cls][1], BLOCK_SIZE_QUAD);
-            break;
-        case SurgeStorage::HARDCLIP_TO_0DBFS:
-            hardclip_block(sceneout[cls][0], BLOCK_SIZE_QUAD);
-            hardclip_block(sceneout[cls][1], BLOCK_SIZE_QUAD);
-            break;
-        default:
-            break;
-        }
+        sc_state[i] = sceneRingout[i];
     }
 
     // sum scenes
@@ -3648,51 +4071,57 @@ void SurgeSynthesizer::process()
     accumulate_block(sceneout[1][0], output[0], BLOCK_SIZE_QUAD);
     accumulate_block(sceneout[1][1], output[1], BLOCK_SIZE_QUAD);
 
+    profiler.lap(prof_t::stage_output, block.mark);
+
     bool send1 = false, send2 = false;
     // add send effects
     // TODO: FIX SCENE ASSUMPTION
     if (fx_bypass == fxb_all_fx)
     {
-        if (fx[fxslot_send1] && !(storage.getPatch().fx_disable.val.i & (1 << 4)))
+        if (fxSlotActive(fxslot_send1) && !(storage.getPatch().fx_disable.val.i & (1 << 4)))
         {
             send[0][0].MAC_2_blocks_to(sceneout[0][0], sceneout[0][1], fxsendout[0][0],
                                        fxsendout[0][1], BLOCK_SIZE_QUAD);
             send[0][1].MAC_2_blocks_to(sceneout[1][0], sceneout[1][1], fxsendout[0][0],
                                        fxsendout[0][1], BLOCK_SIZE_QUAD);
-            send1 = fx[fxslot_send1]->process_ringout(fxsendout[0][0], fxsendout[0][1],
-                                                      sc_state[0] || sc_state[1]);
+            send1 = processFxSlot(fxslot_send1, fxsendout[0][0], fxsendout[0][1],
+                                  sc_state[0] || sc_state[1], true);
             FX1.MAC_2_blocks_to(fxsendout[0][0], fxsendout[0][1], output[0], output[1],
                                 BLOCK_SIZE_QUAD);
         }
-        if (fx[fxslot_send2] && !(storage.getPatch().fx_disable.val.i & (1 << 5)))
+        if (fxSlotActive(fxslot_send2) && !(storage.getPatch().fx_disable.val.i & (1 << 5)))
         {
             send[1][0].MAC_2_blocks_to(sceneout[0][0], sceneout[0][1], fxsendout[1][0],
                                        fxsendout[1][1], BLOCK_SIZE_QUAD);
             send[1][1].MAC_2_blocks_to(sceneout[1][0], sceneout[1][1], fxsendout[1][0],
                                        fxsendout[1][1], BLOCK_SIZE_QUAD);
-            send2 = fx[fxslot_send2]->process_ringout(fxsendout[1][0], fxsendout[1][1],
-                                                      sc_state[0] || sc_state[1]);
+            send2 = processFxSlot(fxslot_send2, fxsendout[1][0], fxsendout[1][1],
+                                  sc_state[0] || sc_state[1], true);
             FX2.MAC_2_blocks_to(fxsendout[1][0], fxsendout[1][1], output[0], output[1],
                                 BLOCK_SIZE_QUAD);
         }
     }
 
+    profiler.lap(prof_t::stage_send_fx, block.mark);
+
     // apply global effects
     if ((fx_bypass == fxb_all_fx) || (fx_bypass == fxb_no_sends))
     {
         bool glob = sc_state[0] || sc_state[1] || send1 || send2;
 
-        if (fx[fxslot_global1] && !(storage.getPatch().fx_disable.val.i & (1 << 6)))
+        if (fxSlotActive(fxslot_global1) && !(storage.getPatch().fx_disable.val.i & (1 << 6)))
         {
-            glob = fx[fxslot_global1]->process_ringout(output[0], output[1], glob);
+            glob = processFxSlot(fxslot_global1, output[0], output[1], glob, false);
         }
 
-        if (fx[fxslot_global2] && !(storage.getPatch().fx_disable.val.i & (1 << 7)))
+        if (fxSlotActive(fxslot_global2) && !(storage.getPatch().fx_disable.val.i & (1 << 7)))
         {
-            glob = fx[fxslot_global2]->process_ringout(output[0], output[1], glob);
+            glob = processFxSlot(fxslot_global2, output[0], output[1], glob, false);
         }
     }
 
+    profiler.lap(prof_t::stage_global_fx, block.mark);
+
     amp.multiply_2_blocks(output[0], output[1], BLOCK_SIZE_QUAD);
     amp_mute.multiply_2_blocks(output[0], output[1], BLOCK_SIZE_QUAD);
 
@@ -3724,6 +4153,9 @@ void SurgeSynthesizer::process()
     {
         amp_mute.multiply_2_blocks(sceneout[sc][0], sceneout[sc][1], BLOCK_SIZE_QUAD);
     }
+
+    profiler.lap(prof_t::stage_output, block.mark);
+    profiler.endBlock(block);
 }
 
 SurgeSynthesizer::PluginLayer *SurgeSynthesizer::getParent()
@@ -3778,6 +4210,20 @@ void SurgeSynthesizer::populateDawExtraState()
 
 void SurgeSynthesizer::loadFromDawExtraState()
 {
+    if (!storage.getPatch().dawExtraState.isPopulated)
+        return;
+
+    auto tuning = std::make_unique<SurgeStorage::PreparedTuning>();
+    storage.captureTuning(*tuning);
+    storage.prepareTuningFromDawExtraState(storage.getPatch(), *tuning);
+    storage.buildTuning(*tuning);
+    applyDawExtraState(*tuning);
+}
+
+void SurgeSynthesizer::applyDawExtraState(SurgeStorage::PreparedTuning &tuning)
+{
+    storage.adoptTuning(tuning);
+
     if (!storage.getPatch().dawExtraState.isPopulated)
         return;
     mpeEnabled = storage.getPatch().dawExtraState.mpeEnabled;
@@ -3788,50 +4234,6 @@ void SurgeSynthesizer::loadFromDawExtraState()
     storage.oddsoundRetuneMode =
         (SurgeStorage::OddsoundRetuneMode)storage.getPatch().dawExtraState.oddsoundRetuneMode;
 
-    if (storage.getPatch().dawExtraState.hasScale)
-    {
-        try
-        {
-            auto sc = Tunings::parseSCLData(storage.getPatch().dawExtraState.scaleContents);
-            storage.retuneToScale(sc);
-        }
-        catch (Tunings::TuningError &e)
-        {
-            storage.reportError(e.what(), "Unable to restore tuning!");
-            storage.retuneTo12TETScale();
-        }
-    }
-    else
-    {
-        storage.retuneTo12TETScale();
-    }
-
-    if (storage.getPatch().dawExtraState.hasMapping)
-    {
-        try
-        {
-            auto kb = Tunings::parseKBMData(storage.getPatch().dawExtraState.mappingContents);
-            if (storage.getPatch().dawExtraState.mappingName.size() > 1)
-            {
-                kb.name = storage.getPatch().dawExtraState.mappingName;
-            }
-            else
-            {
-                kb.name = storage.guessAtKBMName(kb);
-            }
-            storage.remapToKeyboard(kb);
-        }
-        catch (Tunings::TuningError &e)
-        {
-            storage.reportError(e.what(), "Unable to restore mapping!");
-            storage.remapToConcertCKeyboard();
-        }
-    }
-    else
-    {
-        storage.remapToConcertCKeyboard();
-    }
-
     int n = n_global_params + n_scene_params; // only store midictrl's for scene A (scene A -> scene
                                               // B will be duplicated on load)
     for (int i = 0; i < n; i++)
@@ -3927,6 +4329,7 @@ void SurgeSynthesizer::swapMetaControllers(int c1, int c2)
         }
     }
 
+    storage.publishModulationRouting();
     storage.modRoutingMutex.unlock();
 
     refresh_editor = true;
@@ -17,7 +17,12 @@
 #include "SurgeStorage.h"
 #include "SurgeVoice.h"
 #include "Effect.h"
+#include "EffectLoader.h"
+#include "ShadowPatchLoader.h"
 #include "BiquadFilter.h"
+#include "ActiveVoiceTable.h"
+#include "RealtimeThreads.h"
+#include "WideFilterChain.h"
 
 struct QuadFilterChainState;
 
@@ -83,6 +88,96 @@ class alignas(16) SurgeSynthesizer
     int getMpeMainChannel(int voiceChannel, int key);
     void process();
 
+    /*
+     * Render scene s up to and including its insert effects into sceneout[s]. The two scenes
+     * don't share any state here, so with multithreaded scenes on, scene B renders on a worker
+     * thread alongside scene A and the result is bit-identical to rendering them in turn.
+     */
+    void renderScene(int s);
+    bool sceneRingout[n_scenes] = {false, false};
+    int sceneVoiceCount[n_scenes] = {0, 0};
+
+    /*
+     * Opt in to rendering the scenes in parallel. This starts or stops a thread, so call it
+     * from the UI or setup code, never while process() may be running. The worker spins between
+     * blocks to be ready in time, so this trades a core's worth of idle time for latency headroom
+     * on dual and split patches.
+     */
+    void setMultithreadedScenes(bool b);
+    bool getMultithreadedScenes() const { return sceneWorker != nullptr; }
+    std::unique_ptr<Surge::Threading::RealtimeWorker> sceneWorker;
+    // Whether this block may hand scene B to the worker; otherwise the scenes render in turn
+    bool canRenderScenesInParallel();
+    // Blocks in which scene B actually rendered on the worker
+    uint64_t sceneWorkerBlocks = 0;
+
+    /*
+     * Spread the voices of a scene over n threads (counting the audio thread), a group of four
+     * voices sharing a QuadFilterChainState at a time. Like setMultithreadedScenes this
+     * starts threads, so never call it while process() may be running. The result is
+     * bit-identical to rendering on one thread. Scenes whose voice LFOs run formulas always
+     * render on the audio thread, since the formula evaluator isn't thread safe.
+     */
+    void setVoiceThreads(int n);
+    int getVoiceThreads() const { return voicePool ? voicePool->size() : 1; }
+    std::unique_ptr<Surge::Threading::WorkStealingPool> voicePool;
+    // Scene blocks whose voices were handed to the pool rather than rendered in turn
+    uint64_t voicePoolRuns = 0;
+
+    /*
+     * Opt in to switching patches without going silent while the new one loads. The current
+     * patch keeps playing while shadowPatchLoader builds the next one; then the output dips for
+     * patchSwitchDipBlocks, commitShadowPatch swaps the new patch in between two blocks and the
+     * old patch's effects ring out for up to patchSwitchTailSeconds. Held notes still end at
+     * the switch, since the voices read the live patch. DAW state restores always load this
+     * way (see enqueuePatchForLoad).
+     */
+    void setGaplessPatchSwitching(bool b) { gaplessPatchSwitching = b; }
+    bool getGaplessPatchSwitching() const { return gaplessPatchSwitching; }
+    std::atomic<bool> gaplessPatchSwitching{false};
+    std::unique_ptr<Surge::Storage::ShadowPatchLoader> shadowPatchLoader;
+    bool commitShadowPatch();
+    static constexpr int patchSwitchDipBlocks = 4;
+    static constexpr float patchSwitchTailSeconds = 4.f;
+
+    // The parts of a patch load the shadow loader shares with loadPatch and loadPatchByPath
+    bool takeQueuedPatch(std::string &path, int &categoryId, std::string &name, int &id);
+    bool readPatchFile(const char *fxpPath, const char *patchName, std::unique_ptr<char[]> &data,
+                       int &size);
+    void applyTuningFromPatch();
+
+    /*
+     * Run the filter chains of 8 or 16 voices at once where the CPU has AVX2 or AVX-512 (see
+     * WideFilterChain.h). The wide chain is bit-identical to the SSE one, so it is on whenever
+     * it is available; setting 4 lanes goes back to the SSE chain alone, and anything else is
+     * rounded down to what this CPU supports. Like setVoiceThreads, don't call this while
+     * process() may be running.
+     */
+    void setFilterChainLanes(int lanes);
+    int getFilterChainLanes() const { return filterChainLanes; }
+    int filterChainLanes = GetWideFilterLanesAvailable();
+
+    /*
+     * Run the voice LFOs and envelopes of a scene together in SSE lanes ahead of the voices
+     * (see SurgeVoice::process_modulators_batch). It is bit-identical to running them voice by
+     * voice, so it is on by default; turning it off is there to check that.
+     */
+    void setBatchedModulators(bool b) { batchedModulators = b; }
+    bool getBatchedModulators() const { return batchedModulators; }
+    bool batchedModulators = true;
+    // Scene blocks whose voice modulators actually ran in the lane batches
+    uint64_t batchedModulatorBlocks = 0;
+
+    void prepareVoiceQuad(int s, int q, int n);
+    void finishVoiceQuad(int s, int q, int n);
+    void renderVoiceQuad(int s, int q, int n, fbq_global &g, FBQFPtr ProcessQuadFB, float *outL,
+                         float *outR);
+    void renderVoiceGroup(int s, int q0, int quads, int n, wide_fbq_global &g,
+                          WideFBQFPtr ProcessWideFB, float **outL, float **outR);
+    bool voicesUseFormulaModulators(int s);
+    float quadout alignas(16)[n_scenes][MAX_VOICES >> 2][2][BLOCK_SIZE_OS];
+    bool voiceAlive[n_scenes][MAX_VOICES];
+
     PluginLayer *getParent();
 
     // protected:
@@ -104,6 +199,16 @@ class alignas(16) SurgeSynthesizer
     bool loadOscalgos();
     bool load_fx_needed;
 
+    /*
+     * A change of FX type is built by effectLoader off the audio thread. Every block
+     * applyLoadedFx swaps in whatever has finished, and the slot then crossfades from the old
+     * effect to the new one over fxFadeBlocks, after which the old one goes back to the loader
+     * to be deleted. Patch loads still rebuild all the FX synchronously in loadFx.
+     */
+    std::unique_ptr<Surge::FX::EffectLoader> effectLoader;
+    void applyLoadedFx();
+    static constexpr int fxFadeBlocks = 8;
+
     /*
      * FX Lifecycle events happen on the audio thread but is read in the openOrRecreateEditor
      * so if you swpan or init the fx[s] object lock this mutex
@@ -287,12 +392,20 @@ class alignas(16) SurgeSynthesizer
     std::mutex rawLoadQueueMutex;
     void *enqueuedLoadData{nullptr}; // if this is set I need to free it
     int enqueuedLoadSize{0};
+    /*
+     * Restore a DAW state without loading it on the audio thread. data is malloc()ed and is
+     * ours from here. The audio thread hands it to shadowPatchLoader, which parses it and builds
+     * the patch; the audio thread then only swaps the result in.
+     */
     void enqueuePatchForLoad(void *data, int size); // safe from any thread
     void processEnqueuedPatchIfNeeded();            // only safe from audio thread
+    bool takeEnqueuedState(void *&data, int &size); // for shadowPatchLoader
 
     void loadRaw(const void *data, int size, bool preset = false);
     void loadPatch(int id);
     bool loadPatchByPath(const char *fxpPath, int categoryId, const char *name);
+    // If patchid isn't set, look the loaded patch up in the patch list by name and category
+    void findCurrentPatchInList();
     void incrementPatch(bool nextPrev, bool insideCategory = true);
     void incrementCategory(bool nextPrev);
     void selectRandomPatch();
@@ -326,13 +439,15 @@ class alignas(16) SurgeSynthesizer
     void populateDawExtraState();
 
     void loadFromDawExtraState();
+    // The session state's settings and MIDI mappings, with its tuning already prepared
+    void applyDawExtraState(SurgeStorage::PreparedTuning &tuning);
 
   public:
     int CC0, CC32, PCH, patchid;
     float masterfade = 0;
     HalfRateFilter halfbandA, halfbandB,
         halfbandIN; // TODO: FIX SCENE ASSUMPTION (for halfbandA/B - use std::array)
-    std::list<SurgeVoice *> voices[n_scenes];
+    ActiveVoiceTable voices[n_scenes];
     std::unique_ptr<Effect> fx[n_fx_slots];
     std::atomic<bool> halt_engine;
     MidiChannelState channelState[16];
@@ -354,9 +469,35 @@ class alignas(16) SurgeSynthesizer
     bool fx_reload[n_fx_slots];   // if true, reload new effect parameters from fxsync
     FxStorage fxsync[n_fx_slots]; // used for synchronisation of parameter init
     bool fx_reload_mod[n_fx_slots];
+    bool fx_reload_defaults[n_fx_slots]; // if true, the new effect starts from its defaults
     std::array<std::vector<std::tuple<int, int, float>>, n_fx_slots> fxmodsync;
     int fx_suspend_bitmask;
 
+    /*
+     * While a slot crossfades the outgoing effect keeps running against a frozen copy of the
+     * parameters it was last given, since the patch now holds the new effect's. After a patch
+     * switch the outgoing effect instead rings out (tail) on silence, mixed in on top of the new
+     * one, until it falls quiet or the fade ends.
+     */
+    struct FxFade
+    {
+        std::unique_ptr<Effect> outgoing;
+        int blocksLeft = 0, length = 1;
+        bool tail = false;
+    } fxFade[n_fx_slots];
+    FxStorage fxFadeStorage[n_fx_slots];
+    pdata fxFadeData[n_fx_slots][n_global_params];
+
+    bool fxSlotActive(int slot) const { return fx[slot] || fxFade[slot].blocksLeft > 0; }
+
+    /*
+     * process_ringout on the slot, crossfading from the outgoing effect if there is one. An
+     * empty slot passes the signal through, or, for the sends (silentWhenOff), contributes
+     * nothing.
+     */
+    bool processFxSlot(int slot, float *dataL, float *dataR, bool indata_present,
+                       bool silentWhenOff);
+
     // hold pedal stuff
 
     std::list<std::pair<int, int>> holdbuffer[n_scenes];
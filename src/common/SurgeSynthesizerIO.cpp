@@ -15,6 +15,7 @@
 
 #include "SurgeSynthesizer.h"
 #include "DSPUtils.h"
+#include "WavetableLoader.h"
 #include <time.h>
 #include <vembertech/vt_dsp_endian.h>
 
@@ -52,6 +53,8 @@ void SurgeSynthesizer::incrementPatch(bool nextPrev, bool insideCategory)
     // Don't increment if we still have an outstanding load
     if (patchid_queue >= 0)
         return;
+    storage.ensurePatchListLoaded();
+    findCurrentPatchInList();
     int p = storage.patch_list.size();
 
     if (!p)
@@ -134,6 +137,8 @@ void SurgeSynthesizer::incrementPatch(bool nextPrev, bool insideCategory)
 
 void SurgeSynthesizer::incrementCategory(bool nextPrev)
 {
+    storage.ensurePatchListLoaded();
+    findCurrentPatchInList();
     int c = storage.patch_category.size();
 
     if (!c)
@@ -178,6 +183,7 @@ void SurgeSynthesizer::selectRandomPatch()
 {
     if (patchid_queue >= 0)
         return;
+    storage.ensurePatchListLoaded();
     int p = storage.patch_list.size();
 
     if (!p)
@@ -191,6 +197,7 @@ void SurgeSynthesizer::selectRandomPatch()
 
 void SurgeSynthesizer::loadPatch(int id)
 {
+    storage.ensurePatchListLoaded();
     if (id < 0)
         id = 0;
     if (id >= storage.patch_list.size())
@@ -202,7 +209,54 @@ void SurgeSynthesizer::loadPatch(int id)
     loadPatchByPath(path_to_string(e.path).c_str(), e.category, e.name.c_str());
 }
 
-bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, const char *patchName)
+bool SurgeSynthesizer::takeQueuedPatch(std::string &path, int &categoryId, std::string &name,
+                                       int &id)
+{
+    std::lock_guard<std::mutex> mg(patchLoadSpawnMutex);
+    storage.ensurePatchListLoaded();
+
+    id = -1;
+    if (patchid_queue >= 0)
+    {
+        id = patchid_queue;
+        patchid_queue = -1;
+        if (id >= storage.patch_list.size())
+            id = id % storage.patch_list.size();
+    }
+    else if (has_patchid_file)
+    {
+        has_patchid_file = false;
+        path = patchid_file;
+
+        int ct = 0;
+        for (const auto &pti : storage.patch_list)
+        {
+            if (path_to_string(pti.path) == path)
+                id = ct;
+            ct++;
+        }
+
+        if (id < 0)
+        {
+            categoryId = -1;
+            name = path_to_string(string_to_path(path).stem());
+            return true;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    auto &e = storage.patch_list[id];
+    path = path_to_string(e.path);
+    categoryId = e.category;
+    name = e.name;
+    return true;
+}
+
+bool SurgeSynthesizer::readPatchFile(const char *fxpPath, const char *patchName,
+                                     std::unique_ptr<char[]> &data, int &size)
 {
     std::filebuf f;
     if (!f.open(string_to_path(fxpPath), std::ios::binary | std::ios::in))
@@ -244,11 +298,32 @@ bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, cons
         return false;
     }
 
-    int cs = vt_read_int32BE(fxp.chunkSize);
-    std::unique_ptr<char[]> data{new char[cs]};
-    if (f.sgetn(data.get(), cs) != cs)
+    size = vt_read_int32BE(fxp.chunkSize);
+    data.reset(new char[size]);
+    if (f.sgetn(data.get(), size) != size)
         perror("Error while loading patch!");
     f.close();
+    return true;
+}
+
+void SurgeSynthesizer::applyTuningFromPatch()
+{
+    if (!storage.getPatch().patchTuning.tuningStoredInPatch)
+        return;
+
+    auto tuning = std::make_unique<SurgeStorage::PreparedTuning>();
+    storage.captureTuning(*tuning);
+    storage.prepareTuningFromPatch(storage.getPatch(), *tuning);
+    storage.buildTuning(*tuning);
+    storage.adoptTuning(*tuning);
+}
+
+bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, const char *patchName)
+{
+    std::unique_ptr<char[]> data;
+    int cs = 0;
+    if (!readPatchFile(fxpPath, patchName, data, cs))
+        return false;
 
     storage.getPatch().comment = "";
     storage.getPatch().author = "";
@@ -269,86 +344,7 @@ bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, cons
     /*
     ** OK so at this point we may have loaded a patch with a tuning override
     */
-    if (storage.getPatch().patchTuning.tuningStoredInPatch)
-    {
-        if (storage.isStandardTuning)
-        {
-            try
-            {
-                if (storage.getPatch().patchTuning.scaleContents.size() > 1)
-                {
-                    storage.retuneToScale(
-                        Tunings::parseSCLData(storage.getPatch().patchTuning.scaleContents));
-                }
-                else
-                {
-                    storage.retuneTo12TETScale();
-                }
-                if (storage.getPatch().patchTuning.mappingContents.size() > 1)
-                {
-                    auto kb = Tunings::parseKBMData(storage.getPatch().patchTuning.mappingContents);
-                    if (storage.getPatch().patchTuning.mappingName.size() > 1)
-                        kb.name = storage.getPatch().patchTuning.mappingName;
-                    else
-                        kb.name = storage.guessAtKBMName(kb);
-                    storage.remapToKeyboard(kb);
-                }
-                else
-                {
-                    storage.remapToConcertCKeyboard();
-                }
-            }
-            catch (Tunings::TuningError &e)
-            {
-                storage.reportError(e.what(), "Error restoring tuning!");
-                storage.retuneTo12TETScaleC261Mapping();
-            }
-        }
-        else
-        {
-            auto okc = storage.okCancelProvider(
-                std::string("Loaded patch contains a custom tuning, but there is ") +
-                    "already a user-selected tuning in place. Do you want to replace the currently "
-                    "loaded tuning " +
-                    "with the tuning stored in the patch? (The rest of the patch will load "
-                    "normally.)",
-                "Replace Tuning", SurgeStorage::CANCEL);
-            if (okc == SurgeStorage::OK)
-            {
-                try
-                {
-                    if (storage.getPatch().patchTuning.scaleContents.size() > 1)
-                    {
-                        storage.retuneToScale(
-                            Tunings::parseSCLData(storage.getPatch().patchTuning.scaleContents));
-                    }
-                    else
-                    {
-                        storage.retuneTo12TETScale();
-                    }
-                    if (storage.getPatch().patchTuning.mappingContents.size() > 1)
-                    {
-                        auto kb =
-                            Tunings::parseKBMData(storage.getPatch().patchTuning.mappingContents);
-                        if (storage.getPatch().patchTuning.mappingName.size() > 1)
-                            kb.name = storage.getPatch().patchTuning.mappingName;
-                        else
-                            kb.name = storage.guessAtKBMName(kb);
-                        storage.remapToKeyboard(kb);
-                    }
-                    else
-                    {
-                        storage.remapToConcertCKeyboard();
-                    }
-                }
-                catch (Tunings::TuningError &e)
-                {
-                    storage.reportError(e.what(), "Error Restoring Tuning");
-                    storage.retuneTo12TETScaleC261Mapping();
-                }
-            }
-        }
-    }
+    applyTuningFromPatch();
 
     masterfade = 1.f;
     /*
@@ -375,21 +371,22 @@ void SurgeSynthesizer::enqueuePatchForLoad(void *data, int size)
 
 void SurgeSynthesizer::processEnqueuedPatchIfNeeded()
 {
-    bool expected = true;
-    void *freeThis = nullptr;
-    if (rawLoadEnqueued.compare_exchange_weak(expected, true) && expected)
-    {
-        std::lock_guard<std::mutex> g(rawLoadQueueMutex);
-        rawLoadEnqueued = false;
-        loadRaw(enqueuedLoadData, enqueuedLoadSize);
-        loadFromDawExtraState();
+    // shadowPatchLoader parses and builds it; process() swaps it in once it is ready
+    if (rawLoadEnqueued)
+        shadowPatchLoader->poke();
+}
 
-        freeThis = enqueuedLoadData;
-        enqueuedLoadData = nullptr;
-        rawLoadNeedsUIDawExtraState = true;
-    }
-    if (freeThis)
-        free(freeThis); // do this outside the lock
+bool SurgeSynthesizer::takeEnqueuedState(void *&data, int &size)
+{
+    std::lock_guard<std::mutex> g(rawLoadQueueMutex);
+    if (!rawLoadEnqueued)
+        return false;
+
+    rawLoadEnqueued = false;
+    data = enqueuedLoadData;
+    size = enqueuedLoadSize;
+    enqueuedLoadData = nullptr;
+    return data != nullptr;
 }
 
 void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset)
@@ -400,9 +397,16 @@ void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset)
         for (int i = 0; i < n_customcontrollers; i++)
             storage.getPatch().scene[s].modsources[ms_ctrl1 + i]->reset();
 
-    storage.getPatch().init_default_values();
-    storage.getPatch().load_patch(data, size, preset);
-    storage.getPatch().update_controls(false, nullptr, true);
+    // a wavetable picked for the old patch mustn't land on top of the new one
+    storage.wavetableLoader->discardPendingLoads();
+    shadowPatchLoader->discardPendingLoads();
+    {
+        std::lock_guard<std::recursive_mutex> g(storage.modRoutingMutex);
+        storage.getPatch().init_default_values();
+        storage.getPatch().load_patch(data, size, preset);
+        storage.getPatch().update_controls(false, nullptr, true);
+        storage.publishModulationRouting();
+    }
     for (int i = 0; i < n_fx_slots; i++)
     {
         memcpy((void *)&fxsync[i], (void *)&storage.getPatch().fx[i], sizeof(FxStorage));
@@ -411,6 +415,8 @@ void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset)
 
     loadFx(false, true);
 
+    storage.reserveOscillatorBlocks();
+
     for (int sc = 0; sc < n_scenes; sc++)
     {
         setParameter01(storage.getPatch().scene[sc].f2_cutoff_is_offset.id,
@@ -421,29 +427,125 @@ void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset)
     patch_loaded = true;
     refresh_editor = true;
 
-    if (patchid < 0)
+    // a patch list which is still being scanned gets asked when someone next jogs
+    if (storage.isPatchListReady())
+        findCurrentPatchInList();
+}
+
+void SurgeSynthesizer::findCurrentPatchInList()
+{
+    if (patchid >= 0)
+        return;
+
+    /*
+    ** new patch just loaded so I look up and set the current category and patch.
+    ** This is used to draw checkmarks in the menu. If for some reason we don't
+    ** find one, nothing will break
+    */
+    int cnt = storage.patch_list.size();
+    string name = storage.getPatch().name;
+    string cat = storage.getPatch().category;
+    for (int p = 0; p < cnt; ++p)
     {
-        /*
-        ** new patch just loaded so I look up and set the current category and patch.
-        ** This is used to draw checkmarks in the menu. If for some reason we don't
-        ** find one, nothing will break
-        */
-        int cnt = storage.patch_list.size();
-        string name = storage.getPatch().name;
-        string cat = storage.getPatch().category;
-        for (int p = 0; p < cnt; ++p)
+        if (storage.patch_list[p].name == name &&
+            storage.patch_category[storage.patch_list[p].category].name == cat)
         {
-            if (storage.patch_list[p].name == name &&
-                storage.patch_category[storage.patch_list[p].category].name == cat)
-            {
-                current_category_id = storage.patch_list[p].category;
-                patchid = p;
-                break;
-            }
+            current_category_id = storage.patch_list[p].category;
+            patchid = p;
+            break;
         }
     }
 }
 
+bool SurgeSynthesizer::commitShadowPatch()
+{
+    /*
+     * the editor may be reading the routings, the effects or the wavetables (the oscillator
+     * display, the preview worker) we are about to swap out; in that case, next block
+     */
+    std::unique_lock<std::recursive_mutex> routingLock(storage.modRoutingMutex, std::try_to_lock);
+    std::unique_lock<std::mutex> spawnLock(fxSpawnMutex, std::try_to_lock);
+    std::unique_lock<std::mutex> wtLock(storage.waveTableDataMutex, std::try_to_lock);
+    if (!routingLock.owns_lock() || !spawnLock.owns_lock() || !wtLock.owns_lock())
+        return false;
+
+    auto &loader = *shadowPatchLoader;
+    auto &patch = storage.getPatch();
+
+    allNotesOff();
+    for (int s = 0; s < n_scenes; s++)
+        for (int i = 0; i < n_customcontrollers; i++)
+            patch.scene[s].modsources[ms_ctrl1 + i]->reset();
+
+    storage.wavetableLoader->discardPendingLoads();
+    effectLoader->discardPendingLoads();
+
+    // the old patch's effects ring out on their own copy of its parameters
+    int tailBlocks = std::max(1, (int)(patchSwitchTailSeconds * samplerate / BLOCK_SIZE));
+    for (int s = 0; s < n_fx_slots; s++)
+    {
+        auto &fade = fxFade[s];
+        effectLoader->retire(std::move(fade.outgoing));
+        fade.blocksLeft = 0;
+
+        if (!fx[s])
+            continue;
+
+        memcpy((void *)&fxFadeStorage[s], (void *)&patch.fx[s], sizeof(FxStorage));
+        memcpy((void *)fxFadeData[s], (void *)patch.globaldata, sizeof(fxFadeData[s]));
+        fade.outgoing = std::move(fx[s]);
+        fade.outgoing->rebind(&fxFadeStorage[s], fxFadeData[s]);
+        fade.blocksLeft = fade.length = tailBlocks;
+        fade.tail = true;
+    }
+
+    patch.adoptFrom(loader.shadow());
+    wtLock.unlock();
+    // the loader built the tuning tables for the patch's tuning application mode already
+    patch.applyStorageSettings(false);
+    storage.publishModulationRouting();
+
+    // and what loadRaw's callers do next, with the tuning already parsed and built
+    if (loader.isRestoringState())
+    {
+        // the tuning and MIDI mappings saved with the session; then the editor follows
+        applyDawExtraState(loader.tuning);
+        rawLoadNeedsUIDawExtraState = true;
+    }
+    else
+    {
+        storage.adoptTuning(loader.tuning);
+    }
+
+    for (int s = 0; s < n_fx_slots; s++)
+    {
+        fx[s] = std::move(loader.effects[s]);
+        if (fx[s])
+            fx[s]->rebind(&patch.fx[s], patch.globaldata);
+
+        memcpy((void *)&fxsync[s], (void *)&patch.fx[s], sizeof(FxStorage));
+        fx_reload[s] = false;
+        fx_reload_mod[s] = false;
+        fx_reload_defaults[s] = false;
+    }
+    load_fx_needed = false;
+
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        setParameter01(patch.scene[sc].f2_cutoff_is_offset.id,
+                       patch.scene[sc].f2_cutoff_is_offset.get_value_f01());
+    }
+
+    if (loader.patchid >= 0)
+        patchid = loader.patchid;
+    current_category_id = loader.categoryId;
+    patch_loaded = true;
+    refresh_editor = true;
+
+    loader.committed();
+    return true;
+}
+
 #if MAC || LINUX
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -117,6 +117,12 @@ void initMaps()
             case LayoutGridResolution:
                 r = "layoutGridResolution";
                 break;
+            case CacheWavetableMipmaps:
+                r = "cacheWavetableMipmaps";
+                break;
+            case WavetableMipmapCacheMaxMB:
+                r = "wavetableMipmapCacheMaxMB";
+                break;
             case ShowVirtualKeyboard_Plugin:
                 r = "showVirtualKeyboardPlugin";
                 break;
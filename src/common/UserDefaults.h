@@ -44,6 +44,8 @@ enum DefaultKey // streamed as strings so feel free to change the order to whate
     ModWindowShowsValues,
     SkinReloadViaF5,
     LayoutGridResolution,
+    CacheWavetableMipmaps,
+    WavetableMipmapCacheMaxMB,
 
     ShowVirtualKeyboard_Plugin,
     ShowVirtualKeyboard_Standalone,
@@ -0,0 +1,100 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "WavetableCache.h"
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "filesystem/import.h"
+
+namespace Surge
+{
+namespace Storage
+{
+namespace
+{
+std::mutex cacheMutex;
+std::unordered_map<std::string, std::weak_ptr<const Wavetable>> cache;
+
+void pruneExpired()
+{
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        if (it->second.expired())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+}
+} // namespace
+
+std::shared_ptr<const Wavetable> WavetableCache::get(const std::string &key,
+                                                     const std::function<bool(Wavetable *)> &build)
+{
+    {
+        std::lock_guard<std::mutex> g(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+        {
+            if (auto res = it->second.lock())
+                return res;
+        }
+    }
+
+    auto built = std::make_shared<Wavetable>();
+    if (!build(built.get()))
+        return nullptr;
+
+    std::lock_guard<std::mutex> g(cacheMutex);
+    auto &entry = cache[key];
+    if (auto other = entry.lock())
+        return other;
+
+    entry = built;
+    pruneExpired();
+    return built;
+}
+
+std::string WavetableCache::keyForFile(const std::string &filename)
+{
+    std::error_code ec;
+    auto p = string_to_path(filename);
+
+    auto size = fs::file_size(p, ec);
+    if (ec)
+        return "";
+    auto mtime = fs::last_write_time(p, ec);
+    if (ec)
+        return "";
+
+    std::ostringstream oss;
+    oss << filename << "|" << size << "|" << mtime.time_since_epoch().count();
+    return oss.str();
+}
+
+size_t WavetableCache::liveTables()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    size_t res = 0;
+    for (auto &c : cache)
+        if (!c.second.expired())
+            res++;
+    return res;
+}
+} // namespace Storage
+} // namespace Surge
@@ -0,0 +1,57 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_WAVETABLECACHE_H
+#define SURGE_XT_WAVETABLECACHE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "Wavetable.h"
+
+namespace Surge
+{
+namespace Storage
+{
+/*
+ * Built wavetables, shared read only between every oscillator of every SurgeStorage in the
+ * process which loads the same file.
+ *
+ * Tables are keyed by path, size and modification time, so saving over a file builds it afresh.
+ * The cache only holds weak references: a table goes away with the last Wavetable reading it
+ * (see Wavetable::ShareData), and the next load builds it again.
+ */
+struct WavetableCache
+{
+    /*
+     * The built table for key. If no one holds one, build is called on a fresh Wavetable and its
+     * result kept, unless it returns false, in which case this returns null. build runs without
+     * any lock held, so two threads asking for a new key at once may both build it; only one
+     * result is kept.
+     */
+    static std::shared_ptr<const Wavetable> get(const std::string &key,
+                                                const std::function<bool(Wavetable *)> &build);
+
+    // A key for the file as it is now, or an empty string if it can't be stat'ed
+    static std::string keyForFile(const std::string &filename);
+
+    // How many built tables are still alive, for tests and statistics
+    static size_t liveTables();
+};
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_XT_WAVETABLECACHE_H
@@ -0,0 +1,208 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "WavetableLoader.h"
+#include "StringOps.h"
+
+namespace Surge
+{
+namespace Storage
+{
+WavetableLoader::WavetableLoader(SurgeStorage *s) : storage(s)
+{
+    for (auto &sc : mailboxes)
+    {
+        for (auto &mb : sc)
+        {
+            mb.requestedFilename[0] = 0;
+            mb.displayName[0] = 0;
+        }
+    }
+
+    worker = std::thread([this]() { this->workerLoop(); });
+}
+
+WavetableLoader::~WavetableLoader()
+{
+    keepRunning = false;
+    workerCV.notify_all();
+    worker.join();
+}
+
+void WavetableLoader::processQueuedLoads()
+{
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        for (int o = 0; o < n_oscs; o++)
+        {
+            auto &mb = mailboxes[sc][o];
+
+            if (mb.state == READY && !applyLoad(sc, o))
+                continue;
+
+            if (mb.state != IDLE || !postLoad(sc, o))
+                continue;
+
+            // Even a first load; the wavetable oscillators play silence until a table arrives
+            mb.state = REQUESTED;
+            pendingLoads++;
+            workerCV.notify_one();
+        }
+    }
+}
+
+bool WavetableLoader::postLoad(int scene, int osc)
+{
+    auto &mb = mailboxes[scene][osc];
+    auto &wt = storage->getPatch().scene[scene].osc[osc].wt;
+
+    // queue_wt resolved the request against wt_list already, so all we pass on is the file
+    if (!wt.queue_filename[0])
+        return false;
+
+    mb.requestedId = wt.queue_id;
+    mb.requestedFromList = wt.queue_from_list;
+    strxcpy(mb.requestedFilename, wt.queue_filename, sizeof(mb.requestedFilename));
+    wt.queue_id = -1;
+    wt.queue_from_list = false;
+    wt.queue_filename[0] = 0;
+
+    mb.generation = generation;
+    mb.requestedAt = std::chrono::high_resolution_clock::now();
+    return true;
+}
+
+void WavetableLoader::buildLoad(Mailbox &mb)
+{
+    if (!mb.staging)
+        mb.staging = std::make_unique<Wavetable>();
+
+    mb.built = false;
+    mb.displayName[0] = 0;
+
+    std::string filename = mb.requestedFilename;
+    mb.resolvedId = mb.requestedId;
+
+    // the same name wt_list gives the entry: the file name without its extension
+    auto fn = filename.substr(filename.find_last_of(PATH_SEPARATOR) + 1, filename.npos);
+    auto name = fn.substr(0, fn.find_last_of('.'));
+
+    mb.built = storage->load_wt(filename, mb.staging.get(), nullptr);
+
+    if (mb.built)
+        strxcpy(mb.displayName, name.c_str(), sizeof(mb.displayName));
+}
+
+bool WavetableLoader::applyLoad(int scene, int osc)
+{
+    auto &mb = mailboxes[scene][osc];
+    auto &oscdata = storage->getPatch().scene[scene].osc[osc];
+
+    /*
+     * The GUI holds this while it draws the table, and a patch save while it reads a finished
+     * staging table (see finishedLoad); just pick the load up next block.
+     */
+    std::unique_lock<std::mutex> dataLock(storage->waveTableDataMutex, std::try_to_lock);
+    if (!dataLock.owns_lock())
+        return false;
+
+    if (mb.generation != generation)
+    {
+        mb.state = IDLE;
+        return true;
+    }
+
+    if (mb.built)
+    {
+        oscdata.wt.SwapData(mb.staging.get());
+        dataLock.unlock();
+
+        if (mb.displayName[0])
+            strxcpy(oscdata.wavetable_display_name, mb.displayName, WAVETABLE_DISPLAY_NAME_SIZE);
+
+        // Loading a file from the menu or drag and drop switches a non-wavetable oscillator over
+        if (!mb.requestedFromList &&
+            !(oscdata.type.val.i == ot_wavetable || oscdata.type.val.i == ot_window))
+        {
+            oscdata.queue_type = ot_wavetable;
+        }
+    }
+
+    oscdata.wt.current_id = mb.resolvedId;
+    oscdata.wt.refresh_display = true;
+
+    auto latency = std::chrono::duration<float, std::milli>(
+                       std::chrono::high_resolution_clock::now() - mb.requestedAt)
+                       .count();
+    lastLoadLatencyMS = latency;
+    if (latency > maxLoadLatencyMS)
+        maxLoadLatencyMS = latency;
+    loadsCompleted++;
+
+    mb.state = IDLE;
+    return true;
+}
+
+void WavetableLoader::discardPendingLoads() { generation++; }
+
+const Wavetable *WavetableLoader::finishedLoad(int scene, int osc)
+{
+    auto &mb = mailboxes[scene][osc];
+
+    if (mb.state != READY || !mb.built || mb.generation != generation)
+        return nullptr;
+
+    return mb.staging.get();
+}
+
+void WavetableLoader::waitForPendingLoads()
+{
+    while (pendingLoads > 0)
+    {
+        std::unique_lock<std::mutex> g(workerLock);
+        workerCV.wait_for(g, std::chrono::milliseconds(5), [this]() { return pendingLoads == 0; });
+    }
+}
+
+void WavetableLoader::workerLoop()
+{
+    while (keepRunning)
+    {
+        for (auto &sc : mailboxes)
+        {
+            for (auto &mb : sc)
+            {
+                int expected = REQUESTED;
+                if (mb.state.compare_exchange_strong(expected, BUILDING))
+                {
+                    buildLoad(mb);
+                    mb.state = READY;
+                    pendingLoads--;
+                    workerCV.notify_all();
+                }
+            }
+        }
+
+        /*
+         * The audio thread notifies without taking the lock, so a wakeup can slip in between
+         * the predicate check and the wait. The timeout bounds how late we notice that.
+         */
+        std::unique_lock<std::mutex> g(workerLock);
+        workerCV.wait_for(g, std::chrono::milliseconds(50),
+                          [this]() { return !keepRunning || pendingLoads > 0; });
+    }
+}
+} // namespace Storage
+} // namespace Surge
@@ -0,0 +1,127 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_WAVETABLELOADER_H
+#define SURGE_XT_WAVETABLELOADER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "SurgeStorage.h"
+
+namespace Surge
+{
+namespace Storage
+{
+/*
+ * Reads and builds wavetables (including the mipmaps) on a worker thread so that choosing a
+ * wavetable doesn't stall the audio thread on file IO.
+ *
+ * Each oscillator has one mailbox. The audio thread posts the oscillator's queued file (resolved
+ * by SurgeStorage::queue_wt, so the worker never reads wt_list) into an idle mailbox, the worker
+ * builds a complete staging Wavetable and marks the mailbox ready, and at the start of a later
+ * block the audio thread swaps the staging data into the oscillator's wavetable. The old data
+ * ends up in the staging table and is reused (or freed) by the worker on the next load. While a
+ * mailbox is busy the oscillator keeps its queued request, so the most recent request made during
+ * a load is picked up afterwards. The first table an oscillator ever gets comes this way too;
+ * until it lands the wavetable and window oscillators play silence.
+ */
+struct WavetableLoader
+{
+    explicit WavetableLoader(SurgeStorage *storage);
+    ~WavetableLoader();
+
+    WavetableLoader(const WavetableLoader &) = delete;
+    WavetableLoader &operator=(const WavetableLoader &) = delete;
+
+    /*
+     * Audio thread only: apply any finished loads and post queued ones. Never blocks.
+     */
+    void processQueuedLoads();
+
+    /*
+     * Block until every posted load has been built. Outside of tests and offline rendering you
+     * don't want this; the result is applied on the next processQueuedLoads().
+     */
+    void waitForPendingLoads();
+
+    /*
+     * Drop every load posted so far; loads which are in flight are finished but never applied.
+     * Call this when a patch load replaces the oscillators' wavetables.
+     */
+    void discardPendingLoads();
+
+    /*
+     * The table a finished but not yet applied load built for this oscillator, or nullptr.
+     * Hold waveTableDataMutex for as long as you read it; the audio thread won't apply (or
+     * drop) a finished load while you do.
+     */
+    const Wavetable *finishedLoad(int scene, int osc);
+
+    // Time from posting a load on the audio thread to swapping it in, in milliseconds
+    std::atomic<float> lastLoadLatencyMS{0.f}, maxLoadLatencyMS{0.f};
+    std::atomic<int> loadsCompleted{0};
+
+  private:
+    enum State
+    {
+        IDLE,
+        REQUESTED,
+        BUILDING,
+        READY
+    };
+
+    struct Mailbox
+    {
+        std::atomic<int> state{IDLE};
+
+        // written by the audio thread before REQUESTED
+        int requestedId = -1;
+        bool requestedFromList = false;
+        char requestedFilename[256];
+        int generation = 0;
+        std::chrono::high_resolution_clock::time_point requestedAt;
+
+        // written by the worker before READY
+        bool built = false;
+        int resolvedId = -1;
+        char displayName[256];
+        std::unique_ptr<Wavetable> staging;
+    };
+
+    bool postLoad(int scene, int osc);
+    bool applyLoad(int scene, int osc);
+    void buildLoad(Mailbox &mb);
+    void workerLoop();
+
+    SurgeStorage *storage;
+    std::array<std::array<Mailbox, n_oscs>, n_scenes> mailboxes;
+
+    std::thread worker;
+    std::mutex workerLock;
+    std::condition_variable workerCV;
+    std::atomic<bool> keepRunning{true};
+    std::atomic<int> pendingLoads{0};
+    std::atomic<int> generation{0};
+};
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_XT_WAVETABLELOADER_H
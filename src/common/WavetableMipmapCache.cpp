@@ -0,0 +1,471 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "WavetableMipmapCache.h"
+#include "globals.h"
+#include "SurgeStorage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if MAC || LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "filesystem/import.h"
+
+namespace Surge
+{
+namespace Storage
+{
+namespace
+{
+// Bump this whenever the layout below or the way BuildWT and MipMapWT fill a table changes
+const uint32_t cacheVersion = 1;
+const char cacheTag[8] = {'S', 'U', 'R', 'G', 'E', 'W', 'T', 'M'};
+const uint32_t byteOrderMark = 0x01020304;
+const uint64_t dataAlignment = 64;
+
+struct CacheHeader
+{
+    char tag[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t floatSize, shortSize;
+    int32_t size, n_tables, size_po2, flags;
+    float dt;
+    uint32_t keyLength; // the key follows the header
+    uint64_t dataSizes;
+    uint64_t f32Offset, i16Offset; // in bytes from the start of the file
+    uint64_t fileSize;
+    // In elements from the start of the float or int16 data, or -1 for a null pointer
+    int32_t f32Pointers[max_mipmap_levels][max_subtables];
+    int32_t i16Pointers[max_mipmap_levels][max_subtables];
+};
+
+uint64_t aligned(uint64_t n) { return (n + dataAlignment - 1) / dataAlignment * dataAlignment; }
+
+// A whole cache file in memory, mapped if we can, which the tables read from keep alive
+struct CacheFileData
+{
+    const char *data = nullptr;
+    size_t size = 0;
+
+    ~CacheFileData()
+    {
+        if (!data)
+            return;
+#if MAC || LINUX
+        if (mapped)
+            munmap(const_cast<char *>(data), size);
+        else
+            free(const_cast<char *>(data));
+#else
+        if (mapped)
+        {
+            UnmapViewOfFile(data);
+            CloseHandle(mapping);
+        }
+        else
+        {
+            free(const_cast<char *>(data));
+        }
+#endif
+    }
+
+    bool mapped = false;
+#if WINDOWS
+    HANDLE mapping = nullptr;
+#endif
+};
+
+bool mapFile(const fs::path &p, CacheFileData &into)
+{
+#if MAC || LINUX
+    int fd = open(p.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+#ifdef MAP_POPULATE
+    auto m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+#else
+    auto m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif
+    close(fd);
+    if (m == MAP_FAILED)
+        return false;
+#ifndef MAP_POPULATE
+    madvise(m, st.st_size, MADV_WILLNEED);
+#endif
+
+    into.data = static_cast<const char *>(m);
+    into.size = st.st_size;
+    into.mapped = true;
+    return true;
+#else
+    auto fh = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(fh, &sz) || sz.QuadPart <= 0)
+    {
+        CloseHandle(fh);
+        return false;
+    }
+
+    auto mh = CreateFileMappingW(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(fh);
+    if (!mh)
+        return false;
+
+    auto m = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (!m)
+    {
+        CloseHandle(mh);
+        return false;
+    }
+
+    into.data = static_cast<const char *>(m);
+    into.size = (size_t)sz.QuadPart;
+    into.mapped = true;
+    into.mapping = mh;
+    return true;
+#endif
+}
+
+/*
+ * The oscillators read the table on the audio thread, so fault every page in here on the loading
+ * thread rather than there on the first note. MAP_POPULATE has done this already where we have it.
+ */
+void prefault(const CacheFileData &f)
+{
+#ifndef MAP_POPULATE
+    if (!f.mapped)
+        return;
+
+    const size_t page = 4096;
+    volatile char sink = 0;
+    for (size_t i = 0; i < f.size; i += page)
+        sink += f.data[i];
+    sink += f.data[f.size - 1];
+#endif
+}
+
+bool readFile(const fs::path &p, CacheFileData &into)
+{
+    std::error_code ec;
+    auto sz = fs::file_size(p, ec);
+    if (ec || sz == 0)
+        return false;
+
+    std::ifstream ifs(p, std::ios::binary);
+    if (!ifs)
+        return false;
+
+    auto d = static_cast<char *>(malloc(sz));
+    if (!d)
+        return false;
+    if (!ifs.read(d, sz))
+    {
+        free(d);
+        return false;
+    }
+
+    into.data = d;
+    into.size = sz;
+    return true;
+}
+
+bool headerChecksOut(const CacheHeader &h, const CacheFileData &f, const std::string &key)
+{
+    if (memcmp(h.tag, cacheTag, sizeof(cacheTag)) != 0 || h.version != cacheVersion ||
+        h.byteOrder != byteOrderMark || h.floatSize != sizeof(float) ||
+        h.shortSize != sizeof(short))
+        return false;
+
+    if (h.fileSize != f.size || h.keyLength != key.size() ||
+        sizeof(CacheHeader) + h.keyLength > f.size ||
+        memcmp(f.data + sizeof(CacheHeader), key.data(), key.size()) != 0)
+        return false;
+
+    if (h.size <= 0 || h.size > max_wtable_size || h.size_po2 < 0 || h.size_po2 > 30 ||
+        h.size != (1 << h.size_po2))
+        return false;
+
+    /*
+     * RequiredWTSize pads by three tables, which BuildWT has already counted into n_tables if it
+     * appended silence, and the oscillators read at least three tables whatever n_tables is.
+     */
+    auto laidOut = std::max(h.n_tables, 3) - 3;
+    if (h.n_tables < 0 || h.n_tables > max_subtables ||
+        RequiredWTSize(h.size, laidOut) > h.dataSizes || h.dataSizes == 0 ||
+        h.dataSizes > f.size || h.f32Offset > f.size || h.i16Offset > f.size ||
+        h.f32Offset % dataAlignment || h.i16Offset % dataAlignment ||
+        h.f32Offset < sizeof(CacheHeader) + h.keyLength ||
+        h.f32Offset + h.dataSizes * sizeof(float) > h.i16Offset ||
+        h.i16Offset + h.dataSizes * sizeof(short) > f.size)
+        return false;
+
+    // Every level of every table has to lie wholly inside the data, padding included
+    for (int i = 0; i < max_mipmap_levels; ++i)
+    {
+        int64_t f32Length = h.size >> i;
+        int64_t i16Length = f32Length + FIRipolI16_N;
+        for (int j = 0; j < max_subtables; ++j)
+        {
+            int64_t fo = h.f32Pointers[i][j], io = h.i16Pointers[i][j];
+            if (fo < -1 || io < -1 || (fo >= 0 && fo + f32Length > (int64_t)h.dataSizes) ||
+                (io >= 0 && io + i16Length > (int64_t)h.dataSizes))
+                return false;
+        }
+    }
+    return true;
+}
+
+uint64_t fnv1a(const std::string &s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (auto c : s)
+    {
+        h ^= (unsigned char)c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+} // namespace
+
+std::string WavetableMipmapCache::cacheFileFor(const std::string &cacheDir,
+                                               const std::string &filename)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wtcache", (unsigned long long)fnv1a(filename));
+    return path_to_string(string_to_path(cacheDir) / name);
+}
+
+bool WavetableMipmapCache::read(const std::string &cacheDir, const std::string &filename,
+                                const std::string &key, Wavetable *into)
+{
+    if (cacheDir.empty() || key.empty())
+        return false;
+
+    auto p = string_to_path(cacheFileFor(cacheDir, filename));
+    auto f = std::make_shared<CacheFileData>();
+    if (!mapFile(p, *f) && !readFile(p, *f))
+        return false;
+
+    if (f->size < sizeof(CacheHeader))
+        return false;
+
+    // The pointer tables make the header too big to want on a loader thread's stack
+    auto hp = std::make_unique<CacheHeader>();
+    auto &h = *hp;
+    memcpy(&h, f->data, sizeof(CacheHeader));
+    if (!headerChecksOut(h, *f, key))
+        return false;
+
+    prefault(*f);
+
+    // the modification time is when we last used this, which is what trim() goes by
+    std::error_code ec;
+    fs::last_write_time(p, fs::file_time_type::clock::now(), ec);
+
+    auto f32 = reinterpret_cast<float *>(const_cast<char *>(f->data + h.f32Offset));
+    auto i16 = reinterpret_cast<short *>(const_cast<char *>(f->data + h.i16Offset));
+
+    into->ReadExternalData(f32, i16, h.dataSizes, f);
+    into->everBuilt = true;
+    into->size = h.size;
+    into->n_tables = h.n_tables;
+    into->size_po2 = h.size_po2;
+    into->flags = h.flags;
+    into->dt = h.dt;
+    for (int i = 0; i < max_mipmap_levels; ++i)
+    {
+        for (int j = 0; j < max_subtables; ++j)
+        {
+            auto fo = h.f32Pointers[i][j], io = h.i16Pointers[i][j];
+            into->TableF32WeakPointers[i][j] = fo < 0 ? nullptr : f32 + fo;
+            into->TableI16WeakPointers[i][j] = io < 0 ? nullptr : i16 + io;
+        }
+    }
+    return true;
+}
+
+int WavetableMipmapCache::trim(const std::string &cacheDir, uint64_t maxBytes)
+{
+    if (cacheDir.empty())
+        return 0;
+
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type lastUsed;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code ec;
+    for (auto &d : fs::directory_iterator(string_to_path(cacheDir), ec))
+    {
+        if (path_to_string(d.path().extension()) != ".wtcache")
+            continue;
+
+        std::error_code fec;
+        auto size = fs::file_size(d.path(), fec);
+        auto lastUsed = fs::last_write_time(d.path(), fec);
+        if (fec)
+            continue;
+
+        entries.push_back({d.path(), size, lastUsed});
+        total += size;
+    }
+
+    if (total <= maxBytes)
+        return 0;
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.lastUsed < b.lastUsed; });
+
+    int removed = 0;
+    for (const auto &e : entries)
+    {
+        if (total <= maxBytes)
+            break;
+
+        std::error_code rec;
+        if (fs::remove(e.path, rec))
+        {
+            total -= e.size;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+bool WavetableMipmapCache::write(const std::string &cacheDir, const std::string &filename,
+                                 const std::string &key, const Wavetable *wt)
+{
+    if (cacheDir.empty() || key.empty() || !wt->everBuilt || !wt->TableF32Data ||
+        !wt->TableI16Data || wt->dataSizes > INT32_MAX)
+        return false;
+
+    auto h = std::make_unique<CacheHeader>();
+    memset(h.get(), 0, sizeof(CacheHeader));
+    memcpy(h->tag, cacheTag, sizeof(cacheTag));
+    h->version = cacheVersion;
+    h->byteOrder = byteOrderMark;
+    h->floatSize = sizeof(float);
+    h->shortSize = sizeof(short);
+    h->size = wt->size;
+    h->n_tables = wt->n_tables;
+    h->size_po2 = wt->size_po2;
+    h->flags = wt->flags;
+    h->dt = wt->dt;
+    h->keyLength = key.size();
+    h->dataSizes = wt->dataSizes;
+    h->f32Offset = aligned(sizeof(CacheHeader) + key.size());
+    h->i16Offset = aligned(h->f32Offset + wt->dataSizes * sizeof(float));
+    h->fileSize = h->i16Offset + wt->dataSizes * sizeof(short);
+
+    for (int i = 0; i < max_mipmap_levels; ++i)
+    {
+        for (int j = 0; j < max_subtables; ++j)
+        {
+            auto fp = wt->TableF32WeakPointers[i][j];
+            auto ip = wt->TableI16WeakPointers[i][j];
+            h->f32Pointers[i][j] = fp ? (int32_t)(fp - wt->TableF32Data) : -1;
+            h->i16Pointers[i][j] = ip ? (int32_t)(ip - wt->TableI16Data) : -1;
+        }
+    }
+
+    std::error_code ec;
+    auto dir = string_to_path(cacheDir);
+    fs::create_directories(dir, ec);
+    if (ec)
+        return false;
+
+    static std::atomic<uint64_t> tempCounter{0};
+    auto dest = string_to_path(cacheFileFor(cacheDir, filename));
+    std::ostringstream tn;
+    tn << path_to_string(dest) << "." << std::hash<std::thread::id>()(std::this_thread::get_id())
+       << "." << tempCounter++ << ".tmp";
+    auto temp = string_to_path(tn.str());
+
+    {
+        std::ofstream ofs(temp, std::ios::binary | std::ios::trunc);
+        if (!ofs)
+            return false;
+
+        auto pad = [&ofs](uint64_t to) {
+            static const char zeros[dataAlignment] = {};
+            auto at = (uint64_t)ofs.tellp();
+            if (to > at)
+                ofs.write(zeros, to - at);
+        };
+
+        ofs.write(reinterpret_cast<const char *>(h.get()), sizeof(CacheHeader));
+        ofs.write(key.data(), key.size());
+        pad(h->f32Offset);
+        ofs.write(reinterpret_cast<const char *>(wt->TableF32Data),
+                  wt->dataSizes * sizeof(float));
+        pad(h->i16Offset);
+        ofs.write(reinterpret_cast<const char *>(wt->TableI16Data),
+                  wt->dataSizes * sizeof(short));
+        ofs.close();
+
+        if (!ofs)
+        {
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+
+    /*
+     * Windows won't replace a file someone has mapped. In that case the old file stays, and since
+     * it is for an older key it just keeps missing until nothing has it open.
+     */
+    fs::rename(temp, dest, ec);
+    if (ec)
+    {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+} // namespace Storage
+} // namespace Surge
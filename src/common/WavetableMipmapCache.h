@@ -0,0 +1,75 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_WAVETABLEMIPMAPCACHE_H
+#define SURGE_XT_WAVETABLEMIPMAPCACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "Wavetable.h"
+
+namespace Surge
+{
+namespace Storage
+{
+/*
+ * Finished wavetables on disk, so a table which has been read and mipmapped once is mapped
+ * straight back in on later loads rather than filtered down level by level again.
+ *
+ * Each source file gets one file in the cache directory, named for a hash of its path. That
+ * holds a versioned header, the WavetableCache key of the source it was built from (so an edited
+ * source misses and is rebuilt over it), the layout of the table, and then the float and int16
+ * data, each 64 byte aligned, in the same arrangement as TableF32Data and TableI16Data. The weak
+ * pointers are stored as offsets into those. Anything about a file which doesn't check out makes
+ * it a miss; the cache is never more than a shortcut. SurgeStorage trims it back to the user's
+ * size limit after each write, dropping the least recently used tables first.
+ */
+struct WavetableMipmapCache
+{
+    /*
+     * Fill into from the cache file for filename if it was written for key. The data is mapped
+     * where the platform allows and read otherwise; either way into reads it through
+     * Wavetable::ReadExternalData. A mapping is faulted in before this returns, so call it from
+     * the thread doing the loading.
+     */
+    static bool read(const std::string &cacheDir, const std::string &filename,
+                     const std::string &key, Wavetable *into);
+
+    /*
+     * Store wt, built from filename as described by key. Writes to a temporary file and renames
+     * it into place, so readers in other threads or processes only ever see a whole file. Returns
+     * false, leaving the cache as it was, if that fails.
+     */
+    static bool write(const std::string &cacheDir, const std::string &filename,
+                      const std::string &key, const Wavetable *wt);
+
+    /*
+     * Delete the least recently used files in cacheDir until what is left adds up to no more
+     * than maxBytes, and return how many went. read() bumps a file's modification time on every
+     * hit, so that is its last use. A file Windows won't delete because another process has it
+     * mapped is skipped.
+     */
+    static int trim(const std::string &cacheDir, uint64_t maxBytes);
+
+    // How large the cache may grow unless the user defaults say otherwise
+    static constexpr int defaultMaxMegabytes = 256;
+
+    static std::string cacheFileFor(const std::string &cacheDir, const std::string &filename);
+};
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_XT_WAVETABLEMIPMAPCACHE_H
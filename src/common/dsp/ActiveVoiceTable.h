@@ -0,0 +1,88 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_ACTIVEVOICETABLE_H
+#define SURGE_XT_ACTIVEVOICETABLE_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "globals.h"
+
+class SurgeVoice;
+
+/*
+ * The voices sounding in one scene, oldest first, packed at the front of a fixed array.
+ *
+ * Voice n renders in lane n & 3 of the scene's QuadFilterChainState n >> 2, so keeping the
+ * array dense keeps the quads full as voices die, and walking it is a walk over MAX_VOICES
+ * contiguous pointers rather than list nodes. Nothing here allocates.
+ *
+ * It offers the parts of std::list the synth used to use so the voice loops read the same.
+ * The one difference is that erase slides the younger voices down a slot, so iterators past
+ * the erased one are invalidated; use the iterator erase returns.
+ */
+class ActiveVoiceTable
+{
+  public:
+    typedef SurgeVoice **iterator;
+    typedef SurgeVoice *const *const_iterator;
+
+    // A scene only ever has the MAX_VOICES voices of its voices_array to hand out
+    static constexpr size_t capacity = MAX_VOICES;
+
+    iterator begin() { return slots.data(); }
+    iterator end() { return slots.data() + count; }
+    const_iterator begin() const { return slots.data(); }
+    const_iterator end() const { return slots.data() + count; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+
+    SurgeVoice *&operator[](size_t i) { return slots[i]; }
+    SurgeVoice *operator[](size_t i) const { return slots[i]; }
+
+    void push_back(SurgeVoice *v)
+    {
+        assert(count < capacity);
+        if (count < capacity)
+            slots[count++] = v;
+    }
+
+    iterator erase(iterator it)
+    {
+        std::move(it + 1, end(), it);
+        count--;
+        return it;
+    }
+
+    /*
+     * Keep only the first n voices. Used after compacting the survivors of a block in place.
+     */
+    void truncate(size_t n)
+    {
+        assert(n <= count);
+        count = std::min(n, count);
+    }
+
+  private:
+    std::array<SurgeVoice *, capacity> slots{};
+    size_t count = 0;
+};
+
+#endif // SURGE_XT_ACTIVEVOICETABLE_H
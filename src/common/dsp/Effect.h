@@ -40,6 +40,10 @@ class alignas(16) Effect
     // No matter what path is used to reload (whether created anew or what not) this is called after
     // the loading state of an item has changed
     virtual void updateAfterReload(){};
+
+    // Point the effect at a different copy of its parameters, e.g. once an effect built off the
+    // audio thread against a private copy is swapped into the patch
+    void rebind(FxStorage *fxdata, pdata *pd);
     virtual int vu_type(int id) { return 0; };
     virtual int vu_ypos(int id) { return id; }; // in 'half-hslider' heights
     virtual const char *group_label(int id) { return 0; };
@@ -0,0 +1,207 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "EffectLoader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Surge
+{
+namespace FX
+{
+EffectLoader::EffectLoader(SurgeStorage *s) : storage(s)
+{
+    for (auto &t : trash)
+        t = nullptr;
+
+    worker = std::thread([this]() { this->workerLoop(); });
+}
+
+EffectLoader::~EffectLoader()
+{
+    keepRunning = false;
+    workerCV.notify_all();
+    worker.join();
+
+    for (auto &t : trash)
+        delete t.exchange(nullptr);
+}
+
+bool EffectLoader::post(int slot, const FxStorage &params, bool initDefaults)
+{
+    auto &mb = mailboxes[slot];
+    if (mb.state != IDLE)
+        return false;
+
+    memcpy((void *)&mb.params, (const void *)&params, sizeof(FxStorage));
+
+    // an FX slot turned off has its parameters cleared, exactly as loadFx does it
+    if (mb.params.type.val.i == fxt_off)
+    {
+        for (int j = 0; j < n_fx_params; j++)
+        {
+            mb.params.p[j].set_type(ct_none);
+            std::string n = "Param ";
+            n += std::to_string(j + 1);
+            mb.params.p[j].set_name(n.c_str());
+            mb.params.p[j].val.i = 0;
+        }
+    }
+
+    mb.initDefaults = initDefaults;
+    mb.generation = generation;
+    mb.requestedAt = std::chrono::high_resolution_clock::now();
+    mb.state = REQUESTED;
+    pendingLoads++;
+    workerCV.notify_one();
+
+    return true;
+}
+
+FxStorage *EffectLoader::collect(int slot, std::unique_ptr<Effect> &effect)
+{
+    auto &mb = mailboxes[slot];
+    if (mb.state != READY)
+        return nullptr;
+
+    if (mb.generation != generation)
+    {
+        retire(std::move(mb.effect));
+        mb.state = IDLE;
+        return nullptr;
+    }
+
+    auto latency = std::chrono::duration<float, std::milli>(
+                       std::chrono::high_resolution_clock::now() - mb.requestedAt)
+                       .count();
+    lastLoadLatencyMS = latency;
+    if (latency > maxLoadLatencyMS)
+        maxLoadLatencyMS = latency;
+    loadsCompleted++;
+
+    effect = std::move(mb.effect);
+    return &mb.params;
+}
+
+void EffectLoader::release(int slot) { mailboxes[slot].state = IDLE; }
+
+void EffectLoader::retire(std::unique_ptr<Effect> effect)
+{
+    if (!effect)
+        return;
+
+    auto *e = effect.release();
+    for (auto &t : trash)
+    {
+        Effect *expected = nullptr;
+        if (t.compare_exchange_strong(expected, e))
+        {
+            workerCV.notify_one();
+            return;
+        }
+    }
+
+    delete e;
+}
+
+void EffectLoader::discardPendingLoads() { generation++; }
+
+void EffectLoader::waitForPendingLoads()
+{
+    while (pendingLoads > 0)
+    {
+        std::unique_lock<std::mutex> g(workerLock);
+        workerCV.wait_for(g, std::chrono::milliseconds(5), [this]() { return pendingLoads == 0; });
+    }
+}
+
+void EffectLoader::boundParameters(FxStorage &params)
+{
+    for (int j = 0; j < n_fx_params; j++)
+    {
+        auto p = &(params.p[j]);
+        if (p->ctrltype != ct_none)
+        {
+            if (p->valtype == vt_float)
+            {
+                p->val.f = std::clamp(p->val.f, p->val_min.f, p->val_max.f);
+            }
+            else if (p->valtype == vt_int)
+            {
+                p->val.i = std::clamp(p->val.i, p->val_min.i, p->val_max.i);
+            }
+        }
+    }
+}
+
+Effect *EffectLoader::buildEffect(SurgeStorage *storage, FxStorage &params, pdata *paramData,
+                                  bool initDefaults)
+{
+    memset(paramData, 0, sizeof(pdata) * n_global_params);
+
+    auto *e = spawn_effect(params.type.val.i, storage, &params, paramData);
+    if (!e)
+        return nullptr;
+
+    e->init_ctrltypes();
+    if (initDefaults)
+        e->init_default_values();
+    else
+        boundParameters(params);
+
+    // init() reads the parameters through pd, so give it the values it will start with
+    for (int j = 0; j < n_fx_params; j++)
+        paramData[params.p[j].id] = params.p[j].val;
+
+    e->init();
+    return e;
+}
+
+void EffectLoader::build(Mailbox &mb)
+{
+    mb.effect.reset(buildEffect(storage, mb.params, mb.paramData, mb.initDefaults));
+}
+
+void EffectLoader::workerLoop()
+{
+    while (keepRunning)
+    {
+        for (auto &mb : mailboxes)
+        {
+            int expected = REQUESTED;
+            if (mb.state.compare_exchange_strong(expected, BUILDING))
+            {
+                build(mb);
+                mb.state = READY;
+                pendingLoads--;
+                workerCV.notify_all();
+            }
+        }
+
+        for (auto &t : trash)
+            delete t.exchange(nullptr);
+
+        /*
+         * The audio thread notifies without taking the lock, so a wakeup can slip in between
+         * the predicate check and the wait. The timeout bounds how late we notice that.
+         */
+        std::unique_lock<std::mutex> g(workerLock);
+        workerCV.wait_for(g, std::chrono::milliseconds(50),
+                          [this]() { return !keepRunning || pendingLoads > 0; });
+    }
+}
+} // namespace FX
+} // namespace Surge
@@ -0,0 +1,142 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_EFFECTLOADER_H
+#define SURGE_XT_EFFECTLOADER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Effect.h"
+
+namespace Surge
+{
+namespace FX
+{
+/*
+ * Builds effects on a worker thread, so that picking a new FX type doesn't run the effect's
+ * constructor and init() (which for the reverbs, Nimbus, the BBD and tape effects and so on
+ * means allocating and clearing large buffers) on the audio thread. Retired effects are handed
+ * back here and deleted on the worker too.
+ *
+ * Each FX slot has one mailbox. The audio thread posts a copy of the slot's FxStorage, the
+ * worker spawns the effect against that copy and a private parameter block, sets it up
+ * completely and marks the mailbox ready, and on a later block the audio thread collects it,
+ * rebinds it to the patch and swaps it in.
+ */
+struct EffectLoader
+{
+    explicit EffectLoader(SurgeStorage *storage);
+    ~EffectLoader();
+
+    EffectLoader(const EffectLoader &) = delete;
+    EffectLoader &operator=(const EffectLoader &) = delete;
+
+    /*
+     * Audio thread: build an effect of params' type with params' values (or, with initDefaults,
+     * the type's defaults) for slot. Returns false if the slot already has a load in flight.
+     */
+    bool post(int slot, const FxStorage &params, bool initDefaults);
+
+    bool isBusy(int slot) const { return mailboxes[slot].state != IDLE; }
+    bool isReady(int slot) const { return mailboxes[slot].state == READY; }
+
+    /*
+     * Audio thread: if the slot's load is done, move the effect (which is nullptr for fxt_off)
+     * into effect and return the parameters it was built with. Those stay valid until
+     * release(slot). Returns nullptr if there is nothing to apply yet.
+     */
+    FxStorage *collect(int slot, std::unique_ptr<Effect> &effect);
+    void release(int slot);
+
+    /*
+     * Audio thread: hand an effect over to be deleted on the worker. Never blocks; if the
+     * worker is hopelessly behind the effect is deleted right here.
+     */
+    void retire(std::unique_ptr<Effect> effect);
+
+    // Block until every posted load has been built; for tests and offline rendering
+    void waitForPendingLoads();
+
+    // Drop every load posted so far, e.g. because a patch load replaced all the FX
+    void discardPendingLoads();
+
+    /*
+     * Pull FX parameters carried over from another type back into range. Shared with the
+     * synchronous load in SurgeSynthesizer::loadFx.
+     */
+    static void boundParameters(FxStorage &params);
+
+    /*
+     * Spawn an effect of params' type against params and paramData and set it up completely,
+     * ready to be rebound to the patch. Returns nullptr for fxt_off. Allocates, so never on the
+     * audio thread.
+     */
+    static Effect *buildEffect(SurgeStorage *storage, FxStorage &params, pdata *paramData,
+                               bool initDefaults);
+
+    // Time from post() to collect(), in milliseconds
+    std::atomic<float> lastLoadLatencyMS{0.f}, maxLoadLatencyMS{0.f};
+    std::atomic<int> loadsCompleted{0};
+
+  private:
+    enum State
+    {
+        IDLE,
+        REQUESTED,
+        BUILDING,
+        READY
+    };
+
+    struct Mailbox
+    {
+        std::atomic<int> state{IDLE};
+
+        // written by the audio thread before REQUESTED
+        FxStorage params;
+        bool initDefaults = false;
+        int generation = 0;
+        std::chrono::high_resolution_clock::time_point requestedAt;
+
+        // written by the worker before READY
+        std::unique_ptr<Effect> effect;
+        pdata paramData[n_global_params];
+    };
+
+    void build(Mailbox &mb);
+    void workerLoop();
+
+    SurgeStorage *storage;
+    std::array<Mailbox, n_fx_slots> mailboxes;
+
+    static constexpr int trashSize = 32;
+    std::array<std::atomic<Effect *>, trashSize> trash;
+
+    std::thread worker;
+    std::mutex workerLock;
+    std::condition_variable workerCV;
+    std::atomic<bool> keepRunning{true};
+    std::atomic<int> pendingLoads{0};
+    std::atomic<int> generation{0};
+};
+} // namespace FX
+} // namespace Surge
+
+#endif // SURGE_XT_EFFECTLOADER_H
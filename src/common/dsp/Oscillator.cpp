@@ -16,6 +16,7 @@
 #include "Oscillator.h"
 #include "DSPUtils.h"
 #include "FastMath.h"
+#include <algorithm>
 #include <cmath>
 
 #include "AliasOscillator.h"
@@ -27,54 +28,126 @@
 #include "SampleAndHoldOscillator.h"
 #include "SineOscillator.h"
 #include "StringOscillator.h"
-#include "TwistOscillator.h"
 #include "WavetableOscillator.h"
 #include "WindowOscillator.h"
 
 using namespace std;
 
-Oscillator *spawn_osc(int osctype, SurgeStorage *storage, OscillatorStorage *oscdata,
-                      pdata *localcopy)
+namespace
+{
+template <typename T> constexpr size_t largestOf() { return sizeof(T); }
+template <typename T, typename U, typename... Rest> constexpr size_t largestOf()
+{
+    return sizeof(T) > largestOf<U, Rest...>() ? sizeof(T) : largestOf<U, Rest...>();
+}
+
+constexpr size_t largestOscillatorSize =
+    largestOf<ClassicOscillator, WavetableOscillator, WindowOscillator, SampleAndHoldOscillator,
+              AudioInputOscillator, FM3Oscillator, FM2Oscillator, ModernOscillator,
+              StringOscillator, AliasOscillator, SineOscillator>();
+
+Oscillator *spawn_osc_onto(int osctype, SurgeStorage *storage, OscillatorStorage *oscdata,
+                           pdata *localcopy, unsigned char *onto)
 {
-    Oscillator *osc = 0;
     switch (osctype)
     {
     case ot_classic:
-        return new ClassicOscillator(storage, oscdata, localcopy);
+        return OscSpawner<ClassicOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_wavetable:
-        return new WavetableOscillator(storage, oscdata, localcopy);
+        return OscSpawner<WavetableOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_window:
     {
         // In the event we are misconfigured, window oscillator will segfault. If you still play
         // after clicking through 100 warnings, let's just give you a sine
         if (storage && storage->WindowWT.size == 0)
-            return new SineOscillator(storage, oscdata, localcopy);
+            return OscSpawner<SineOscillator>::make(storage, oscdata, localcopy, onto);
 
-        return new WindowOscillator(storage, oscdata, localcopy);
+        return OscSpawner<WindowOscillator>::make(storage, oscdata, localcopy, onto);
     }
     case ot_shnoise:
-        return new SampleAndHoldOscillator(storage, oscdata, localcopy);
+        return OscSpawner<SampleAndHoldOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_audioinput:
-        return new AudioInputOscillator(storage, oscdata, localcopy);
+        return OscSpawner<AudioInputOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_FM3:
-        return new FM3Oscillator(storage, oscdata, localcopy);
+        return OscSpawner<FM3Oscillator>::make(storage, oscdata, localcopy, onto);
     case ot_FM2:
-        return new FM2Oscillator(storage, oscdata, localcopy);
+        return OscSpawner<FM2Oscillator>::make(storage, oscdata, localcopy, onto);
     case ot_modern:
-        return new ModernOscillator(storage, oscdata, localcopy);
+        return OscSpawner<ModernOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_string:
-        return new StringOscillator(storage, oscdata, localcopy);
+        return OscSpawner<StringOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_twist:
-        return new TwistOscillator(storage, oscdata, localcopy);
+        return spawn_twist_osc(storage, oscdata, localcopy, onto);
     case ot_alias:
-        return new AliasOscillator(storage, oscdata, localcopy);
+        return OscSpawner<AliasOscillator>::make(storage, oscdata, localcopy, onto);
     case ot_sine:
     default:
-        return new SineOscillator(storage, oscdata, localcopy);
+        return OscSpawner<SineOscillator>::make(storage, oscdata, localcopy, onto);
     }
-    return osc;
+    return nullptr;
+}
+} // namespace
+
+Oscillator *spawn_osc(int osctype, SurgeStorage *storage, OscillatorStorage *oscdata,
+                      pdata *localcopy)
+{
+    return spawn_osc_onto(osctype, storage, oscdata, localcopy, nullptr);
+}
+
+Oscillator *spawn_osc(int osctype, SurgeStorage *storage, OscillatorStorage *oscdata,
+                      pdata *localcopy, unsigned char *onto)
+{
+    assert(storage);
+    assert(onto);
+    return spawn_osc_onto(osctype, storage, oscdata, localcopy, onto);
+}
+
+void release_osc(Oscillator *osc, SurgeStorage *storage, unsigned char *onto)
+{
+    if (!osc)
+        return;
+
+    osc->~Oscillator();
+
+    if ((unsigned char *)osc != onto)
+        storage->oscillatorBlockPool->returnBlock((unsigned char *)osc);
 }
 
+bool osc_needs_pool_block(int osctype)
+{
+    switch (osctype)
+    {
+    case ot_classic:
+        return sizeof(ClassicOscillator) > oscillator_buffer_size;
+    case ot_wavetable:
+        return sizeof(WavetableOscillator) > oscillator_buffer_size;
+    case ot_window:
+        return sizeof(WindowOscillator) > oscillator_buffer_size;
+    case ot_shnoise:
+        return sizeof(SampleAndHoldOscillator) > oscillator_buffer_size;
+    case ot_audioinput:
+        return sizeof(AudioInputOscillator) > oscillator_buffer_size;
+    case ot_FM3:
+        return sizeof(FM3Oscillator) > oscillator_buffer_size;
+    case ot_FM2:
+        return sizeof(FM2Oscillator) > oscillator_buffer_size;
+    case ot_modern:
+        return sizeof(ModernOscillator) > oscillator_buffer_size;
+    case ot_string:
+        return sizeof(StringOscillator) > oscillator_buffer_size;
+    case ot_twist:
+        return twist_osc_size() > oscillator_buffer_size;
+    case ot_alias:
+        return sizeof(AliasOscillator) > oscillator_buffer_size;
+    case ot_sine:
+    default:
+        return sizeof(SineOscillator) > oscillator_buffer_size;
+    }
+    return false;
+}
+
+size_t osc_pool_block_size() { return std::max(largestOscillatorSize, twist_osc_size()); }
+
 Oscillator::Oscillator(SurgeStorage *storage, OscillatorStorage *oscdata, pdata *localcopy)
     : master_osc(0)
 {
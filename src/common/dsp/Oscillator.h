@@ -7,5 +7,70 @@
 
 #include "OscillatorBase.h"
 
+#include <new>
+
+/*
+ * Voices construct their oscillators in place into a buffer of this size, so starting a voice
+ * never goes to the allocator. Oscillator types which don't fit (String and Twist carry large
+ * delay lines and resamplers) are placed into a block borrowed from
+ * SurgeStorage::oscillatorBlockPool instead, which is reserved off the audio thread by
+ * SurgeStorage::reserveOscillatorBlocks before a patch load or type change makes them live.
+ */
+const int oscillator_buffer_size = 16 * 1024;
+
+// Heap allocates. Fine for the UI and tests; voices use the placement version below.
 Oscillator *spawn_osc(int osctype, SurgeStorage *storage, OscillatorStorage *oscdata,
                       pdata *localcopy);
+
+Oscillator *spawn_osc(int osctype, SurgeStorage *storage, OscillatorStorage *oscdata,
+                      pdata *localcopy, unsigned char *onto);
+// Destroys an oscillator made by the placement spawn_osc, returning any borrowed block
+void release_osc(Oscillator *osc, SurgeStorage *storage, unsigned char *onto);
+
+bool osc_needs_pool_block(int osctype);
+size_t osc_pool_block_size();
+
+/*
+ * What a voice gets when the pool has no block for its large oscillator. It plays silence for
+ * the life of the voice; later voices get the real type once the pool has been topped up.
+ */
+class SilentOscillator : public Oscillator
+{
+  public:
+    SilentOscillator(SurgeStorage *storage, OscillatorStorage *oscdata, pdata *localcopy)
+        : Oscillator(storage, oscdata, localcopy)
+    {
+        memset(output, 0, sizeof(output));
+        memset(outputR, 0, sizeof(outputR));
+    }
+};
+
+/*
+ * Places a T into onto, or into a block from the storage's pool if T doesn't fit there, or onto
+ * the heap if there is no onto at all. Never allocates when given an onto; if the pool is dry
+ * the voice gets a SilentOscillator in onto instead.
+ */
+template <typename T> struct OscSpawner
+{
+    static Oscillator *make(SurgeStorage *storage, OscillatorStorage *oscdata, pdata *localcopy,
+                            unsigned char *onto)
+    {
+        if (!onto)
+            return new T(storage, oscdata, localcopy);
+
+        if (sizeof(T) > oscillator_buffer_size)
+        {
+            auto block = storage->oscillatorBlockPool->getBlock();
+            if (!block)
+                return new (onto) SilentOscillator(storage, oscdata, localcopy);
+            onto = block;
+        }
+
+        return new (onto) T(storage, oscdata, localcopy);
+    }
+};
+
+// TwistOscillator.h brings in plaits, so it stays inside TwistOscillator.cpp and these stand in
+Oscillator *spawn_twist_osc(SurgeStorage *storage, OscillatorStorage *oscdata, pdata *localcopy,
+                            unsigned char *onto);
+size_t twist_osc_size();
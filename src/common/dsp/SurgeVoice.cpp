@@ -16,6 +16,8 @@
 #include "SurgeVoice.h"
 #include "DSPUtils.h"
 #include "QuadFilterChain.h"
+#include "ModulationRoutingTable.h"
+#include "ProcessProfiler.h"
 #include <math.h>
 #include "libMTSClient.h"
 
@@ -75,7 +77,11 @@ float SurgeVoiceState::getPitch(SurgeStorage *storage)
     }
 }
 
-SurgeVoice::SurgeVoice() {}
+SurgeVoice::SurgeVoice()
+{
+    for (int i = 0; i < n_oscs; i++)
+        osc[i] = nullptr;
+}
 
 SurgeVoice::SurgeVoice(SurgeStorage *storage, SurgeSceneStorage *oscene, pdata *params, int key,
                        int velocity, int channel, int scene_id, float detune,
@@ -91,6 +97,11 @@ SurgeVoice::SurgeVoice(SurgeStorage *storage, SurgeSceneStorage *oscene, pdata *
     assert(storage);
     assert(oscene);
 
+#if STORAGE_USES_INDEPENDENT_RNG
+    if (storage->independentVoiceRngs)
+        rngGen.g.seed(storage->rand_u32());
+#endif
+
     memcpy(localcopy, paramptr, sizeof(localcopy));
 
     // We want this on the keystate so it survives the voice for mono mode
@@ -141,6 +152,7 @@ SurgeVoice::SurgeVoice(SurgeStorage *storage, SurgeSceneStorage *oscene, pdata *
     for (int i = 0; i < n_oscs; i++)
     {
         osctype[i] = -1;
+        osc[i] = nullptr;
     }
     memset(&FBP, 0, sizeof(FBP));
 
@@ -264,7 +276,14 @@ SurgeVoice::SurgeVoice(SurgeStorage *storage, SurgeSceneStorage *oscene, pdata *
     //}
 }
 
-SurgeVoice::~SurgeVoice() {}
+SurgeVoice::~SurgeVoice()
+{
+    for (int i = 0; i < n_oscs; ++i)
+    {
+        release_osc(osc[i], storage, oscbuffer[i]);
+        osc[i] = nullptr;
+    }
+}
 
 void SurgeVoice::legato(int key, int velocity, char detune)
 {
@@ -329,9 +348,9 @@ void SurgeVoice::switch_toggled()
     /*
      * Since we have updated the keytrack output here we need to re-update the localcopy modulators
      */
-    vector<ModulationRouting>::iterator iter;
-    iter = scene->modulation_voice.begin();
-    while (iter != scene->modulation_voice.end())
+    auto &modulation_voice = storage->modRoutingTable->current().scenes[state.scene_id].voice;
+    auto iter = modulation_voice.begin();
+    while (iter != modulation_voice.end())
     {
         int src_id = iter->source_id;
         int dst_id = iter->destination_id;
@@ -348,7 +367,9 @@ void SurgeVoice::switch_toggled()
         if (osctype[i] != scene->osc[i].type.val.i)
         {
             bool nzid = scene->drift.extend_range;
-            osc[i].reset(spawn_osc(scene->osc[i].type.val.i, storage, &scene->osc[i], localcopy));
+            release_osc(osc[i], storage, oscbuffer[i]);
+            osc[i] = spawn_osc(scene->osc[i].type.val.i, storage, &scene->osc[i], localcopy,
+                               oscbuffer[i]);
             if (osc[i])
             {
                 osc[i]->init(state.pitch, false, nzid);
@@ -523,7 +544,7 @@ int SurgeVoice::routefilter(int r)
     return r;
 }
 
-template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, int e)
+void SurgeVoice::process_modulators()
 {
     // Always process LFO1 so the gate retrigger always work
     lfo[0].process_block();
@@ -550,6 +571,77 @@ template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, in
     modsources[ms_filtereg]->process_block();
     if (((ADSRModulationSource *)modsources[ms_ampeg])->is_idle())
         state.keep_playing = false;
+}
+
+bool SurgeVoice::process_modulators_batch(SurgeVoice **v, int n)
+{
+    if (n < 2)
+        return false;
+
+    /*
+     * The voices share the storage's one formula Lua state. With a single formula LFO in use
+     * the script still gets called voice by voice, just as from calc_ctrldata; with more than one
+     * the calls would interleave differently, so such a patch keeps the voice by voice order.
+     */
+    auto *scene = v[0]->scene;
+    int formulas = 0;
+    for (int i = 0; i < n_lfos_voice; ++i)
+    {
+        if (scene->lfo[i].shape.val.i == lt_formula &&
+            (i == 0 || scene->modsource_doprocess[ms_lfo1 + i]))
+            formulas++;
+    }
+    if (formulas > 1)
+        return false;
+
+    LFOModulationSource *lfos[MAX_VOICES];
+    ADSRModulationSource *egs[MAX_VOICES];
+
+    for (int i = 0; i < n_lfos_voice; ++i)
+    {
+        // Always process LFO1 so the gate retrigger always work
+        if (i > 0 && !scene->modsource_doprocess[ms_lfo1 + i])
+            continue;
+
+        for (int j = 0; j < n; ++j)
+            lfos[j] = &v[j]->lfo[i];
+        LFOModulationSource::process_block_batch(lfos, n);
+    }
+
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n_lfos_voice; ++i)
+        {
+            if (v[j]->lfo[i].retrigger_AEG)
+                v[j]->ampEGSource.retrigger();
+            if (v[j]->lfo[i].retrigger_FEG)
+                v[j]->filterEGSource.retrigger();
+        }
+    }
+
+    for (int j = 0; j < n; ++j)
+        egs[j] = &v[j]->ampEGSource;
+    ADSRModulationSource::process_block_batch(egs, n);
+
+    for (int j = 0; j < n; ++j)
+        egs[j] = &v[j]->filterEGSource;
+    ADSRModulationSource::process_block_batch(egs, n);
+
+    for (int j = 0; j < n; ++j)
+    {
+        if (v[j]->ampEGSource.is_idle())
+            v[j]->state.keep_playing = false;
+        v[j]->modulatorsProcessed = true;
+    }
+    return true;
+}
+
+template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, int e)
+{
+    if (modulatorsProcessed)
+        modulatorsProcessed = false;
+    else
+        process_modulators();
 
     // TODO memcpy is bottleneck
     memcpy(localcopy, paramptr, sizeof(localcopy));
@@ -558,28 +650,16 @@ template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, in
     // same for FX & OSCs
     // also ignore int-parameters
 
-    vector<ModulationRouting>::iterator iter;
-    iter = scene->modulation_voice.begin();
-    while (iter != scene->modulation_voice.end())
-    {
-        int src_id = iter->source_id;
-        int dst_id = iter->destination_id;
-        float depth = iter->depth;
-
-        if (modsources[src_id])
-        {
-            localcopy[dst_id].f += depth * modsources[src_id]->output * (1.0 - iter->muted);
-        }
-        iter++;
-    }
+    auto &routing = storage->modRoutingTable->current().scenes[state.scene_id];
+    routing.voicePlan.apply(modsources, localcopy);
 
     if (mpeEnabled)
     {
         // See github issue 1214. This basically compensates for
         // channel AT being per-voice in MPE mode (since it is per channel)
         // vs per-scene (since it is per keyboard in non MPE mode).
-        iter = scene->modulation_scene.begin();
-        while (iter != scene->modulation_scene.end())
+        auto iter = routing.scene.begin();
+        while (iter != routing.scene.end())
         {
             int src_id = iter->source_id;
             if (src_id == ms_aftertouch && modsources[src_id])
@@ -743,15 +823,19 @@ bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
         }
     }
 
+    auto &profiler = *storage->processProfiler;
+
     if (osc3 || ring23 || ((osc1 || osc2 || ring12) && (FMmode == fm_3to2to1)) ||
         ((osc1 || ring12) && (FMmode == fm_2and3to1)))
     {
+        auto t0 = profiler.now();
         osc[2]->process_block(
             noteShiftFromPitchParam(
                 (scene->osc[2].keytrack.val.b ? state.pitch : ktrkroot + state.scenepbpitch) +
                     octaveSize * scene->osc[2].octave.val.i,
                 2),
             drift, is_wide);
+        profiler.addOscillator(osctype[2], t0);
 
         if (osc3)
         {
@@ -778,6 +862,7 @@ bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
 
     if (osc2 || ring12 || ring23 || (FMmode && osc1))
     {
+        auto t0 = profiler.now();
         if (FMmode == fm_3to2to1)
         {
             osc[1]->process_block(
@@ -796,6 +881,7 @@ bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
                     1),
                 drift, is_wide);
         }
+        profiler.addOscillator(osctype[1], t0);
 
         if (osc2)
         {
@@ -822,6 +908,7 @@ bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
 
     if (osc1 || ring12)
     {
+        auto t0 = profiler.now();
         if (FMmode == fm_2and3to1)
         {
             add_block(osc[1]->output, osc[2]->output, fmbuffer, BLOCK_SIZE_OS_QUAD);
@@ -850,6 +937,7 @@ bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
                     0),
                 drift, is_wide);
         }
+        profiler.addOscillator(osctype[0], t0);
 
         if (osc1)
         {
@@ -1180,7 +1268,8 @@ void SurgeVoice::freeAllocatedElements()
 {
     for (int i = 0; i < 3; ++i)
     {
-        osc[i].reset(nullptr);
+        release_osc(osc[i], storage, oscbuffer[i]);
+        osc[i] = nullptr;
         osctype[i] = -1;
     }
     for (int i = 0; i < n_lfos_voice; ++i)
@@ -47,6 +47,16 @@ class alignas(16) SurgeVoice
     void uber_release();
 
     bool process_block(QuadFilterChainState &, int);
+
+    /*
+     * Run the LFOs and envelopes of n voices of one scene ahead of their process_block, slot by
+     * slot across the voices, so each slot goes through the lane batches of
+     * LFOModulationSource and ADSRModulationSource. Each voice then skips that step in
+     * calc_ctrldata. Returns false, having done nothing, when the voices are better left to
+     * calc_ctrldata (fewer than two, or more than one formula LFO).
+     */
+    static bool process_modulators_batch(SurgeVoice **v, int n);
+
     void GetQFB(); // Get the updated registers from the QuadFB
     void legato(int key, int velocity, char detune);
     void switch_toggled();
@@ -55,6 +65,15 @@ class alignas(16) SurgeVoice
     SurgeVoiceState state;
     int age, age_release;
 
+#if STORAGE_USES_INDEPENDENT_RNG
+    /*
+     * What storage->rand() draws from while this voice renders when
+     * storage->independentVoiceRngs is set, so a voice draws the same numbers whichever thread
+     * renders it and whatever its neighbours drew.
+     */
+    SurgeStorage::RNGGen rngGen;
+#endif
+
     /*
     ** Given a note0 and an oscilator this returns the appropriate note.
     ** This is a pretty easy calculation in non-absolute mode. Just add.
@@ -135,6 +154,8 @@ class alignas(16) SurgeVoice
 
   private:
     template <bool first> void calc_ctrldata(QuadFilterChainState *, int);
+    void process_modulators();
+    bool modulatorsProcessed = false;
     void update_portamento();
     void set_path(bool osc1, bool osc2, bool osc3, int FMmode, bool ring12, bool ring23,
                   bool noise);
@@ -173,7 +194,12 @@ class alignas(16) SurgeVoice
     int FMmode;
     float noisegenL[2], noisegenR[2];
 
-    std::unique_ptr<Oscillator> osc[3];
+    /*
+     * Oscillators are constructed in place into oscbuffer (or a pool block, for the big ones)
+     * by spawn_osc and torn down with release_osc, so a voice start never allocates.
+     */
+    Oscillator *osc[n_oscs];
+    unsigned char oscbuffer alignas(16)[n_oscs][oscillator_buffer_size];
 
   public: // this is public, but only for the regtests
     std::array<ModulationSource *, n_modsources> modsources;
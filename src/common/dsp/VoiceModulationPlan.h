@@ -0,0 +1,109 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_VOICEMODULATIONPLAN_H
+#define SURGE_XT_VOICEMODULATIONPLAN_H
+
+#include <array>
+#include <vector>
+
+#include "globals.h"
+#include "ModulationSource.h"
+#include "Parameter.h"
+
+/*
+ * A scene's modulation_voice list flattened into parallel arrays of source, destination and
+ * depth, with mute folded into the depth.
+ *
+ * It is compiled whenever the routings are published (see ModulationRoutingTable), and then
+ * every voice of the scene applies the same plan in calc_ctrldata. So the per voice work is a
+ * straight run over three arrays with no branches on the routing, and the depths are
+ * multiplied four routings at a time.
+ */
+class VoiceModulationPlan
+{
+  public:
+    VoiceModulationPlan()
+    {
+        // enough for any sane patch, so compile() doesn't allocate on the audio thread
+        source.reserve(initialCapacity);
+        destination.reserve(initialCapacity);
+        depth.reserve(initialCapacity);
+    }
+
+    static constexpr int initialCapacity = 256;
+
+    void compile(const std::vector<ModulationRouting> &routings)
+    {
+        count = (int)routings.size();
+
+        // pad to a whole number of quads; the padding has depth 0 and is never applied
+        auto padded = (count + 3) & ~3;
+        source.resize(padded);
+        destination.resize(padded);
+        depth.resize(padded);
+
+        for (int i = 0; i < count; ++i)
+        {
+            source[i] = routings[i].source_id;
+            destination[i] = routings[i].destination_id;
+            depth[i] = routings[i].muted ? 0.f : routings[i].depth;
+        }
+        for (int i = count; i < padded; ++i)
+        {
+            source[i] = ms_original;
+            destination[i] = 0;
+            depth[i] = 0.f;
+        }
+    }
+
+    int size() const { return count; }
+
+    /*
+     * localcopy[dst] += depth * output for every routing. A source the voice doesn't have
+     * contributes nothing.
+     */
+    void apply(const std::array<ModulationSource *, n_modsources> &modsources,
+               pdata *localcopy) const
+    {
+        if (count == 0)
+            return;
+
+        float output alignas(16)[n_modsources];
+        for (int i = 0; i < n_modsources; ++i)
+            output[i] = modsources[i] ? modsources[i]->output : 0.f;
+
+        float amount alignas(16)[4];
+        for (int i = 0; i < count; i += 4)
+        {
+            auto d = _mm_loadu_ps(&depth[i]);
+            auto o = _mm_setr_ps(output[source[i]], output[source[i + 1]],
+                                 output[source[i + 2]], output[source[i + 3]]);
+            _mm_store_ps(amount, _mm_mul_ps(d, o));
+
+            // routings can share a destination, so the adds stay scalar and in order
+            auto n = std::min(4, count - i);
+            for (int k = 0; k < n; ++k)
+                localcopy[destination[i + k]].f += amount[k];
+        }
+    }
+
+  private:
+    std::vector<int> source, destination;
+    std::vector<float> depth;
+    int count = 0;
+};
+
+#endif // SURGE_XT_VOICEMODULATIONPLAN_H
@@ -86,20 +86,31 @@ Wavetable::Wavetable()
     memset(TableI16WeakPointers, 0, sizeof(TableI16WeakPointers));
     current_id = -1;
     queue_id = -1;
+    queue_filename[0] = 0;
     everBuilt = false;
     refresh_display = true; // I have never been drawn so assume I need refresh if asked
 }
 
-Wavetable::~Wavetable()
+Wavetable::~Wavetable() { releaseData(); }
+
+void Wavetable::releaseData()
 {
-    free(TableF32Data);
-    free(TableI16Data);
+    if (dataOwner)
+    {
+        dataOwner.reset();
+    }
+    else
+    {
+        free(TableF32Data);
+        free(TableI16Data);
+    }
+    TableF32Data = nullptr;
+    TableI16Data = nullptr;
 }
 
 void Wavetable::allocPointers(size_t newSize)
 {
-    free(TableF32Data);
-    free(TableI16Data);
+    releaseData();
     dataSizes = newSize;
     TableF32Data = (float *)malloc(dataSizes * sizeof(float));
     TableI16Data = (short *)malloc(dataSizes * sizeof(short));
@@ -109,6 +120,15 @@ void Wavetable::allocPointers(size_t newSize)
 
 void Wavetable::Copy(Wavetable *wt)
 {
+    if (wt->dataOwner)
+    {
+        ReadExternalData(wt->TableF32Data, wt->TableI16Data, wt->dataSizes, wt->dataOwner);
+        copyLayout(wt);
+        current_id = wt->current_id;
+        queue_id = -1;
+        return;
+    }
+
     size = wt->size;
     size_po2 = wt->size_po2;
     flags = wt->flags;
@@ -119,13 +139,13 @@ void Wavetable::Copy(Wavetable *wt)
     queue_id = -1;
     everBuilt = wt->everBuilt;
 
-    if (dataSizes < wt->dataSizes)
+    if (dataSizes < wt->dataSizes || dataOwner)
     {
-        allocPointers(wt->dataSizes);
+        allocPointers(std::max(dataSizes, wt->dataSizes));
     }
 
-    memcpy(TableF32Data, wt->TableF32Data, dataSizes * sizeof(float));
-    memcpy(TableI16Data, wt->TableI16Data, dataSizes * sizeof(short));
+    memcpy(TableF32Data, wt->TableF32Data, wt->dataSizes * sizeof(float));
+    memcpy(TableI16Data, wt->TableI16Data, wt->dataSizes * sizeof(short));
 
     for (int i = 0; i < max_mipmap_levels; i++)
     {
@@ -152,6 +172,51 @@ void Wavetable::Copy(Wavetable *wt)
     current_id = wt->current_id;
 }
 
+void Wavetable::SwapData(Wavetable *wt)
+{
+    std::swap(everBuilt, wt->everBuilt);
+    std::swap(size, wt->size);
+    std::swap(n_tables, wt->n_tables);
+    std::swap(size_po2, wt->size_po2);
+    std::swap(flags, wt->flags);
+    std::swap(dt, wt->dt);
+    std::swap(TableF32WeakPointers, wt->TableF32WeakPointers);
+    std::swap(TableI16WeakPointers, wt->TableI16WeakPointers);
+    std::swap(dataSizes, wt->dataSizes);
+    std::swap(TableF32Data, wt->TableF32Data);
+    std::swap(TableI16Data, wt->TableI16Data);
+    std::swap(dataOwner, wt->dataOwner);
+}
+
+void Wavetable::ShareData(std::shared_ptr<const Wavetable> src)
+{
+    ReadExternalData(src->TableF32Data, src->TableI16Data, src->dataSizes, src);
+    copyLayout(src.get());
+}
+
+void Wavetable::copyLayout(const Wavetable *wt)
+{
+    everBuilt = wt->everBuilt;
+    size = wt->size;
+    n_tables = wt->n_tables;
+    size_po2 = wt->size_po2;
+    flags = wt->flags;
+    dt = wt->dt;
+    memcpy(TableF32WeakPointers, wt->TableF32WeakPointers, sizeof(TableF32WeakPointers));
+    memcpy(TableI16WeakPointers, wt->TableI16WeakPointers, sizeof(TableI16WeakPointers));
+}
+
+void Wavetable::ReadExternalData(float *f32, short *i16, size_t newSize,
+                                 std::shared_ptr<const void> owner)
+{
+    // owner may be the very thing keeping our current data alive, so hold it before releasing
+    releaseData();
+    dataSizes = newSize;
+    TableF32Data = f32;
+    TableI16Data = i16;
+    dataOwner = std::move(owner);
+}
+
 bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
 {
     assert(wdata);
@@ -162,9 +227,10 @@ bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
 
     size_t req_size = RequiredWTSize(size, n_tables);
 
-    if (req_size > dataSizes)
+    // a shared table is read by others, so build into our own memory
+    if (req_size > dataSizes || dataOwner)
     {
-        allocPointers(req_size);
+        allocPointers(std::max(req_size, dataSizes));
     }
 
     int wdata_tables = n_tables;
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <memory>
 const int max_wtable_size = 4096;
 const int max_subtables = 512;
 const int max_mipmap_levels = 16;
@@ -9,6 +10,9 @@ const int max_mipmap_levels = 16;
 const int max_wtable_samples = 2097152;
 // const int max_wtable_samples =  268000; // delay pops 4 uses the most
 
+// The samples BuildWT allocates for a table: each mip level of TableCount tables, plus three
+size_t RequiredWTSize(int TableSize, int TableCount);
+
 #pragma pack(push, 1)
 struct wt_header
 {
@@ -25,9 +29,26 @@ class Wavetable
     Wavetable();
     ~Wavetable();
     void Copy(Wavetable *wt);
+    // Exchange the built table data (not the queue or id state) with wt. Doesn't allocate.
+    void SwapData(Wavetable *wt);
     bool BuildWT(void *wdata, wt_header &wh, bool AppendSilence);
     void MipMapWT();
 
+    /*
+     * Read the built data of src instead of owning a copy. src must never be changed again;
+     * anything here which would write to the data (BuildWT, Copy onto this) takes a private
+     * allocation first.
+     */
+    void ShareData(std::shared_ptr<const Wavetable> src);
+    bool isShared() const { return (bool)dataOwner; }
+
+    /*
+     * Read data which lives elsewhere, such as a mapped cache file, and is kept alive by owner.
+     * The header fields and weak pointers are the caller's to fill in, pointing into f32 and i16.
+     */
+    void ReadExternalData(float *f32, short *i16, size_t newSize,
+                          std::shared_ptr<const void> owner);
+
     void allocPointers(size_t newSize);
 
   public:
@@ -46,7 +67,21 @@ class Wavetable
 
     int current_id, queue_id;
     bool refresh_display;
+    /*
+     * A queued load is the file in queue_filename; queue_id is its index in wt_list (or -1) and
+     * queue_from_list says it was picked from there rather than loaded as a file. Fill these
+     * with SurgeStorage::queue_wt so the loader never has to look at wt_list.
+     */
     char queue_filename[256];
+    bool queue_from_list = false;
+
+  private:
+    void releaseData();
+    // The header fields and weak pointers of wt, which must point at the data we now read
+    void copyLayout(const Wavetable *wt);
+
+    // When set, TableF32Data and TableI16Data belong to this and aren't ours to free
+    std::shared_ptr<const void> dataOwner;
 };
 
 enum wtflags
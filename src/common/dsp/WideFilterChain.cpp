@@ -0,0 +1,134 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "WideFilterChain.h"
+#include "CPUFeatures.h"
+
+// The SSE kernels of QuadFilterUnit.cpp which have a wide counterpart
+__m128 SVFLP12Aquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 SVFHP12Aquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 SVFBP12Aquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 SVFLP24Aquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 SVFHP24Aquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 SVFBP24Aquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 IIR12Bquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 IIR12CFCquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 IIR24Bquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 IIR24CFCquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 LPMOOGquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 SNHquad(QuadFilterUnitState *__restrict f, __m128 in);
+__m128 TANH(__m128 in, __m128 drive);
+__m128 CLIP(__m128 in, __m128 drive);
+__m128 ASYM_SSE2(__m128 in, __m128 drive);
+__m128 SINUS_SSE2(__m128 in, __m128 drive);
+__m128 DIGI_SSE2(__m128 in, __m128 drive);
+
+/*
+ * Going through the SSE pointer means the wide chain picks a kernel for a type and subtype
+ * exactly as GetQFPtrFilterUnit does, quirks and all.
+ */
+static WideFilterKernel wideUnitKernel(FilterUnitQFPtr p)
+{
+    if (p == SVFLP12Aquad)
+        return wfk_svf_lp12;
+    if (p == SVFHP12Aquad)
+        return wfk_svf_hp12;
+    if (p == SVFBP12Aquad)
+        return wfk_svf_bp12;
+    if (p == SVFLP24Aquad)
+        return wfk_svf_lp24;
+    if (p == SVFHP24Aquad)
+        return wfk_svf_hp24;
+    if (p == SVFBP24Aquad)
+        return wfk_svf_bp24;
+    if (p == IIR12Bquad)
+        return wfk_iir12b;
+    if (p == IIR12CFCquad)
+        return wfk_iir12cfc;
+    if (p == IIR24Bquad)
+        return wfk_iir24b;
+    if (p == IIR24CFCquad)
+        return wfk_iir24cfc;
+    if (p == LPMOOGquad)
+        return wfk_lpmoog;
+    if (p == SNHquad)
+        return wfk_snh;
+    return wfk_none;
+}
+
+static WideFilterKernel wideWaveshaperKernel(WaveshaperQFPtr p)
+{
+    if (p == TANH)
+        return wfk_ws_soft;
+    if (p == CLIP)
+        return wfk_ws_hard;
+    if (p == ASYM_SSE2)
+        return wfk_ws_asym;
+    if (p == SINUS_SSE2)
+        return wfk_ws_sine;
+    if (p == DIGI_SSE2)
+        return wfk_ws_digital;
+    return wfk_none;
+}
+
+int GetWideFilterLanesAvailable()
+{
+    static int lanes = Surge::CPUFeatures::hasAVX512F() ? 16
+                       : Surge::CPUFeatures::hasAVX2()  ? 8
+                                                        : 4;
+    return lanes;
+}
+
+static wide_fbq_global::KernelPtr getKernel(int lanes, WideFilterKernel k)
+{
+    if (k == wfk_none)
+        return nullptr;
+    if (lanes == 16)
+        return WideFilterChainAVX512::GetKernel(k);
+    return WideFilterChainAVX2::GetKernel(k);
+}
+
+bool GetWideFBQGlobal(int lanes, int fu1type, int fu1subtype, int fu2type, int fu2subtype,
+                      int wstype, wide_fbq_global &g)
+{
+    if ((lanes != 8 && lanes != 16) || lanes > GetWideFilterLanesAvailable())
+        return false;
+
+    auto fu1 = GetQFPtrFilterUnit(fu1type, fu1subtype);
+    auto fu2 = GetQFPtrFilterUnit(fu2type, fu2subtype);
+    auto ws = GetQFPtrWaveshaper(wstype);
+
+    g.lanes = lanes;
+    g.FU1ptr = getKernel(lanes, wideUnitKernel(fu1));
+    g.FU2ptr = getKernel(lanes, wideUnitKernel(fu2));
+    g.WSptr = getKernel(lanes, wideWaveshaperKernel(ws));
+
+    return (bool)fu1 == (bool)g.FU1ptr && (bool)fu2 == (bool)g.FU2ptr && (bool)ws == (bool)g.WSptr;
+}
+
+WideFBQFPtr GetWideFBQPointer(int lanes, int config, bool A, bool WS, bool B)
+{
+    if (lanes > GetWideFilterLanesAvailable())
+        return nullptr;
+
+    switch (lanes)
+    {
+    case 8:
+        return WideFilterChainAVX2::GetFBQPointer(config, A, WS, B);
+    case 16:
+        return WideFilterChainAVX512::GetFBQPointer(config, A, WS, B);
+    }
+    return nullptr;
+}
@@ -0,0 +1,104 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_WIDEFILTERCHAIN_H
+#define SURGE_XT_WIDEFILTERCHAIN_H
+
+#include "QuadFilterChain.h"
+
+/*
+ * The filter chain of QuadFilterChain.cpp, run over two (AVX2, 8 lanes) or four (AVX-512, 16
+ * lanes) adjacent QuadFilterChainStates at once.
+ *
+ * The voices still fill in QuadFilterChainStates exactly as for the SSE chain, so nothing
+ * upstream changes. A wide pass gathers the states of its quads into registers twice or four
+ * times as wide, runs the block through wide versions of the chain, the filter units and the
+ * waveshaper, and scatters the state back. Every kernel does the same operations in the same
+ * order as its SSE original (the reciprocal estimates included) and the quads are summed into
+ * the output in the same order too, so the result is bit-identical to running the quads one by
+ * one.
+ *
+ * Wide kernels exist for the classic filters (the SVF, Rough and Smooth LP/HP/BP/notch/allpass
+ * variants, the legacy ladder and sample & hold) and for every waveshaper. For anything else
+ * GetWideFBQGlobal says no and the quads go through the SSE chain as before.
+ */
+
+struct wide_fbq_global
+{
+    typedef void (*KernelPtr)();
+
+    int lanes = 4;
+    KernelPtr FU1ptr = nullptr, FU2ptr = nullptr, WSptr = nullptr;
+};
+
+/*
+ * Process the lanes / 4 states starting at Q. OutL[j] and OutR[j] are where quad j is summed
+ * into; they may all be the same buffer.
+ */
+typedef void (*WideFBQFPtr)(QuadFilterChainState *Q, wide_fbq_global &g, float **OutL,
+                            float **OutR);
+
+// 16 or 8 if this CPU can run the wide chains, or 4 if only the SSE chain is available
+int GetWideFilterLanesAvailable();
+
+/*
+ * Fill g with the wide kernels for this filter and waveshaper configuration. Returns false if
+ * lanes isn't available or a unit in use has no wide kernel.
+ */
+bool GetWideFBQGlobal(int lanes, int fu1type, int fu1subtype, int fu2type, int fu2subtype,
+                      int wstype, wide_fbq_global &g);
+
+WideFBQFPtr GetWideFBQPointer(int lanes, int config, bool A, bool WS, bool B);
+
+/*
+ * The kernels, as named by the per instruction set halves in WideFilterChainAVX2.cpp and
+ * WideFilterChainAVX512.cpp.
+ */
+enum WideFilterKernel
+{
+    wfk_none = 0,
+    wfk_svf_lp12,
+    wfk_svf_hp12,
+    wfk_svf_bp12,
+    wfk_svf_lp24,
+    wfk_svf_hp24,
+    wfk_svf_bp24,
+    wfk_iir12b,
+    wfk_iir12cfc,
+    wfk_iir24b,
+    wfk_iir24cfc,
+    wfk_lpmoog,
+    wfk_snh,
+
+    wfk_ws_soft,
+    wfk_ws_hard,
+    wfk_ws_asym,
+    wfk_ws_sine,
+    wfk_ws_digital,
+};
+
+namespace WideFilterChainAVX2
+{
+wide_fbq_global::KernelPtr GetKernel(WideFilterKernel k);
+WideFBQFPtr GetFBQPointer(int config, bool A, bool WS, bool B);
+} // namespace WideFilterChainAVX2
+
+namespace WideFilterChainAVX512
+{
+wide_fbq_global::KernelPtr GetKernel(WideFilterKernel k);
+WideFBQFPtr GetFBQPointer(int config, bool A, bool WS, bool B);
+} // namespace WideFilterChainAVX512
+
+#endif // SURGE_XT_WIDEFILTERCHAIN_H
@@ -0,0 +1,113 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "WideFilterChain.h"
+#include "SurgeStorage.h"
+
+#if !ARM_NEON
+#include <immintrin.h>
+
+/*
+ * The rest of the build is SSE2 only, so only what follows gets to use AVX2, and only ever runs
+ * once GetWideFilterLanesAvailable has checked the CPU. Contracting a multiply and an add into
+ * an FMA would round differently to the SSE chain, so that stays off.
+ */
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace WideFilterChainAVX2
+{
+struct Lanes
+{
+    typedef __m256 V;
+    static constexpr int quads = 2;
+
+    static inline V set1(float f) { return _mm256_set1_ps(f); }
+    static inline V zero() { return _mm256_setzero_ps(); }
+    static inline V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static inline V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static inline V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static inline V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static inline V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static inline V and_(V a, V b) { return _mm256_and_ps(a, b); }
+    static inline V andnot(V a, V b) { return _mm256_andnot_ps(a, b); }
+    static inline V or_(V a, V b) { return _mm256_or_ps(a, b); }
+    static inline V cmpgt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OS); }
+
+    static inline V join(const __m128 *q)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(q[0]), q[1], 1);
+    }
+    static inline void split(V v, __m128 *q)
+    {
+        q[0] = _mm256_castps256_ps128(v);
+        q[1] = _mm256_extractf128_ps(v, 1);
+    }
+
+    // rcpps only promises a relative error, so stay on the very instruction the SSE chain uses
+    static inline V rcp(V v)
+    {
+        __m128 q[quads];
+        split(v, q);
+        for (auto &x : q)
+            x = _mm_rcp_ps(x);
+        return join(q);
+    }
+
+    static inline V roundToInt(V v) { return _mm256_cvtepi32_ps(_mm256_cvtps_epi32(v)); }
+
+    // The interpolated table read of ASYM_SSE2 and SINUS_SSE2
+    static inline void lookup(const float *table, V x, V &a, V &ws, V &wsn)
+    {
+        __m256i e = _mm256_cvtps_epi32(x);
+        a = _mm256_sub_ps(x, _mm256_cvtepi32_ps(e));
+        e = _mm256_max_epi32(_mm256_min_epi32(e, _mm256_set1_epi32(0x3fe)),
+                             _mm256_setzero_si256());
+        ws = _mm256_i32gather_ps(table, e, 4);
+        wsn = _mm256_i32gather_ps(table, _mm256_add_epi32(e, _mm256_set1_epi32(1)), 4);
+    }
+};
+
+#include "WideFilterChainImpl.h"
+
+wide_fbq_global::KernelPtr GetKernel(WideFilterKernel k) { return wideGetKernel<Lanes>(k); }
+
+WideFBQFPtr GetFBQPointer(int config, bool A, bool WS, bool B)
+{
+    return wideGetFBQPointer<Lanes>(config, A, WS, B);
+}
+} // namespace WideFilterChainAVX2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#else
+
+namespace WideFilterChainAVX2
+{
+wide_fbq_global::KernelPtr GetKernel(WideFilterKernel k) { return nullptr; }
+WideFBQFPtr GetFBQPointer(int config, bool A, bool WS, bool B) { return nullptr; }
+} // namespace WideFilterChainAVX2
+
+#endif
@@ -0,0 +1,132 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "WideFilterChain.h"
+#include "SurgeStorage.h"
+
+#if !ARM_NEON
+#include <immintrin.h>
+
+// See WideFilterChainAVX2.cpp. AVX-512 brings FMA along, so keeping fp-contract off matters here
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace WideFilterChainAVX512
+{
+struct Lanes
+{
+    typedef __m512 V;
+    static constexpr int quads = 4;
+
+    static inline V set1(float f) { return _mm512_set1_ps(f); }
+    static inline V zero() { return _mm512_setzero_ps(); }
+    static inline V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static inline V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static inline V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static inline V min(V a, V b) { return _mm512_min_ps(a, b); }
+    static inline V max(V a, V b) { return _mm512_max_ps(a, b); }
+
+    // the float logic ops are AVX512DQ; the integer ones are in the foundation
+    static inline V and_(V a, V b)
+    {
+        return _mm512_castsi512_ps(
+            _mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+    }
+    static inline V andnot(V a, V b)
+    {
+        return _mm512_castsi512_ps(
+            _mm512_andnot_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+    }
+    static inline V or_(V a, V b)
+    {
+        return _mm512_castsi512_ps(
+            _mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+    }
+    static inline V cmpgt(V a, V b)
+    {
+        return _mm512_castsi512_ps(
+            _mm512_maskz_set1_epi32(_mm512_cmp_ps_mask(a, b, _CMP_GT_OS), -1));
+    }
+
+    static inline V join(const __m128 *q)
+    {
+        auto v = _mm512_castps128_ps512(q[0]);
+        v = _mm512_insertf32x4(v, q[1], 1);
+        v = _mm512_insertf32x4(v, q[2], 2);
+        return _mm512_insertf32x4(v, q[3], 3);
+    }
+    static inline void split(V v, __m128 *q)
+    {
+        q[0] = _mm512_castps512_ps128(v);
+        q[1] = _mm512_extractf32x4_ps(v, 1);
+        q[2] = _mm512_extractf32x4_ps(v, 2);
+        q[3] = _mm512_extractf32x4_ps(v, 3);
+    }
+
+    // rcp14ps is more accurate than rcpps, which is exactly what we can't have
+    static inline V rcp(V v)
+    {
+        __m128 q[quads];
+        split(v, q);
+        for (auto &x : q)
+            x = _mm_rcp_ps(x);
+        return join(q);
+    }
+
+    static inline V roundToInt(V v) { return _mm512_cvtepi32_ps(_mm512_cvtps_epi32(v)); }
+
+    // The interpolated table read of ASYM_SSE2 and SINUS_SSE2
+    static inline void lookup(const float *table, V x, V &a, V &ws, V &wsn)
+    {
+        __m512i e = _mm512_cvtps_epi32(x);
+        a = _mm512_sub_ps(x, _mm512_cvtepi32_ps(e));
+        e = _mm512_max_epi32(_mm512_min_epi32(e, _mm512_set1_epi32(0x3fe)),
+                             _mm512_setzero_si512());
+        ws = _mm512_i32gather_ps(e, table, 4);
+        wsn = _mm512_i32gather_ps(_mm512_add_epi32(e, _mm512_set1_epi32(1)), table, 4);
+    }
+};
+
+#include "WideFilterChainImpl.h"
+
+wide_fbq_global::KernelPtr GetKernel(WideFilterKernel k) { return wideGetKernel<Lanes>(k); }
+
+WideFBQFPtr GetFBQPointer(int config, bool A, bool WS, bool B)
+{
+    return wideGetFBQPointer<Lanes>(config, A, WS, B);
+}
+} // namespace WideFilterChainAVX512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#else
+
+namespace WideFilterChainAVX512
+{
+wide_fbq_global::KernelPtr GetKernel(WideFilterKernel k) { return nullptr; }
+WideFBQFPtr GetFBQPointer(int config, bool A, bool WS, bool B) { return nullptr; }
+} // namespace WideFilterChainAVX512
+
+#endif
@@ -0,0 +1,834 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+/*
+ * The wide filter chain and its kernels, written once against a lane type S which supplies the
+ * vector type S::V, S::quads (the number of QuadFilterChainStates a pass covers) and the
+ * handful of operations below. WideFilterChainAVX2.cpp and WideFilterChainAVX512.cpp define
+ * an S and include this file after all their other includes, with the compiler targeting their
+ * instruction set, so that nothing else gets compiled for it by accident.
+ *
+ * Each kernel is a line by line transcription of its SSE original in QuadFilterUnit.cpp or
+ * QuadFilterChain.cpp. Keep it that way: the wide chain is only allowed because it produces the
+ * same bits, so don't reassociate anything here.
+ *
+ * Deliberately no include guard and no includes.
+ */
+
+template <typename S> struct WideFilterUnitState
+{
+    typename S::V C[n_cm_coeffs], dC[n_cm_coeffs], R[n_filter_registers];
+    int WP0; // the legacy ladder keeps its output tap here
+};
+
+template <typename S> struct WideFilterChainState
+{
+    typedef typename S::V V;
+
+    WideFilterUnitState<S> FU[4];
+
+    V Gain, FB, Mix1, Mix2, Drive;
+    V dGain, dFB, dMix1, dMix2, dDrive;
+    V wsLPF, FBlineL, FBlineR;
+    V OutL, OutR, dOutL, dOutR;
+    V Out2L, Out2R, dOut2L, dOut2R;
+    V mask;
+};
+
+// The same __m128 of each of the quads, as one wide vector; field is that member of Q[0]
+template <typename S>
+inline typename S::V wideGather(const QuadFilterChainState *Q, const __m128 &field)
+{
+    auto off = (const char *)&field - (const char *)Q;
+    __m128 q[S::quads];
+    for (int j = 0; j < S::quads; ++j)
+        q[j] = *(const __m128 *)((const char *)&Q[j] + off);
+    return S::join(q);
+}
+
+template <typename S>
+inline void wideScatter(QuadFilterChainState *Q, __m128 &field, typename S::V v)
+{
+    auto off = (char *)&field - (char *)Q;
+    __m128 q[S::quads];
+    S::split(v, q);
+    for (int j = 0; j < S::quads; ++j)
+        *(__m128 *)((char *)&Q[j] + off) = q[j];
+}
+
+template <typename S> void wideLoadChain(WideFilterChainState<S> &w, QuadFilterChainState *Q)
+{
+#define WG(x) w.x = wideGather<S>(Q, Q[0].x)
+    WG(Gain);
+    WG(FB);
+    WG(Mix1);
+    WG(Mix2);
+    WG(Drive);
+    WG(dGain);
+    WG(dFB);
+    WG(dMix1);
+    WG(dMix2);
+    WG(dDrive);
+    WG(wsLPF);
+    WG(FBlineL);
+    WG(FBlineR);
+    WG(OutL);
+    WG(OutR);
+    WG(dOutL);
+    WG(dOutR);
+    WG(Out2L);
+    WG(Out2R);
+    WG(dOut2L);
+    WG(dOut2R);
+    for (int u = 0; u < 4; ++u)
+    {
+        for (int i = 0; i < n_cm_coeffs; ++i)
+        {
+            WG(FU[u].C[i]);
+            WG(FU[u].dC[i]);
+        }
+        for (int i = 0; i < n_filter_registers; ++i)
+            WG(FU[u].R[i]);
+        w.FU[u].WP0 = Q[0].FU[u].WP[0];
+    }
+#undef WG
+
+    __m128 q[S::quads];
+    for (int j = 0; j < S::quads; ++j)
+        q[j] = _mm_load_ps((float *)&Q[j].FU[0].active);
+    w.mask = S::join(q);
+}
+
+template <typename S> void wideStoreChain(const WideFilterChainState<S> &w, QuadFilterChainState *Q)
+{
+#define WS(x) wideScatter<S>(Q, Q[0].x, w.x)
+    WS(Gain);
+    WS(FB);
+    WS(Mix1);
+    WS(Mix2);
+    WS(Drive);
+    WS(wsLPF);
+    WS(FBlineL);
+    WS(FBlineR);
+    WS(OutL);
+    WS(OutR);
+    WS(Out2L);
+    WS(Out2R);
+    for (int u = 0; u < 4; ++u)
+    {
+        for (int i = 0; i < n_cm_coeffs; ++i)
+            WS(FU[u].C[i]);
+        for (int i = 0; i < n_filter_registers; ++i)
+            WS(FU[u].R[i]);
+    }
+#undef WS
+}
+
+// sum_ps_to_ss of each quad, added into that quad's output
+template <typename S> inline void wideAccumulate(typename S::V v, float **Out, int k)
+{
+    __m128 q[S::quads];
+    S::split(v, q);
+    for (int j = 0; j < S::quads; ++j)
+    {
+        __m128 a = _mm_add_ps(q[j], _mm_movehl_ps(q[j], q[j]));
+        a = _mm_add_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 1)));
+        _mm_store_ss(&Out[j][k], _mm_add_ss(_mm_load_ss(&Out[j][k]), a));
+    }
+}
+
+// MWriteOutputs and MWriteOutputsDual
+template <typename S>
+inline void wideWriteOutputs(WideFilterChainState<S> &d, typename S::V x, float **OutL,
+                             float **OutR, int k)
+{
+    d.OutL = S::add(d.OutL, d.dOutL);
+    d.OutR = S::add(d.OutR, d.dOutR);
+    wideAccumulate<S>(S::mul(x, d.OutL), OutL, k);
+    wideAccumulate<S>(S::mul(x, d.OutR), OutR, k);
+}
+
+template <typename S>
+inline void wideWriteOutputsDual(WideFilterChainState<S> &d, typename S::V x, typename S::V y,
+                                 float **OutL, float **OutR, int k)
+{
+    d.OutL = S::add(d.OutL, d.dOutL);
+    d.OutR = S::add(d.OutR, d.dOutR);
+    d.Out2L = S::add(d.Out2L, d.dOut2L);
+    d.Out2R = S::add(d.Out2R, d.dOut2R);
+    wideAccumulate<S>(S::add(S::mul(x, d.OutL), S::mul(y, d.Out2L)), OutL, k);
+    wideAccumulate<S>(S::add(S::mul(x, d.OutR), S::mul(y, d.Out2R)), OutR, k);
+}
+
+template <typename S> inline typename S::V wideSoftclip(typename S::V in)
+{
+    const auto a = S::set1(-4.f / 27.f);
+    auto x = S::max(S::min(in, S::set1(1.5f)), S::set1(-1.5f));
+    auto xx = S::mul(x, x);
+    auto t = S::mul(x, a);
+    t = S::mul(t, xx);
+    return S::add(t, x);
+}
+
+template <typename S> inline typename S::V wideSoftclip8(typename S::V in)
+{
+    const auto a = S::set1(-0.00028935185185f);
+    auto x = S::max(S::min(in, S::set1(12.f)), S::set1(-12.f));
+    auto xx = S::mul(x, x);
+    auto t = S::mul(x, a);
+    t = S::mul(t, xx);
+    return S::add(t, x);
+}
+
+/*
+ * Filter units
+ */
+
+// The two passes of the legacy SVF over registers r0 and r1; B1 is the band after the first
+template <typename S>
+inline void wideSVFStage(WideFilterUnitState<S> *__restrict f, typename S::V in, int r0, int r1,
+                         typename S::V &L, typename S::V &H, typename S::V &B,
+                         typename S::V &B1)
+{
+    L = S::add(f->R[r1], S::mul(f->C[0], f->R[r0]));
+    H = S::sub(S::sub(in, L), S::mul(f->C[1], f->R[r0]));
+    B1 = S::add(f->R[r0], S::mul(f->C[0], H));
+
+    L = S::add(L, S::mul(f->C[0], B1));
+    H = S::sub(S::sub(in, L), S::mul(f->C[1], B1));
+    B = S::add(B1, S::mul(f->C[0], H));
+}
+
+template <typename S, int out>
+typename S::V wideSVF12(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    f->C[0] = S::add(f->C[0], f->dC[0]); // F1
+    f->C[1] = S::add(f->C[1], f->dC[1]); // Q1
+
+    typename S::V L, H, B, B1;
+    wideSVFStage<S>(f, in, 0, 1, L, H, B, B1);
+
+    f->R[0] = S::mul(B, f->R[2]);
+    f->R[1] = S::mul(L, f->R[2]);
+
+    f->C[2] = S::add(f->C[2], f->dC[2]);
+    f->R[2] =
+        S::max(S::set1(0.1f), S::sub(S::set1(1.f), S::mul(f->C[2], S::mul(B1, B1))));
+
+    f->C[3] = S::add(f->C[3], f->dC[3]); // Gain
+    return S::mul(out == 0 ? L : (out == 1 ? H : B), f->C[3]);
+}
+
+template <typename S, int out>
+typename S::V wideSVF24(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    f->C[0] = S::add(f->C[0], f->dC[0]); // F1
+    f->C[1] = S::add(f->C[1], f->dC[1]); // Q1
+
+    typename S::V L, H, B, B1;
+    wideSVFStage<S>(f, in, 0, 1, L, H, B, B1);
+
+    f->R[0] = S::mul(B, f->R[2]);
+    f->R[1] = S::mul(L, f->R[2]);
+
+    in = out == 0 ? L : (out == 1 ? H : B);
+    wideSVFStage<S>(f, in, 3, 4, L, H, B, B1);
+
+    f->R[3] = S::mul(B, f->R[2]);
+    f->R[4] = S::mul(L, f->R[2]);
+
+    f->C[2] = S::add(f->C[2], f->dC[2]);
+    f->R[2] = S::max(S::set1(0.1f), S::sub(S::set1(1.f), S::mul(f->C[2], S::mul(B, B))));
+
+    f->C[3] = S::add(f->C[3], f->dC[3]); // Gain
+    return S::mul(out == 0 ? L : (out == 1 ? H : B), f->C[3]);
+}
+
+template <typename S> typename S::V wideIIR12B(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    auto f2 = S::sub(S::mul(f->C[3], in), S::mul(f->C[1], f->R[1])); // Q2*in - K2*R1
+    f->C[1] = S::add(f->C[1], f->dC[1]);                             // K2
+    f->C[3] = S::add(f->C[3], f->dC[3]);                             // Q2
+    auto g2 = S::add(S::mul(f->C[1], in), S::mul(f->C[3], f->R[1])); // K2*in + Q2*R1
+
+    auto f1 = S::sub(S::mul(f->C[2], f2), S::mul(f->C[0], f->R[0])); // Q1*f2 - K1*R0
+    f->C[0] = S::add(f->C[0], f->dC[0]);                             // K1
+    f->C[2] = S::add(f->C[2], f->dC[2]);                             // Q1
+    auto g1 = S::add(S::mul(f->C[0], f2), S::mul(f->C[2], f->R[0])); // K1*f2 + Q1*R0
+
+    f->C[4] = S::add(f->C[4], f->dC[4]); // V1
+    f->C[5] = S::add(f->C[5], f->dC[5]); // V2
+    f->C[6] = S::add(f->C[6], f->dC[6]); // V3
+    auto y = S::add(S::add(S::mul(f->C[6], g2), S::mul(f->C[5], g1)), S::mul(f->C[4], f1));
+
+    f->R[0] = S::mul(f1, f->R[2]);
+    f->R[1] = S::mul(g1, f->R[2]);
+
+    f->C[7] = S::add(f->C[7], f->dC[7]); // Clipgain
+    f->R[2] = S::max(S::set1(0.1f), S::sub(S::set1(1.f), S::mul(f->C[7], S::mul(y, y))));
+
+    return y;
+}
+
+// The coupled form section shared by IIR12CFC and both halves of IIR24CFC
+template <typename S>
+inline typename S::V wideCFCSection(WideFilterUnitState<S> *__restrict f, typename S::V in, int r0,
+                                    int r1)
+{
+    auto y = S::add(S::add(S::mul(f->C[4], f->R[r0]), S::mul(f->C[6], in)),
+                    S::mul(f->C[5], f->R[r1]));
+    auto s1 = S::add(S::mul(in, f->C[2]),
+                     S::sub(S::mul(f->C[0], f->R[r0]), S::mul(f->C[1], f->R[r1])));
+    auto s2 = S::add(S::mul(f->C[1], f->R[r0]), S::mul(f->C[0], f->R[r1]));
+
+    f->R[r0] = S::mul(s1, f->R[2]);
+    f->R[r1] = S::mul(s2, f->R[2]);
+    return y;
+}
+
+template <typename S, bool twoPole>
+typename S::V wideIIRCFC(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    f->C[0] = S::add(f->C[0], f->dC[0]); // ar
+    f->C[1] = S::add(f->C[1], f->dC[1]); // ai
+    f->C[2] = S::add(f->C[2], f->dC[2]); // b1
+    f->C[4] = S::add(f->C[4], f->dC[4]); // c1
+    f->C[5] = S::add(f->C[5], f->dC[5]); // c2
+    f->C[6] = S::add(f->C[6], f->dC[6]); // d
+
+    auto y = wideCFCSection<S>(f, in, 0, 1);
+    if (!twoPole)
+        y = wideCFCSection<S>(f, y, 3, 4);
+
+    f->C[7] = S::add(f->C[7], f->dC[7]); // Clipgain
+    f->R[2] = S::max(S::set1(0.1f), S::sub(S::set1(1.f), S::mul(f->C[7], S::mul(y, y))));
+
+    return y;
+}
+
+template <typename S> typename S::V wideIIR24B(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    f->C[1] = S::add(f->C[1], f->dC[1]); // K2
+    f->C[3] = S::add(f->C[3], f->dC[3]); // Q2
+    f->C[0] = S::add(f->C[0], f->dC[0]); // K1
+    f->C[2] = S::add(f->C[2], f->dC[2]); // Q1
+    f->C[4] = S::add(f->C[4], f->dC[4]); // V1
+    f->C[5] = S::add(f->C[5], f->dC[5]); // V2
+    f->C[6] = S::add(f->C[6], f->dC[6]); // V3
+
+    auto f2 = S::sub(S::mul(f->C[3], in), S::mul(f->C[1], f->R[1]));
+    auto g2 = S::add(S::mul(f->C[1], in), S::mul(f->C[3], f->R[1]));
+    auto f1 = S::sub(S::mul(f->C[2], f2), S::mul(f->C[0], f->R[0]));
+    auto g1 = S::add(S::mul(f->C[0], f2), S::mul(f->C[2], f->R[0]));
+    f->R[0] = S::mul(f1, f->R[4]);
+    f->R[1] = S::mul(g1, f->R[4]);
+    auto y1 = S::add(S::add(S::mul(f->C[6], g2), S::mul(f->C[5], g1)), S::mul(f->C[4], f1));
+
+    f2 = S::sub(S::mul(f->C[3], y1), S::mul(f->C[1], f->R[3]));
+    g2 = S::add(S::mul(f->C[1], y1), S::mul(f->C[3], f->R[3]));
+    f1 = S::sub(S::mul(f->C[2], f2), S::mul(f->C[0], f->R[2]));
+    g1 = S::add(S::mul(f->C[0], f2), S::mul(f->C[2], f->R[2]));
+    f->R[2] = S::mul(f1, f->R[4]);
+    f->R[3] = S::mul(g1, f->R[4]);
+    auto y2 = S::add(S::add(S::mul(f->C[6], g2), S::mul(f->C[5], g1)), S::mul(f->C[4], f1));
+
+    f->C[7] = S::add(f->C[7], f->dC[7]); // Clipgain
+    f->R[4] = S::max(S::set1(0.1f), S::sub(S::set1(1.f), S::mul(f->C[7], S::mul(y2, y2))));
+
+    return y2;
+}
+
+template <typename S> typename S::V wideLPMOOG(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    f->C[0] = S::add(f->C[0], f->dC[0]);
+    f->C[1] = S::add(f->C[1], f->dC[1]);
+    f->C[2] = S::add(f->C[2], f->dC[2]);
+
+    f->R[0] = wideSoftclip8<S>(S::add(
+        f->R[0], S::mul(f->C[1], S::sub(S::sub(S::mul(in, f->C[0]),
+                                               S::mul(f->C[2], S::add(f->R[3], f->R[4]))),
+                                        f->R[0]))));
+    f->R[1] = S::add(f->R[1], S::mul(f->C[1], S::sub(f->R[0], f->R[1])));
+    f->R[2] = S::add(f->R[2], S::mul(f->C[1], S::sub(f->R[1], f->R[2])));
+    f->R[4] = f->R[3];
+    f->R[3] = S::add(f->R[3], S::mul(f->C[1], S::sub(f->R[2], f->R[3])));
+
+    // the tap is the filter subtype, so the same for every voice of the scene
+    return f->R[f->WP0 & 3];
+}
+
+template <typename S> typename S::V wideSNH(WideFilterUnitState<S> *__restrict f, typename S::V in)
+{
+    f->C[0] = S::add(f->C[0], f->dC[0]);
+    f->C[1] = S::add(f->C[1], f->dC[1]);
+
+    f->R[0] = S::add(f->R[0], f->C[0]);
+
+    auto mask = S::cmpgt(f->R[0], S::zero());
+
+    f->R[1] = S::or_(S::andnot(mask, f->R[1]),
+                     S::and_(mask, wideSoftclip<S>(S::sub(in, S::mul(f->C[1], f->R[1])))));
+
+    f->R[0] = S::add(f->R[0], S::and_(S::set1(-1.f), mask));
+
+    return f->R[1];
+}
+
+/*
+ * Waveshapers
+ */
+
+template <typename S> typename S::V wideCLIP(typename S::V in, typename S::V drive)
+{
+    return S::max(S::min(S::mul(in, drive), S::set1(1.f)), S::set1(-1.f));
+}
+
+template <typename S> typename S::V wideDIGI(typename S::V in, typename S::V drive)
+{
+    const auto mofs = S::set1(0.5f);
+
+    auto invdrive = S::rcp(drive);
+    auto a = S::roundToInt(S::add(mofs, S::mul(invdrive, S::mul(S::set1(16.f), in))));
+
+    return S::mul(drive, S::mul(S::set1(0.0625f), S::sub(a, mofs)));
+}
+
+template <typename S> typename S::V wideTANH(typename S::V in, typename S::V drive)
+{
+    const auto m9 = S::set1(9.f);
+    const auto m27 = S::set1(27.f);
+
+    auto x = S::mul(in, drive);
+    auto xx = S::mul(x, x);
+    auto denom = S::add(m27, S::mul(m9, xx));
+    auto y = S::mul(x, S::add(m27, xx));
+    y = S::mul(y, S::rcp(denom));
+
+    return S::max(S::min(y, S::set1(1.f)), S::set1(-1.f));
+}
+
+template <typename S, int table, int scale>
+typename S::V wideTableShaper(typename S::V in, typename S::V drive)
+{
+    auto x = S::mul(in, drive);
+    x = S::add(S::mul(x, S::set1((float)scale)), S::set1(512.f));
+
+    typename S::V a, ws, wsn;
+    S::lookup(waveshapers[table], x, a, ws, wsn);
+
+    return S::add(S::mul(S::sub(S::set1(1.f), a), ws), S::mul(a, wsn));
+}
+
+template <typename S> wide_fbq_global::KernelPtr wideGetKernel(WideFilterKernel k)
+{
+    typedef wide_fbq_global::KernelPtr K;
+
+    switch (k)
+    {
+    case wfk_svf_lp12:
+        return (K)wideSVF12<S, 0>;
+    case wfk_svf_hp12:
+        return (K)wideSVF12<S, 1>;
+    case wfk_svf_bp12:
+        return (K)wideSVF12<S, 2>;
+    case wfk_svf_lp24:
+        return (K)wideSVF24<S, 0>;
+    case wfk_svf_hp24:
+        return (K)wideSVF24<S, 1>;
+    case wfk_svf_bp24:
+        return (K)wideSVF24<S, 2>;
+    case wfk_iir12b:
+        return (K)wideIIR12B<S>;
+    case wfk_iir12cfc:
+        return (K)wideIIRCFC<S, true>;
+    case wfk_iir24b:
+        return (K)wideIIR24B<S>;
+    case wfk_iir24cfc:
+        return (K)wideIIRCFC<S, false>;
+    case wfk_lpmoog:
+        return (K)wideLPMOOG<S>;
+    case wfk_snh:
+        return (K)wideSNH<S>;
+
+    case wfk_ws_soft:
+        return (K)wideTANH<S>;
+    case wfk_ws_hard:
+        return (K)wideCLIP<S>;
+    case wfk_ws_asym:
+        return (K)wideTableShaper<S, wst_asym, 32>;
+    case wfk_ws_sine:
+        return (K)wideTableShaper<S, wst_sine, 256>;
+    case wfk_ws_digital:
+        return (K)wideDIGI<S>;
+
+    case wfk_none:
+        break;
+    }
+    return nullptr;
+}
+
+/*
+ * The chain
+ */
+
+template <typename S, int config, bool A, bool WS, bool B>
+void ProcessWideFBQuad(QuadFilterChainState *Q, wide_fbq_global &g, float **OutL, float **OutR)
+{
+    typedef typename S::V V;
+    typedef V (*UnitPtr)(WideFilterUnitState<S> *__restrict, V);
+    typedef V (*ShaperPtr)(V, V);
+
+    auto FU1ptr = (UnitPtr)g.FU1ptr;
+    auto FU2ptr = (UnitPtr)g.FU2ptr;
+    auto WSptr = (ShaperPtr)g.WSptr;
+
+    WideFilterChainState<S> d;
+    wideLoadChain<S>(d, Q);
+
+    const V hb_c = S::set1(0.5f);
+    const V one = S::set1(1.0f);
+    const V mask = d.mask;
+
+    switch (config)
+    {
+    case fc_serial1:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            V input = wideGather<S>(Q, Q[0].DL[k]);
+            V x = input, y = wideGather<S>(Q, Q[0].DR[k]);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (WS)
+            {
+                d.wsLPF = S::mul(hb_c, S::add(d.wsLPF, S::and_(mask, x)));
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(d.wsLPF, d.Drive);
+            }
+
+            if (A || WS)
+            {
+                d.Mix1 = S::add(d.Mix1, d.dMix1);
+                x = S::add(S::mul(input, S::sub(one, d.Mix1)), S::mul(x, d.Mix1));
+            }
+
+            y = S::add(x, y);
+
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+            x = S::add(S::mul(x, S::sub(one, d.Mix2)), S::mul(y, d.Mix2));
+            d.Gain = S::add(d.Gain, d.dGain);
+            V out = S::and_(mask, S::mul(x, d.Gain));
+
+            wideWriteOutputs<S>(d, out, OutL, OutR, k);
+        }
+        break;
+    case fc_serial2:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V input = S::mul(d.FB, d.FBlineL);
+            input = S::add(wideGather<S>(Q, Q[0].DL[k]), wideSoftclip<S>(input));
+            V x = input, y = wideGather<S>(Q, Q[0].DR[k]);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (WS)
+            {
+                d.wsLPF = S::mul(hb_c, S::add(d.wsLPF, S::and_(mask, x)));
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(d.wsLPF, d.Drive);
+            }
+
+            if (A || WS)
+            {
+                d.Mix1 = S::add(d.Mix1, d.dMix1);
+                x = S::add(S::mul(input, S::sub(one, d.Mix1)), S::mul(x, d.Mix1));
+            }
+
+            y = S::add(x, y);
+
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+            x = S::add(S::mul(x, S::sub(one, d.Mix2)), S::mul(y, d.Mix2));
+            d.Gain = S::add(d.Gain, d.dGain);
+            V out = S::and_(mask, S::mul(x, d.Gain));
+            d.FBlineL = out;
+
+            wideWriteOutputs<S>(d, out, OutL, OutR, k);
+        }
+        break;
+    case fc_serial3:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V input = S::mul(d.FB, d.FBlineL);
+            input = S::add(wideGather<S>(Q, Q[0].DL[k]), wideSoftclip<S>(input));
+            V x = input, y = wideGather<S>(Q, Q[0].DR[k]);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (WS)
+            {
+                d.wsLPF = S::mul(hb_c, S::add(d.wsLPF, S::and_(mask, x)));
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(d.wsLPF, d.Drive);
+            }
+
+            if (A || WS)
+            {
+                d.Mix1 = S::add(d.Mix1, d.dMix1);
+                x = S::add(S::mul(input, S::sub(one, d.Mix1)), S::mul(x, d.Mix1));
+            }
+
+            d.Gain = S::add(d.Gain, d.dGain);
+            x = S::and_(mask, S::mul(x, d.Gain));
+
+            wideWriteOutputs<S>(d, x, OutL, OutR, k);
+
+            y = S::add(x, y);
+
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+            d.FBlineL = y;
+        }
+        break;
+    case fc_dual1:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V fb = wideSoftclip<S>(S::mul(d.FB, d.FBlineL));
+            V x = S::add(wideGather<S>(Q, Q[0].DL[k]), fb);
+            V y = S::add(wideGather<S>(Q, Q[0].DR[k]), fb);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            d.Mix1 = S::add(d.Mix1, d.dMix1);
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+            x = S::add(S::mul(x, d.Mix1), S::mul(y, d.Mix2));
+
+            if (WS)
+            {
+                d.wsLPF = S::mul(hb_c, S::add(d.wsLPF, S::and_(mask, x)));
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(d.wsLPF, d.Drive);
+            }
+
+            d.Gain = S::add(d.Gain, d.dGain);
+            V out = S::and_(mask, S::mul(x, d.Gain));
+            d.FBlineL = out;
+
+            wideWriteOutputs<S>(d, out, OutL, OutR, k);
+        }
+        break;
+    case fc_dual2:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V fb = wideSoftclip<S>(S::mul(d.FB, d.FBlineL));
+            V x = S::add(wideGather<S>(Q, Q[0].DL[k]), fb);
+            V y = S::add(wideGather<S>(Q, Q[0].DR[k]), fb);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (WS)
+            {
+                d.wsLPF = S::mul(hb_c, S::add(d.wsLPF, S::and_(mask, x)));
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(d.wsLPF, d.Drive);
+            }
+
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            d.Mix1 = S::add(d.Mix1, d.dMix1);
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+            x = S::add(S::mul(x, d.Mix1), S::mul(y, d.Mix2));
+
+            d.Gain = S::add(d.Gain, d.dGain);
+            V out = S::and_(mask, S::mul(x, d.Gain));
+            d.FBlineL = out;
+
+            wideWriteOutputs<S>(d, out, OutL, OutR, k);
+        }
+        break;
+    case fc_ring:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V fb = wideSoftclip<S>(S::mul(d.FB, d.FBlineL));
+            V x = S::add(wideGather<S>(Q, Q[0].DL[k]), fb);
+            V y = S::add(wideGather<S>(Q, Q[0].DR[k]), fb);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            d.Mix1 = S::add(d.Mix1, d.dMix1);
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+
+            x = S::mul(S::add(S::mul(S::sub(one, d.Mix1), y), S::mul(x, d.Mix1)),
+                       S::add(S::mul(S::sub(one, d.Mix2), x), S::mul(y, d.Mix2)));
+
+            if (WS)
+            {
+                d.wsLPF = S::mul(hb_c, S::add(d.wsLPF, x));
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(S::and_(mask, d.wsLPF), d.Drive);
+            }
+
+            d.Gain = S::add(d.Gain, d.dGain);
+            V out = S::and_(mask, S::mul(x, d.Gain));
+            d.FBlineL = out;
+
+            wideWriteOutputs<S>(d, out, OutL, OutR, k);
+        }
+        break;
+    case fc_stereo:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V fb = wideSoftclip<S>(S::mul(d.FB, d.FBlineL));
+            V x = S::add(wideGather<S>(Q, Q[0].DL[k]), fb);
+            V y = S::add(wideGather<S>(Q, Q[0].DR[k]), fb);
+
+            if (A)
+                x = FU1ptr(&d.FU[0], x);
+            if (B)
+                y = FU2ptr(&d.FU[1], y);
+
+            if (WS)
+            {
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(S::and_(mask, x), d.Drive);
+                y = WSptr(S::and_(mask, y), d.Drive);
+            }
+
+            d.Mix1 = S::add(d.Mix1, d.dMix1);
+            d.Mix2 = S::add(d.Mix2, d.dMix2);
+            x = S::mul(x, d.Mix1);
+            y = S::mul(y, d.Mix2);
+
+            d.Gain = S::add(d.Gain, d.dGain);
+            x = S::and_(mask, S::mul(x, d.Gain));
+            y = S::and_(mask, S::mul(y, d.Gain));
+            d.FBlineL = S::add(x, y);
+
+            wideWriteOutputsDual<S>(d, x, y, OutL, OutR, k);
+        }
+        break;
+    case fc_wide:
+        for (int k = 0; k < BLOCK_SIZE_OS; k++)
+        {
+            d.FB = S::add(d.FB, d.dFB);
+            V fbL = S::mul(d.FB, d.FBlineL);
+            V fbR = S::mul(d.FB, d.FBlineR);
+            V xin = S::add(wideGather<S>(Q, Q[0].DL[k]), wideSoftclip<S>(fbL));
+            V yin = S::add(wideGather<S>(Q, Q[0].DR[k]), wideSoftclip<S>(fbR));
+            V x = xin;
+            V y = yin;
+
+            if (A)
+            {
+                x = FU1ptr(&d.FU[0], x);
+                y = FU1ptr(&d.FU[2], y);
+            }
+
+            if (WS)
+            {
+                d.Drive = S::add(d.Drive, d.dDrive);
+                x = WSptr(S::and_(mask, x), d.Drive);
+                y = WSptr(S::and_(mask, y), d.Drive);
+            }
+
+            if (A || WS)
+            {
+                d.Mix1 = S::add(d.Mix1, d.dMix1);
+                V t = S::sub(one, d.Mix1);
+                x = S::add(S::mul(xin, t), S::mul(x, d.Mix1));
+                y = S::add(S::mul(yin, t), S::mul(y, d.Mix1));
+            }
+
+            if (B)
+            {
+                V z = FU2ptr(&d.FU[1], x);
+                V w = FU2ptr(&d.FU[3], y);
+
+                d.Mix2 = S::add(d.Mix2, d.dMix2);
+                V t = S::sub(one, d.Mix2);
+                x = S::add(S::mul(x, t), S::mul(z, d.Mix2));
+                y = S::add(S::mul(y, t), S::mul(w, d.Mix2));
+            }
+
+            d.Gain = S::add(d.Gain, d.dGain);
+            x = S::and_(mask, S::mul(x, d.Gain));
+            y = S::and_(mask, S::mul(y, d.Gain));
+            d.FBlineL = x;
+            d.FBlineR = y;
+
+            wideWriteOutputsDual<S>(d, x, y, OutL, OutR, k);
+        }
+        break;
+    }
+
+    wideStoreChain<S>(d, Q);
+}
+
+template <typename S, int config> WideFBQFPtr wideGetFBQPointer2(bool A, bool WS, bool B)
+{
+    if (A)
+    {
+        if (B)
+            return WS ? ProcessWideFBQuad<S, config, 1, 1, 1> : ProcessWideFBQuad<S, config, 1, 0, 1>;
+        return WS ? ProcessWideFBQuad<S, config, 1, 1, 0> : ProcessWideFBQuad<S, config, 1, 0, 0>;
+    }
+    if (B)
+        return WS ? ProcessWideFBQuad<S, config, 0, 1, 1> : ProcessWideFBQuad<S, config, 0, 0, 1>;
+    return WS ? ProcessWideFBQuad<S, config, 0, 1, 0> : ProcessWideFBQuad<S, config, 0, 0, 0>;
+}
+
+template <typename S> WideFBQFPtr wideGetFBQPointer(int config, bool A, bool WS, bool B)
+{
+    switch (config)
+    {
+    case fc_serial1:
+        return wideGetFBQPointer2<S, fc_serial1>(A, WS, B);
+    case fc_serial2:
+        return wideGetFBQPointer2<S, fc_serial2>(A, WS, B);
+    case fc_serial3:
+        return wideGetFBQPointer2<S, fc_serial3>(A, WS, B);
+    case fc_dual1:
+        return wideGetFBQPointer2<S, fc_dual1>(A, WS, B);
+    case fc_dual2:
+        return wideGetFBQPointer2<S, fc_dual2>(A, WS, B);
+    case fc_ring:
+        return wideGetFBQPointer2<S, fc_ring>(A, WS, B);
+    case fc_stereo:
+        return wideGetFBQPointer2<S, fc_stereo>(A, WS, B);
+    case fc_wide:
+        return wideGetFBQPointer2<S, fc_wide>(A, WS, B);
+    }
+    return nullptr;
+}
@@ -14,3 +14,278 @@
 */
 
 #include "ADSRModulationSource.h"
+
+void ADSRModulationSource::process_block_batch(ADSRModulationSource **e, int n)
+{
+#if !ARM_NEON
+    if (n > 1)
+    {
+        // Gather four envelopes of each mode at a time; they are independent so order is free
+        ADSRModulationSource *l[2][4];
+        int count[2] = {0, 0};
+
+        for (int i = 0; i < n; ++i)
+        {
+            int m = e[i]->lc[e[i]->mode].b ? 1 : 0;
+            l[m][count[m]++] = e[i];
+            if (count[m] == 4)
+            {
+                if (m)
+                    process_block_analog_lanes(l[m], 4);
+                else
+                    process_block_digital_lanes(l[m], 4);
+                count[m] = 0;
+            }
+        }
+
+        if (count[1])
+            process_block_analog_lanes(l[1], count[1]);
+        if (count[0])
+            process_block_digital_lanes(l[0], count[0]);
+        return;
+    }
+#endif
+
+    // On ARM the scalar code may fuse multiplies and adds, which the lanes can't follow
+    for (int i = 0; i < n; ++i)
+        e[i]->process_block();
+}
+
+static inline __m128 loadLanes(ADSRModulationSource *const *v, float ADSRModulationSource::*m)
+{
+    return _mm_setr_ps(v[0]->*m, v[1]->*m, v[2]->*m, v[3]->*m);
+}
+
+static inline void storeLanes(ADSRModulationSource *const *v, float ADSRModulationSource::*m,
+                              __m128 x, int lanes)
+{
+    float f alignas(16)[4];
+    _mm_store_ps(f, x);
+    for (int i = 0; i < 4; ++i)
+        if (lanes & (1 << i))
+            v[i]->*m = f[i];
+}
+
+/*
+ * The analog mode of process_block with _ps for _ss. The lanes are padded out to four by
+ * repeating the last envelope, which is read but never written.
+ */
+void ADSRModulationSource::process_block_analog_lanes(ADSRModulationSource **l, int n)
+{
+    ADSRModulationSource *v[4];
+    for (int i = 0; i < 4; ++i)
+        v[i] = l[std::min(i, n - 1)];
+    int lanes = (1 << n) - 1;
+
+    const float v_cc = 1.5f;
+
+    __m128 v_c1 = loadLanes(v, &ADSRModulationSource::_v_c1);
+    __m128 v_c1_delayed = loadLanes(v, &ADSRModulationSource::_v_c1_delayed);
+    __m128 discharge = loadLanes(v, &ADSRModulationSource::_discharge);
+    const __m128 one = _mm_set1_ps(1.0f); // attack->decay switch at 1 volt
+    const __m128 v_cc_vec = _mm_set1_ps(v_cc);
+
+    bool gate[4];
+    float sparm alignas(16)[4], coef_A alignas(16)[4], coef_D alignas(16)[4],
+        coef_R alignas(16)[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        gate[i] = (v[i]->envstate == s_attack) || (v[i]->envstate == s_decay);
+        sparm[i] = limit_range(v[i]->lc[v[i]->s].f, 0.f, 1.f);
+        v[i]->analogCoefficients(coef_A[i], coef_D[i], coef_R[i]);
+    }
+
+    __m128 v_gate = _mm_setr_ps(gate[0] ? v_cc : 0.f, gate[1] ? v_cc : 0.f,
+                                gate[2] ? v_cc : 0.f, gate[3] ? v_cc : 0.f);
+    __m128 v_is_gate = _mm_cmpgt_ps(v_gate, _mm_setzero_ps());
+
+    discharge = _mm_and_ps(_mm_or_ps(_mm_cmpgt_ps(v_c1_delayed, one), discharge), v_is_gate);
+
+    v_c1_delayed = v_c1;
+
+    __m128 S = _mm_load_ps(sparm);
+    S = _mm_mul_ps(S, S);
+    __m128 v_attack = _mm_andnot_ps(discharge, v_gate);
+    __m128 v_decay = _mm_or_ps(_mm_andnot_ps(discharge, v_cc_vec), _mm_and_ps(discharge, S));
+    __m128 v_release = v_gate;
+
+    __m128 diff_v_a = _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(v_attack, v_c1));
+
+    __m128 diff_vd_kernel = _mm_sub_ps(v_decay, v_c1);
+    __m128 diff_vd_kernel_min = _mm_min_ps(_mm_setzero_ps(), diff_vd_kernel);
+    __m128 dis_and_gate = _mm_and_ps(discharge, v_is_gate);
+    __m128 diff_v_d = select_ps(dis_and_gate, diff_vd_kernel, diff_vd_kernel_min);
+
+    __m128 diff_v_r = _mm_min_ps(_mm_setzero_ps(), _mm_sub_ps(v_release, v_c1));
+
+    v_c1 = _mm_add_ps(v_c1, _mm_mul_ps(diff_v_a, _mm_load_ps(coef_A)));
+    v_c1 = _mm_add_ps(v_c1, _mm_mul_ps(diff_v_d, _mm_load_ps(coef_D)));
+    v_c1 = _mm_add_ps(v_c1, _mm_mul_ps(diff_v_r, _mm_load_ps(coef_R)));
+
+    storeLanes(v, &ADSRModulationSource::_v_c1, v_c1, lanes);
+    storeLanes(v, &ADSRModulationSource::_v_c1_delayed, v_c1_delayed, lanes);
+    storeLanes(v, &ADSRModulationSource::_discharge, discharge, lanes);
+    storeLanes(v, &ADSRModulationSource::output, v_c1, lanes);
+
+    const float SILENCE_THRESHOLD = 1e-6;
+
+    for (int i = 0; i < n; ++i)
+    {
+        auto *e = v[i];
+        if (!gate[i] && e->_discharge == 0.f && e->_v_c1 < SILENCE_THRESHOLD)
+        {
+            e->envstate = s_idle;
+            e->output = 0;
+            e->idlecount++;
+        }
+    }
+}
+
+/*
+ * The digital mode of process_block. Every lane works out the attack, decay and release
+ * steps and keeps the one for its stage; lanes in a stage the lanes don't cover run the scalar
+ * code instead.
+ */
+void ADSRModulationSource::process_block_digital_lanes(ADSRModulationSource **l, int n)
+{
+    ADSRModulationSource *v[4];
+    for (int i = 0; i < 4; ++i)
+        v[i] = l[std::min(i, n - 1)];
+
+    enum
+    {
+        lane_scalar,
+        lane_attack,
+        lane_decay,
+        lane_release,
+    };
+
+    int kind alignas(16)[4], shape alignas(16)[4], lanes = 0, maxshape = 0;
+    float x alignas(16)[4], ts alignas(16)[4], lozero alignas(16)[4];
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto *e = v[i];
+        auto &lc = e->lc;
+        auto tsr = e->storage->temposyncratio;
+
+        kind[i] = lane_scalar;
+        shape[i] = 0;
+        x[i] = 0.f;
+        ts[i] = 1.f;
+        lozero[i] = 0.f;
+
+        switch (e->envstate)
+        {
+        case s_attack:
+            if (lc[e->a_s].i >= 0 && lc[e->a_s].i <= 2)
+            {
+                kind[i] = lane_attack;
+                shape[i] = lc[e->a_s].i;
+                x[i] = lc[e->a].f;
+                ts[i] = e->adsr->a.temposync ? tsr : 1.f;
+            }
+            break;
+        case s_decay:
+            if (lc[e->d_s].i != 2)
+            {
+                kind[i] = lane_decay;
+                shape[i] = lc[e->d_s].i == 1 ? 1 : 0;
+                x[i] = lc[e->d].f;
+                ts[i] = e->adsr->d.temposync ? tsr : 1.f;
+                // the empirical low sustain limits of the scalar code, in its double precision
+                if ((lc[e->s].f < 1e-3 && e->phase < 1e-4) || (lc[e->s].f == 0 && lc[e->d].f < -7))
+                    lozero[i] = 1.f;
+            }
+            break;
+        case s_release:
+        case s_uberrelease:
+            kind[i] = lane_release;
+            shape[i] = lc[e->r_s].i;
+            x[i] = e->envstate == s_release ? lc[e->r].f : -6.5f;
+            ts[i] = e->envstate == s_release && e->adsr->r.temposync ? tsr : 1.f;
+            break;
+        }
+
+        if (i < n && kind[i] != lane_scalar)
+        {
+            lanes |= 1 << i;
+            if (kind[i] == lane_release)
+                maxshape = std::max(maxshape, shape[i]);
+        }
+    }
+
+    for (int i = 0; i < n; ++i)
+        if (!(lanes & (1 << i)))
+            v[i]->process_block();
+
+    if (!lanes)
+        return;
+
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+    auto kinds = _mm_load_si128((__m128i *)kind), shapes = _mm_load_si128((__m128i *)shape);
+    auto is = [](__m128i a, int b) {
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(a, _mm_set1_epi32(b)));
+    };
+
+    __m128 rate = _mm_mul_ps(envelope_rate_linear_nowrap_ps(_mm_load_ps(x)), _mm_load_ps(ts));
+    __m128 phase = loadLanes(v, &ADSRModulationSource::phase);
+    __m128 sustain = _mm_setr_ps(v[0]->lc[v[0]->s].f, v[1]->lc[v[1]->s].f, v[2]->lc[v[2]->s].f,
+                                 v[3]->lc[v[3]->s].f);
+
+    // attack
+    __m128 pa = _mm_add_ps(phase, rate);
+    pa = select_ps(_mm_cmpge_ps(pa, one), one, pa);
+    __m128 oa = select_ps(is(shapes, 0), _mm_sqrt_ps(pa),
+                          select_ps(is(shapes, 2), _mm_mul_ps(pa, pa), pa));
+
+    // decay, linear or quadratic
+    __m128 sx = _mm_sqrt_ps(phase);
+    __m128 sxr = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.f), sx), rate);
+    __m128 rr = _mm_mul_ps(rate, rate);
+    __m128 lo1 = _mm_add_ps(_mm_sub_ps(phase, sxr), rr);
+    __m128 hi1 = _mm_add_ps(_mm_add_ps(phase, sxr), rr);
+    lo1 = select_ps(_mm_cmpneq_ps(_mm_load_ps(lozero), zero), zero, lo1);
+    lo1 = select_ps(_mm_and_ps(_mm_cmpgt_ps(rate, one), _mm_cmpgt_ps(lo1, sustain)), sustain,
+                    lo1);
+    __m128 quadratic = is(shapes, 1);
+    __m128 lo = select_ps(quadratic, lo1, _mm_sub_ps(phase, rate));
+    __m128 hi = select_ps(quadratic, hi1, _mm_add_ps(phase, rate));
+    __m128 pd = limit_range_ps(sustain, lo, hi);
+
+    // release, with the curve applied as many times as each lane asks
+    __m128 pr = _mm_sub_ps(phase, rate);
+    __m128 orl = pr;
+    for (int k = 0; k < maxshape; ++k)
+    {
+        auto more = _mm_castsi128_ps(_mm_cmpgt_epi32(shapes, _mm_set1_epi32(k)));
+        orl = select_ps(more, _mm_mul_ps(orl, pr), orl);
+    }
+    orl = select_ps(_mm_cmplt_ps(pr, zero), zero, orl);
+    orl = _mm_mul_ps(orl, loadLanes(v, &ADSRModulationSource::scalestage));
+
+    __m128 attack = is(kinds, lane_attack), decay = is(kinds, lane_decay);
+    phase = select_ps(attack, pa, select_ps(decay, pd, pr));
+    __m128 output = select_ps(attack, oa, select_ps(decay, pd, orl));
+    output = limit_range_ps(output, zero, one);
+
+    storeLanes(v, &ADSRModulationSource::phase, phase, lanes);
+    storeLanes(v, &ADSRModulationSource::output, output, lanes);
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (!(lanes & (1 << i)))
+            continue;
+
+        auto *e = v[i];
+        if (kind[i] == lane_attack && e->phase >= 1)
+        {
+            e->envstate = s_decay;
+            e->sustain = e->lc[e->s].f;
+        }
+        else if (kind[i] == lane_release && e->phase < 0)
+        {
+            e->envstate = s_idle;
+        }
+    }
+}
@@ -188,26 +188,8 @@ class ADSRModulationSource : public ModulationSource
 
             __m128 diff_v_r = _mm_min_ss(_mm_setzero_ps(), _mm_sub_ss(v_release, v_c1));
 
-            // calculate coefficients for envelope
-            const float shortest = 6.f;
-            const float longest = -2.f;
-            const float coeff_offset = 2.f - log(samplerate / BLOCK_SIZE) / log(2.f);
-
-            float coef_A =
-                powf(2.f, std::min(0.f, coeff_offset - lc[a].f * (adsr->a.temposync
-                                                                      ? storage->temposyncratio
-                                                                      : 1.f)));
-            float coef_D =
-                powf(2.f, std::min(0.f, coeff_offset - lc[d].f * (adsr->d.temposync
-                                                                      ? storage->temposyncratio
-                                                                      : 1.f)));
-            float coef_R =
-                envstate == s_uberrelease
-                    ? 6.f
-                    : powf(2.f,
-                           std::min(0.f, coeff_offset - lc[r].f * (adsr->r.temposync
-                                                                       ? storage->temposyncratio
-                                                                       : 1.f)));
+            float coef_A, coef_D, coef_R;
+            analogCoefficients(coef_A, coef_D, coef_R);
 
             v_c1 = _mm_add_ss(v_c1, _mm_mul_ss(diff_v_a, _mm_load_ss(&coef_A)));
             v_c1 = _mm_add_ss(v_c1, _mm_mul_ss(diff_v_d, _mm_load_ss(&coef_D)));
@@ -359,7 +341,40 @@ class ADSRModulationSource : public ModulationSource
 
     int getEnvState() { return envstate; }
 
+    /*
+     * process_block for n envelopes, one per voice, four voices at a time in SSE lanes. The
+     * analog mode runs entirely in the lanes; the digital attack, decay and release stages do
+     * too, and the rarer cases (the cubic decay, the odd attack shape, idling) drop to the
+     * scalar code for just the envelopes concerned. The result is bit-identical to calling
+     * process_block on each.
+     */
+    static void process_block_batch(ADSRModulationSource **e, int n);
+
   private:
+    static void process_block_analog_lanes(ADSRModulationSource **l, int n);
+    static void process_block_digital_lanes(ADSRModulationSource **l, int n);
+
+    void analogCoefficients(float &coef_A, float &coef_D, float &coef_R)
+    {
+        // calculate coefficients for envelope
+        const float shortest = 6.f;
+        const float longest = -2.f;
+        const float coeff_offset = 2.f - log(samplerate / BLOCK_SIZE) / log(2.f);
+
+        coef_A = powf(2.f, std::min(0.f, coeff_offset - lc[a].f * (adsr->a.temposync
+                                                                       ? storage->temposyncratio
+                                                                       : 1.f)));
+        coef_D = powf(2.f, std::min(0.f, coeff_offset - lc[d].f * (adsr->d.temposync
+                                                                       ? storage->temposyncratio
+                                                                       : 1.f)));
+        coef_R = envstate == s_uberrelease
+                     ? 6.f
+                     : powf(2.f,
+                            std::min(0.f, coeff_offset - lc[r].f * (adsr->r.temposync
+                                                                        ? storage->temposyncratio
+                                                                        : 1.f)));
+    }
+
     ADSRStorage *adsr = nullptr;
     SurgeVoiceState *state = nullptr;
     SurgeStorage *storage = nullptr;
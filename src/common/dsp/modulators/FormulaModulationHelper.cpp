@@ -17,47 +17,222 @@
 #include "LuaSupport.h"
 #include <thread>
 #include <functional>
+#include <cstring>
 
 namespace Surge
 {
 namespace Formula
 {
 
-bool prepareForEvaluation(FormulaModulatorStorage *fs, EvaluatorState &s, bool is_display)
+/*
+ * The fields valueAt writes into the modstate table and reads back from it, in the order they are
+ * written. The key strings are interned once per lua_State into a table indexed by these values,
+ * so an evaluation pushes each key with a rawgeti rather than hashing it again.
+ */
+enum EvaluatorKey
+{
+    key_intphase = 1,
+    key_phase,
+    key_delay,
+    key_attack,
+    key_hold,
+    key_sustain,
+    key_release,
+    key_rate,
+    key_amplitude,
+    key_startphase,
+    key_deform,
+    key_tempo,
+    key_songpos,
+    key_retrigger_AEG,
+    key_retrigger_FEG,
+    key_output,
+    key_use_envelope,
+
+    n_evaluator_keys
+};
+
+static const char *evaluatorKeyNames[n_evaluator_keys] = {
+    nullptr,   "intphase", "phase",    "delay",         "attack",        "hold",
+    "sustain", "release",  "rate",     "amplitude",     "startphase",    "deform",
+    "tempo",   "songpos",  "retrigger_AEG", "retrigger_FEG", "output", "use_envelope"};
+
+enum BatchStatus
 {
-    static lua_State *audioState = nullptr, *displayState = nullptr;
+    batch_table = 0,   // the script returned a table with a numeric output
+    batch_number,      // the script returned a number
+    batch_invalid,     // the evaluation failed and the state is no longer valid
+    batch_bad_output,  // the script returned a table without a numeric output
+};
 
-    bool firstTimeThrough = false;
-    if (!is_display)
+/*
+ * The batch driver, compiled once into each lua_State outside the surge function environment.
+ * Loading the chunk returns a function which binds the state table and the two FFI arrays and
+ * returns the driver, which runs the named function for n states and returns nil or a table of
+ * error messages indexed from 0. Each state goes exactly the way it would through valueAt,
+ * including the error stub replacing the function for the states after one which fails.
+ */
+static const char *batchDriverSource = R"FN(
+local ffi = require("ffi")
+return function(states, inputs, outputs)
+    local G = _G
+    local input = ffi.cast("double *", inputs)
+    local output = ffi.cast("double *", outputs)
+
+    local function evaluate(f, s, x)
+        s.intphase = input[x + 1]
+        s.phase = input[x + 2]
+        s.delay = input[x + 3]
+        s.attack = input[x + 4]
+        s.hold = input[x + 5]
+        s.sustain = input[x + 6]
+        s.release = input[x + 7]
+        s.rate = input[x + 8]
+        s.amplitude = input[x + 9]
+        s.startphase = input[x + 10]
+        s.deform = input[x + 11]
+        s.tempo = input[x + 12]
+        s.songpos = input[x + 13]
+        s.retrigger_AEG = nil
+        s.retrigger_FEG = nil
+        return f(s)
+    end
+
+    local function number(v)
+        if type(v) == "number" then
+            return v
+        end
+        if type(v) == "string" then
+            return tonumber(v)
+        end
+        return nil
+    end
+
+    local function flag(v, default)
+        if type(v) == "boolean" then
+            return v and 1 or 0
+        end
+        return default
+    end
+
+    return function(fname, n)
+        local errors = nil
+        for i = 0, n - 1 do
+            local x, y = i * 14, i * 5
+            local value, status, replace = 0, 2, true
+            local f = G[fname]
+            if type(f) == "function" then
+                local ok, r = pcall(evaluate, f, states[input[x]], x)
+                if not ok then
+                    local m = ""
+                    if type(r) == "string" or type(r) == "number" then
+                        m = tostring(r)
+                    end
+                    errors = errors or {}
+                    errors[i] = "Failed to evaluate 'process' function." .. m
+                elseif number(r) ~= nil then
+                    value, status = number(r), 1
+                elseif type(r) ~= "table" then
+                    errors = errors or {}
+                    errors[i] = "The return of your LUA function must be a number or table. " ..
+                                "Just return input with output set."
+                else
+                    states[input[x]] = r
+                    replace, status = false, 0
+                    value = number(r.output)
+                    if value == nil then
+                        value, status = 0, 3
+                        errors = errors or {}
+                        errors[i] = "You must define the  'output' field in the returned table " ..
+                                    "as a number"
+                    end
+                    output[y + 2] = flag(r.use_envelope, 1)
+                    output[y + 3] = flag(r.retrigger_AEG, 0)
+                    output[y + 4] = flag(r.retrigger_FEG, 0)
+                end
+            end
+            if replace then
+                G[fname] = G.surge_reserved_formula_error_stub
+            end
+            output[y] = value
+            output[y + 1] = status
+        end
+        return errors
+    end
+end
+)FN";
+
+/*
+ * Shared by every display evaluation in the process, whichever synth it shows. Those run in
+ * GUI::PreviewCache jobs, on the UI thread or on the cache's worker, and always under its
+ * computeMutex, which is what keeps two of them off this lua_State at once.
+ */
+static EvaluatorSupport displaySupport;
+
+EvaluatorSupport::~EvaluatorSupport()
+{
+    if (L)
+        lua_close(L);
+}
+
+static void setupEvaluatorSupport(EvaluatorSupport &sup)
+{
+    auto L = sup.L;
+
+    lua_newtable(L);
+    sup.statesRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    lua_createtable(L, n_evaluator_keys, 0);
+    for (int i = 1; i < n_evaluator_keys; ++i)
     {
-        static int aid = 1;
-        if (audioState == nullptr)
-        {
-            audioState = lua_open();
-            luaL_openlibs(audioState);
-            firstTimeThrough = true;
-        }
-        s.L = audioState;
-        snprintf(s.stateName, TXT_SIZE, "audiostate_%d", aid);
-        aid++;
-        if (aid < 0)
-            aid = 1;
+        lua_pushstring(L, evaluatorKeyNames[i]);
+        lua_rawseti(L, -2, i);
+    }
+    sup.keysRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+#if LJ_HASFFI
+    /*
+     * If any of this fails valueAtBatch just goes through valueAt. The driver is ours, not the
+     * user's, so there is nothing worth telling them; the batch test checks it loads.
+     */
+    bool ok = luaL_loadbuffer(L, batchDriverSource, strlen(batchDriverSource),
+                              "formula-batch") == LUA_OK &&
+              lua_pcall(L, 0, 1, 0) == LUA_OK;
+    if (ok)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, sup.statesRef);
+        lua_pushlightuserdata(L, sup.inputs);
+        lua_pushlightuserdata(L, sup.outputs);
+        ok = lua_pcall(L, 3, 1, 0) == LUA_OK && lua_isfunction(L, -1);
+    }
+    if (ok)
+    {
+        sup.batchRef = luaL_ref(L, LUA_REGISTRYINDEX);
     }
     else
     {
-        static int did = 1;
-        if (displayState == nullptr)
-        {
-            displayState = lua_open();
-            luaL_openlibs(displayState);
-            firstTimeThrough = true;
-        }
-        s.L = displayState;
-        snprintf(s.stateName, TXT_SIZE, "dispstate_%d", did);
-        did++;
-        if (did < 0)
-            did = 1;
+        lua_pop(L, 1);
+    }
+#endif
+}
+
+bool prepareForEvaluation(SurgeStorage *storage, FormulaModulatorStorage *fs, EvaluatorState &s,
+                          bool is_display)
+{
+    // Release the state table of any earlier preparation
+    cleanEvaluatorState(s);
+
+    auto &sup = is_display ? displaySupport : *storage->formulaEvaluator;
+
+    bool firstTimeThrough = false;
+    if (sup.L == nullptr)
+    {
+        sup.L = lua_open();
+        luaL_openlibs(sup.L);
+        firstTimeThrough = true;
     }
+    s.support = &sup;
+    s.L = sup.L;
 
     auto lg = Surge::LuaSupport::SGLD("prepareForEvaluation", s.L);
 
@@ -75,8 +250,9 @@ end
         {
             lua_setglobal(s.L, "surge_reserved_formula_error_stub");
         }
-    }
 
+        setupEvaluatorSupport(sup);
+    }
     // OK so now evaluate the formula. This is a mistake - the loading and
     // compiling can be expensive so lets look it up by hash first
     auto h = fs->formulaHash;
@@ -143,9 +319,10 @@ end
     if (s.isvalid)
     {
         // Create my state object each time
+        lua_rawgeti(s.L, LUA_REGISTRYINDEX, sup.statesRef);
         lua_createtable(s.L, 0, 10);
-        lua_setglobal(s.L,
-                      s.stateName); // FIXME - we have to clean this up when evaluat is done
+        s.stateRef = luaL_ref(s.L, -2);
+        lua_pop(s.L, 1);
     }
 
     if (is_display)
@@ -200,11 +377,12 @@ end
 
 bool cleanEvaluatorState(EvaluatorState &s)
 {
-    if (s.L && s.stateName[0] != 0)
+    if (s.L && s.stateRef != LUA_NOREF)
     {
-        lua_pushnil(s.L);
-        lua_setglobal(s.L, s.stateName);
-        s.stateName[0] = 0;
+        lua_rawgeti(s.L, LUA_REGISTRYINDEX, s.support->statesRef);
+        luaL_unref(s.L, -1, s.stateRef);
+        lua_pop(s.L, 1);
+        s.stateRef = LUA_NOREF;
     }
     return true;
 }
@@ -212,7 +390,8 @@ bool cleanEvaluatorState(EvaluatorState &s)
 bool initEvaluatorState(EvaluatorState &s)
 {
     s.funcName[0] = 0;
-    s.stateName[0] = 0;
+    s.stateRef = LUA_NOREF;
+    s.support = nullptr;
     s.L = nullptr;
     return true;
 }
@@ -224,126 +403,134 @@ float valueAt(int phaseIntPart, float phaseFracPart, FormulaModulatorStorage *fs
     if (!s->isvalid)
         return 0;
 
-    auto gs = Surge::LuaSupport::SGLD("valueAt", s->L);
+    auto L = s->L;
+    auto &sup = *s->support;
+
+    auto gs = Surge::LuaSupport::SGLD("valueAt", L);
     struct OnErrorReplaceWithZero
     {
-        OnErrorReplaceWithZero(lua_State *L, std::string fn) : L(L), fn(fn) {}
+        OnErrorReplaceWithZero(lua_State *L, const char *fn) : L(L), fn(fn) {}
         ~OnErrorReplaceWithZero()
         {
             if (replace)
             {
-                // std::cout << "Would nuke " << fn << std::endl;
                 lua_getglobal(L, "surge_reserved_formula_error_stub");
-                lua_setglobal(L, fn.c_str());
+                lua_setglobal(L, fn);
             }
         }
         lua_State *L;
-        std::string fn;
+        const char *fn;
         bool replace = true;
-    } onerr(s->L, s->funcName);
+    } onerr(L, s->funcName);
     /*
-     * So: make the stack my evaluation func then my table; then push my table
-     * values; then call my function; then update my global
+     * So: make the stack the state tables, my evaluation func, then my table; then push my table
+     * values; then call my function; then update my state
      */
-    lua_getglobal(s->L, s->funcName);
-    if (!lua_isfunction(s->L, -1))
+    lua_rawgeti(L, LUA_REGISTRYINDEX, sup.statesRef);
+    lua_getglobal(L, s->funcName);
+    if (!lua_isfunction(L, -1))
     {
         s->isvalid = false;
-        lua_pop(s->L, 1);
+        lua_pop(L, 2);
         return 0;
     }
-    lua_getglobal(s->L, s->stateName);
-    // Stack is now func > table  so we can update the table
-    lua_pushstring(s->L, "intphase");
-    lua_pushinteger(s->L, phaseIntPart);
-    lua_settable(s->L, -3);
-
-    auto addn = [s](const char *q, float f) {
-        lua_pushstring(s->L, q);
-        lua_pushnumber(s->L, f);
-        lua_settable(s->L, -3);
+    lua_rawgeti(L, -2, s->stateRef);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, sup.keysRef);
+    // Stack is now states > func > table > keys so we can update the table
+    auto addn = [L](int k, lua_Number f) {
+        lua_rawgeti(L, -1, k);
+        lua_pushnumber(L, f);
+        lua_settable(L, -4);
     };
 
-    auto addnil = [s](const char *q) {
-        lua_pushstring(s->L, q);
-        lua_pushnil(s->L);
-        lua_settable(s->L, -3);
+    auto addnil = [L](int k) {
+        lua_rawgeti(L, -1, k);
+        lua_pushnil(L);
+        lua_settable(L, -4);
     };
 
-    addn("phase", phaseFracPart);
-    addn("delay", s->del);
-    addn("attack", s->a);
-    addn("hold", s->h);
-    addn("sustain", s->s);
-    addn("release", s->r);
-    addn("rate", s->rate);
-    addn("amplitude", s->amp);
-    addn("startphase", s->phase);
-    addn("deform", s->deform);
-    addn("tempo", s->tempo);
-    addn("songpos", s->songpos);
-
-    addnil("retrigger_AEG");
-    addnil("retrigger_FEG");
-
-    auto lres = lua_pcall(s->L, 1, 1, 0);
-    // stack is now just the result
+    lua_rawgeti(L, -1, key_intphase);
+    lua_pushinteger(L, phaseIntPart);
+    lua_settable(L, -4);
+
+    addn(key_phase, phaseFracPart);
+    addn(key_delay, s->del);
+    addn(key_attack, s->a);
+    addn(key_hold, s->h);
+    addn(key_sustain, s->s);
+    addn(key_release, s->r);
+    addn(key_rate, s->rate);
+    addn(key_amplitude, s->amp);
+    addn(key_startphase, s->phase);
+    addn(key_deform, s->deform);
+    addn(key_tempo, s->tempo);
+    addn(key_songpos, s->songpos);
+
+    addnil(key_retrigger_AEG);
+    addnil(key_retrigger_FEG);
+
+    lua_pop(L, 1);
+
+    auto lres = lua_pcall(L, 1, 1, 0);
+    // stack is now the state tables and the result
     if (lres == LUA_OK)
     {
-        if (lua_isnumber(s->L, -1))
+        if (lua_isnumber(L, -1))
         {
             // OK so you returned a value. Just use it
-            auto r = lua_tonumber(s->L, -1);
-            lua_pop(s->L, 1);
+            auto r = lua_tonumber(L, -1);
+            lua_pop(L, 2);
             return r;
         }
-        if (!lua_istable(s->L, -1))
+        if (!lua_istable(L, -1))
         {
             s->adderror(
                 "The return of your LUA function must be a number or table. Just return input with "
                 "output set.");
             s->isvalid = false;
-            lua_pop(s->L, 1);
+            lua_pop(L, 2);
             return 0;
         }
         // Store the value and keep it on top of the stack
-        lua_setglobal(s->L, s->stateName);
-        lua_getglobal(s->L, s->stateName);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, s->stateRef);
 
-        lua_pushstring(s->L, "output");
-        lua_gettable(s->L, -2);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, sup.keysRef);
+        // Stack is now states > result > keys
+        lua_rawgeti(L, -1, key_output);
+        lua_gettable(L, -3);
         // top of stack is now the result
         float res = 0.0;
-        if (lua_isnumber(s->L, -1))
+        if (lua_isnumber(L, -1))
         {
-            res = lua_tonumber(s->L, -1);
+            res = lua_tonumber(L, -1);
         }
         else
         {
             s->adderror("You must define the  'output' field in the returned table as a number");
             s->isvalid = false;
         };
-        // pop the result and the function
-        lua_pop(s->L, 1);
+        // pop the output
+        lua_pop(L, 1);
 
-        auto getBoolDefault = [s](const char *n, bool def) -> bool {
+        auto getBoolDefault = [L](int k, bool def) -> bool {
             auto res = def;
-            lua_pushstring(s->L, n);
-            lua_gettable(s->L, -2);
-            if (lua_isboolean(s->L, -1))
+            lua_rawgeti(L, -1, k);
+            lua_gettable(L, -3);
+            if (lua_isboolean(L, -1))
             {
-                res = lua_toboolean(s->L, -1);
+                res = lua_toboolean(L, -1);
             }
-            lua_pop(s->L, 1);
+            lua_pop(L, 1);
             return res;
         };
 
-        s->useEnvelope = getBoolDefault("use_envelope", true);
-        s->retrigger_AEG = getBoolDefault("retrigger_AEG", false);
-        s->retrigger_FEG = getBoolDefault("retrigger_FEG", false);
+        s->useEnvelope = getBoolDefault(key_use_envelope, true);
+        s->retrigger_AEG = getBoolDefault(key_retrigger_AEG, false);
+        s->retrigger_FEG = getBoolDefault(key_retrigger_FEG, false);
 
-        // Finally pop the table result
-        lua_pop(s->L, 1);
+        // Finally pop the keys, the table result and the state tables
+        lua_pop(L, 3);
         onerr.replace = false;
         return res;
     }
@@ -351,13 +538,128 @@ float valueAt(int phaseIntPart, float phaseFracPart, FormulaModulatorStorage *fs
     {
         s->isvalid = false;
         std::ostringstream oss;
-        oss << "Failed to evaluate 'process' function." << lua_tostring(s->L, -1);
+        oss << "Failed to evaluate 'process' function." << lua_tostring(L, -1);
         s->adderror(oss.str());
-        lua_pop(s->L, 1);
+        lua_pop(L, 2);
         return 0;
     }
 }
 
+void valueAtBatch(EvaluatorState **states, const int *phaseIntPart, const float *phaseFracPart,
+                  FormulaModulatorStorage *fs, float *out, int n)
+{
+    /*
+     * The driver can take everything from states which share the lua_State and function of the
+     * first one with a chance of evaluating; anything else, or a missing driver, goes one by one.
+     */
+    EvaluatorState *first = nullptr;
+    for (int i = 0; i < n && !first; ++i)
+    {
+        if (states[i]->L && states[i]->isvalid)
+            first = states[i];
+    }
+
+    bool batch = first && first->support->batchRef != LUA_NOREF;
+    for (int i = 0; i < n && batch; ++i)
+    {
+        auto *s = states[i];
+        if (s->L && s->isvalid)
+            batch = s->L == first->L && strncmp(s->funcName, first->funcName, TXT_SIZE) == 0;
+    }
+
+    if (!batch)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = valueAt(phaseIntPart[i], phaseFracPart[i], fs, states[i]);
+        return;
+    }
+
+    auto L = first->L;
+    auto &sup = *first->support;
+    auto gs = Surge::LuaSupport::SGLD("valueAtBatch", L);
+    sup.batchCalls++;
+
+    int idx[MAX_VOICES];
+    for (int i0 = 0; i0 < n; i0 += MAX_VOICES)
+    {
+        int k = 0;
+        for (int i = i0; i < std::min(n, i0 + MAX_VOICES); ++i)
+        {
+            auto *s = states[i];
+            if (!s->L || !s->isvalid)
+            {
+                out[i] = 0;
+                continue;
+            }
+
+            auto *in = sup.inputs + k * batchInputStride;
+            in[0] = s->stateRef;
+            in[1] = phaseIntPart[i];
+            in[2] = phaseFracPart[i];
+            in[3] = s->del;
+            in[4] = s->a;
+            in[5] = s->h;
+            in[6] = s->s;
+            in[7] = s->r;
+            in[8] = s->rate;
+            in[9] = s->amp;
+            in[10] = s->phase;
+            in[11] = s->deform;
+            in[12] = s->tempo;
+            in[13] = s->songpos;
+            idx[k++] = i;
+        }
+        if (k == 0)
+            continue;
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, sup.batchRef);
+        lua_pushstring(L, first->funcName);
+        lua_pushinteger(L, k);
+        if (lua_pcall(L, 2, 1, 0) != LUA_OK)
+        {
+            // Only something having broken the driver itself lands here
+            std::ostringstream oss;
+            oss << "Failed to evaluate 'process' function." << lua_tostring(L, -1);
+            for (int j = 0; j < k; ++j)
+            {
+                states[idx[j]]->isvalid = false;
+                states[idx[j]]->adderror(oss.str());
+                out[idx[j]] = 0;
+            }
+            lua_pop(L, 1);
+            continue;
+        }
+
+        // The stack is now nil or the table of error messages
+        for (int j = 0; j < k; ++j)
+        {
+            auto *s = states[idx[j]];
+            auto *o = sup.outputs + j * batchOutputStride;
+            auto status = (int)o[1];
+
+            out[idx[j]] = (float)o[0];
+            if (status == batch_table || status == batch_bad_output)
+            {
+                s->useEnvelope = o[2] != 0;
+                s->retrigger_AEG = o[3] != 0;
+                s->retrigger_FEG = o[4] != 0;
+            }
+            if (status == batch_invalid || status == batch_bad_output)
+            {
+                s->isvalid = false;
+                if (lua_istable(L, -1))
+                {
+                    lua_rawgeti(L, -1, j);
+                    if (lua_isstring(L, -1))
+                        s->adderror(lua_tostring(L, -1));
+                    lua_pop(L, 1);
+                }
+            }
+        }
+        lua_pop(L, 1);
+    }
+}
+
 void createInitFormula(FormulaModulatorStorage *fs)
 {
     fs->setFormula(R"FN(function process(modstate)
@@ -39,7 +39,11 @@ namespace Formula
 struct EvaluatorState
 {
 };
-bool prepareForEvaluation(FormulaModulatorStorage *fs, EvaluatorState &s, bool is_display)
+struct EvaluatorSupport
+{
+};
+bool prepareForEvaluation(SurgeStorage *storage, FormulaModulatorStorage *fs, EvaluatorState &s,
+                          bool is_display)
 {
     return false;
 }
@@ -51,11 +55,46 @@ float valueAt(int phaseIntPart, float phaseFracPart, float deform, FormulaModula
 }
 
 #else
+// Per state, valueAtBatch sends over the state reference and then the 13 numbers valueAt pushes
+static constexpr int batchInputStride = 14;
+// and gets back the value, a status and the three flags
+static constexpr int batchOutputStride = 5;
+
+/*
+ * A lua_State formulas are evaluated in, with what valueAt and valueAtBatch need of it beyond
+ * the globals: registry references to the table of modstate tables, the interned keys and the
+ * batch driver, and the arrays the driver reads and writes. Each SurgeStorage owns the one its
+ * voices use, so separate synths can run on separate threads; the LFO displays share another,
+ * under PreviewCache's computeMutex. The lua_State is opened by the first prepareForEvaluation.
+ */
+struct EvaluatorSupport
+{
+    EvaluatorSupport() = default;
+    EvaluatorSupport(const EvaluatorSupport &) = delete;
+    EvaluatorSupport &operator=(const EvaluatorSupport &) = delete;
+    ~EvaluatorSupport();
+
+    lua_State *L = nullptr;
+    int statesRef = LUA_NOREF, keysRef = LUA_NOREF, batchRef = LUA_NOREF;
+
+    double inputs[MAX_VOICES * batchInputStride];
+    double outputs[MAX_VOICES * batchOutputStride];
+
+    // valueAtBatch calls which went through the driver rather than one voice at a time
+    uint64_t batchCalls = 0;
+};
+
 struct EvaluatorState
 {
     bool released;
     char funcName[TXT_SIZE];
-    char stateName[TXT_SIZE];
+
+    /*
+     * The modstate table handed to the script. It is held by reference in a table of states
+     * private to the lua_State rather than under a global name, and released by
+     * cleanEvaluatorState.
+     */
+    int stateRef = LUA_NOREF;
 
     bool isvalid = false;
     bool useEnvelope = true;
@@ -74,16 +113,28 @@ struct EvaluatorState
         raisedError = true;
     }
 
-    lua_State *L; // This is assigned by prepareForEvaluation to be one per thread
+    // These are assigned by prepareForEvaluation: the storage's evaluator or the display's
+    EvaluatorSupport *support = nullptr;
+    lua_State *L = nullptr;
 };
 
 bool initEvaluatorState(EvaluatorState &s);
 bool cleanEvaluatorState(EvaluatorState &s);
-bool prepareForEvaluation(FormulaModulatorStorage *fs, EvaluatorState &s, bool is_display);
+bool prepareForEvaluation(SurgeStorage *storage, FormulaModulatorStorage *fs, EvaluatorState &s,
+                          bool is_display);
 
 float valueAt(int phaseIntPart, float phaseFracPart, FormulaModulatorStorage *fs,
               EvaluatorState *state);
 
+/*
+ * valueAt for n states prepared from the same FormulaModulatorStorage, such as one LFO slot
+ * across all voices, writing the results to out. The inputs of every state go over in one FFI
+ * array and a single call into LuaJIT runs the script for all of them, in order, with exactly the
+ * outcome of calling valueAt on each in turn; without the FFI it does just that.
+ */
+void valueAtBatch(EvaluatorState **states, const int *phaseIntPart, const float *phaseFracPart,
+                  FormulaModulatorStorage *fs, float *out, int n);
+
 void createInitFormula(FormulaModulatorStorage *fs);
 
 #endif
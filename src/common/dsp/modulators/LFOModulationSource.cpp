@@ -354,7 +354,7 @@ void LFOModulationSource::attack()
     break;
     case lt_formula:
     {
-        Surge::Formula::prepareForEvaluation(fs, formulastate, is_display);
+        Surge::Formula::prepareForEvaluation(storage, fs, formulastate, is_display);
     }
     break;
     }
@@ -374,7 +374,7 @@ void LFOModulationSource::release()
     }
 }
 
-void LFOModulationSource::process_block()
+void LFOModulationSource::startBlock()
 {
     if ((!phaseInitialized) || (lfo->trigmode.val.i == lm_keytrigger && lfo->rate.deactivated))
     {
@@ -383,8 +383,10 @@ void LFOModulationSource::process_block()
 
     retrigger_FEG = false;
     retrigger_AEG = false;
-    int s = lfo->shape.val.i;
+}
 
+float LFOModulationSource::blockRate()
+{
     float frate = 0;
 
     if (!lfo->rate.temposync)
@@ -411,75 +413,85 @@ void LFOModulationSource::process_block()
     if (lfo->rate.temposync)
         frate *= storage->temposyncratio;
 
-    phase += frate * ratemult;
-    if (frate == 0 && phase == 0 && s == lt_stepseq)
+    return frate;
+}
+
+float LFOModulationSource::envelopeRate()
+{
+    float envrate = 0;
+
+    switch (env_state)
     {
-        phase = 0.001; // step forward a smidge
-    }
+    case lfoeg_delay:
+        envrate = envelope_rate_linear_nowrap(localcopy[idelay].f);
+        if (lfo->delay.temposync)
+            envrate *= storage->temposyncratio;
+        break;
+    case lfoeg_attack:
+        envrate = envelope_rate_linear_nowrap(localcopy[iattack].f);
+        if (lfo->attack.temposync)
+            envrate *= storage->temposyncratio;
+        break;
+    case lfoeg_hold:
+        envrate = envelope_rate_linear_nowrap(localcopy[ihold].f);
+        if (lfo->hold.temposync)
+            envrate *= storage->temposyncratio;
+        break;
+    case lfoeg_decay:
+        envrate = envelope_rate_linear_nowrap(localcopy[idecay].f);
+        if (lfo->decay.temposync)
+            envrate *= storage->temposyncratio;
+        break;
+    case lfoeg_release:
+        envrate = envelope_rate_linear_nowrap(localcopy[irelease].f);
+        if (lfo->release.temposync)
+            envrate *= storage->temposyncratio;
+        break;
+    };
 
-    if (env_state != lfoeg_stuck && env_state != lfoeg_msegrelease)
+    return envrate;
+}
+
+void LFOModulationSource::envelopeStageDone(float sustainlevel)
+{
+    switch (env_state)
     {
-        float envrate = 0;
+    case lfoeg_delay:
+        env_state = lfoeg_attack;
+        env_phase = 0.f;
+        break;
+    case lfoeg_attack:
+        env_state = lfoeg_hold;
+        env_phase = 0.f;
+        break;
+    case lfoeg_hold:
+        env_state = lfoeg_decay;
+        env_phase = 0.f;
+        break;
+    case lfoeg_decay:
+        env_state = lfoeg_stuck;
+        env_phase = 0;
+        env_val = sustainlevel;
+        break;
+    case lfoeg_release:
+        env_state = lfoeg_stuck;
+        env_phase = 0;
+        env_val = 0.f;
+        break;
+    };
+}
 
-        switch (env_state)
-        {
-        case lfoeg_delay:
-            envrate = envelope_rate_linear_nowrap(localcopy[idelay].f);
-            if (lfo->delay.temposync)
-                envrate *= storage->temposyncratio;
-            break;
-        case lfoeg_attack:
-            envrate = envelope_rate_linear_nowrap(localcopy[iattack].f);
-            if (lfo->attack.temposync)
-                envrate *= storage->temposyncratio;
-            break;
-        case lfoeg_hold:
-            envrate = envelope_rate_linear_nowrap(localcopy[ihold].f);
-            if (lfo->hold.temposync)
-                envrate *= storage->temposyncratio;
-            break;
-        case lfoeg_decay:
-            envrate = envelope_rate_linear_nowrap(localcopy[idecay].f);
-            if (lfo->decay.temposync)
-                envrate *= storage->temposyncratio;
-            break;
-        case lfoeg_release:
-            envrate = envelope_rate_linear_nowrap(localcopy[irelease].f);
-            if (lfo->release.temposync)
-                envrate *= storage->temposyncratio;
-            break;
-        };
-        env_phase += envrate;
+void LFOModulationSource::updateEnvelope()
+{
+    if (env_state != lfoeg_stuck && env_state != lfoeg_msegrelease)
+    {
+        env_phase += envelopeRate();
 
         float sustainlevel = localcopy[isustain].f;
 
         if (env_phase > 1.f)
         {
-            switch (env_state)
-            {
-            case lfoeg_delay:
-                env_state = lfoeg_attack;
-                env_phase = 0.f;
-                break;
-            case lfoeg_attack:
-                env_state = lfoeg_hold;
-                env_phase = 0.f;
-                break;
-            case lfoeg_hold:
-                env_state = lfoeg_decay;
-                env_phase = 0.f;
-                break;
-            case lfoeg_decay:
-                env_state = lfoeg_stuck;
-                env_phase = 0;
-                env_val = sustainlevel;
-                break;
-            case lfoeg_release:
-                env_state = lfoeg_stuck;
-                env_phase = 0;
-                env_val = 0.f;
-                break;
-            };
+            envelopeStageDone(sustainlevel);
         }
         switch (env_state)
         {
@@ -500,111 +512,132 @@ void LFOModulationSource::process_block()
             break;
         };
     }
+}
 
-    if (phase > 1 || phase < 0)
+// Called once phase has left [0, 1]
+void LFOModulationSource::wrapPhase(int s)
+{
+    if (phase >= 2)
     {
-        if (phase >= 2)
+        float ipart;
+        phase = modf(phase, &ipart);
+        unwrappedphase_intpart += ipart;
+    }
+    else if (phase < 0)
+    {
+        // -6.02 needs to go to .98
+        //
+        int p = (int)phase - 1;
+        float np = -p + phase;
+        if (np >= 0 && np < 1)
         {
-            float ipart;
-            phase = modf(phase, &ipart);
-            unwrappedphase_intpart += ipart;
+            phase = np;
+            unwrappedphase_intpart += p;
         }
-        else if (phase < 0)
+        else
+            phase =
+                0; // should never get here but something is already wierd with the mod stack
+    }
+    else
+    {
+        phase -= 1;
+        unwrappedphase_intpart++;
+    }
+
+    switch (s)
+    {
+    case lt_snh:
+    {
+        if (lfo->deform.deform_type == type_2)
         {
-            // -6.02 needs to go to .98
-            //
-            int p = (int)phase - 1;
-            float np = -p + phase;
-            if (np >= 0 && np < 1)
-            {
-                phase = np;
-                unwrappedphase_intpart += p;
-            }
-            else
-                phase =
-                    0; // should never get here but something is already wierd with the mod stack
+            wf_history[3] = wf_history[2];
+            wf_history[2] = wf_history[1];
+            wf_history[1] = wf_history[0];
+
+            wf_history[0] = correlated_noise_o2mk2_suppliedrng(target, noised1, 0.f, urng);
         }
         else
         {
-            phase -= 1;
-            unwrappedphase_intpart++;
+            iout = correlated_noise_o2mk2_suppliedrng(
+                target, noised1, limit_range(localcopy[ideform].f, -1.f, 1.f), urng);
         }
+    }
+    break;
+    case lt_noise:
+    {
+        wf_history[3] = wf_history[2];
+        wf_history[2] = wf_history[1];
+        wf_history[1] = wf_history[0];
 
-        switch (s)
+        wf_history[0] = correlated_noise_o2mk2_suppliedrng(
+            target, noised1, limit_range(localcopy[ideform].f, -1.f, 1.f), urng);
+        // target = storage->rand_pm1();
+    }
+    break;
+    case lt_stepseq:
+        /*
+        ** You might thing we don't need this and technically we don't
+        ** but I wanted to keep it here to retain compatability with
+        ** versions of trigmask which were streamed in older sessions
+        */
+        if (ss->trigmask & (UINT64_C(1) << step))
         {
-        case lt_snh:
+            retrigger_FEG = true;
+            retrigger_AEG = true;
+        }
+        if (ss->trigmask & (UINT64_C(1) << (16 + step)))
         {
-            if (lfo->deform.deform_type == type_2)
-            {
-                wf_history[3] = wf_history[2];
-                wf_history[2] = wf_history[1];
-                wf_history[1] = wf_history[0];
-
-                wf_history[0] = correlated_noise_o2mk2_suppliedrng(target, noised1, 0.f, urng);
-            }
-            else
-            {
-                iout = correlated_noise_o2mk2_suppliedrng(
-                    target, noised1, limit_range(localcopy[ideform].f, -1.f, 1.f), urng);
-            }
+            retrigger_FEG = true;
         }
-        break;
-        case lt_noise:
+        if (ss->trigmask & (UINT64_C(1) << (32 + step)))
         {
-            wf_history[3] = wf_history[2];
-            wf_history[2] = wf_history[1];
-            wf_history[1] = wf_history[0];
+            retrigger_AEG = true;
+        }
+        step++;
+        shuffle_id = (shuffle_id + 1) & 1;
+        if (shuffle_id)
+            ratemult = 1.f / max(0.01f, 1.f - 0.5f * lfo->start_phase.val.f);
+        else
+            ratemult = 1.f / (1.f + 0.5f * lfo->start_phase.val.f);
 
-            wf_history[0] = correlated_noise_o2mk2_suppliedrng(
-                target, noised1, limit_range(localcopy[ideform].f, -1.f, 1.f), urng);
-            // target = storage->rand_pm1();
+        if (ss->loop_end >= ss->loop_start)
+        {
+            if (step > ss->loop_end)
+                step = ss->loop_start;
+        }
+        else
+        {
+            if (step >= ss->loop_start)
+                step = ss->loop_end + 1;
         }
+        wf_history[3] = wf_history[2];
+        wf_history[2] = wf_history[1];
+        wf_history[1] = wf_history[0];
+        wf_history[0] = ss->steps[step & (n_stepseqsteps - 1)];
         break;
-        case lt_stepseq:
-            /*
-            ** You might thing we don't need this and technically we don't
-            ** but I wanted to keep it here to retain compatability with
-            ** versions of trigmask which were streamed in older sessions
-            */
-            if (ss->trigmask & (UINT64_C(1) << step))
-            {
-                retrigger_FEG = true;
-                retrigger_AEG = true;
-            }
-            if (ss->trigmask & (UINT64_C(1) << (16 + step)))
-            {
-                retrigger_FEG = true;
-            }
-            if (ss->trigmask & (UINT64_C(1) << (32 + step)))
-            {
-                retrigger_AEG = true;
-            }
-            step++;
-            shuffle_id = (shuffle_id + 1) & 1;
-            if (shuffle_id)
-                ratemult = 1.f / max(0.01f, 1.f - 0.5f * lfo->start_phase.val.f);
-            else
-                ratemult = 1.f / (1.f + 0.5f * lfo->start_phase.val.f);
+    };
+}
 
-            if (ss->loop_end >= ss->loop_start)
-            {
-                if (step > ss->loop_end)
-                    step = ss->loop_start;
-            }
-            else
-            {
-                if (step >= ss->loop_start)
-                    step = ss->loop_end + 1;
-            }
-            wf_history[3] = wf_history[2];
-            wf_history[2] = wf_history[1];
-            wf_history[1] = wf_history[0];
-            wf_history[0] = ss->steps[step & (n_stepseqsteps - 1)];
-            break;
-        };
+float LFOModulationSource::deformed(float x)
+{
+    switch (lfo->deform.deform_type)
+    {
+    case type_1:
+        return bend1(x);
+    case type_2:
+        if (localcopy[ideform].f >= -1 / 4.5)
+            return bend2(x);
+        else
+            return bend2(x) / (1 - ((localcopy[ideform].f + (1 / 4.5)) / 1.6));
+    case type_3:
+        return (bend3(x) / (1.f + 0.5 * abs(localcopy[ideform].f)) -
+                (0.06 * localcopy[ideform].f));
     }
+    return iout;
+}
 
-    float useenvval = env_val;
+void LFOModulationSource::evaluateShape(int s, float frate, float &useenvval)
+{
     switch (s)
     {
     case lt_envelope:
@@ -650,64 +683,15 @@ void LFOModulationSource::process_block()
         break;
 
     case lt_sine:
-        switch (lfo->deform.deform_type)
-        {
-        case type_1:
-            iout = bend1(lookup_waveshape_warp(wst_sine, 2.f - 4.f * phase));
-            break;
-        case type_2:
-            if (localcopy[ideform].f >= -1 / 4.5)
-                iout = bend2(lookup_waveshape_warp(wst_sine, 2.f - 4.f * phase));
-            else
-                iout = bend2(lookup_waveshape_warp(wst_sine, 2.f - 4.f * phase)) /
-                       (1 - ((localcopy[ideform].f + (1 / 4.5)) / 1.6));
-            break;
-        case type_3:
-            iout = (bend3(lookup_waveshape_warp(wst_sine, 2.f - 4.f * phase)) /
-                        (1.f + 0.5 * abs(localcopy[ideform].f)) -
-                    (0.06 * localcopy[ideform].f));
-            break;
-        }
+        iout = deformed(lookup_waveshape_warp(wst_sine, 2.f - 4.f * phase));
         break;
 
     case lt_tri:
-        switch (lfo->deform.deform_type)
-        {
-        case type_1:
-            iout = bend1(-1.f + 4.f * ((phase > 0.5) ? (1 - phase) : phase));
-            break;
-        case type_2:
-            if (localcopy[ideform].f >= -1 / 4.5)
-                iout = bend2(-1.f + 4.f * ((phase > 0.5) ? (1 - phase) : phase));
-            else
-                iout = bend2(-1.f + 4.f * ((phase > 0.5) ? (1 - phase) : phase)) /
-                       (1 - ((localcopy[ideform].f + (1 / 4.5)) / 1.6));
-            break;
-        case type_3:
-            iout = (bend3(-1.f + 4.f * ((phase > 0.5) ? (1 - phase) : phase)) /
-                        (1.f + 0.5 * abs(localcopy[ideform].f)) -
-                    (0.06 * localcopy[ideform].f));
-            break;
-        }
+        iout = deformed(-1.f + 4.f * ((phase > 0.5) ? (1 - phase) : phase));
         break;
 
     case lt_ramp:
-        switch (lfo->deform.deform_type)
-        {
-        case type_1:
-            iout = bend1(1.f - 2.f * phase);
-            break;
-        case type_2:
-            if (localcopy[ideform].f >= -1 / 4.5)
-                iout = bend2(1.f - 2.f * phase);
-            else
-                iout = bend2(1.f - 2.f * phase) / (1 - ((localcopy[ideform].f + (1 / 4.5)) / 1.6));
-            break;
-        case type_3:;
-            iout = (bend3(1.f - 2.f * phase) / (1.f + 0.5 * abs(localcopy[ideform].f)) -
-                    (0.06 * localcopy[ideform].f));
-            break;
-        }
+        iout = deformed(1.f - 2.f * phase);
         break;
 
     case lt_square:
@@ -844,42 +828,78 @@ void LFOModulationSource::process_block()
         retrigger_AEG = msegstate.retrigger_AEG;
         break;
     case lt_formula:
-        formulastate.released = (env_state == lfoeg_release || env_state == lfoeg_msegrelease);
-
-        formulastate.del = lfo->delay.value_to_normalized(localcopy[idelay].f);
-        formulastate.a = lfo->attack.value_to_normalized(localcopy[iattack].f);
-        formulastate.h = lfo->hold.value_to_normalized(localcopy[ihold].f);
-        formulastate.dec = lfo->decay.value_to_normalized(localcopy[idecay].f);
-        formulastate.s = lfo->sustain.value_to_normalized(localcopy[isustain].f);
-        formulastate.r = lfo->release.value_to_normalized(localcopy[irelease].f);
-
-        formulastate.rate = localcopy[rate].f;
-        formulastate.amp = localcopy[magn].f;
-        formulastate.phase = localcopy[startphase].f;
-        formulastate.deform = localcopy[ideform].f;
-        formulastate.tempo = storage->temposyncratio * 120.0;
-        formulastate.songpos = storage->songpos;
-
+        prepareFormula();
         iout = Surge::Formula::valueAt(unwrappedphase_intpart, phase, fs, &formulastate);
-
-        if (!formulastate.useEnvelope)
-        {
-            useenvval = 1.0;
-        }
-        retrigger_AEG = formulastate.retrigger_AEG;
-        retrigger_FEG = formulastate.retrigger_FEG;
-
-        if (formulastate.raisedError)
-        {
-            auto em = formulastate.error;
-            formulastate.error = "";
-            formulastate.raisedError = false;
-            storage->reportError(em, "Formula Evaluator Error");
-            std::cout << "ERROR: " << em << std::endl;
-        }
+        finishFormula(useenvval);
         break;
     };
+}
+
+void LFOModulationSource::prepareFormula()
+{
+    formulastate.released = (env_state == lfoeg_release || env_state == lfoeg_msegrelease);
+
+    formulastate.del = lfo->delay.value_to_normalized(localcopy[idelay].f);
+    formulastate.a = lfo->attack.value_to_normalized(localcopy[iattack].f);
+    formulastate.h = lfo->hold.value_to_normalized(localcopy[ihold].f);
+    formulastate.dec = lfo->decay.value_to_normalized(localcopy[idecay].f);
+    formulastate.s = lfo->sustain.value_to_normalized(localcopy[isustain].f);
+    formulastate.r = lfo->release.value_to_normalized(localcopy[irelease].f);
+
+    formulastate.rate = localcopy[rate].f;
+    formulastate.amp = localcopy[magn].f;
+    formulastate.phase = localcopy[startphase].f;
+    formulastate.deform = localcopy[ideform].f;
+    formulastate.tempo = storage->temposyncratio * 120.0;
+    formulastate.songpos = storage->songpos;
+}
+
+void LFOModulationSource::finishFormula(float &useenvval)
+{
+    if (!formulastate.useEnvelope)
+    {
+        useenvval = 1.0;
+    }
+    retrigger_AEG = formulastate.retrigger_AEG;
+    retrigger_FEG = formulastate.retrigger_FEG;
+
+    if (formulastate.raisedError)
+    {
+        auto em = formulastate.error;
+        formulastate.error = "";
+        formulastate.raisedError = false;
+        storage->reportError(em, "Formula Evaluator Error");
+        std::cout << "ERROR: " << em << std::endl;
+    }
+}
+
+float LFOModulationSource::magnitude()
+{
+    return limit_range(lfo->magnitude.get_extended(localcopy[magn].f), -3.f, 3.f);
+}
+
+float LFOModulationSource::advanceBlock(int s)
+{
+    startBlock();
+
+    float frate = blockRate();
 
+    phase += frate * ratemult;
+    if (frate == 0 && phase == 0 && s == lt_stepseq)
+    {
+        phase = 0.001; // step forward a smidge
+    }
+
+    updateEnvelope();
+
+    if (phase > 1 || phase < 0)
+        wrapPhase(s);
+
+    return frate;
+}
+
+void LFOModulationSource::finishBlock(int s, float useenvval)
+{
     float io2 = iout;
 
     if (lfo->unipolar.val.b)
@@ -894,8 +914,305 @@ void LFOModulationSource::process_block()
         }
     }
 
-    auto magnf = limit_range(lfo->magnitude.get_extended(localcopy[magn].f), -3.f, 3.f);
-    output = useenvval * magnf * io2;
+    output = useenvval * magnitude() * io2;
+}
+
+void LFOModulationSource::process_block()
+{
+    int s = lfo->shape.val.i;
+    float frate = advanceBlock(s);
+
+    float useenvval = env_val;
+    evaluateShape(s, frate, useenvval);
+
+    finishBlock(s, useenvval);
+}
+
+void LFOModulationSource::process_block_batch(LFOModulationSource **lfos, int n)
+{
+#if !ARM_NEON
+    /*
+     * The lanes only pay off, and are only identical, when every LFO runs off the same
+     * LFOStorage. On ARM the scalar code may fuse multiplies and adds, which the lanes can't
+     * follow, so there we always go one by one.
+     */
+    bool lanes = n > 1;
+    for (int i = 0; i < n && lanes; ++i)
+        lanes = lfos[i]->lfo == lfos[0]->lfo && !lfos[i]->is_display;
+
+    if (lanes && lfos[0]->lfo->shape.val.i != lt_mseg &&
+        lfos[0]->lfo->shape.val.i != lt_formula)
+    {
+        for (int i = 0; i < n; i += 4)
+            process_block_lanes(lfos + i, std::min(n - i, 4));
+        return;
+    }
+#endif
+
+    bool formula = n > 1;
+    for (int i = 0; i < n && formula; ++i)
+        formula = lfos[i]->lfo == lfos[0]->lfo && lfos[i]->fs == lfos[0]->fs &&
+                  !lfos[i]->is_display && lfos[i]->lfo->shape.val.i == lt_formula;
+
+    if (formula)
+    {
+        process_block_formula(lfos, n);
+        return;
+    }
+
+    for (int i = 0; i < n; ++i)
+        lfos[i]->process_block();
+}
+
+/*
+ * Formula LFOs sharing a FormulaModulatorStorage: each LFO steps up to its shape as usual, then
+ * the script runs for all of them in one go and each LFO finishes its block. Nothing between
+ * the steps and the script touches the Lua state, so the script sees the same calls in the same
+ * order as it would from process_block.
+ */
+void LFOModulationSource::process_block_formula(LFOModulationSource **lfos, int n)
+{
+    Surge::Formula::EvaluatorState *states[MAX_VOICES];
+    int intPhase[MAX_VOICES];
+    float phase[MAX_VOICES], useenvval[MAX_VOICES], out[MAX_VOICES];
+
+    for (int i0 = 0; i0 < n; i0 += MAX_VOICES)
+    {
+        int k = std::min(n - i0, MAX_VOICES);
+        auto *l = lfos + i0;
+
+        for (int i = 0; i < k; ++i)
+        {
+            l[i]->advanceBlock(lt_formula);
+            useenvval[i] = l[i]->env_val;
+            l[i]->prepareFormula();
+
+            states[i] = &l[i]->formulastate;
+            intPhase[i] = l[i]->unwrappedphase_intpart;
+            phase[i] = l[i]->phase;
+        }
+
+        Surge::Formula::valueAtBatch(states, intPhase, phase, l[0]->fs, out, k);
+
+        for (int i = 0; i < k; ++i)
+        {
+            l[i]->iout = out[i];
+            l[i]->finishFormula(useenvval[i]);
+            l[i]->finishBlock(lt_formula, useenvval[i]);
+        }
+    }
+}
+
+/*
+ * process_block over up to four LFOs sharing an LFOStorage, step by step. Every lane does the
+ * operations of the scalar code in the same order, so the results match exactly; wherever the
+ * scalar code branches on something particular to a lane, that lane takes the scalar step.
+ */
+void LFOModulationSource::process_block_lanes(LFOModulationSource **l, int n)
+{
+    // Pad out to four by repeating the last LFO; the padding is read but never written
+    LFOModulationSource *v[4];
+    for (int i = 0; i < 4; ++i)
+        v[i] = l[std::min(i, n - 1)];
+
+    auto *lfo = v[0]->lfo;
+    int s = lfo->shape.val.i;
+
+    auto load = [&v](float LFOModulationSource::*m) {
+        return _mm_setr_ps(v[0]->*m, v[1]->*m, v[2]->*m, v[3]->*m);
+    };
+    auto store = [&v, n](float LFOModulationSource::*m, __m128 x) {
+        float f alignas(16)[4];
+        _mm_store_ps(f, x);
+        for (int i = 0; i < n; ++i)
+            v[i]->*m = f[i];
+    };
+    auto param = [&v](int id) {
+        return _mm_setr_ps(v[0]->localcopy[id].f, v[1]->localcopy[id].f, v[2]->localcopy[id].f,
+                           v[3]->localcopy[id].f);
+    };
+
+    for (int i = 0; i < n; ++i)
+        v[i]->startBlock();
+
+    float frate alignas(16)[4];
+    if (!lfo->rate.temposync && !lfo->rate.deactivated)
+    {
+        auto r = _mm_xor_ps(param(v[0]->rate), _mm_set1_ps(-0.f));
+        _mm_store_ps(frate, envelope_rate_linear_nowrap_ps(r));
+    }
+    else
+    {
+        for (int i = 0; i < 4; ++i)
+            frate[i] = v[i]->blockRate();
+    }
+
+    store(&LFOModulationSource::phase,
+          _mm_add_ps(load(&LFOModulationSource::phase),
+                     _mm_mul_ps(_mm_load_ps(frate), load(&LFOModulationSource::ratemult))));
+
+    if (s == lt_stepseq)
+    {
+        for (int i = 0; i < n; ++i)
+            if (frate[i] == 0 && v[i]->phase == 0)
+                v[i]->phase = 0.001; // step forward a smidge
+    }
+
+    // The envelope: each lane picks up the rate of its own stage
+    {
+        float x alignas(16)[4], ts alignas(16)[4], m alignas(16)[4];
+        int active = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto *o = v[i];
+            const Parameter *p = nullptr;
+            int id = 0;
+            switch (o->env_state)
+            {
+            case lfoeg_delay:
+                p = &lfo->delay;
+                id = o->idelay;
+                break;
+            case lfoeg_attack:
+                p = &lfo->attack;
+                id = o->iattack;
+                break;
+            case lfoeg_hold:
+                p = &lfo->hold;
+                id = o->ihold;
+                break;
+            case lfoeg_decay:
+                p = &lfo->decay;
+                id = o->idecay;
+                break;
+            case lfoeg_release:
+                p = &lfo->release;
+                id = o->irelease;
+                break;
+            }
+            x[i] = p ? o->localcopy[id].f : 0.f;
+            ts[i] = p && p->temposync ? o->storage->temposyncratio : 1.f;
+            m[i] = p ? 1.f : 0.f;
+            if (i < n && o->env_state != lfoeg_stuck && o->env_state != lfoeg_msegrelease)
+                active |= 1 << i;
+        }
+
+        if (active)
+        {
+            auto envrate = _mm_mul_ps(envelope_rate_linear_nowrap_ps(_mm_load_ps(x)),
+                                      _mm_load_ps(ts));
+            envrate = _mm_and_ps(_mm_cmpneq_ps(_mm_load_ps(m), _mm_setzero_ps()), envrate);
+            _mm_store_ps(x, _mm_add_ps(load(&LFOModulationSource::env_phase), envrate));
+
+            for (int i = 0; i < n; ++i)
+            {
+                if (!(active & (1 << i)))
+                    continue;
+                v[i]->env_phase = x[i];
+                if (v[i]->env_phase > 1.f)
+                    v[i]->envelopeStageDone(v[i]->localcopy[v[i]->isustain].f);
+            }
+
+            auto one = _mm_set1_ps(1.f);
+            auto ep = load(&LFOModulationSource::env_phase);
+            auto ev = load(&LFOModulationSource::env_val);
+            auto sustain = param(v[0]->isustain);
+            auto state = _mm_setr_epi32(v[0]->env_state, v[1]->env_state, v[2]->env_state,
+                                        v[3]->env_state);
+            auto is = [state](int st) {
+                return _mm_castsi128_ps(_mm_cmpeq_epi32(state, _mm_set1_epi32(st)));
+            };
+
+            ev = select_ps(is(lfoeg_delay), _mm_setzero_ps(), ev);
+            ev = select_ps(is(lfoeg_attack), ep, ev);
+            ev = select_ps(is(lfoeg_hold), one, ev);
+            ev = select_ps(is(lfoeg_decay),
+                           _mm_add_ps(_mm_sub_ps(one, ep), _mm_mul_ps(ep, sustain)), ev);
+            ev = select_ps(is(lfoeg_release),
+                           _mm_mul_ps(_mm_sub_ps(one, ep),
+                                      load(&LFOModulationSource::env_releasestart)),
+                           ev);
+
+            _mm_store_ps(x, ev);
+            for (int i = 0; i < n; ++i)
+                if (active & (1 << i))
+                    v[i]->env_val = x[i];
+        }
+    }
+
+    for (int i = 0; i < n; ++i)
+        if (v[i]->phase > 1 || v[i]->phase < 0)
+            v[i]->wrapPhase(s);
+
+    float useenvval alignas(16)[4];
+    for (int i = 0; i < 4; ++i)
+        useenvval[i] = v[i]->env_val;
+
+    // The shapes with a deform which stays in single precision run in the lanes
+    bool laneShape = s == lt_square;
+    if (s == lt_sine || s == lt_tri || s == lt_ramp || s == lt_envelope)
+        laneShape = lfo->deform.deform_type == type_1;
+    auto phase = load(&LFOModulationSource::phase);
+    auto deform = param(v[0]->ideform);
+    auto one = _mm_set1_ps(1.f);
+    __m128 iout;
+
+    if (!laneShape)
+    {
+        for (int i = 0; i < n; ++i)
+            v[i]->evaluateShape(s, frate[i], useenvval[i]);
+        iout = load(&LFOModulationSource::iout);
+    }
+    else if (s == lt_square)
+    {
+        auto flip = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_set1_ps(0.5f), deform));
+        iout = select_ps(_mm_cmpgt_ps(phase, flip), _mm_set1_ps(-1.f), one);
+    }
+    else if (s == lt_envelope)
+    {
+        iout = _mm_add_ps(_mm_sub_ps(one, deform),
+                          _mm_mul_ps(deform, load(&LFOModulationSource::env_val)));
+    }
+    else
+    {
+        if (s == lt_sine)
+        {
+            auto x = _mm_sub_ps(_mm_set1_ps(2.f), _mm_mul_ps(_mm_set1_ps(4.f), phase));
+            iout = lookup_waveshape_warp_ps(wst_sine, x);
+        }
+        else if (s == lt_tri)
+        {
+            auto x = select_ps(_mm_cmpgt_ps(phase, _mm_set1_ps(0.5f)), _mm_sub_ps(one, phase),
+                               phase);
+            iout = _mm_add_ps(_mm_set1_ps(-1.f), _mm_mul_ps(_mm_set1_ps(4.f), x));
+        }
+        else
+        {
+            iout = _mm_sub_ps(one, _mm_mul_ps(_mm_set1_ps(2.f), phase));
+        }
+
+        // bend1, twice
+        auto a = _mm_mul_ps(_mm_set1_ps(0.5f),
+                            limit_range_ps(deform, _mm_set1_ps(-3.f), _mm_set1_ps(3.f)));
+        for (int k = 0; k < 2; ++k)
+            iout = _mm_add_ps(_mm_sub_ps(iout, _mm_mul_ps(_mm_mul_ps(a, iout), iout)), a);
+    }
+
+    store(&LFOModulationSource::iout, iout);
+
+    auto io2 = iout;
+    if (lfo->unipolar.val.b)
+    {
+        if (s != lt_stepseq)
+            io2 = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_set1_ps(0.5f), io2));
+        else
+            io2 = _mm_andnot_ps(_mm_cmplt_ps(io2, _mm_setzero_ps()), io2);
+    }
+
+    auto magnitude = _mm_setr_ps(v[0]->magnitude(), v[1]->magnitude(), v[2]->magnitude(),
+                                 v[3]->magnitude());
+    store(&LFOModulationSource::output,
+          _mm_mul_ps(_mm_mul_ps(_mm_load_ps(useenvval), magnitude), io2));
 }
 
 void LFOModulationSource::completedModulation()
@@ -51,6 +51,16 @@ class LFOModulationSource : public ModulationSource
     virtual void process_block() override;
     virtual void completedModulation();
 
+    /*
+     * process_block for n LFOs of the same slot of one scene, one per voice, four voices at a
+     * time in SSE lanes. The phase, rate and envelope run in the lanes, as do the sine, triangle,
+     * ramp, square and envelope shapes; phase wraps, the random and step shapes and the bends
+     * which need double precision drop to the scalar code for just the lanes concerned, and MSEG
+     * LFOs are processed one by one. Formula LFOs run their script for every voice in a single
+     * call into Lua. The result is bit-identical to calling process_block on each.
+     */
+    static void process_block_batch(LFOModulationSource **lfos, int n);
+
     virtual const char *get_title() override { return "LFO"; }
     virtual int get_type() override { return mst_lfo; }
     virtual bool is_bipolar() override { return true; }
@@ -78,6 +88,23 @@ class LFOModulationSource : public ModulationSource
     void initPhaseFromStartPhase();
     void msegEnvelopePhaseAdjustment();
 
+    // The steps of process_block, shared with process_block_batch
+    float advanceBlock(int s);
+    void finishBlock(int s, float useenvval);
+    void startBlock();
+    float blockRate();
+    float envelopeRate();
+    void envelopeStageDone(float sustainlevel);
+    void updateEnvelope();
+    void wrapPhase(int s);
+    float deformed(float x);
+    void evaluateShape(int s, float frate, float &useenvval);
+    void prepareFormula();
+    void finishFormula(float &useenvval);
+    float magnitude();
+    static void process_block_lanes(LFOModulationSource **l, int n);
+    static void process_block_formula(LFOModulationSource **lfos, int n);
+
     float phase, target, noise, noised1, env_phase, priorPhase;
     int unwrappedphase_intpart;
     int priorStep = -1;
@@ -80,6 +80,18 @@ void rebuildCache(MSEGStorage *ms)
         constrainControlPointAt(ms, i);
     }
 
+    ms->indexedSegments = ms->n_activeSegments;
+    for (int i = 1; i < ms->n_activeSegments; ++i)
+    {
+        // written so that a NaN anywhere counts as out of order too
+        if (!(ms->segmentStart[i - 1] <= ms->segmentStart[i]) ||
+            !(ms->segmentEnd[i - 1] <= ms->segmentEnd[i]))
+        {
+            ms->indexedSegments = -1;
+            break;
+        }
+    }
+
     ms->durationToLoopEnd = ms->totalDuration;
     ms->durationLoopStartToLoopEnd = ms->totalDuration;
 
@@ -93,6 +105,62 @@ void rebuildCache(MSEGStorage *ms)
     }
 }
 
+/*
+ * The first segment with segmentStart <= t < segmentEnd, or <= segmentEnd if closed, or -1 if
+ * there is none.
+ *
+ * When rebuildCache found the starts and ends in order, segments ending before t form a prefix,
+ * so the first segment not ending before t is the only candidate. Usually that is the segment
+ * of the previous lookup or the one after; otherwise we bisect for it.
+ */
+static int findSegment(MSEGStorage *ms, double t, bool closed, int &cursor)
+{
+    int n = ms->n_activeSegments;
+
+    auto within = [ms, t, closed](int i) {
+        return ms->segmentStart[i] <= t &&
+               (closed ? t <= ms->segmentEnd[i] : t < ms->segmentEnd[i]);
+    };
+
+    if (ms->indexedSegments != n)
+    {
+        for (int i = 0; i < n; ++i)
+            if (within(i))
+                return i;
+        return -1;
+    }
+
+    auto endsBefore = [ms, t, closed](int i) {
+        return closed ? ms->segmentEnd[i] < t : ms->segmentEnd[i] <= t;
+    };
+
+    for (int c = cursor; c <= cursor + 1; ++c)
+    {
+        if (c >= 0 && c < n && within(c) && (c == 0 || endsBefore(c - 1)))
+        {
+            cursor = c;
+            return c;
+        }
+    }
+
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (endsBefore(mid))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < n && within(lo))
+    {
+        cursor = lo;
+        return lo;
+    }
+    return -1;
+}
+
 float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es, bool forceOneShot)
 {
     if (ms->n_activeSegments <= 0)
@@ -130,7 +198,7 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
         idx = timeToSegment(ms, up,
                             forceOneShot || ms->loopMode == MSEGStorage::ONESHOT ||
                                 ms->editMode == MSEGStorage::LFO,
-                            timeAlongSegment);
+                            timeAlongSegment, es->segmentCursor);
         if (idx < 0 || idx >= ms->n_activeSegments)
             return 0;
     }
@@ -150,10 +218,7 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
             double adjustedPhase = up - es->releaseStartPhase + ms->segmentEnd[ms->loop_end];
 
             // so now find the index
-            idx = -1;
-            for (int ai = 0; ai < ms->n_activeSegments && idx < 0; ai++)
-                if (ms->segmentStart[ai] <= adjustedPhase && ms->segmentEnd[ai] > adjustedPhase)
-                    idx = ai;
+            idx = findSegment(ms, adjustedPhase, false, es->segmentCursor);
             if (idx < 0)
             {
                 return ms->segments[ms->n_activeSegments - 1].nv1; // We are past the end
@@ -624,6 +689,13 @@ int timeToSegment(MSEGStorage *ms, double t)
 }
 
 int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlongSegment)
+{
+    int cursor = 0;
+    return timeToSegment(ms, t, ignoreLoops, amountAlongSegment, cursor);
+}
+
+int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlongSegment,
+                  int &cursor)
 {
     if (ms->totalDuration < MSEGStorage::minimumDuration)
         return -1;
@@ -638,16 +710,9 @@ int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlon
                 t += ms->totalDuration;
         }
 
-        int idx = -1;
-        for (int i = 0; i < ms->n_activeSegments; ++i)
-        {
-            if (t >= ms->segmentStart[i] && t < ms->segmentEnd[i])
-            {
-                idx = i;
-                amountAlongSegment = t - ms->segmentStart[i];
-                break;
-            }
-        }
+        int idx = findSegment(ms, t, false, cursor);
+        if (idx >= 0)
+            amountAlongSegment = t - ms->segmentStart[idx];
 
         return idx;
     }
@@ -659,12 +724,12 @@ int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlon
         // So are we before the first loop end point
         if (t <= ms->durationToLoopEnd)
         {
-            for (int i = 0; i < ms->n_activeSegments; ++i)
-                if (t >= ms->segmentStart[i] && t <= ms->segmentEnd[i])
-                {
-                    amountAlongSegment = t - ms->segmentStart[i];
-                    return i;
-                }
+            int idx = findSegment(ms, t, true, cursor);
+            if (idx >= 0)
+            {
+                amountAlongSegment = t - ms->segmentStart[idx];
+                return idx;
+            }
         }
         else if (ms->loop_start > ms->loop_end && ms->loop_start >= 0 && ms->loop_end >= 0)
         {
@@ -686,12 +751,12 @@ int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlon
             // and we need to offset it by the starting point
             nt += ms->segmentStart[ls];
 
-            for (int i = 0; i < ms->n_activeSegments; ++i)
-                if (nt >= ms->segmentStart[i] && nt <= ms->segmentEnd[i])
-                {
-                    amountAlongSegment = nt - ms->segmentStart[i];
-                    return i;
-                }
+            int idx = findSegment(ms, nt, true, cursor);
+            if (idx >= 0)
+            {
+                amountAlongSegment = nt - ms->segmentStart[idx];
+                return idx;
+            }
         }
 
         return 0;
@@ -18,6 +18,8 @@ struct EvaluatorState
         urd = std::uniform_real_distribution<float>(-1.0, 1.0);
     }
     int lastEval = -1;
+    // Where timeToSegment last found the phase; the next lookup usually lands here or just after
+    int segmentCursor = 0;
     float lastOutput = 0;
     float msegState[6] = {0};
     bool released = false, retrigger_FEG = false, retrigger_AEG = false;
@@ -41,6 +43,9 @@ float valueAt(int phaseIntPart, float phaseFracPart, float deform, MSEGStorage *
 */
 int timeToSegment(MSEGStorage *ms, double t); // these are double to deal with very long phases
 int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &timeAlongSegment);
+// As above, starting the search from cursor and leaving it at the segment found
+int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &timeAlongSegment,
+                  int &cursor);
 void changeTypeAt(MSEGStorage *ms, float t, MSEGStorage::segment::Type type);
 void insertAfter(MSEGStorage *ms, float t);
 void insertBefore(MSEGStorage *ms, float t);
@@ -14,23 +14,25 @@
 */
 
 #include "TwistOscillator.h"
+#include "Oscillator.h"
 #include "DebugHelpers.h"
 
-#define TEST
-#ifndef _MSC_VER
-#pragma GCC diagnostic push
-#ifndef __clang__
-#pragma GCC diagnostic ignored "-Wsuggest-override"
-#endif
-#endif
-#include "plaits/dsp/voice.h"
-
+#if SAMPLERATE_SRC
 #include "samplerate.h"
+#endif
 
 #if SAMPLERATE_LANCZOS
 #include "LanczosResampler.h"
 #endif
 
+Oscillator *spawn_twist_osc(SurgeStorage *storage, OscillatorStorage *oscdata, pdata *localcopy,
+                            unsigned char *onto)
+{
+    return OscSpawner<TwistOscillator>::make(storage, oscdata, localcopy, onto);
+}
+
+size_t twist_osc_size() { return sizeof(TwistOscillator); }
+
 std::string twist_engine_name(int i)
 {
     switch (i)
@@ -274,26 +276,20 @@ TwistOscillator::TwistOscillator(SurgeStorage *storage, OscillatorStorage *oscda
       lancRes(48000, dsamplerate_os)
 #endif
 {
-    voice = std::make_unique<plaits::Voice>();
-    alloc = std::make_unique<stmlib::BufferAllocator>(shared_buffer, sizeof(shared_buffer));
-    voice->Init(alloc.get());
-    patch = std::make_unique<plaits::Patch>();
-    mod = std::make_unique<plaits::Modulations>();
+    alloc.Init(shared_buffer, sizeof(shared_buffer));
+    voice.Init(&alloc);
 
+#if SAMPLERATE_SRC
     int error;
     srcstate = src_new(SRC_SINC_FASTEST, 2, &error);
-    // srcstate = src_new(SRC_LINEAR, 2, &error);
     if (error != 0)
     {
         srcstate = nullptr;
     }
+#endif
 
     // FM downsampling with a linear interpolator is absolutely fine
-    fmdownsamplestate = src_new(SRC_LINEAR, 1, &error);
-    if (error != 0)
-    {
-        fmdownsamplestate = nullptr;
-    }
+    fmDownsampler.init(dsamplerate_os, 48000.0);
 }
 
 float TwistOscillator::tuningAwarePitch(float pitch)
@@ -316,8 +312,8 @@ void TwistOscillator::init(float pitch, bool is_display, bool nonzero_drift)
     charFilt.init(storage->getPatch().character.val.i);
 
     float tpitch = tuningAwarePitch(pitch);
-    memset((void *)patch.get(), 0, sizeof(plaits::Patch));
-    memset((void *)mod.get(), 0, sizeof(plaits::Modulations));
+    memset((void *)&patch, 0, sizeof(plaits::Patch));
+    memset((void *)&mod, 0, sizeof(plaits::Modulations));
 
     driftLFO.init(nonzero_drift);
 
@@ -336,16 +332,16 @@ void TwistOscillator::init(float pitch, bool is_display, bool nonzero_drift)
     memset(fmlagbuffer, 0, (BLOCK_SIZE_OS << 1) * sizeof(float));
     fmrp = 0;
     fmwp = (int)(BLOCK_SIZE_OS * 48000 * dsamplerate_os_inv);
+    fmDownsampler.init(dsamplerate_os, 48000.0);
 
     process_block_internal<false, true>(pitch, 0, false, 0, std::ceil(cycleInSamples));
 }
 TwistOscillator::~TwistOscillator()
 {
+#if SAMPLERATE_SRC
     if (srcstate)
         srcstate = src_delete(srcstate);
-
-    if (fmdownsamplestate)
-        fmdownsamplestate = src_delete(fmdownsamplestate);
+#endif
 }
 
 template <bool FM> inline constexpr int getBlockSize() { return 4; }
@@ -356,17 +352,16 @@ template <bool FM, bool throwaway>
 void TwistOscillator::process_block_internal(float pitch, float drift, bool stereo, float FMdepth,
                                              int throwawayBlocks)
 {
+#if SAMPLERATE_SRC
     if (!srcstate)
         return;
-
-    if (FM && !fmdownsamplestate)
-        return;
+#endif
 
     pitch = tuningAwarePitch(pitch);
 
     auto driftv = driftLFO.next();
-    patch->note = pitch + drift * driftv;
-    patch->engine = oscdata->p[twist_engine].val.i;
+    patch.note = pitch + drift * driftv;
+    patch.engine = oscdata->p[twist_engine].val.i;
 
     harm.newValue(fvbp(twist_harmonics));
     timb.newValue(fvbp(twist_timbre));
@@ -390,14 +385,8 @@ void TwistOscillator::process_block_internal(float pitch, float drift, bool ster
     if (FM)
     {
         float dsmaster[BLOCK_SIZE_OS << 2];
-        SRC_DATA fmdata;
-        fmdata.end_of_input = 0;
-        fmdata.src_ratio = 48000.0 / dsamplerate_os; // going INTO the plaits rate
-        fmdata.data_in = master_osc;
-        fmdata.data_out = &(dsmaster[0]);
-        fmdata.input_frames = BLOCK_SIZE_OS;
-        fmdata.output_frames = BLOCK_SIZE_OS << 2;
-        src_process(fmdownsamplestate, &fmdata);
+        // going INTO the plaits rate
+        auto dsgen = fmDownsampler.process(master_osc, BLOCK_SIZE_OS, dsmaster, BLOCK_SIZE_OS << 2);
 
         const float bl = -143.5, bhi = 71.7, oos = 1.0 / (bhi - bl);
         float adb = limit_range(amp_to_db(FMdepth), bl, bhi);
@@ -405,7 +394,7 @@ void TwistOscillator::process_block_internal(float pitch, float drift, bool ster
 
         normFMdepth = limit_range(nfm, 0.f, 1.f);
 
-        for (int i = 0; i < fmdata.output_frames_gen; ++i)
+        for (int i = 0; i < dsgen; ++i)
         {
             fmlagbuffer[fmwp] = dsmaster[i];
             fmwp = (fmwp + 1) & ((BLOCK_SIZE_OS << 1) - 1);
@@ -439,18 +428,18 @@ void TwistOscillator::process_block_internal(float pitch, float drift, bool ster
 
     if (lpgIsOn)
     {
-        mod->trigger = gate ? 1.0 : 0.0;
-        mod->trigger_patched = true;
+        mod.trigger = gate ? 1.0 : 0.0;
+        mod.trigger_patched = true;
     }
 
     while (total_generated < required_blocks)
     {
         plaits::Voice::Frame poutput[subblock];
-        patch->harmonics = harm.v;
-        patch->timbre = timb.v;
-        patch->morph = morph.v;
-        patch->decay = lpgdec.v;
-        patch->lpg_colour = lpgcol.v;
+        patch.harmonics = harm.v;
+        patch.timbre = timb.v;
+        patch.morph = morph.v;
+        patch.decay = lpgdec.v;
+        patch.lpg_colour = lpgcol.v;
 
         harm.process();
         timb.process();
@@ -463,18 +452,18 @@ void TwistOscillator::process_block_internal(float pitch, float drift, bool ster
 
         if (FM)
         {
-            mod->frequency_patched = true;
-            mod->frequency = 137 * fmlagbuffer[fmrp]; // this is in 'notes'
+            mod.frequency_patched = true;
+            mod.frequency = 137 * fmlagbuffer[fmrp]; // this is in 'notes'
             fmrp = (fmrp + 1) & ((BLOCK_SIZE_OS << 1) - 1);
-            patch->frequency_modulation_amount = normFMdepth;
+            patch.frequency_modulation_amount = normFMdepth;
         }
         else
         {
-            mod->frequency_patched = false;
-            patch->frequency_modulation_amount = 0;
+            mod.frequency_patched = false;
+            patch.frequency_modulation_amount = 0;
         }
 
-        voice->Render(*patch, *mod, poutput, subblock);
+        voice.Render(patch, mod, poutput, subblock);
 
 #if SAMPLERATE_LANCZOS
         for (int i = 0; i < subblock; ++i)
@@ -29,19 +29,34 @@
 #include "LanczosResampler.h"
 #endif
 
-namespace plaits
-{
-class Voice;
-class Patch;
-class Modulations;
-} // namespace plaits
-
-namespace stmlib
-{
-class BufferAllocator;
-}
+/*
+ * The plaits objects are held by value (rather than behind unique_ptrs) so that constructing a
+ * TwistOscillator in a voice's oscillator block doesn't touch the heap. That needs plaits here,
+ * so only TwistOscillator.cpp includes this header; everything else spawns and sizes a Twist
+ * through spawn_twist_osc and twist_osc_size in Oscillator.h.
+ */
+#ifndef TEST
+#define TEST
+#define SURGE_TWIST_DEFINED_TEST
+#endif
+#ifndef _MSC_VER
+#pragma GCC diagnostic push
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wsuggest-override"
+#endif
+#endif
+#include "plaits/dsp/voice.h"
+#ifndef _MSC_VER
+#pragma GCC diagnostic pop
+#endif
+#ifdef SURGE_TWIST_DEFINED_TEST
+#undef TEST
+#undef SURGE_TWIST_DEFINED_TEST
+#endif
 
+#if SAMPLERATE_SRC
 struct SRC_STATE_tag;
+#endif
 
 class TwistOscillator : public Oscillator
 {
@@ -79,14 +94,51 @@ class TwistOscillator : public Oscillator
         return clamp01((localcopy[oscdata->p[ps].param_id_in_scene].f + 1) * 0.5f);
     }
 
-    std::unique_ptr<plaits::Voice> voice;
-    std::unique_ptr<plaits::Patch> patch;
-    std::unique_ptr<plaits::Modulations> mod;
-    std::unique_ptr<stmlib::BufferAllocator> alloc;
+    plaits::Voice voice;
+    plaits::Patch patch;
+    plaits::Modulations mod;
+    stmlib::BufferAllocator alloc;
     char shared_buffer[16834];
 
-    // Keep this here for now even if using lanczos since I'm using SRC for FM still
-    SRC_STATE_tag *srcstate, *fmdownsamplestate;
+#if SAMPLERATE_SRC
+    SRC_STATE_tag *srcstate;
+#endif
+
+    /*
+     * The FM input only needs linear interpolation down to the plaits rate. This used to be a
+     * libsamplerate SRC_LINEAR state, but src_new allocates, so we carry the few bytes of state
+     * it needs ourselves.
+     */
+    struct LinearDownsampler
+    {
+        double step = 1.0; // input samples per output sample
+        double pos = -1.0; // read position; -1 is the last sample of the previous block
+        float last = 0.f;
+
+        void init(double inRate, double outRate)
+        {
+            step = inRate / outRate;
+            pos = -1.0;
+            last = 0.f;
+        }
+
+        int process(const float *in, int nIn, float *out, int maxOut)
+        {
+            int nOut = 0;
+            while (nOut < maxOut && pos < nIn - 1)
+            {
+                int idx = (int)std::floor(pos);
+                float frac = (float)(pos - idx);
+                float a = idx < 0 ? last : in[idx];
+                float b = in[idx + 1];
+                out[nOut++] = a + frac * (b - a);
+                pos += step;
+            }
+            pos -= nIn;
+            last = in[nIn - 1];
+            return nOut;
+        }
+    } fmDownsampler;
     float fmlagbuffer[BLOCK_SIZE_OS << 1];
     int fmwp, fmrp;
 
@@ -387,6 +387,14 @@ template <bool is_init> void WavetableOscillator::update_lagvals()
 void WavetableOscillator::process_block(float pitch0, float drift, bool stereo, bool FM,
                                         float depth)
 {
+    // A first table may still be with the WavetableLoader; play silence until it arrives
+    if (!oscdata->wt.everBuilt)
+    {
+        memset(output, 0, BLOCK_SIZE_OS * sizeof(float));
+        memset(outputR, 0, BLOCK_SIZE_OS * sizeof(float));
+        return;
+    }
+
     pitch_last = pitch_t;
     pitch_t = min(148.f, pitch0);
     pitchmult_inv =
@@ -346,6 +346,14 @@ void WindowOscillator::ProcessWindowOscs(bool stereo, bool FM)
 
 void WindowOscillator::process_block(float pitch, float drift, bool stereo, bool FM, float fmdepth)
 {
+    // As in the wavetable oscillator, nothing to play until the loader delivers a first table
+    if (!oscdata->wt.everBuilt)
+    {
+        memset(output, 0, BLOCK_SIZE_OS * sizeof(float));
+        memset(outputR, 0, BLOCK_SIZE_OS * sizeof(float));
+        return;
+    }
+
     memset(IOutputL, 0, BLOCK_SIZE_OS * sizeof(int));
 
     if (stereo)
@@ -13,6 +13,23 @@ template <typename T> inline T limit_range(const T &x, const T &low, const T &hi
 template <typename T> inline T limit01(const T &x) { return limit_range(x, (T)0, (T)1); }
 template <typename T> inline T limitpm1(const T &x) { return limit_range(x, (T)-1, (T)1); }
 
+// mask ? a : b, lane by lane
+inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// limit_range on four floats, down to what comes out for a NaN or for crossed bounds
+inline __m128 limit_range_ps(__m128 x, __m128 low, __m128 high)
+{
+#if __cplusplus > 201402L
+    return select_ps(_mm_cmplt_ps(x, low), low, select_ps(_mm_cmplt_ps(high, x), high, x));
+#else
+    x = select_ps(_mm_cmplt_ps(x, low), low, x);
+    return select_ps(_mm_cmplt_ps(high, x), high, x);
+#endif
+}
+
 void hardclip_block(float *x, unsigned int nquads);
 void hardclip_block8(float *x, unsigned int nquads);
 void softclip_block(float *in, unsigned int nquads);
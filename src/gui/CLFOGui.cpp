@@ -24,6 +24,7 @@
 #include "StringOps.h"
 #include <cstdint>
 #include "RuntimeFont.h"
+#include "UIInstrumentation.h"
 
 using namespace VSTGUI;
 using namespace std;
@@ -57,8 +58,337 @@ void CLFOGui::drawtri(CRect r, CDrawContext *dc, int orientation)
     dc->drawPolygon(pl, kDrawFilled);
 }
 
+/*
+ * A copy of everything the simulated LFO reads, so it can run on the preview worker while the
+ * originals keep being edited.
+ */
+struct LFOPreviewInputs
+{
+    SurgeStorage *storage = nullptr;
+    const LFOStorage *source = nullptr;
+    LFOStorage lfo, fullWaveLfo;
+    pdata tp[n_scene_params], tpd[n_scene_params];
+    StepSequencerStorage ss;
+    MSEGStorage ms;
+    FormulaModulatorStorage fs;
+
+    bool hasFullWave = false;
+    float susTime = 0.5;
+    int totalSamples = 0, averagingWindow = 1;
+
+    // The step sequencer display only
+    float cycleSamples = 1, valScale = 100;
+
+    LFOPreviewInputs(SurgeStorage *storage, LFOStorage *lfodata, StepSequencerStorage *ss,
+                     MSEGStorage *ms, FormulaModulatorStorage *fs)
+        : storage(storage), source(lfodata), lfo(*lfodata), fullWaveLfo(*lfodata), ss(*ss),
+          ms(*ms), fs(*fs)
+    {
+    }
+
+    /*
+     * Everything above which can change the picture. The family is the part we would rather not
+     * see an old picture of while the new one is made.
+     */
+    void hash(Surge::GUI::PreviewHash &family, Surge::GUI::PreviewHash &ph) const
+    {
+        family.add(source).add(lfo.shape.val.i);
+        ph = family;
+        for (auto *c = &lfo.rate; c <= &lfo.release; ++c)
+        {
+            ph.add(c->val.i).add(c->deform_type).add(c->extend_range).add(c->absolute);
+            ph.add(c->temposync).add(c->deactivated);
+        }
+        ph.add(samplerate).add(storage->temposyncratio).add(hasFullWave);
+        ph.add(fullWaveLfo.rate.val.i).add(fullWaveLfo.magnitude.val.i).add(susTime);
+        ph.add(totalSamples).add(averagingWindow).add(cycleSamples).add(valScale);
+
+        switch (lfo.shape.val.i)
+        {
+        case lt_stepseq:
+            ph.addBytes(ss.steps, sizeof(ss.steps));
+            ph.add(ss.loop_start).add(ss.loop_end).add(ss.shuffle).add(ss.trigmask);
+            break;
+        case lt_mseg:
+            ph.add(ms.endpointMode).add(ms.editMode).add(ms.loopMode);
+            ph.add(ms.loop_start).add(ms.loop_end).add(ms.n_activeSegments);
+            for (int i = 0; i < ms.n_activeSegments; ++i)
+            {
+                auto &sg = ms.segments[i];
+                ph.add(sg.duration).add(sg.v0).add(sg.cpduration).add(sg.cpv).add(sg.type);
+                ph.add(sg.useDeform).add(sg.invertDeform);
+            }
+            break;
+        case lt_formula:
+            ph.add(fs.formulaString);
+            break;
+        }
+    }
+};
+
+// The waveform, envelope and full wave of the main display, in [0, 100] coordinates
+static void simulateLFO(LFOPreviewInputs &in, Surge::GUI::Preview &out)
+{
+    auto *lfodata = &in.lfo;
+
+    LFOModulationSource *tlfo = new LFOModulationSource();
+    LFOModulationSource *tFullWave = nullptr;
+    tlfo->assign(in.storage, lfodata, in.tp, 0, &in.ss, &in.ms, &in.fs, true);
+    tlfo->attack();
+
+    if (in.hasFullWave)
+    {
+        tFullWave = new LFOModulationSource();
+        tFullWave->assign(in.storage, &in.fullWaveLfo, in.tpd, 0, &in.ss, &in.ms, &in.fs, true);
+        tFullWave->attack();
+    }
+
+    int totalSamples = in.totalSamples;
+    int averagingWindow = in.averagingWindow;
+    float susTime = in.susTime;
+    auto &path = out.wave;
+    auto &deactPath = out.fullWave;
+    auto &eupath = out.envelopeUp;
+    auto &edpath = out.envelopeDown;
+
+    float valScale = 100.0;
+    int susCountdown = -1;
+
+    float priorval = 0.f, priorwval = 0.f;
+    for (int i = 0; i < totalSamples; i += averagingWindow)
+    {
+        float val = 0;
+        float wval = 0;
+        float eval = 0;
+        float minval = 1000000, minwval = 1000000;
+        float maxval = -1000000, maxwval = -1000000;
+        float firstval;
+        float lastval;
+        for (int s = 0; s < averagingWindow; s++)
+        {
+            tlfo->process_block();
+            if (tFullWave)
+                tFullWave->process_block();
+            if (susCountdown < 0 && tlfo->env_state == lfoeg_stuck)
+            {
+                susCountdown = susTime * samplerate / BLOCK_SIZE;
+            }
+            else if (susCountdown == 0 && tlfo->env_state == lfoeg_stuck)
+            {
+                tlfo->release();
+                if (tFullWave)
+                    tFullWave->release();
+            }
+            else if (susCountdown > 0)
+            {
+                susCountdown--;
+            }
+
+            val += tlfo->output;
+            if (tFullWave)
+            {
+                auto v = tFullWave->output;
+                minwval = std::min(v, minwval);
+                maxwval = std::max(v, maxwval);
+                wval += v;
+            }
+            if (s == 0)
+                firstval = tlfo->output;
+            if (s == averagingWindow - 1)
+                lastval = tlfo->output;
+            minval = std::min(tlfo->output, minval);
+            maxval = std::max(tlfo->output, maxval);
+            eval += tlfo->env_val * lfodata->magnitude.get_extended(lfodata->magnitude.val.f);
+        }
+        val = val / averagingWindow;
+        wval = wval / averagingWindow;
+        eval = eval / averagingWindow;
+        val = ((-val + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+        wval = ((-wval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+        minwval = ((-minwval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+        maxwval = ((-maxwval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+        float euval = ((-eval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+        float edval = ((eval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+
+        float xc = valScale * i / totalSamples;
+
+        if (i == 0)
+        {
+            path.beginSubpath(xc, val);
+            eupath.beginSubpath(xc, euval);
+            if ((lfodata->unipolar.val.b == false) && (lfodata->shape.val.i != lt_envelope))
+                edpath.beginSubpath(xc, edval);
+            if (tFullWave)
+            {
+                deactPath.beginSubpath(xc, wval);
+            }
+            priorval = val;
+            priorwval = wval;
+        }
+        else
+        {
+            minval = ((-minval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+            maxval = ((-maxval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
+            // Windows is sensitive to out-of-order line draws in a way which causes spikes.
+            // Make sure we draw one closest to prior first. See #1438
+            float firstval = minval;
+            float secondval = maxval;
+            if (priorval - minval < maxval - priorval)
+            {
+                firstval = maxval;
+                secondval = minval;
+            }
+            path.addLine(xc - 0.1 * valScale / totalSamples, firstval);
+            path.addLine(xc + 0.1 * valScale / totalSamples, secondval);
+
+            priorval = val;
+            eupath.addLine(xc, euval);
+            edpath.addLine(xc, edval);
+
+            // We can skip the ordering thing since we know we have set rate here to a low rate
+            if (tFullWave)
+            {
+                firstval = minwval;
+                secondval = maxwval;
+                if (priorwval - minwval < maxwval - priorwval)
+                {
+                    firstval = maxwval;
+                    secondval = minwval;
+                }
+                deactPath.addLine(xc - 0.1 * valScale / totalSamples, firstval);
+                deactPath.addLine(xc + 0.1 * valScale / totalSamples, secondval);
+                priorwval = wval;
+            }
+        }
+    }
+    if (lfodata->shape.val.i == lt_formula)
+    {
+        out.drawEnvelope = tlfo->formulastate.useEnvelope;
+    }
+    tlfo->completedModulation();
+    delete tlfo;
+    if (tFullWave)
+    {
+        tFullWave->completedModulation();
+        delete tFullWave;
+    }
+}
+
+// The waveform and envelope under the steps, in [0, in.valScale] coordinates
+static void simulateStepSeqLFO(LFOPreviewInputs &in, Surge::GUI::Preview &out)
+{
+    auto *lfodata = &in.lfo;
+
+    LFOModulationSource *tlfo = new LFOModulationSource();
+    tlfo->assign(in.storage, lfodata, in.tp, 0, &in.ss, &in.ms, &in.fs, true);
+    tlfo->attack();
+
+    int totalSamples = in.totalSamples;
+    int averagingWindow = in.averagingWindow;
+    float susTime = in.susTime;
+    float valScale = in.valScale;
+    auto &path = out.wave;
+    auto &eupath = out.envelopeUp;
+    auto &edpath = out.envelopeDown;
+
+    int susCountdown = -1;
+
+    for (int i = 0; i < totalSamples; i += averagingWindow)
+    {
+        float val = 0;
+        float eval = 0;
+        float minval = 1000000;
+        float maxval = -1000000;
+        float firstval;
+        float lastval;
+        for (int s = 0; s < averagingWindow; s++)
+        {
+            tlfo->process_block();
+            if (susCountdown < 0 && tlfo->env_state == lfoeg_stuck)
+            {
+                susCountdown = susTime * samplerate / BLOCK_SIZE;
+            }
+            else if (susCountdown == 0 && tlfo->env_state == lfoeg_stuck)
+            {
+                tlfo->release();
+            }
+            else if (susCountdown > 0)
+            {
+                susCountdown--;
+            }
+
+            val += tlfo->output;
+            if (s == 0)
+                firstval = tlfo->output;
+            if (s == averagingWindow - 1)
+                lastval = tlfo->output;
+            minval = std::min(tlfo->output, minval);
+            maxval = std::max(tlfo->output, maxval);
+            eval += tlfo->env_val * lfodata->magnitude.get_extended(lfodata->magnitude.val.f);
+        }
+        val = val / averagingWindow;
+        eval = eval / averagingWindow;
+
+        if (lfodata->unipolar.val.b)
+            val = val * 2.0 - 1.0;
+
+        val = ((-val + 1.0f) * 0.5) * valScale;
+        float euval = ((-eval + 1.0f) * 0.5) * valScale;
+        float edval = ((eval + 1.0f) * 0.5) * valScale;
+
+        float xc = valScale * i / (in.cycleSamples * n_stepseqsteps);
+        if (i == 0)
+        {
+            path.beginSubpath(xc, val);
+            eupath.beginSubpath(xc, euval);
+            if (!lfodata->unipolar.val.b)
+                edpath.beginSubpath(xc, edval);
+        }
+        else
+        {
+            path.addLine(xc, val);
+            eupath.addLine(xc, euval);
+            edpath.addLine(xc, edval);
+        }
+    }
+    delete tlfo;
+}
+
+std::shared_ptr<const Surge::GUI::Preview>
+CLFOGui::getPreview(std::shared_ptr<LFOPreviewInputs> in,
+                    void (*simulate)(LFOPreviewInputs &, Surge::GUI::Preview &))
+{
+    Surge::GUI::PreviewHash family, ph;
+    in->hash(family, ph);
+
+    // Own the inputs through the job, since it may outlive this paint
+    auto job = [in, simulate](Surge::GUI::Preview &p) { simulate(*in, p); };
+
+    if (!previewCache)
+    {
+        auto p = std::make_shared<Surge::GUI::Preview>();
+        job(*p);
+        return p;
+    }
+
+    bool current = false;
+    auto res = previewCache->get(Surge::GUI::PreviewCache::LFO, ph.h, family.h, job, current);
+#ifdef INSTRUMENT_UI
+    Surge::Debug::record(current ? "CLFOGui::draw cached preview"
+                         : res   ? "CLFOGui::draw older preview while refilling"
+                                 : "CLFOGui::draw preview computed on paint");
+#endif
+    if (!res)
+        res = previewCache->compute(Surge::GUI::PreviewCache::LFO, ph.h, family.h, job);
+    return res;
+}
+
 void CLFOGui::draw(CDrawContext *dc)
 {
+#ifdef INSTRUMENT_UI
+    Surge::Debug::TimeThisBlock tb("CLFOGui::draw");
+#endif
+
     assert(lfodata);
     assert(storage);
     assert(ss);
@@ -87,12 +417,9 @@ void CLFOGui::draw(CDrawContext *dc)
     else
     {
         bool drawBeats = false;
-        CGraphicsPath *path = dc->createGraphicsPath();
-        CGraphicsPath *deactPath = dc->createGraphicsPath();
-        CGraphicsPath *eupath = dc->createGraphicsPath();
-        CGraphicsPath *edpath = dc->createGraphicsPath();
-
-        pdata tp[n_scene_params], tpd[n_scene_params];
+        auto in = std::make_shared<LFOPreviewInputs>(storage, lfodata, ss, ms, fs);
+        auto &tp = in->tp;
+        auto &tpd = in->tpd;
         {
             tp[lfodata->delay.param_id_in_scene].i = lfodata->delay.val.i;
             tp[lfodata->attack.param_id_in_scene].i = lfodata->attack.val.i;
@@ -144,17 +471,11 @@ void CLFOGui::draw(CDrawContext *dc)
             lfoEnvelopeDAHDTime + std::min(pow(2.0f, lfodata->release.val.f), 4.f) +
             0.5; // susTime; this is now 0.5 to keep the envelope fixed in gate mode
 
-        LFOModulationSource *tlfo = new LFOModulationSource();
-        LFOModulationSource *tFullWave = nullptr;
-        tlfo->assign(storage, lfodata, tp, 0, ss, ms, fs, true);
-        tlfo->attack();
-
-        LFOStorage deactivateStorage;
+        LFOStorage &deactivateStorage = in->fullWaveLfo;
         bool hasFullWave = false, waveIsAmpWave = false;
         if (lfodata->rate.deactivated)
         {
             hasFullWave = true;
-            memcpy((void *)(&deactivateStorage), (void *)lfodata, sizeof(LFOStorage));
             memcpy((void *)tpd, (void *)tp, n_scene_params * sizeof(pdata));
 
             auto desiredRate = log2(1.f / totalEnvTime);
@@ -168,9 +489,6 @@ void CLFOGui::draw(CDrawContext *dc)
             deactivateStorage.start_phase.val.f = 0;
             tpd[lfodata->start_phase.param_id_in_scene].f = 0;
             tpd[lfodata->rate.param_id_in_scene].f = desiredRate;
-            tFullWave = new LFOModulationSource();
-            tFullWave->assign(storage, &deactivateStorage, tpd, 0, ss, ms, fs, true);
-            tFullWave->attack();
         }
         else if (lfodata->magnitude.val.f != lfodata->magnitude.val_max.f &&
                  skin->getVersion() >= 2)
@@ -181,14 +499,10 @@ void CLFOGui::draw(CDrawContext *dc)
             {
                 hasFullWave = true;
                 waveIsAmpWave = true;
-                memcpy((void *)(&deactivateStorage), (void *)lfodata, sizeof(LFOStorage));
                 memcpy((void *)tpd, (void *)tp, n_scene_params * sizeof(pdata));
 
                 deactivateStorage.magnitude.val.f = 1.f;
                 tpd[lfodata->magnitude.param_id_in_scene].f = 1.f;
-                tFullWave = new LFOModulationSource();
-                tFullWave->assign(storage, &deactivateStorage, tpd, 0, ss, ms, fs, true);
-                tFullWave->attack();
             }
         }
         CRect boxo(maindisp);
@@ -218,126 +532,22 @@ void CLFOGui::draw(CDrawContext *dc)
         int averagingWindow = (int)(totalSamples / 1000.0) + 1;
 
         float valScale = 100.0;
-        int susCountdown = -1;
 
-        float priorval = 0.f, priorwval = 0.f;
-        for (int i = 0; i < totalSamples; i += averagingWindow)
-        {
-            float val = 0;
-            float wval = 0;
-            float eval = 0;
-            float minval = 1000000, minwval = 1000000;
-            float maxval = -1000000, maxwval = -1000000;
-            float firstval;
-            float lastval;
-            for (int s = 0; s < averagingWindow; s++)
-            {
-                tlfo->process_block();
-                if (tFullWave)
-                    tFullWave->process_block();
-                if (susCountdown < 0 && tlfo->env_state == lfoeg_stuck)
-                {
-                    susCountdown = susTime * samplerate / BLOCK_SIZE;
-                }
-                else if (susCountdown == 0 && tlfo->env_state == lfoeg_stuck)
-                {
-                    tlfo->release();
-                    if (tFullWave)
-                        tFullWave->release();
-                }
-                else if (susCountdown > 0)
-                {
-                    susCountdown--;
-                }
+        in->hasFullWave = hasFullWave;
+        in->susTime = susTime;
+        in->totalSamples = totalSamples;
+        in->averagingWindow = averagingWindow;
+        auto preview = getPreview(in, simulateLFO);
 
-                val += tlfo->output;
-                if (tFullWave)
-                {
-                    auto v = tFullWave->output;
-                    minwval = std::min(v, minwval);
-                    maxwval = std::max(v, maxwval);
-                    wval += v;
-                }
-                if (s == 0)
-                    firstval = tlfo->output;
-                if (s == averagingWindow - 1)
-                    lastval = tlfo->output;
-                minval = std::min(tlfo->output, minval);
-                maxval = std::max(tlfo->output, maxval);
-                eval += tlfo->env_val * lfodata->magnitude.get_extended(lfodata->magnitude.val.f);
-            }
-            val = val / averagingWindow;
-            wval = wval / averagingWindow;
-            eval = eval / averagingWindow;
-            val = ((-val + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-            wval = ((-wval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-            minwval = ((-minwval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-            maxwval = ((-maxwval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-            float euval = ((-eval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-            float edval = ((eval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-
-            float xc = valScale * i / totalSamples;
-
-            if (i == 0)
-            {
-                path->beginSubpath(xc, val);
-                eupath->beginSubpath(xc, euval);
-                if ((lfodata->unipolar.val.b == false) && (lfodata->shape.val.i != lt_envelope))
-                    edpath->beginSubpath(xc, edval);
-                if (tFullWave)
-                {
-                    deactPath->beginSubpath(xc, wval);
-                }
-                priorval = val;
-                priorwval = wval;
-            }
-            else
-            {
-                minval = ((-minval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-                maxval = ((-maxval + 1.0f) * 0.5 * 0.8 + 0.1) * valScale;
-                // Windows is sensitive to out-of-order line draws in a way which causes spikes.
-                // Make sure we draw one closest to prior first. See #1438
-                float firstval = minval;
-                float secondval = maxval;
-                if (priorval - minval < maxval - priorval)
-                {
-                    firstval = maxval;
-                    secondval = minval;
-                }
-                path->addLine(xc - 0.1 * valScale / totalSamples, firstval);
-                path->addLine(xc + 0.1 * valScale / totalSamples, secondval);
-
-                priorval = val;
-                eupath->addLine(xc, euval);
-                edpath->addLine(xc, edval);
-
-                // We can skip the ordering thing since we know we have set rate here to a low rate
-                if (tFullWave)
-                {
-                    firstval = minwval;
-                    secondval = maxwval;
-                    if (priorwval - minwval < maxwval - priorwval)
-                    {
-                        firstval = maxwval;
-                        secondval = minwval;
-                    }
-                    deactPath->addLine(xc - 0.1 * valScale / totalSamples, firstval);
-                    deactPath->addLine(xc + 0.1 * valScale / totalSamples, secondval);
-                    priorwval = wval;
-                }
-            }
-        }
-        if (lfodata->shape.val.i == lt_formula)
-        {
-            drawEnvelope = tlfo->formulastate.useEnvelope;
-        }
-        tlfo->completedModulation();
-        delete tlfo;
-        if (tFullWave)
-        {
-            tFullWave->completedModulation();
-            delete tFullWave;
-        }
+        CGraphicsPath *path = dc->createGraphicsPath();
+        CGraphicsPath *deactPath = dc->createGraphicsPath();
+        CGraphicsPath *eupath = dc->createGraphicsPath();
+        CGraphicsPath *edpath = dc->createGraphicsPath();
+        preview->wave.addTo(path);
+        preview->fullWave.addTo(deactPath);
+        preview->envelopeUp.addTo(eupath);
+        preview->envelopeDown.addTo(edpath);
+        drawEnvelope = preview->drawEnvelope;
 
         VSTGUI::CGraphicsTransform tf =
             VSTGUI::CGraphicsTransform()
@@ -948,7 +1158,8 @@ void CLFOGui::drawStepSeq(VSTGUI::CDrawContext *dc, VSTGUI::CRect &maindisp,
     // code above but with very different scaling in time since we need to match the steps no
     // matter the rate
 
-    pdata tp[n_scene_params];
+    auto in = std::make_shared<LFOPreviewInputs>(storage, lfodata, ss, ms, fs);
+    auto &tp = in->tp;
     tp[lfodata->delay.param_id_in_scene].i = lfodata->delay.val.i;
     tp[lfodata->attack.param_id_in_scene].i = lfodata->attack.val.i;
     tp[lfodata->hold.param_id_in_scene].i = lfodata->hold.val.i;
@@ -1001,9 +1212,6 @@ void CLFOGui::drawStepSeq(VSTGUI::CDrawContext *dc, VSTGUI::CRect &maindisp,
     float totalSampleTime = cyclesec * n_stepseqsteps;
     float susTime = 4.0 * cyclesec;
 
-    LFOModulationSource *tlfo = new LFOModulationSource();
-    tlfo->assign(storage, lfodata, tp, 0, ss, ms, fs, true);
-    tlfo->attack();
     CRect boxo(rect_steps);
 
     int minSamples = (1 << 3) * (int)(boxo.right - boxo.left);
@@ -1018,71 +1226,20 @@ void CLFOGui::drawStepSeq(VSTGUI::CDrawContext *dc, VSTGUI::CRect &maindisp,
 #else
     float valScale = 100.0;
 #endif
-    int susCountdown = -1;
+
+    in->susTime = susTime;
+    in->totalSamples = totalSamples;
+    in->averagingWindow = averagingWindow;
+    in->cycleSamples = cycleSamples;
+    in->valScale = valScale;
+    auto preview = getPreview(in, simulateStepSeqLFO);
 
     CGraphicsPath *path = dc->createGraphicsPath();
     CGraphicsPath *eupath = dc->createGraphicsPath();
     CGraphicsPath *edpath = dc->createGraphicsPath();
-
-    for (int i = 0; i < totalSamples; i += averagingWindow)
-    {
-        float val = 0;
-        float eval = 0;
-        float minval = 1000000;
-        float maxval = -1000000;
-        float firstval;
-        float lastval;
-        for (int s = 0; s < averagingWindow; s++)
-        {
-            tlfo->process_block();
-            if (susCountdown < 0 && tlfo->env_state == lfoeg_stuck)
-            {
-                susCountdown = susTime * samplerate / BLOCK_SIZE;
-            }
-            else if (susCountdown == 0 && tlfo->env_state == lfoeg_stuck)
-            {
-                tlfo->release();
-            }
-            else if (susCountdown > 0)
-            {
-                susCountdown--;
-            }
-
-            val += tlfo->output;
-            if (s == 0)
-                firstval = tlfo->output;
-            if (s == averagingWindow - 1)
-                lastval = tlfo->output;
-            minval = std::min(tlfo->output, minval);
-            maxval = std::max(tlfo->output, maxval);
-            eval += tlfo->env_val * lfodata->magnitude.get_extended(lfodata->magnitude.val.f);
-        }
-        val = val / averagingWindow;
-        eval = eval / averagingWindow;
-
-        if (lfodata->unipolar.val.b)
-            val = val * 2.0 - 1.0;
-
-        val = ((-val + 1.0f) * 0.5) * valScale;
-        float euval = ((-eval + 1.0f) * 0.5) * valScale;
-        float edval = ((eval + 1.0f) * 0.5) * valScale;
-
-        float xc = valScale * i / (cycleSamples * n_stepseqsteps);
-        if (i == 0)
-        {
-            path->beginSubpath(xc, val);
-            eupath->beginSubpath(xc, euval);
-            if (!lfodata->unipolar.val.b)
-                edpath->beginSubpath(xc, edval);
-        }
-        else
-        {
-            path->addLine(xc, val);
-            eupath->addLine(xc, euval);
-            edpath->addLine(xc, edval);
-        }
-    }
-    delete tlfo;
+    preview->wave.addTo(path);
+    preview->envelopeUp.addTo(eupath);
+    preview->envelopeDown.addTo(edpath);
 
     auto q = boxo;
 
@@ -1680,6 +1837,7 @@ CMouseEventResult CLFOGui::onMouseMoved(CPoint &where, const CButtonState &butto
                 if (lfodata->shape.val.i != i)
                 {
                     lfodata->shape.val.i = i;
+                    lfodata->shape.markDirty();
                     invalid();
 
                     // This is such a hack
@@ -1914,6 +2072,7 @@ bool CLFOGui::onWheel(const VSTGUI::CPoint &where, const float &distance,
             if (ns != this->lfodata->shape.val.i)
             {
                 this->lfodata->shape.val.i = ns;
+                this->lfodata->shape.markDirty();
                 this->invalid();
                 // This is such a hack
                 auto sge = dynamic_cast<SurgeGUIEditor *>(this->listener);
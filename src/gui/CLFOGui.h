@@ -21,8 +21,10 @@
 #include "SurgeBitmaps.h"
 #include "CScalableBitmap.h"
 #include "CursorControlGuard.h"
+#include "PreviewCache.h"
 
 class CScalableBitmap;
+struct LFOPreviewInputs;
 
 class CLFOGui : public VSTGUI::CControl,
                 public Surge::GUI::SkinConsumingComponent,
@@ -95,6 +97,8 @@ class CLFOGui : public VSTGUI::CControl,
         tsDen = d;
     }
 
+    void setPreviewCache(Surge::GUI::PreviewCache *c) { previewCache = c; }
+
     void openPopup(VSTGUI::CPoint &where);
 
     bool insideTypeSelector(const VSTGUI::CPoint &where) { return rect_shapes.pointInside(where); }
@@ -111,6 +115,12 @@ class CLFOGui : public VSTGUI::CControl,
     std::shared_ptr<SurgeBitmaps> bitmapStore;
     int tsNum = 4, tsDen = 4;
 
+    // Without a cache the wave is simulated on every paint
+    Surge::GUI::PreviewCache *previewCache = nullptr;
+    std::shared_ptr<const Surge::GUI::Preview>
+    getPreview(std::shared_ptr<LFOPreviewInputs> in,
+               void (*simulate)(LFOPreviewInputs &, Surge::GUI::Preview &));
+
     VSTGUI::CRect shaperect[n_lfo_types];
     VSTGUI::CRect steprect[n_stepseqsteps];
     VSTGUI::CRect gaterect[n_stepseqsteps];
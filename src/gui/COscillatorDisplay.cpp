@@ -21,6 +21,7 @@
 #include "SurgeGUIUtils.h"
 #include "SkinColors.h"
 #include "RuntimeFont.h"
+#include "UIInstrumentation.h"
 
 #include "filesystem/import.h"
 #include "CursorControlGuard.h"
@@ -36,6 +37,175 @@ using namespace VSTGUI;
 const float disp_pitch = 90.15f - 48.f;
 const int wtbheight = 12;
 
+/*
+ * Run an oscillator of this type made from oscdata and the values in tp at pitch for
+ * totalSamples samples, and average it into wave. Leaves wave empty if the oscillator
+ * doesn't display. This may run on the preview worker, so it must only read oscdata.
+ */
+static void simulateOscillator(SurgeStorage *storage, OscillatorStorage *oscdata, int type,
+                               pdata *tp, float pitch, int totalSamples, float scaleDownBy,
+                               Surge::GUI::PreviewPath &wave)
+{
+    Oscillator *osc = spawn_osc(type, storage, oscdata, tp);
+    if (!osc)
+        return;
+
+    bool use_display = osc->allow_display();
+
+    // Mis-install check #2
+    if (uses_wavetabledata(type) && storage->wt_list.size() == 0)
+        use_display = false;
+
+    if (!use_display)
+    {
+        delete osc;
+        return;
+    }
+
+    osc->init(pitch, true, true);
+
+    int averagingWindow = 4; // this must be both less than BLOCK_SIZE_OS and BLOCK_SIZE_OS must be
+                             // an integer multiple of it
+    float valScale = 100.0f;
+
+    int block_pos = BLOCK_SIZE_OS;
+    for (int i = 0; i < totalSamples; i += averagingWindow)
+    {
+        if (block_pos >= BLOCK_SIZE_OS)
+        {
+            if (uses_wavetabledata(type))
+            {
+                std::lock_guard<std::mutex> g(storage->waveTableDataMutex);
+                osc->process_block(pitch);
+            }
+            else
+            {
+                osc->process_block(pitch);
+            }
+            block_pos = 0;
+        }
+
+        float val = 0.f;
+        for (int j = 0; j < averagingWindow; ++j)
+        {
+            val += osc->output[block_pos];
+            block_pos++;
+        }
+        val = val / averagingWindow;
+        val = ((-val + 1.0f) * 0.5f * (1.0 - scaleDownBy) + 0.5 * scaleDownBy) * valScale;
+        block_pos++;
+        float xc = valScale * i / totalSamples;
+
+        // OK so val is now a value between 0 and valScale, and xc is a value between 0 and
+        // valScale
+        if (i == 0)
+        {
+            wave.beginSubpath(xc, val);
+        }
+        else
+        {
+            wave.addLine(xc, val);
+        }
+    }
+
+    delete osc;
+}
+
+float COscillatorDisplay::displayPitch()
+{
+    float disp_pitch_rs = disp_pitch + 12.0 * log2(dsamplerate / 44100.0);
+    if (!storage->isStandardTuning)
+    {
+        // OK so in this case we need to find a better version of the note which gets us
+        // that pitch. Sigh.
+        auto pit = storage->note_to_pitch_ignoring_tuning(disp_pitch_rs);
+        int bracket = -1;
+        for (int i = 0; i < 128; ++i)
+        {
+            if (storage->note_to_pitch(i) < pit && storage->note_to_pitch(i + 1) > pit)
+            {
+                bracket = i;
+                break;
+            }
+        }
+        if (bracket >= 0)
+        {
+            float f1 = storage->note_to_pitch(bracket);
+            float f2 = storage->note_to_pitch(bracket + 1);
+            float frac = (pit - f1) / (f2 - f1);
+            disp_pitch_rs = bracket + frac;
+        }
+        else
+        {
+            // What the hell type of scale is this folks! But this is just UI code so just
+            // punt
+        }
+    }
+    return disp_pitch_rs;
+}
+
+std::shared_ptr<const Surge::GUI::Preview>
+COscillatorDisplay::getPreview(pdata *tp, float pitch, int totalSamples)
+{
+    int type = oscdata->type.val.i;
+
+    /*
+     * Everything simulateOscillator reads which can change under us. The family is what we
+     * would rather not see an old picture of while the new one is made.
+     */
+    Surge::GUI::PreviewHash family;
+    family.add(oscdata).add(type);
+
+    Surge::GUI::PreviewHash ph = family;
+    ph.add(pitch).add(totalSamples).add(samplerate).add(storage->getPatch().character.val.i);
+    ph.add(storage->wt_list.empty());
+    for (int i = 0; i < n_osc_params; ++i)
+    {
+        auto &p = oscdata->p[i];
+        ph.add(p.val.i).add(p.deform_type).add(p.extend_range).add(p.absolute);
+        ph.add(p.temposync).add(p.deactivated);
+    }
+    ph.add(oscdata->extraConfig.nData);
+    ph.addBytes(oscdata->extraConfig.data, sizeof(float) * oscdata->extraConfig.nData);
+    if (uses_wavetabledata(type))
+    {
+        std::lock_guard<std::mutex> g(storage->waveTableDataMutex);
+        auto &wt = oscdata->wt;
+        ph.add(wt.current_id).add(wt.n_tables).add(wt.size).add(wt.flags);
+        ph.add(wt.TableF32Data).add(wt.TableI16Data).add(oscdata->wavetable_display_name);
+    }
+    if (!storage->isStandardTuning)
+    {
+        for (int i = 0; i < 128; ++i)
+            ph.add(storage->note_to_pitch(i));
+    }
+
+    auto job = [storage = storage, oscdata = oscdata, type, pitch, totalSamples,
+                tpc = std::vector<pdata>(tp, tp + n_scene_params)](Surge::GUI::Preview &p) mutable {
+        simulateOscillator(storage, oscdata, type, tpc.data(), pitch, totalSamples, scaleDownBy,
+                           p.wave);
+    };
+
+    if (!previewCache)
+    {
+        auto p = std::make_shared<Surge::GUI::Preview>();
+        job(*p);
+        return p;
+    }
+
+    bool current = false;
+    auto res =
+        previewCache->get(Surge::GUI::PreviewCache::OSCILLATOR, ph.h, family.h, job, current);
+#ifdef INSTRUMENT_UI
+    Surge::Debug::record(current ? "COscillatorDisplay::draw cached preview"
+                         : res   ? "COscillatorDisplay::draw older preview while refilling"
+                                 : "COscillatorDisplay::draw preview computed on paint");
+#endif
+    if (!res)
+        res = previewCache->compute(Surge::GUI::PreviewCache::OSCILLATOR, ph.h, family.h, job);
+    return res;
+}
+
 void COscillatorDisplay::draw(CDrawContext *dc)
 {
     if (customEditor && !canHaveCustomEditor())
@@ -50,13 +220,30 @@ void COscillatorDisplay::draw(CDrawContext *dc)
         return;
     }
 
+#ifdef INSTRUMENT_UI
+    Surge::Debug::TimeThisBlock tb("COscillatorDisplay::draw");
+#endif
+
+    float h = getHeight();
+    float extraYTranslate = 0;
+    if (uses_wavetabledata(oscdata->type.val.i))
+    {
+        h -= wtbheight + 2.5;
+        extraYTranslate = 0.1 * wtbheight;
+    }
+
+    int totalSamples = (1 << 4) * (int)getWidth();
+    float disp_pitch_rs = displayPitch();
+
+    float valScale = 100.0f;
+
+    auto size = getViewSize();
+
     pdata tp[2][n_scene_params]; // 0 is orange, 1 is blue
-    Oscillator *osces[2];
+    std::shared_ptr<const Surge::GUI::Preview> previews[2];
     std::string olabel;
     for (int c = 0; c < 2; ++c)
     {
-        osces[c] = nullptr;
-
 #if OSC_MOD_ANIMATION
         if (!is_mod && c > 0)
             continue;
@@ -135,115 +322,28 @@ void COscillatorDisplay::draw(CDrawContext *dc)
         }
 #endif
 
-        osces[c] = spawn_osc(oscdata->type.val.i, storage, oscdata, tp[c]);
-    }
-
-    float h = getHeight();
-    float extraYTranslate = 0;
-    if (uses_wavetabledata(oscdata->type.val.i))
-    {
-        h -= wtbheight + 2.5;
-        extraYTranslate = 0.1 * wtbheight;
+        if (c == 0)
+        {
+            previews[c] = getPreview(tp[c], disp_pitch_rs, totalSamples);
+        }
+        else
+        {
+            // The animated wave moves on every frame, so there is nothing to keep
+            auto p = std::make_shared<Surge::GUI::Preview>();
+            simulateOscillator(storage, oscdata, oscdata->type.val.i, tp[c], disp_pitch_rs,
+                               totalSamples, scaleDownBy, p->wave);
+            previews[c] = p;
+        }
     }
 
-    int totalSamples = (1 << 4) * (int)getWidth();
-    int averagingWindow = 4; // this must be both less than BLOCK_SIZE_OS and BLOCK_SIZE_OS must be
-                             // an integer multiple of it
-
-    float valScale = 100.0f;
-
-    auto size = getViewSize();
-
     for (int c = 1; c >= 0; --c) // backwards so we draw blue first
     {
-        bool use_display = false;
-        Oscillator *osc = osces[c];
+        auto preview = previews[c];
+        bool use_display = preview && !preview->wave.subpaths.empty();
         CGraphicsPath *path = dc->createGraphicsPath();
-        if (osc)
+        if (use_display)
         {
-            float disp_pitch_rs = disp_pitch + 12.0 * log2(dsamplerate / 44100.0);
-            if (!storage->isStandardTuning)
-            {
-                // OK so in this case we need to find a better version of the note which gets us
-                // that pitch. Sigh.
-                auto pit = storage->note_to_pitch_ignoring_tuning(disp_pitch_rs);
-                int bracket = -1;
-                for (int i = 0; i < 128; ++i)
-                {
-                    if (storage->note_to_pitch(i) < pit && storage->note_to_pitch(i + 1) > pit)
-                    {
-                        bracket = i;
-                        break;
-                    }
-                }
-                if (bracket >= 0)
-                {
-                    float f1 = storage->note_to_pitch(bracket);
-                    float f2 = storage->note_to_pitch(bracket + 1);
-                    float frac = (pit - f1) / (f2 - f1);
-                    disp_pitch_rs = bracket + frac;
-                }
-                else
-                {
-                    // What the hell type of scale is this folks! But this is just UI code so just
-                    // punt
-                }
-            }
-            use_display = osc->allow_display();
-
-            // Mis-install check #2
-            if (uses_wavetabledata(oscdata->type.val.i) && storage->wt_list.size() == 0)
-                use_display = false;
-
-            if (use_display)
-                osc->init(disp_pitch_rs, true, true);
-
-            int block_pos = BLOCK_SIZE_OS;
-            for (int i = 0; i < totalSamples; i += averagingWindow)
-            {
-                if (use_display && (block_pos >= BLOCK_SIZE_OS))
-                {
-                    if (uses_wavetabledata(oscdata->type.val.i))
-                    {
-                        storage->waveTableDataMutex.lock();
-                        osc->process_block(disp_pitch_rs);
-                        block_pos = 0;
-                        storage->waveTableDataMutex.unlock();
-                    }
-                    else
-                    {
-                        osc->process_block(disp_pitch_rs);
-                        block_pos = 0;
-                    }
-                }
-
-                float val = 0.f;
-                if (use_display)
-                {
-                    for (int j = 0; j < averagingWindow; ++j)
-                    {
-                        val += osc->output[block_pos];
-                        block_pos++;
-                    }
-                    val = val / averagingWindow;
-                    val =
-                        ((-val + 1.0f) * 0.5f * (1.0 - scaleDownBy) + 0.5 * scaleDownBy) * valScale;
-                }
-                block_pos++;
-                float xc = valScale * i / totalSamples;
-
-                // OK so val is now a value between 0 and valScale, and xc is a value between 0 and
-                // valScale
-                if (i == 0)
-                {
-                    path->beginSubpath(xc, val);
-                }
-                else
-                {
-                    path->addLine(xc, val);
-                }
-            }
-            // srand( (unsigned)time( NULL ) );
+            preview->wave.addTo(path);
         }
         // OK so now we need to figure out how to transfer the box with is [0,valscale] x
         // [0,valscale] to our coords. So scale then position
@@ -314,7 +414,7 @@ void COscillatorDisplay::draw(CDrawContext *dc)
             }
 
             // OK so now the label
-            if (osces[1])
+            if (previews[1])
             {
                 dc->setFontColor(skin->getColor(Colors::Osc::Display::AnimatedWave));
                 dc->setFont(Surge::GUI::getFontManager()->displayFont);
@@ -341,8 +441,6 @@ void COscillatorDisplay::draw(CDrawContext *dc)
         dc->restoreGlobalState();
 
         path->forget();
-
-        delete osces[c];
     }
 
     if (uses_wavetabledata(oscdata->type.val.i))
@@ -560,13 +658,13 @@ CMouseEventResult COscillatorDisplay::onMouseDown(CPoint &where, const CButtonSt
         {
             id = storage->getAdjacentWaveTable(oscdata->wt.current_id, false);
             if (id >= 0)
-                oscdata->wt.queue_id = id;
+                storage->queue_wt(&oscdata->wt, id);
         }
         else if (rnext.pointInside(where))
         {
             id = storage->getAdjacentWaveTable(oscdata->wt.current_id, true);
             if (id >= 0)
-                oscdata->wt.queue_id = id;
+                storage->queue_wt(&oscdata->wt, id);
         }
         else if (rmenu.pointInside(where))
         {
@@ -754,7 +852,7 @@ void COscillatorDisplay::loadWavetable(int id)
 {
     if (id >= 0 && (id < storage->wt_list.size()))
     {
-        oscdata->wt.queue_id = id;
+        storage->queue_wt(&oscdata->wt, id);
     }
 }
 
@@ -766,7 +864,7 @@ void COscillatorDisplay::loadWavetableFromFile()
     {
         auto res = c.getResult();
         auto rString = res.getFullPathName().toStdString();
-        strncpy(this->oscdata->wt.queue_filename, rString.c_str(), 255);
+        storage->queue_wt(&this->oscdata->wt, rString);
     }
 }
 
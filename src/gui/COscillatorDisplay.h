@@ -18,6 +18,7 @@
 #include "DSPUtils.h"
 #include "SkinSupport.h"
 #include "CursorControlGuard.h"
+#include "PreviewCache.h"
 
 #define OSC_MOD_ANIMATION 0
 
@@ -123,6 +124,8 @@ class COscillatorDisplay : public VSTGUI::CControl,
 
     void invalidateIfIdIsInRange(int id);
 
+    void setPreviewCache(Surge::GUI::PreviewCache *c) { previewCache = c; }
+
 #if OSC_MOD_ANIMATION
     void setIsMod(bool b)
     {
@@ -141,6 +144,12 @@ class COscillatorDisplay : public VSTGUI::CControl,
     SurgeStorage *storage;
     unsigned int controlstate;
 
+    // Without a cache the wave is simulated on every paint
+    Surge::GUI::PreviewCache *previewCache = nullptr;
+    float displayPitch();
+    std::shared_ptr<const Surge::GUI::Preview> getPreview(pdata *tp, float pitch,
+                                                          int totalSamples);
+
     int scene, osc_in_scene;
 
     bool doingDrag = false;
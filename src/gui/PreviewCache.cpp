@@ -0,0 +1,149 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#include "PreviewCache.h"
+#include "UIInstrumentation.h"
+
+namespace Surge
+{
+namespace GUI
+{
+
+/*
+ * Jobs run the DSP in display mode, and the formula modulator has one display lua_State for the
+ * whole process, so only one preview may be computed at a time across every open editor.
+ */
+static std::mutex computeMutex;
+
+#ifdef INSTRUMENT_UI
+static const char *slotTag(PreviewCache::Slot s)
+{
+    return s == PreviewCache::OSCILLATOR ? "PreviewCache oscillator" : "PreviewCache LFO";
+}
+#endif
+
+static std::shared_ptr<const Preview> runJob(PreviewCache::Slot s, const PreviewCache::Job &job,
+                                             const char *where)
+{
+#ifdef INSTRUMENT_UI
+    Surge::Debug::TimeThisBlock tb(std::string(slotTag(s)) + " " + where);
+#endif
+    auto p = std::make_shared<Preview>();
+    std::lock_guard<std::mutex> g(computeMutex);
+    job(*p);
+    return p;
+}
+
+PreviewCache::PreviewCache() { worker = std::thread([this]() { run(); }); }
+
+PreviewCache::~PreviewCache()
+{
+    {
+        std::lock_guard<std::mutex> g(m);
+        running = false;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+std::shared_ptr<const Preview> PreviewCache::get(Slot s, uint64_t hash, uint64_t family, Job job,
+                                                 bool &current)
+{
+    std::lock_guard<std::mutex> g(m);
+    auto &sl = slots[s];
+
+    current = sl.preview && sl.hash == hash;
+    if (current)
+        return sl.preview;
+    if (!sl.preview || sl.family != family)
+        return nullptr;
+
+    if (sl.requestedHash != hash)
+    {
+        sl.requestedHash = hash;
+        sl.job = std::move(job);
+        cv.notify_one();
+    }
+    return sl.preview;
+}
+
+std::shared_ptr<const Preview> PreviewCache::compute(Slot s, uint64_t hash, uint64_t family,
+                                                     const Job &job)
+{
+    auto p = runJob(s, job, "on paint");
+
+    std::lock_guard<std::mutex> g(m);
+    auto &sl = slots[s];
+    sl.preview = p;
+    sl.hash = hash;
+    sl.family = family;
+    sl.requestedHash = hash;
+    sl.job = nullptr;
+    return p;
+}
+
+bool PreviewCache::collectUpdate(Slot s)
+{
+    std::lock_guard<std::mutex> g(m);
+    auto res = slots[s].updated;
+    slots[s].updated = false;
+    return res;
+}
+
+void PreviewCache::run()
+{
+    std::unique_lock<std::mutex> lk(m);
+    while (true)
+    {
+        cv.wait(lk, [this]() {
+            if (!running)
+                return true;
+            for (auto &sl : slots)
+                if (sl.job)
+                    return true;
+            return false;
+        });
+        if (!running)
+            break;
+
+        for (int i = 0; i < n_slots && running; ++i)
+        {
+            auto &sl = slots[i];
+            if (!sl.job)
+                continue;
+
+            auto job = std::move(sl.job);
+            auto hash = sl.requestedHash;
+            auto family = sl.family;
+            sl.job = nullptr;
+
+            lk.unlock();
+            auto p = runJob((Slot)i, job, "on worker");
+            lk.lock();
+
+            // Something newer was asked for while this ran, so this is stale already
+            if (hash != sl.requestedHash)
+                continue;
+
+            sl.preview = p;
+            sl.hash = hash;
+            sl.family = family;
+            sl.updated = true;
+        }
+    }
+}
+
+} // namespace GUI
+} // namespace Surge
@@ -0,0 +1,153 @@
+/*
+** Surge Synthesizer is Free and Open Source Software
+**
+** Surge is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html
+**
+** Copyright 2004-2021 by various individuals as described by the Git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/surge.git
+**
+** Surge was a commercial product from 2004-2018, with Copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Surge
+** open source in September 2018.
+*/
+
+#ifndef SURGE_XT_PREVIEWCACHE_H
+#define SURGE_XT_PREVIEWCACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Surge
+{
+namespace GUI
+{
+
+/*
+ * The oscillator and LFO displays draw a waveform which they get by running the DSP for a few
+ * thousand samples. That only needs doing when something which feeds the DSP changes, so the
+ * displays hash those inputs and keep the resulting lines here, in the [0, valScale] coordinates
+ * they already drew in. A worker thread recomputes a preview whose hash has moved on while the
+ * display keeps painting the one it had; SurgeGUIEditor::idle repaints once the new one arrives.
+ */
+struct PreviewPath
+{
+    struct Point
+    {
+        float x, y;
+    };
+    std::vector<std::vector<Point>> subpaths;
+
+    void beginSubpath(float x, float y) { subpaths.push_back({{x, y}}); }
+    void addLine(float x, float y)
+    {
+        if (subpaths.empty())
+            beginSubpath(x, y);
+        else
+            subpaths.back().push_back({x, y});
+    }
+
+    // Replay onto a VSTGUI::CGraphicsPath, or anything else with the same two calls
+    template <typename P> void addTo(P *path) const
+    {
+        for (auto &sp : subpaths)
+        {
+            path->beginSubpath(sp[0].x, sp[0].y);
+            for (size_t i = 1; i < sp.size(); ++i)
+                path->addLine(sp[i].x, sp[i].y);
+        }
+    }
+};
+
+struct Preview
+{
+    PreviewPath wave, envelopeUp, envelopeDown, fullWave;
+    bool drawEnvelope = true;
+};
+
+/*
+ * FNV-1a over the inputs of a preview. Only feed it values without padding (numbers, flags,
+ * strings), since struct padding is not guaranteed to be initialized.
+ */
+struct PreviewHash
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    PreviewHash &addBytes(const void *d, size_t n)
+    {
+        auto c = static_cast<const unsigned char *>(d);
+        for (size_t i = 0; i < n; ++i)
+        {
+            h ^= c[i];
+            h *= 0x100000001b3ULL;
+        }
+        return *this;
+    }
+    template <typename T> PreviewHash &add(const T &v) { return addBytes(&v, sizeof(T)); }
+    PreviewHash &add(const std::string &s) { return add(s.size()).addBytes(s.data(), s.size()); }
+    PreviewHash &add(const char *s) { return addBytes(s, strlen(s) + 1); }
+};
+
+class PreviewCache
+{
+  public:
+    enum Slot
+    {
+        OSCILLATOR = 0,
+        LFO,
+
+        n_slots
+    };
+    typedef std::function<void(Preview &)> Job;
+
+    PreviewCache();
+    ~PreviewCache();
+
+    /*
+     * The preview for slot s if it was made from inputs with this hash, with current set. If it
+     * wasn't but the one s holds is of the same family (the same oscillator and type, say), job is
+     * queued on the worker, replacing any job for s still waiting there, and the older preview is
+     * returned to draw in the meantime. Otherwise this returns null. The job must not refer to
+     * anything which may go away before the cache does.
+     */
+    std::shared_ptr<const Preview> get(Slot s, uint64_t hash, uint64_t family, Job job,
+                                       bool &current);
+
+    /*
+     * Run job on the calling thread and store the result for s. For when get has nothing to show
+     * meanwhile.
+     */
+    std::shared_ptr<const Preview> compute(Slot s, uint64_t hash, uint64_t family, const Job &job);
+
+    // Whether a queued preview for s has arrived since the last call. Polled from idle.
+    bool collectUpdate(Slot s);
+
+  private:
+    void run();
+
+    struct SlotState
+    {
+        std::shared_ptr<const Preview> preview;
+        uint64_t hash = 0, family = 0, requestedHash = 0;
+        Job job;
+        bool updated = false;
+    } slots[n_slots];
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool running = true;
+    std::thread worker;
+};
+
+} // namespace GUI
+} // namespace Surge
+
+#endif // SURGE_XT_PREVIEWCACHE_H
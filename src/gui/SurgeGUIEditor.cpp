@@ -135,6 +135,12 @@ SurgeGUIEditor::SurgeGUIEditor(SurgeSynthEditor *jEd, SurgeSynthesizer *synth) :
     Surge::Debug::record("SurgeGUIEditor::SurgeGUIEditor");
 #endif
     frame = 0;
+    previewCache = std::make_unique<Surge::GUI::PreviewCache>();
+
+    // the patch browser reads the patch list straight from the storage from here on, and the
+    // processor may not have seen the scan finish to start the patch DB yet
+    synth->storage.ensurePatchListLoaded();
+    synth->storage.initializePatchDb();
 
     blinktimer = 0.f;
     blinkstate = false;
@@ -372,6 +378,15 @@ void SurgeGUIEditor::idle()
             }
         }
 
+        if (previewCache->collectUpdate(Surge::GUI::PreviewCache::OSCILLATOR) && oscdisplay)
+        {
+            oscdisplay->invalid();
+        }
+        if (previewCache->collectUpdate(Surge::GUI::PreviewCache::LFO) && lfodisplay)
+        {
+            lfodisplay->invalid();
+        }
+
         if (typeinResetCounter > 0)
         {
             typeinResetCounter--;
@@ -1278,6 +1293,7 @@ void SurgeGUIEditor::openOrRecreateEditor()
                      .osc[current_osc[current_scene]],
                 &synth->storage);
             od->setSkin(currentSkin, bitmapStore);
+            od->setPreviewCache(previewCache.get());
             frame->addView(od);
             oscdisplay = od;
             break;
@@ -3868,6 +3884,7 @@ int32_t SurgeGUIEditor::controlModifierClicked(CControlValueInterface *control,
                         curr->val.b = true;
                     else
                         curr->val.b = false;
+                    curr->markDirty();
 
                     curr++;
                 }
@@ -3887,6 +3904,7 @@ int32_t SurgeGUIEditor::controlModifierClicked(CControlValueInterface *control,
                         curr->val.b = true;
                     else
                         curr->val.b = false;
+                    curr->markDirty();
 
                     curr++;
                 }
@@ -4138,6 +4156,7 @@ void SurgeGUIEditor::valueChanged(CControlValueInterface *control)
         if (a < 0)
             a = nn - 1;
         synth->storage.getPatch().scene[current_scene].filterunit[idx].subtype.val.i = a;
+        synth->storage.getPatch().scene[current_scene].filterunit[idx].subtype.markDirty();
         synth->storage.subtypeMemory[current_scene][idx][t] = a;
         if (csc)
         {
@@ -4159,6 +4178,7 @@ void SurgeGUIEditor::valueChanged(CControlValueInterface *control)
         current_scene = (int)(control->getValue() * 1.f) + 0.5f;
         synth->release_if_latched[synth->storage.getPatch().scene_active.val.i] = true;
         synth->storage.getPatch().scene_active.val.i = current_scene;
+        synth->storage.getPatch().scene_active.markDirty();
         // synth->storage.getPatch().param_ptr[scene_select_pid]->set_value_f01(control->getValue());
 
         if (isAnyOverlayPresent(MSEG_EDITOR))
@@ -4312,6 +4332,7 @@ void SurgeGUIEditor::valueChanged(CControlValueInterface *control)
         int d = fxc->getDeactivatedBitmask();
         synth->fx_suspend_bitmask = synth->storage.getPatch().fx_disable.val.i ^ d;
         synth->storage.getPatch().fx_disable.val.i = d;
+        synth->storage.getPatch().fx_disable.markDirty();
         fxc->setDeactivatedBitmask(d);
 
         int nfx = fxc->getCurrentEffect();
@@ -4806,6 +4827,7 @@ void SurgeGUIEditor::valueChanged(CControlValueInterface *control)
         if (a >= nn)
             a = 0;
         synth->storage.getPatch().scene[current_scene].filterunit[idx].subtype.val.i = a;
+        synth->storage.getPatch().scene[current_scene].filterunit[idx].subtype.markDirty();
         if (!nn)
             ((Surge::Widgets::Switch *)filtersubtype[idx])->setIntegerValue(0);
         else
@@ -6525,7 +6547,7 @@ juce::PopupMenu SurgeGUIEditor::makeDevMenu(VSTGUI::CRect &menuRect)
 
 #ifdef INSTRUMENT_UI
     devSubMenu.addItem(Surge::GUI::toOSCaseForMenu("Show UI Instrumentation..."),
-                       []() { Surge::Debug::report(); });
+                       [this]() { showHTML(Surge::Debug::report()); });
 #endif
 
     return devSubMenu;
@@ -7805,6 +7827,7 @@ SurgeGUIEditor::layoutComponentForSkin(std::shared_ptr<Surge::GUI::Skin::Control
                 &synth->storage.getPatch().msegs[current_scene][lfo_id],
                 &synth->storage.getPatch().formulamods[current_scene][lfo_id], bitmapStore);
             slfo->setSkin(currentSkin, bitmapStore, skinCtrl);
+            slfo->setPreviewCache(previewCache.get());
             lfodisplay = slfo;
             frame->addView(slfo);
             nonmod_param[paramIndex] = slfo;
@@ -8042,11 +8065,9 @@ bool SurgeGUIEditor::onDrop(const std::string &fname)
                    [](unsigned char c) { return std::tolower(c); });
     if (fExt == ".wav" || fExt == ".wt")
     {
-        strxcpy(synth->storage.getPatch()
-                    .scene[current_scene]
-                    .osc[current_osc[current_scene]]
-                    .wt.queue_filename,
-                fname.c_str(), 255);
+        synth->storage.queue_wt(
+            &synth->storage.getPatch().scene[current_scene].osc[current_osc[current_scene]].wt,
+            fname);
     }
     else if (fExt == ".scl")
     {
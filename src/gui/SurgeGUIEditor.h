@@ -30,6 +30,7 @@
 
 #include "overlays/MSEGEditor.h"
 #include "widgets/ModulatableControlInterface.h"
+#include "PreviewCache.h"
 
 #include <vector>
 #include <thread>
@@ -542,6 +543,8 @@ class SurgeGUIEditor : public EditorType,
     CModulationSourceButton *gui_modsrc[n_modsources] = {};
     VSTGUI::CControl *metaparam[n_customcontrollers] = {};
     VSTGUI::CControl *lfodisplay = nullptr;
+    // The waveforms of oscdisplay and lfodisplay, refilled off the UI thread
+    std::unique_ptr<Surge::GUI::PreviewCache> previewCache;
     Surge::Widgets::Switch *filtersubtype[2] = {};
     VSTGUI::CControl *fxmenu = nullptr;
     int clear_infoview_countdown = 0;
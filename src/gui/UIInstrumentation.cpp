@@ -4,34 +4,69 @@
 #include <vector>
 #include <string>
 #include <atomic>
+#include <mutex>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 #ifdef INSTRUMENT_UI
 namespace Surge
 {
 namespace Debug
 {
-std::unordered_map<std::string, std::atomic<int>> records;
+// Previews get computed off the UI thread too, so these are guarded
+std::mutex recordsMutex;
+std::unordered_map<std::string, int> records;
 
-void record(std::string tag) { records[tag]++; }
-void report()
+struct Timing
+{
+    int count = 0;
+    double totalMs = 0, maxMs = 0;
+};
+std::unordered_map<std::string, Timing> timings;
+
+void record(std::string tag)
+{
+    std::lock_guard<std::mutex> g(recordsMutex);
+    records[tag]++;
+}
+
+std::string report()
 {
     std::ostringstream oss;
     oss << "<html><body>\n";
     oss << "<h1>Recorded events</h1><table border=2>\n\n";
 
     std::map<std::string, int> sr;
-    for (auto &k : records)
-        sr[k.first] = k.second;
+    std::map<std::string, Timing> st;
+    {
+        std::lock_guard<std::mutex> g(recordsMutex);
+        for (auto &k : records)
+            sr[k.first] = k.second;
+        for (auto &k : timings)
+            st[k.first] = k.second;
+    }
 
     for (auto &k : sr)
     {
         oss << "<tr><td>" << k.first << " </td><td> " << k.second << "</td></tr>\n" << std::endl;
     }
+    oss << "</table>\n";
+
+    oss << "<h1>Timed blocks</h1><table border=2>\n\n";
+    oss << "<tr><th>Block</th><th>Count</th><th>Total (ms)</th><th>Mean (ms)</th>"
+        << "<th>Max (ms)</th></tr>\n";
+    oss << std::fixed << std::setprecision(3);
+    for (auto &k : st)
+    {
+        auto &t = k.second;
+        oss << "<tr><td>" << k.first << " </td><td> " << t.count << "</td><td>" << t.totalMs
+            << "</td><td>" << t.totalMs / std::max(t.count, 1) << "</td><td>" << t.maxMs
+            << "</td></tr>\n";
+    }
     oss << "</table></body></html>\n";
-    Surge::UserInteractions::showHTML(oss.str());
+    return oss.str();
 }
 
 TimeThisBlock::TimeThisBlock(std::string i) : tag(i)
@@ -42,10 +77,13 @@ TimeThisBlock::TimeThisBlock(std::string i) : tag(i)
 TimeThisBlock::~TimeThisBlock()
 {
     auto end = std::chrono::high_resolution_clock::now();
-    auto duration = end - start;
-    auto durationFloat = duration.count();
-    // std::cout << "Block in " << tag << " took " << durationFloat << std::endl;
-    // FIX - record this so I can report
+    auto ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::lock_guard<std::mutex> g(recordsMutex);
+    auto &t = timings[tag];
+    t.count++;
+    t.totalMs += ms;
+    t.maxMs = std::max(t.maxMs, ms);
 }
 } // namespace Debug
 } // namespace Surge
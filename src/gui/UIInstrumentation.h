@@ -16,16 +16,17 @@ namespace Debug
 void record(std::string tag);
 
 /*
-** Pop up the timing report in a browser
+** The counts and timings as an HTML page, for the editor to show
 */
-void report();
+std::string report();
 
 /*
 ** A little structure which records the time for a block. Like
 ** {
-**    Surge::Debug::TimeThisBlock( "howlong" )
+**    Surge::Debug::TimeThisBlock tb( "howlong" );
 **    // do something slow
 ** }
+** The report shows how often each tag ran and for how long in total and at most.
 */
 struct TimeThisBlock
 {
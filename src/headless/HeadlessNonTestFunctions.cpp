@@ -1,10 +1,23 @@
 #include "HeadlessUtils.h"
 #include "Player.h"
+#include "FormulaModulationHelper.h"
+#include "MSEGModulationHelper.h"
+#include "WavetableCache.h"
+#include "WavetableLoader.h"
+#include "WavetableMipmapCache.h"
+#include "ProcessProfiler.h"
 #include "filesystem/import.h"
+#include "version.h"
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <functional>
 #include <sstream>
 #include <chrono>
 #include <deque>
+#include <atomic>
+#include <algorithm>
+#include <thread>
 
 namespace Surge
 {
@@ -46,7 +59,7 @@ void restreamTemplatesWithModifications()
     }
 }
 
-void statsFromPlayingEveryPatch()
+void statsFromPlayingEveryPatch(int jobs)
 {
     /*
     ** This is a very clean use of the built in APIs, just making a surge
@@ -58,8 +71,10 @@ void statsFromPlayingEveryPatch()
     Surge::Headless::playerEvents_t scale =
         Surge::Headless::make120BPMCMajorQuarterNoteScale(0, 44100);
 
-    auto callBack = [](const Patch &p, const PatchCategory &pc, const float *data, int nSamples,
-                       int nChannels) -> void {
+    int nPlayed = 0;
+    auto callBack = [&nPlayed](const Patch &p, const PatchCategory &pc, const float *data,
+                               int nSamples, int nChannels) -> void {
+        nPlayed++;
         bool writeWav = false; // toggle this to true to write each sample to a wav file
         std::cout << "cat/patch = " << pc.name << " / " << std::left << std::setw(30) << p.name;
 
@@ -92,7 +107,16 @@ void statsFromPlayingEveryPatch()
         std::cout << std::endl;
     };
 
-    Surge::Headless::playOnEveryPatch(surge, scale, callBack);
+    if (jobs <= 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Surge::Headless::playOnEveryPatch(surge, scale, callBack, jobs);
+    auto secs =
+        std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "# played " << nPlayed << " patches with " << jobs << " jobs in " << secs
+              << "s: " << (secs > 0 ? nPlayed / secs : 0) << " patches/sec" << std::endl;
 }
 
 void standardCutoffCurve(int ft, int sft, std::ostream &os)
@@ -483,13 +507,16 @@ void filterAnalyzer(int ft, int sft, std::ostream &os)
     middleCSawIntoFilterVsReso(ft, sft, os);
 }
 
-[[noreturn]] void performancePlay(const std::string &patchName, int mode)
+[[noreturn]] void performancePlay(const std::string &patchName, int mode, bool multithreadedScenes)
 {
     auto surge = Surge::Headless::createSurge(48000);
     std::cout << "Performance Mode with surge at 48k\n"
               << "-- Ctrl-C to exit\n"
               << "-- patchName = " << patchName << "\n"
-              << "-- mode = " << mode << std::endl;
+              << "-- mode = " << mode << "\n"
+              << "-- multithreadedScenes = " << multithreadedScenes << std::endl;
+
+    surge->setMultithreadedScenes(multithreadedScenes);
 
     surge->loadPatchByPath(patchName.c_str(), -1, "RUNTIME");
 
@@ -563,6 +590,683 @@ void filterAnalyzer(int ft, int sft, std::ostream &os)
     }
 }
 
+void voiceThreadScaling(int maxThreads)
+{
+    if (maxThreads < 1)
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    const int nVoices = MAX_VOICES;
+    const int blocks = 48000 / BLOCK_SIZE * 4;
+
+    std::cout << "Voice thread scaling with " << nVoices << " voices, " << blocks
+              << " blocks at 48k\n"
+              << "threads,usPerBlock,realtimePct,speedup,efficiency,voicesPerCore\n";
+
+    double baseUS = 0;
+    for (int t = 1; t <= maxThreads; ++t)
+    {
+        auto surge = Surge::Headless::createSurge(48000);
+        auto &patch = surge->storage.getPatch();
+        patch.polylimit.val.i = nVoices;
+        for (int o = 0; o < n_oscs; ++o)
+            patch.scene[0].osc[o].type.val.i = ot_wavetable;
+        surge->storage.reserveOscillatorBlocks();
+        surge->setVoiceThreads(t);
+
+        for (int i = 0; i < 20; ++i)
+            surge->process();
+        surge->storage.wavetableLoader->waitForPendingLoads();
+        for (int k = 0; k < nVoices; ++k)
+            surge->playNote(0, 30 + k, 100, 0);
+        for (int i = 0; i < 20; ++i)
+            surge->process();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < blocks; ++i)
+            surge->process();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double us = std::chrono::duration<double, std::micro>(end - start).count() / blocks;
+        if (t == 1)
+            baseUS = us;
+
+        // a block of BLOCK_SIZE samples has this long to render in real time
+        double budgetUS = 1e6 * BLOCK_SIZE / 48000.0;
+        double realtimePct = 100.0 * us / budgetUS;
+        double speedup = baseUS / us;
+        double voicesPerCore = nVoices * budgetUS / us / t;
+
+        std::cout << t << "," << us << "," << realtimePct << "," << speedup << ","
+                  << speedup / t << "," << voicesPerCore << std::endl;
+    }
+}
+
+void patchSwitchLatency(int nPatches)
+{
+    if (nPatches < 1)
+        nPatches = 20;
+
+    const int sr = 48000;
+    const auto blockTime = std::chrono::duration<double>(1.0 * BLOCK_SIZE / sr);
+
+    std::cout << "Patch switching at " << sr << "Hz, paced to real time\n"
+              << "mode,patch,switchMS,silentBlocks,silentMS\n";
+
+    for (auto gapless : {false, true})
+    {
+        auto surge = Surge::Headless::createSurge(sr);
+        surge->setGaplessPatchSwitching(gapless);
+
+        int n = surge->storage.patch_list.size();
+        if (n == 0)
+        {
+            std::cout << "No patches found" << std::endl;
+            return;
+        }
+
+        for (int k = 0; k < nPatches; ++k)
+        {
+            int target = (int)((int64_t)k * n / nPatches) % n;
+
+            for (int i = 0; i < 20; ++i)
+                surge->process();
+            for (auto key : {48, 55, 60, 64})
+                surge->playNote(0, key, 100, 0);
+            for (int i = 0; i < 20; ++i)
+                surge->process();
+
+            surge->patch_loaded = false;
+            surge->patchid_queue = target;
+
+            // the host calls us once per block, so keep to that pace; a load is then seen as
+            // the blocks it costs the listener
+            auto start = std::chrono::high_resolution_clock::now();
+            auto next = start;
+            int silentBlocks = 0;
+            while (!surge->patch_loaded || surge->halt_engine)
+            {
+                next += std::chrono::duration_cast<std::chrono::nanoseconds>(blockTime);
+                std::this_thread::sleep_until(next);
+
+                surge->process();
+
+                bool silent = true;
+                for (int s = 0; s < BLOCK_SIZE; ++s)
+                    silent = silent && surge->output[0][s] == 0.f && surge->output[1][s] == 0.f;
+                if (silent)
+                    silentBlocks++;
+            }
+            auto ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::high_resolution_clock::now() - start)
+                          .count();
+
+            surge->allNotesOff();
+
+            std::cout << (gapless ? "gapless" : "classic") << ",\""
+                      << surge->storage.patch_list[target].name << "\"," << ms << ","
+                      << silentBlocks << "," << 1000.0 * silentBlocks * BLOCK_SIZE / sr
+                      << std::endl;
+        }
+    }
+}
+
+void formulaThroughput(int maxVoices)
+{
+#if HAS_FORMULA_MODULATOR
+    if (maxVoices < 1 || maxVoices > MAX_VOICES)
+        maxVoices = MAX_VOICES;
+
+    // Enough blocks that each timing runs for a good fraction of a second
+    const int blocks = 20000;
+
+    auto surge = Surge::Headless::createSurge(44100);
+    FormulaModulatorStorage fs;
+    Surge::Formula::createInitFormula(&fs);
+
+    std::cout << "Formula modulator evaluation of the init script, " << blocks
+              << " blocks per run\n"
+              << "voices,perVoicePerMS,batchPerMS,speedup" << std::endl;
+
+    for (int n = 1; n <= maxVoices; n *= 2)
+    {
+        std::vector<Surge::Formula::EvaluatorState> states(n);
+        std::vector<Surge::Formula::EvaluatorState *> sp(n);
+        std::vector<int> intPhase(n, 0);
+        std::vector<float> phase(n), out(n);
+        for (int i = 0; i < n; ++i)
+        {
+            Surge::Formula::initEvaluatorState(states[i]);
+            Surge::Formula::prepareForEvaluation(&surge->storage, &fs, states[i], false);
+            sp[i] = &states[i];
+        }
+
+        auto advance = [&]() {
+            for (int i = 0; i < n; ++i)
+            {
+                phase[i] += 0.0137f * (i + 1);
+                if (phase[i] > 1)
+                {
+                    phase[i] -= 1;
+                    intPhase[i]++;
+                }
+            }
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int b = 0; b < blocks; ++b)
+        {
+            advance();
+            for (int i = 0; i < n; ++i)
+                out[i] = Surge::Formula::valueAt(intPhase[i], phase[i], &fs, sp[i]);
+        }
+        auto perVoiceMS = std::chrono::duration<double, std::milli>(
+                              std::chrono::high_resolution_clock::now() - start)
+                              .count();
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int b = 0; b < blocks; ++b)
+        {
+            advance();
+            Surge::Formula::valueAtBatch(sp.data(), intPhase.data(), phase.data(), &fs,
+                                         out.data(), n);
+        }
+        auto batchMS = std::chrono::duration<double, std::milli>(
+                           std::chrono::high_resolution_clock::now() - start)
+                           .count();
+
+        for (auto &s : states)
+            Surge::Formula::cleanEvaluatorState(s);
+
+        std::cout << n << "," << n * blocks / perVoiceMS << "," << n * blocks / batchMS << ","
+                  << perVoiceMS / batchMS << std::endl;
+    }
+#else
+    std::cout << "This build has no formula modulator" << std::endl;
+#endif
+}
+
+void msegThroughput()
+{
+    // The MSEG LFO of a full 64 voice patch, once per block for about 20 seconds at 48k
+    const int voices = MAX_VOICES, blocks = 30000;
+    const double blockRate = 2.0 * BLOCK_SIZE / 48000; // a 2Hz LFO
+
+    std::cout << "MSEG evaluation across " << voices << " voices, " << blocks << " blocks\n"
+              << "mode,segments,scanNSPerVoice,indexedNSPerVoice,speedup" << std::endl;
+
+    for (auto envelope : {false, true})
+    {
+        for (int n = 8; n <= max_msegs; n *= 4)
+        {
+            MSEGStorage ms;
+            if (envelope)
+            {
+                ms.editMode = MSEGStorage::ENVELOPE;
+                Surge::MSEG::createStepseqMSEG(&ms, n);
+            }
+            else
+            {
+                ms.editMode = MSEGStorage::LFO;
+                Surge::MSEG::createSinLineMSEG(&ms, n);
+            }
+            int segments = ms.n_activeSegments;
+
+            double ns[2];
+            for (auto indexed : {false, true})
+            {
+                // Dropping the index sends every lookup down the scan, as before the index
+                if (!indexed)
+                    ms.indexedSegments = -1;
+                else
+                    Surge::MSEG::rebuildCache(&ms);
+
+                std::vector<Surge::MSEG::EvaluatorState> es(voices);
+                std::vector<double> phase(voices);
+                for (int v = 0; v < voices; ++v)
+                    phase[v] = 1.0 * v / voices * ms.totalDuration;
+                double rate = blockRate * (envelope ? segments : 1);
+
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int b = 0; b < blocks; ++b)
+                {
+                    for (int v = 0; v < voices; ++v)
+                    {
+                        phase[v] += rate;
+                        int ip = (int)phase[v];
+                        Surge::MSEG::valueAt(ip, phase[v] - ip, 0, &ms, &es[v]);
+                    }
+                }
+                ns[indexed] = std::chrono::duration<double, std::nano>(
+                                  std::chrono::high_resolution_clock::now() - start)
+                                  .count() /
+                              ((double)voices * blocks);
+            }
+
+            std::cout << (envelope ? "envelope" : "lfo") << "," << segments << "," << ns[0] << ","
+                      << ns[1] << "," << ns[0] / ns[1] << std::endl;
+        }
+    }
+}
+
+void prewarmWavetableCache(const std::string &dir, int jobs)
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    auto storage = &surge->storage;
+    const auto &cacheDir = storage->userWavetableCachePath;
+    if (cacheDir.empty())
+    {
+        std::cout << "The wavetable mipmap cache is switched off in the user defaults" << std::endl;
+        return;
+    }
+
+    // Every wavetable Surge knows about, or everything which looks like one under dir
+    std::vector<std::string> files;
+    if (dir.empty())
+    {
+        for (auto &w : storage->wt_list)
+            files.push_back(path_to_string(w.path));
+    }
+    else
+    {
+        std::error_code ec;
+        for (auto &d : fs::recursive_directory_iterator(string_to_path(dir), ec))
+        {
+            auto ext = path_to_string(d.path().extension());
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (ext == ".wt" || ext == ".wav")
+                files.push_back(path_to_string(d.path()));
+        }
+    }
+
+    if (jobs <= 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Prewarming " << files.size() << " wavetables into " << cacheDir << " with "
+              << jobs << " threads" << std::endl;
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> warm{0}, built{0}, failed{0};
+    auto work = [&]() {
+        for (auto i = next++; i < files.size(); i = next++)
+        {
+            const auto &f = files[i];
+            auto key = Surge::Storage::WavetableCache::keyForFile(f);
+            auto wt = std::make_unique<Wavetable>();
+            if (Surge::Storage::WavetableMipmapCache::read(cacheDir, f, key, wt.get()))
+            {
+                warm++;
+                continue;
+            }
+
+            auto ext = path_to_string(string_to_path(f).extension());
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            bool ok = ext == ".wt" ? storage->load_wt_wt(f, wt.get())
+                                   : storage->load_wt_wav_portable(f, wt.get());
+            if (ok && Surge::Storage::WavetableMipmapCache::write(cacheDir, f, key, wt.get()))
+                built++;
+            else
+                failed++;
+        }
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < jobs; ++t)
+        threads.emplace_back(work);
+    for (auto &t : threads)
+        t.join();
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                        start)
+                  .count();
+
+    auto trimmed =
+        Surge::Storage::WavetableMipmapCache::trim(cacheDir, storage->userWavetableCacheMaxBytes);
+
+    std::cout << "built=" << built << " alreadyWarm=" << warm << " failed=" << failed
+              << " trimmed=" << trimmed << " ms=" << ms << std::endl;
+}
+
+void timeToFirstProcess(int runs)
+{
+    if (runs <= 0)
+        runs = 3;
+
+    // The first run has no manifest to go on, so it lists every directory
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        std::error_code ec;
+        fs::remove(string_to_path(surge->storage.libraryManifestPath()), ec);
+    }
+
+    std::cout << "run,constructMS,firstProcessMS,patchListMS,patches" << std::endl;
+    for (int r = 0; r < runs; ++r)
+    {
+        typedef std::chrono::high_resolution_clock clock;
+        auto ms = [](clock::time_point a, clock::time_point b) {
+            return std::chrono::duration<double, std::milli>(b - a).count();
+        };
+
+        auto start = clock::now();
+        auto surge = Surge::Headless::createSurge(44100, false);
+        auto constructed = clock::now();
+        surge->process();
+        auto processed = clock::now();
+        surge->storage.ensurePatchListLoaded();
+        auto listed = clock::now();
+
+        std::cout << (r == 0 ? "cold" : "warm") << "," << ms(start, constructed) << ","
+                  << ms(start, processed) << "," << ms(start, listed) << ","
+                  << surge->storage.patch_list.size() << std::endl;
+    }
+}
+
+namespace
+{
+/*
+ * A benchmark scenario is a patch setup, some held notes and optionally something to do before
+ * every block. Everything about it is fixed, so the same build does the same work each run.
+ */
+struct BenchmarkScenario
+{
+    std::string name;
+    int voices = 16;
+    bool needsPatchList = false;
+    std::function<void(SurgeSynthesizer *)> setup;
+    std::function<void(SurgeSynthesizer *)> notes;
+    std::function<void(SurgeSynthesizer *, int)> eachBlock;
+};
+
+void playBenchmarkNotes(SurgeSynthesizer *surge, int voices)
+{
+    // Distinct keys, so every note is its own voice
+    for (int k = 0; k < voices; ++k)
+        surge->playNote(0, 30 + k, 100, 0);
+}
+
+std::vector<BenchmarkScenario> benchmarkScenarios()
+{
+    std::vector<BenchmarkScenario> res;
+
+    for (int ot = 0; ot < n_osc_types; ++ot)
+    {
+        for (auto voices : {1, 16, 64})
+        {
+            BenchmarkScenario sc;
+            sc.name = std::string("osc/") + osc_type_names[ot] + "/" + std::to_string(voices);
+            sc.voices = voices;
+            sc.setup = [ot](SurgeSynthesizer *surge) {
+                auto oscdata = &(surge->storage.getPatch().scene[0].osc[0]);
+                oscdata->type.val.i = ot;
+                surge->storage.getPatch().update_controls(false, oscdata);
+                surge->storage.reserveOscillatorBlocks();
+            };
+            res.push_back(sc);
+        }
+    }
+
+    for (int ft = 0; ft < n_fu_types; ++ft)
+    {
+        for (int sft = 0; sft < std::max(1, fut_subcount[ft]); ++sft)
+        {
+            BenchmarkScenario sc;
+            sc.name = std::string("filter/") + fut_names[ft] + "/" + std::to_string(sft);
+            sc.setup = [ft, sft](SurgeSynthesizer *surge) {
+                auto &fu = surge->storage.getPatch().scene[0].filterunit[0];
+                fu.type.val.i = ft;
+                fu.subtype.val.i = sft;
+            };
+            res.push_back(sc);
+        }
+    }
+
+    for (int fxt = 0; fxt < n_fx_types; ++fxt)
+    {
+        BenchmarkScenario sc;
+        sc.name = std::string("fx/") + fx_type_names[fxt];
+        sc.voices = 4;
+        sc.setup = [fxt](SurgeSynthesizer *surge) {
+            auto *pt = &(surge->storage.getPatch().fx[0].type);
+            surge->setParameter01(surge->idForParameter(pt), pt->value_to_normalized(fxt), false);
+            for (int i = 0; i < 100 && pt->val.i != fxt; ++i)
+            {
+                surge->process();
+                surge->effectLoader->waitForPendingLoads();
+            }
+        };
+        res.push_back(sc);
+    }
+
+    {
+        BenchmarkScenario sc;
+        sc.name = "modulation/dense";
+        sc.setup = [](SurgeSynthesizer *surge) {
+            auto &scene = surge->storage.getPatch().scene[0];
+            std::vector<Parameter *> targets = {
+                &scene.osc[0].pitch,           &scene.osc[1].pitch,
+                &scene.osc[2].pitch,           &scene.osc[0].p[0],
+                &scene.filterunit[0].cutoff,   &scene.filterunit[0].resonance,
+                &scene.filterunit[1].cutoff,   &scene.level_o1,
+                &scene.level_o2,               &scene.pitch,
+                &scene.wsunit.drive,           &scene.lfo[0].rate};
+            int k = 0;
+            for (int ms = ms_lfo1; ms <= ms_slfo6; ++ms)
+            {
+                for (auto t : targets)
+                {
+                    // Vary the depths a little, so the routings aren't all alike
+                    surge->setModulation(t->id, (modsources)ms, 0.05f + 0.01f * (k++ % 10));
+                }
+            }
+        };
+        res.push_back(sc);
+    }
+
+    {
+        BenchmarkScenario sc;
+        sc.name = "mpe";
+        sc.voices = 15;
+        sc.setup = [](SurgeSynthesizer *surge) { surge->mpeEnabled = true; };
+        sc.notes = [](SurgeSynthesizer *surge) {
+            for (int ch = 1; ch <= 15; ++ch)
+                surge->playNote(ch, 40 + 2 * ch, 100, 0);
+        };
+        // A controller moving on every channel, every block, as an MPE controller would
+        sc.eachBlock = [](SurgeSynthesizer *surge, int b) {
+            for (int ch = 1; ch <= 15; ++ch)
+            {
+                auto ph = (b + ch * 7) % 128;
+                surge->pitchBend(ch, (ph - 64) * 64);
+                surge->channelAftertouch(ch, ph);
+                surge->channelController(ch, 74, 127 - ph);
+            }
+        };
+        res.push_back(sc);
+    }
+
+    {
+        BenchmarkScenario sc;
+        sc.name = "patch-switch";
+        sc.voices = 4;
+        sc.needsPatchList = true;
+        sc.eachBlock = [](SurgeSynthesizer *surge, int b) {
+            const int every = 64;
+            int n = std::min(16, (int)surge->storage.patch_list.size());
+            if (n == 0)
+                return;
+            if (b % every == 0)
+            {
+                surge->patch_loaded = false;
+                surge->patchid_queue = (b / every) % n;
+            }
+            if (b % every == every / 2)
+                playBenchmarkNotes(surge, 4);
+        };
+        res.push_back(sc);
+    }
+
+    return res;
+}
+
+std::string jsonEscaped(const std::string &s)
+{
+    std::string res;
+    for (auto c : s)
+    {
+        if (c == '"' || c == '\\')
+            res += '\\';
+        res += c;
+    }
+    return res;
+}
+} // namespace
+
+void benchmark(int blocks, const std::string &only, const std::string &outFile)
+{
+    if (blocks <= 0)
+        blocks = 48000 / BLOCK_SIZE * 2;
+    const int sr = 48000;
+    const int warmupBlocks = 100;
+    const double budgetNS = 1e9 * BLOCK_SIZE / sr;
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"version\": \"" << jsonEscaped(Surge::Build::FullVersionStr) << "\",\n"
+         << "  \"sampleRate\": " << sr << ",\n"
+         << "  \"blockSize\": " << BLOCK_SIZE << ",\n"
+         << "  \"blocks\": " << blocks << ",\n"
+         << "  \"scenarios\": [";
+
+    bool first = true;
+    for (auto &sc : benchmarkScenarios())
+    {
+        if (!only.empty() && sc.name.find(only) == std::string::npos)
+            continue;
+
+        // std::rand for the scenarios' own choices, and the engine's generators (noise, drift,
+        // S&H) which are otherwise seeded from the clock
+        srand(1);
+        auto surge = Surge::Headless::createSurge(sr, sc.needsPatchList);
+        surge->storage.seed_rand(1);
+        surge->storage.getPatch().polylimit.val.i = MAX_VOICES;
+        if (sc.setup)
+            sc.setup(surge.get());
+
+        for (int i = 0; i < 20; ++i)
+            surge->process();
+        if (sc.notes)
+            sc.notes(surge.get());
+        else
+            playBenchmarkNotes(surge.get(), sc.voices);
+        for (int i = 0; i < warmupBlocks; ++i)
+            surge->process();
+
+        std::vector<double> ns(blocks);
+        for (int b = 0; b < blocks; ++b)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (sc.eachBlock)
+                sc.eachBlock(surge.get(), b);
+            surge->process();
+            ns[b] = std::chrono::duration<double, std::nano>(
+                        std::chrono::high_resolution_clock::now() - start)
+                        .count();
+        }
+
+        double mean = 0;
+        for (auto n : ns)
+            mean += n;
+        mean /= blocks;
+        std::sort(ns.begin(), ns.end());
+        auto pct = [&ns](double p) { return ns[std::min(ns.size() - 1, (size_t)(p * ns.size()))]; };
+
+        std::cerr << std::left << std::setw(40) << sc.name << " " << std::fixed
+                  << std::setprecision(0) << mean << " ns/block" << std::endl;
+
+        json << (first ? "" : ",") << "\n    {\"name\": \"" << jsonEscaped(sc.name)
+             << "\", \"voices\": " << sc.voices << std::fixed << std::setprecision(1)
+             << ", \"nsPerBlock\": " << mean << ", \"p50\": " << pct(0.5)
+             << ", \"p90\": " << pct(0.9) << ", \"p99\": " << pct(0.99)
+             << ", \"max\": " << ns.back() << ", \"realtimePct\": " << 100.0 * mean / budgetNS
+             << ", \"voicesAtRealtime\": " << sc.voices * budgetNS / mean << "}";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    if (outFile.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream ofs(string_to_path(outFile));
+        ofs << json.str();
+        std::cerr << "Wrote " << outFile << std::endl;
+    }
+}
+
+void processProfileReport(const std::string &patchName, int seconds)
+{
+    typedef Surge::Profiling::ProcessProfiler prof_t;
+
+    if (seconds <= 0)
+        seconds = 5;
+    const int sr = 48000;
+    const int blocksPerSecond = sr / BLOCK_SIZE;
+
+    auto surge = Surge::Headless::createSurge(sr);
+    if (!patchName.empty())
+        surge->loadPatchByPath(patchName.c_str(), -1, "RUNTIME");
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+    for (auto key : {48, 55, 60, 64, 67, 72})
+        surge->playNote(0, key, 100, 0);
+
+    auto &profiler = *surge->storage.processProfiler;
+    auto start = profiler.poll();
+    auto last = start;
+
+    // One row a second, as a host's meter would poll it, then everything over the whole run
+    std::cout << "second,nsPerBlock";
+    for (int st = 0; st < prof_t::n_stages; ++st)
+        std::cout << "," << prof_t::stageName(st);
+    std::cout << std::endl;
+
+    for (int sec = 0; sec < seconds; ++sec)
+    {
+        for (int i = 0; i < blocksPerSecond; ++i)
+            surge->process();
+
+        auto now = profiler.poll();
+        auto c = now.since(last);
+        last = now;
+
+        std::cout << sec << "," << 1.0 * c.blockNS / c.blocks;
+        for (int st = 0; st < prof_t::n_stages; ++st)
+            std::cout << "," << c.toNS(c.stageTicks[st]) / c.blocks;
+        std::cout << std::endl;
+    }
+
+    auto c = last.since(start);
+    const double budgetNS = 1e9 * BLOCK_SIZE / sr;
+    std::cout << "\nOver " << c.blocks << " blocks: " << 1.0 * c.blockNS / c.blocks
+              << " ns/block, " << 100.0 * c.blockNS / c.blocks / budgetNS << "% of real time\n"
+              << "\npart,nsPerBlock,pctOfBlock\n";
+    auto row = [&](const std::string &name, uint64_t ticks) {
+        auto ns = c.toNS(ticks) / c.blocks;
+        std::cout << "\"" << name << "\"," << ns << "," << 100.0 * ns * c.blocks / c.blockNS
+                  << std::endl;
+    };
+    for (int st = 0; st < prof_t::n_stages; ++st)
+        row(std::string("stage ") + prof_t::stageName(st), c.stageTicks[st]);
+    for (int sl = 0; sl < n_fx_slots; ++sl)
+        if (c.fxSlotTicks[sl])
+            row(std::string("fx ") + fxslot_names[sl], c.fxSlotTicks[sl]);
+    for (int ot = 0; ot < n_osc_types; ++ot)
+        if (c.oscBlocks[ot])
+            row(std::string("osc ") + osc_type_names[ot], c.oscTicks[ot]);
+    row("filter chain", c.filterChainTicks);
+}
+
 void generateNLFeedbackNorms()
 {
     /*
@@ -8,10 +8,19 @@ namespace Headless
 namespace NonTest
 {
 void restreamTemplatesWithModifications();
-void statsFromPlayingEveryPatch();
+void statsFromPlayingEveryPatch(int jobs = 1);
 void filterAnalyzer(int ft, int fst, std::ostream &os);
 void generateNLFeedbackNorms();
-[[noreturn]] void performancePlay(const std::string &patchName, int mode);
+void voiceThreadScaling(int maxThreads);
+void patchSwitchLatency(int nPatches);
+void formulaThroughput(int maxVoices);
+void msegThroughput();
+void prewarmWavetableCache(const std::string &dir, int jobs);
+void timeToFirstProcess(int runs);
+void benchmark(int blocks, const std::string &only, const std::string &outFile);
+void processProfileReport(const std::string &patchName, int seconds);
+[[noreturn]] void performancePlay(const std::string &patchName, int mode,
+                                  bool multithreadedScenes = false);
 } // namespace NonTest
 } // namespace Headless
 } // namespace Surge
@@ -1,6 +1,8 @@
 #include "HeadlessUtils.h"
 #include "HeadlessPluginLayerProxy.h"
+#include "WavetableLoader.h"
 
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 
@@ -13,7 +15,7 @@ namespace Surge
 namespace Headless
 {
 static std::unique_ptr<HeadlessPluginLayerProxy> parent = nullptr;
-std::shared_ptr<SurgeSynthesizer> createSurge(int sr)
+std::shared_ptr<SurgeSynthesizer> createSurge(int sr, bool waitForPatchList)
 {
     if (parent.get() == nullptr)
         parent.reset(new HeadlessPluginLayerProxy());
@@ -21,9 +23,60 @@ std::shared_ptr<SurgeSynthesizer> createSurge(int sr)
     surge->setSamplerate(sr);
     surge->time_data.tempo = 120;
     surge->time_data.ppqPos = 0;
+    // tests and players go straight to the patch list, so have it in place
+    if (waitForPatchList)
+        surge->storage.ensurePatchListLoaded();
     return surge;
 }
 
+LockStepResult renderInLockStep(const std::function<void(SurgeSynthesizer *, bool)> &setup,
+                                const LockStepNotes &notes)
+{
+    auto plain = createSurge(44100);
+    auto other = createSurge(44100);
+    setup(plain.get(), false);
+    setup(other.get(), true);
+
+    // Tables the setups asked for arrive on the loader thread, so have both synths hold them first
+    for (auto s : {plain.get(), other.get()})
+    {
+        s->process();
+        s->storage.wavetableLoader->waitForPendingLoads();
+    }
+
+    LockStepResult res;
+    for (int b = 0; b < notes.blocks; ++b)
+    {
+        if (b % notes.period == 0 && b < notes.lastNoteOn)
+        {
+            auto n = notes.lowKey + (b / notes.period) % notes.keys;
+            auto vel = notes.varyVelocity ? 40 + (b * 7) % 87 : 100;
+            plain->playNote(0, n, vel, 0);
+            other->playNote(0, n, vel, 0);
+        }
+        if (b % notes.period == notes.period / 2 && b > notes.firstRelease)
+        {
+            auto n = notes.lowKey + ((b - notes.firstRelease) / notes.period) % notes.keys;
+            plain->releaseNote(0, n, 0);
+            other->releaseNote(0, n, 0);
+        }
+
+        plain->process();
+        other->process();
+
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < BLOCK_SIZE; ++s)
+            {
+                if (plain->output[c][s] != other->output[c][s])
+                    res.mismatches++;
+                res.sumAbsOut += fabs(plain->output[c][s]);
+            }
+    }
+    res.plain = plain;
+    res.other = other;
+    return res;
+}
+
 void writeToStream(const float *data, int nSamples, int nChannels, std::ostream &str)
 {
     int overSample = 8;
@@ -6,12 +6,48 @@
 
 #include "SurgeSynthesizer.h"
 
+#include <functional>
+
 namespace Surge
 {
 namespace Headless
 {
 
-std::shared_ptr<SurgeSynthesizer> createSurge(int sr);
+/*
+** Unless waitForPatchList is false, the patch list is in place when this returns,
+** rather than still being scanned in the background.
+*/
+std::shared_ptr<SurgeSynthesizer> createSurge(int sr, bool waitForPatchList = true);
+
+/*
+** The notes renderInLockStep plays: one every period blocks up to lastNoteOn, walking up
+** through keys keys from lowKey, and from firstRelease on each is let go half a period after
+** it started, in the same order.
+*/
+struct LockStepNotes
+{
+    int blocks = 2000;
+    int period = 20;
+    int lastNoteOn = 1200, firstRelease = 600;
+    int lowKey = 36, keys = 48;
+    bool varyVelocity = false; // otherwise every note is at 100
+};
+
+struct LockStepResult
+{
+    int mismatches = 0;  // output samples where the two synths differ at all
+    float sumAbsOut = 0; // of the plain synth, so a test can tell something played
+    // the two synths, kept so a test can check the other way of rendering was really taken
+    std::shared_ptr<SurgeSynthesizer> plain, other;
+};
+
+/*
+** Make two synths, set up one with setup(surge, false) and the other with setup(surge, true),
+** play them the same notes and compare every sample. For checking that an optional way of
+** rendering sounds exactly like the plain one.
+*/
+LockStepResult renderInLockStep(const std::function<void(SurgeSynthesizer *, bool)> &setup,
+                                const LockStepNotes &notes = LockStepNotes());
 
 void writeToStream(const float *data, int nSamples, int nChannels, std::ostream &str);
 void writeToWav(const float *data, int nSamples, int nChannels, float sampleRate,
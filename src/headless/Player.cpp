@@ -1,5 +1,10 @@
 #include "Player.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace Surge
 {
 namespace Headless
@@ -132,32 +137,100 @@ void playOnPatch(std::shared_ptr<SurgeSynthesizer> surge, int patch, const playe
 void playOnEveryPatch(std::shared_ptr<SurgeSynthesizer> surge, const playerEvents_t &events,
                       std::function<void(const Patch &p, const PatchCategory &c, const float *data,
                                          int nSamples, int nChannels)>
-                          cb)
+                          cb,
+                      int nJobs)
 {
     int nPresets = surge->storage.patch_list.size();
-    int nCats = surge->storage.patch_category.size();
 
+    std::vector<int> order;
     for (auto c : surge->storage.patchCategoryOrdering)
     {
         for (auto i = 0; i < nPresets; ++i)
         {
             int idx = surge->storage.patchOrdering[i];
-            Patch p = surge->storage.patch_list[idx];
-            if (p.category == c)
-            {
-                PatchCategory pc = surge->storage.patch_category[p.category];
+            if (surge->storage.patch_list[idx].category == c)
+                order.push_back(idx);
+        }
+    }
+
+    auto report = [&](int idx, const float *data, int nSamples, int nChannels) {
+        Patch p = surge->storage.patch_list[idx];
+        PatchCategory pc = surge->storage.patch_category[p.category];
+        cb(p, pc, data, nSamples, nChannels);
+    };
+
+    nJobs = std::min(nJobs, (int)order.size());
+    if (nJobs <= 1)
+    {
+        for (auto idx : order)
+        {
+            float *data = NULL;
+            int nSamples = 0, nChannels = 0;
 
-                float *data = NULL;
-                int nSamples, nChannels;
+            playOnPatch(surge, idx, events, &data, &nSamples, &nChannels);
+            report(idx, data, nSamples, nChannels);
 
-                playOnPatch(surge, i, events, &data, &nSamples, &nChannels);
-                cb(p, pc, data, nSamples, nChannels);
+            if (data)
+                delete[] data;
+        }
+        return;
+    }
 
-                if (data)
-                    delete[] data;
+    /*
+     * Each worker plays on its own synth, taking the next unplayed patch whenever it finishes
+     * one, and we hand the results to cb here in list order as they come in. The synths are made
+     * up front on this thread; they all scan the same library, so patch indices agree. Each
+     * evaluates formula modulators in its own storage's Lua state, so those patches are fine too.
+     */
+    std::vector<std::shared_ptr<SurgeSynthesizer>> synths{surge};
+    for (int i = 1; i < nJobs; ++i)
+        synths.push_back(createSurge((int)samplerate));
+
+    struct Played
+    {
+        bool ready = false;
+        float *data = NULL;
+        int nSamples = 0, nChannels = 0;
+    };
+    std::vector<Played> played(order.size());
+    std::atomic<size_t> next{0};
+    std::mutex m;
+    std::condition_variable cv;
+
+    std::vector<std::thread> workers;
+    for (auto &s : synths)
+    {
+        workers.emplace_back([&, s]() {
+            for (auto i = next++; i < order.size(); i = next++)
+            {
+                Played res;
+                playOnPatch(s, order[i], events, &res.data, &res.nSamples, &res.nChannels);
+                res.ready = true;
+                {
+                    std::lock_guard<std::mutex> g(m);
+                    played[i] = res;
+                }
+                cv.notify_all();
             }
+        });
+    }
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        Played res;
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&]() { return played[i].ready; });
+            res = played[i];
         }
+        report(order[i], res.data, res.nSamples, res.nChannels);
+
+        if (res.data)
+            delete[] res.data;
     }
+
+    for (auto &w : workers)
+        w.join();
 }
 
 void playOnNRandomPatches(std::shared_ptr<SurgeSynthesizer> surge, const playerEvents_t &events,
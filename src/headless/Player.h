@@ -76,12 +76,15 @@ void playOnPatch(std::shared_ptr<SurgeSynthesizer> synth, int patch, const playe
  * playOnEveryPatch
  *
  * Play the events on every patch Surge knows callign the callback for each one with
- * the result.
+ * the result. With nJobs above 1 the patches are shared out among that many threads, each
+ * playing on its own synth (synth plus nJobs - 1 new ones); the callback is still called on
+ * this thread, once per patch, in the same order as a serial run.
  */
 void playOnEveryPatch(std::shared_ptr<SurgeSynthesizer> synth, const playerEvents_t &events,
                       std::function<void(const Patch &p, const PatchCategory &c, const float *data,
                                          int nSamples, int nChannels)>
-                          completedCallback);
+                          completedCallback,
+                      int nJobs = 1);
 
 /**
  * playOnEveryNRandomPatches
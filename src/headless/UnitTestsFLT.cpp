@@ -80,3 +80,80 @@ TEST_CASE("Run Every Waveshaper", "[flt]")
         }
     }
 }
+
+TEST_CASE("Wide Filter Chain Matches SSE", "[flt]")
+{
+    auto render = [](int lanes, int fu1, int fu1st, int fu2, int fu2st, int ws, int config,
+                     std::vector<float> &out) {
+        auto surge = Surge::Headless::createSurge(44100);
+        REQUIRE(surge);
+        surge->setFilterChainLanes(lanes);
+        REQUIRE(surge->getFilterChainLanes() == lanes);
+
+        auto &sc = surge->storage.getPatch().scene[0];
+        sc.filterunit[0].type.val.i = fu1;
+        sc.filterunit[0].subtype.val.i = fu1st;
+        sc.filterunit[1].type.val.i = fu2;
+        sc.filterunit[1].subtype.val.i = fu2st;
+        sc.wsunit.type.val.i = ws;
+        sc.wsunit.drive.set_value_f01(0.8);
+        sc.filterblock_configuration.val.i = config;
+        sc.feedback.set_value_f01(0.7);
+        surge->storage.getPatch().polylimit.val.i = 32;
+
+        for (int b = 0; b < 200; ++b)
+        {
+            // a chord of up to 22 voices, so there are full groups and a remainder
+            if (b % 8 == 0 && b < 176)
+                surge->playNote(0, 40 + b / 8, 100, 0);
+            if (b % 8 == 4 && b > 120)
+                surge->releaseNote(0, 40 + (b - 120) / 8, 0);
+
+            surge->process();
+            for (int c = 0; c < 2; ++c)
+                out.insert(out.end(), surge->output[c], surge->output[c] + BLOCK_SIZE);
+        }
+    };
+
+    auto compare = [&render](int fu1, int fu1st, int fu2, int fu2st, int ws, int config) {
+        std::vector<float> sse;
+        render(4, fu1, fu1st, fu2, fu2st, ws, config, sse);
+
+        for (int lanes = 8; lanes <= GetWideFilterLanesAvailable(); lanes *= 2)
+        {
+            std::vector<float> wide;
+            render(lanes, fu1, fu1st, fu2, fu2st, ws, config, wide);
+            REQUIRE(wide.size() == sse.size());
+
+            int mismatches = 0;
+            for (int i = 0; i < sse.size(); ++i)
+                if (memcmp(&wide[i], &sse[i], sizeof(float)))
+                    mismatches++;
+            INFO("lanes " << lanes);
+            REQUIRE(mismatches == 0);
+        }
+    };
+
+    for (int fn = 0; fn < n_fu_types; fn++)
+    {
+        auto nst = std::max(1, fut_subcount[fn]);
+        for (int fs = 0; fs < nst; ++fs)
+        {
+            DYNAMIC_SECTION("Wide Filter " << fut_names[fn] << " st: " << fs)
+            {
+                compare(fn, fs, fut_lp12, 0, wst_none, fc_serial1);
+            }
+        }
+    }
+
+    for (int wt = 0; wt < n_ws_types; wt++)
+    {
+        for (int q = 0; q < n_filter_configs; ++q)
+        {
+            DYNAMIC_SECTION("Wide WaveShaper " << wst_names[wt] << " " << fbc_names[q])
+            {
+                compare(fut_lp24, 0, fut_bp12, 1, wt, q);
+            }
+        }
+    }
+}
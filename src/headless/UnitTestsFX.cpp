@@ -61,3 +61,102 @@ TEST_CASE("Airwindows Loud", "[fx]")
         }
     }
 }
+
+TEST_CASE("FX Type Changes Load Off The Audio Thread", "[fx]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge);
+
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    auto &patch = surge->storage.getPatch();
+    auto *pt = &(patch.fx[0].type);
+    auto setType = [&](int t) {
+        surge->setParameter01(surge->idForParameter(pt), pt->value_to_normalized(t), false);
+    };
+
+    auto checkOutput = [&]() {
+        for (int p = 0; p < BLOCK_SIZE; ++p)
+        {
+            REQUIRE(std::isfinite(surge->output[0][p]));
+            REQUIRE(std::isfinite(surge->output[1][p]));
+        }
+    };
+
+    surge->playNote(0, 60, 127, 0);
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    SECTION("A new effect is built, swapped in and faded to")
+    {
+        auto loads = surge->effectLoader->loadsCompleted.load();
+
+        setType(fxt_delay);
+        surge->process();
+        surge->effectLoader->waitForPendingLoads();
+        surge->process();
+
+        REQUIRE(patch.fx[0].type.val.i == fxt_delay);
+        REQUIRE(surge->fx[0]);
+        REQUIRE(surge->effectLoader->loadsCompleted == loads + 1);
+
+        // the new effect starts from its own defaults, and fxsync agrees with the patch
+        for (int j = 0; j < n_fx_params; ++j)
+        {
+            REQUIRE(surge->fxsync[0].p[j].ctrltype == patch.fx[0].p[j].ctrltype);
+            REQUIRE(surge->fxsync[0].p[j].val.i == patch.fx[0].p[j].val.i);
+        }
+        REQUIRE(patch.fx[0].p[0].ctrltype != ct_none);
+
+        REQUIRE(surge->fxFade[0].blocksLeft > 0);
+        for (int i = 0; i < SurgeSynthesizer::fxFadeBlocks; ++i)
+        {
+            surge->process();
+            checkOutput();
+        }
+        REQUIRE(surge->fxFade[0].blocksLeft == 0);
+        REQUIRE(!surge->fxFade[0].outgoing);
+    }
+
+    SECTION("Turning a slot off fades the effect out")
+    {
+        setType(fxt_reverb);
+        surge->process();
+        surge->effectLoader->waitForPendingLoads();
+        for (int i = 0; i < 2 * SurgeSynthesizer::fxFadeBlocks; ++i)
+            surge->process();
+        REQUIRE(surge->fx[0]);
+
+        setType(fxt_off);
+        surge->process();
+        surge->effectLoader->waitForPendingLoads();
+        surge->process();
+
+        REQUIRE(patch.fx[0].type.val.i == fxt_off);
+        REQUIRE(!surge->fx[0]);
+        REQUIRE(surge->fxFade[0].outgoing);
+
+        for (int i = 0; i < SurgeSynthesizer::fxFadeBlocks; ++i)
+        {
+            surge->process();
+            checkOutput();
+        }
+        REQUIRE(!surge->fxFade[0].outgoing);
+    }
+
+    SECTION("Changes made while a load is in flight are not lost")
+    {
+        setType(fxt_delay);
+        surge->process();
+        setType(fxt_chorus4);
+        for (int i = 0; i < 100 && patch.fx[0].type.val.i != fxt_chorus4; ++i)
+        {
+            surge->effectLoader->waitForPendingLoads();
+            surge->process();
+        }
+
+        REQUIRE(patch.fx[0].type.val.i == fxt_chorus4);
+        REQUIRE(surge->fx[0]);
+    }
+}
@@ -4,9 +4,49 @@
 #include "HeadlessUtils.h"
 #include "BiquadFilter.h"
 #include "QuadFilterUnit.h"
+#include "Oscillator.h"
+#include "ProcessProfiler.h"
 
 #include "catch2/catch2.hpp"
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+ * Replace the global allocator with one which can count, so tests can assert that code which
+ * has to run on the audio thread doesn't allocate.
+ */
+namespace
+{
+std::atomic<bool> countAllocations{false};
+std::atomic<int> allocationCount{0};
+
+struct AllocationCounter
+{
+    AllocationCounter()
+    {
+        allocationCount = 0;
+        countAllocations = true;
+    }
+    ~AllocationCounter() { countAllocations = false; }
+    int count() const { return allocationCount; }
+};
+} // namespace
+
+void *operator new(size_t sz)
+{
+    if (countAllocations)
+        allocationCount++;
+
+    auto p = std::malloc(sz ? sz : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
 inline size_t align_diff(const void *ptr, std::uintptr_t alignment) noexcept
 {
     auto iptr = reinterpret_cast<std::uintptr_t>(ptr);
@@ -78,4 +118,186 @@ TEST_CASE("QFU is Aligned", "[infra]")
             delete[] f;
         }
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Oscillator Spawn Does Not Allocate", "[infra]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge);
+
+    auto storage = &(surge->storage);
+    auto oscdata = &(storage->getPatch().scene[0].osc[0]);
+    pdata *localcopy = storage->getPatch().scenedata[0];
+
+    for (int ot = 0; ot < n_osc_types; ++ot)
+    {
+        INFO("Spawning " << osc_type_names[ot]);
+
+        oscdata->type.val.i = ot;
+        storage->getPatch().update_controls(false, oscdata);
+        storage->reserveOscillatorBlocks();
+        for (int i = 0; i < 4; ++i)
+            surge->process();
+
+        unsigned char buffer alignas(16)[oscillator_buffer_size];
+        int allocs = 0;
+        bool spawned = false;
+        {
+            // No REQUIREs in here; catch allocates when it records an assertion
+            AllocationCounter ac;
+
+            auto osc = spawn_osc(ot, storage, oscdata, localcopy, buffer);
+            spawned = (osc != nullptr);
+            if (osc)
+            {
+                osc->init(60.f);
+                for (int b = 0; b < 16; ++b)
+                    osc->process_block(60.f, 0.f, true);
+                release_osc(osc, storage, buffer);
+            }
+
+            allocs = ac.count();
+        }
+        REQUIRE(spawned);
+        REQUIRE(allocs == 0);
+        REQUIRE(storage->oscillatorBlockPool->exhaustedRequests == 0);
+    }
+}
+
+TEST_CASE("A Dry Oscillator Pool Spawns A Silent Oscillator", "[infra]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge);
+
+    auto storage = &(surge->storage);
+    auto oscdata = &(storage->getPatch().scene[0].osc[0]);
+    pdata *localcopy = storage->getPatch().scenedata[0];
+    oscdata->type.val.i = ot_string;
+    storage->getPatch().update_controls(false, oscdata);
+    REQUIRE(osc_needs_pool_block(ot_string));
+
+    auto pool = storage->oscillatorBlockPool.get();
+    std::vector<unsigned char *> taken;
+    while (auto b = pool->getBlock())
+        taken.push_back(b);
+    auto exhausted = pool->exhaustedRequests.load();
+
+    unsigned char buffer alignas(16)[oscillator_buffer_size];
+    int allocs = 0;
+    Oscillator *osc = nullptr;
+    float sumAbsOut = 0.f;
+    {
+        AllocationCounter ac;
+
+        osc = spawn_osc(ot_string, storage, oscdata, localcopy, buffer);
+        if (osc)
+        {
+            osc->init(60.f);
+            for (int b = 0; b < 16; ++b)
+            {
+                osc->process_block(60.f, 0.f, true);
+                for (int i = 0; i < BLOCK_SIZE_OS; ++i)
+                    sumAbsOut += fabs(osc->output[i]) + fabs(osc->outputR[i]);
+            }
+        }
+
+        allocs = ac.count();
+    }
+    REQUIRE(osc == (Oscillator *)buffer);
+    REQUIRE(dynamic_cast<SilentOscillator *>(osc));
+    REQUIRE(sumAbsOut == 0.f);
+    REQUIRE(allocs == 0);
+    REQUIRE(pool->exhaustedRequests == exhausted + 1);
+    REQUIRE(pool->blocksCreated() == taken.size());
+
+    release_osc(osc, storage, buffer);
+    for (auto b : taken)
+        pool->returnBlock(b);
+}
+
+TEST_CASE("Voice Start And Process Do Not Allocate", "[infra]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge);
+
+    surge->storage.getPatch().polylimit.val.i = MAX_VOICES;
+    surge->storage.reserveOscillatorBlocks();
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    int allocs = 0;
+    int maxVoices = 0;
+    {
+        AllocationCounter ac;
+
+        for (int k = 0; k < 48; ++k)
+        {
+            surge->playNote(0, 36 + k, 100, 0);
+            surge->process();
+        }
+        maxVoices = surge->voices[0].size();
+        for (int k = 0; k < 48; k += 2)
+            surge->releaseNote(0, 36 + k, 0);
+        for (int i = 0; i < 200; ++i)
+            surge->process();
+        for (int k = 1; k < 48; k += 2)
+            surge->releaseNote(0, 36 + k, 0);
+        for (int i = 0; i < 2000; ++i)
+            surge->process();
+
+        allocs = ac.count();
+    }
+    REQUIRE(maxVoices > 32);
+    REQUIRE(surge->voices[0].empty());
+    REQUIRE(allocs == 0);
+}
+
+TEST_CASE("Process Profiler Counts Each Stage", "[infra]")
+{
+    typedef Surge::Profiling::ProcessProfiler prof_t;
+
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge);
+
+    auto &patch = surge->storage.getPatch();
+    REQUIRE(patch.scene[0].osc[0].type.val.i == ot_classic);
+    auto *pt = &(patch.fx[fxslot_global1].type);
+    surge->setParameter01(surge->idForParameter(pt), pt->value_to_normalized(fxt_reverb), false);
+    for (int i = 0; i < 100 && pt->val.i != fxt_reverb; ++i)
+    {
+        surge->process();
+        surge->effectLoader->waitForPendingLoads();
+    }
+    REQUIRE(pt->val.i == fxt_reverb);
+
+    surge->playNote(0, 60, 100, 0);
+    surge->playNote(0, 64, 100, 0);
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    const int blocks = 200;
+    auto before = surge->storage.processProfiler->poll();
+    for (int i = 0; i < blocks; ++i)
+        surge->process();
+    auto c = surge->storage.processProfiler->poll().since(before);
+
+    REQUIRE(c.blocks == blocks);
+    REQUIRE(c.blockNS > 0);
+    REQUIRE(c.nsPerTick() > 0);
+
+    // Two voices, each running at least their first oscillator every block
+    REQUIRE(c.oscBlocks[ot_classic] >= 2 * blocks);
+    REQUIRE(c.oscBlocks[ot_classic] <= 2 * n_oscs * blocks);
+    REQUIRE(c.oscTicks[ot_classic] > 0);
+
+    REQUIRE(c.fxSlotTicks[fxslot_global1] > 0);
+    REQUIRE(c.filterChainTicks > 0);
+    REQUIRE(c.stageTicks[prof_t::stage_voices] >= c.oscTicks[ot_classic] + c.filterChainTicks);
+    REQUIRE(c.stageTicks[prof_t::stage_global_fx] >= c.fxSlotTicks[fxslot_global1]);
+
+    // On one thread the stages are back to back within the block
+    uint64_t staged = 0;
+    for (int s = 0; s < prof_t::n_stages; ++s)
+        staged += c.stageTicks[s];
+    REQUIRE(staged > 0);
+    REQUIRE(staged <= c.blockTicks);
+}
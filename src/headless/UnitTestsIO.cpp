@@ -1,6 +1,7 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <fstream>
 #include <algorithm>
 
 #include "HeadlessUtils.h"
@@ -9,6 +10,10 @@
 #include "catch2/catch2.hpp"
 
 #include "UnitTestUtilities.h"
+#include "WavetableLoader.h"
+#include "WavetableCache.h"
+#include "WavetableMipmapCache.h"
+#include "LibraryScanner.h"
 #include <chrono>
 #include <thread>
 
@@ -73,6 +78,484 @@ TEST_CASE("All .wt and .wav factory assets load", "[io]")
     }
 }
 
+TEST_CASE("Queued Wavetables Load In The Background", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge.get());
+
+    auto &osc = surge->storage.getPatch().scene[0].osc[0];
+    osc.type.val.i = ot_wavetable;
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+    REQUIRE(osc.wt.everBuilt);
+
+    int idx = 0, target = -1;
+    for (auto q : surge->storage.wt_list)
+    {
+        if (q.name == "Sine Power HQ")
+            target = idx;
+        idx++;
+    }
+    REQUIRE(target >= 0);
+
+    auto loader = surge->storage.wavetableLoader.get();
+    loader->waitForPendingLoads();
+    surge->process();
+    auto before = loader->loadsCompleted.load();
+
+    surge->playNote(0, 60, 127, 0);
+    surge->storage.queue_wt(&osc.wt, target);
+    surge->process();
+    REQUIRE(osc.wt.queue_filename[0] == 0);
+
+    loader->waitForPendingLoads();
+    float sumAbsOut = 0;
+    for (int i = 0; i < 10; ++i)
+    {
+        surge->process();
+        for (int s = 0; s < BLOCK_SIZE; ++s)
+            sumAbsOut += fabs(surge->output[0][s]);
+    }
+
+    REQUIRE(sumAbsOut > 0.1);
+    REQUIRE(loader->loadsCompleted == before + 1);
+    REQUIRE(loader->lastLoadLatencyMS >= 0.f);
+    REQUIRE(osc.wt.current_id == target);
+    REQUIRE(std::string(osc.wavetable_display_name) == "Sine Power HQ");
+
+    SECTION("Patch Load Discards In Flight Loads")
+    {
+        surge->storage.queue_wt(&osc.wt, 0);
+        surge->process();
+        surge->storage.wavetableLoader->discardPendingLoads();
+        loader->waitForPendingLoads();
+        for (int i = 0; i < 10; ++i)
+            surge->process();
+        REQUIRE(osc.wt.current_id == target);
+    }
+}
+
+TEST_CASE("A First Wavetable Load Is Not Built On The Audio Thread", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge.get());
+
+    auto &osc = surge->storage.getPatch().scene[0].osc[0];
+    osc.type.val.i = ot_wavetable;
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    int idx = 0, target = -1;
+    for (auto q : surge->storage.wt_list)
+    {
+        if (q.name == "Sine Power HQ")
+            target = idx;
+        idx++;
+    }
+    REQUIRE(target >= 0);
+
+    auto loader = surge->storage.wavetableLoader.get();
+    loader->waitForPendingLoads();
+
+    // Looks like an oscillator which never had a table, such as one a patch just switched to
+    osc.wt.everBuilt = false;
+    surge->playNote(0, 60, 127, 0);
+    surge->storage.queue_wt(&osc.wt, target);
+    surge->process();
+    REQUIRE(osc.wt.queue_filename[0] == 0);
+    REQUIRE(!osc.wt.everBuilt);
+
+    float sumAbsOut = 0;
+    for (int s = 0; s < BLOCK_SIZE; ++s)
+        sumAbsOut += fabs(surge->output[0][s]);
+    REQUIRE(sumAbsOut == 0.f);
+
+    loader->waitForPendingLoads();
+    for (int i = 0; i < 10; ++i)
+    {
+        surge->process();
+        for (int s = 0; s < BLOCK_SIZE; ++s)
+            sumAbsOut += fabs(surge->output[0][s]);
+    }
+
+    REQUIRE(osc.wt.everBuilt);
+    REQUIRE(osc.wt.current_id == target);
+    REQUIRE(sumAbsOut > 0.1);
+}
+
+TEST_CASE("Saving Before A First Wavetable Load Lands Keeps The Table", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge.get());
+
+    auto &osc = surge->storage.getPatch().scene[0].osc[0];
+    osc.type.val.i = ot_wavetable;
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    int idx = 0, target = -1;
+    for (auto q : surge->storage.wt_list)
+    {
+        if (q.name == "Sine Power HQ")
+            target = idx;
+        idx++;
+    }
+    REQUIRE(target >= 0);
+
+    auto loader = surge->storage.wavetableLoader.get();
+    loader->waitForPendingLoads();
+    surge->process();
+    osc.wt.everBuilt = false;
+    surge->storage.queue_wt(&osc.wt, target);
+
+    SECTION("Posted To The Loader") { surge->process(); }
+    SECTION("Still Queued On The Oscillator") {}
+
+    void *d = nullptr;
+    auto sz = surge->saveRaw(&d);
+    REQUIRE(!osc.wt.everBuilt);
+
+    auto restored = Surge::Headless::createSurge(44100);
+    restored->loadRaw(d, sz, false);
+
+    loader->waitForPendingLoads();
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+    REQUIRE(osc.wt.everBuilt);
+    REQUIRE(osc.wt.current_id == target);
+
+    auto &rwt = restored->storage.getPatch().scene[0].osc[0].wt;
+    REQUIRE(rwt.size == osc.wt.size);
+    REQUIRE(rwt.n_tables == osc.wt.n_tables);
+    for (int t = 0; t < osc.wt.n_tables; ++t)
+    {
+        for (int i = 0; i < osc.wt.size; ++i)
+        {
+            REQUIRE(rwt.TableI16WeakPointers[0][t][i + FIRoffsetI16] ==
+                    osc.wt.TableI16WeakPointers[0][t][i + FIRoffsetI16]);
+        }
+    }
+}
+
+TEST_CASE("Wavetables Are Shared Between Instances", "[io]")
+{
+    auto surgeA = Surge::Headless::createSurge(44100);
+    auto surgeB = Surge::Headless::createSurge(44100);
+    REQUIRE(surgeA.get());
+    REQUIRE(surgeB.get());
+
+    int target = -1, other = -1, idx = 0;
+    for (auto q : surgeA->storage.wt_list)
+    {
+        if (q.name == "Sine Power HQ")
+            target = idx;
+        else if (other < 0)
+            other = idx;
+        idx++;
+    }
+    REQUIRE(target >= 0);
+    REQUIRE(other >= 0);
+
+    auto fn = path_to_string(surgeA->storage.wt_list[target].path);
+    auto key = Surge::Storage::WavetableCache::keyForFile(fn);
+    REQUIRE(!key.empty());
+
+    auto &oscA = surgeA->storage.getPatch().scene[0].osc[0];
+    auto &oscB = surgeB->storage.getPatch().scene[1].osc[2];
+    surgeA->storage.load_wt(target, &oscA.wt, &oscA);
+    surgeB->storage.load_wt(target, &oscB.wt, &oscB);
+
+    REQUIRE(oscA.wt.isShared());
+    REQUIRE(oscB.wt.isShared());
+    REQUIRE(oscA.wt.TableF32Data == oscB.wt.TableF32Data);
+    REQUIRE(oscA.wt.TableI16WeakPointers[1][0] == oscB.wt.TableI16WeakPointers[1][0]);
+    REQUIRE(std::string(oscB.wavetable_display_name) == "Sine Power HQ");
+
+    // The shared table is the one a private load builds
+    Wavetable reference;
+    REQUIRE(surgeA->storage.load_wt_wt(fn, &reference));
+    auto matchesReference = [&reference](const Wavetable &wt) {
+        if (wt.size != reference.size || wt.n_tables != reference.n_tables ||
+            wt.flags != reference.flags)
+            return false;
+        for (int l = 0; l < max_mipmap_levels && (reference.size >> l) > 0; ++l)
+        {
+            for (int t = 0; t < reference.n_tables; ++t)
+            {
+                auto *rf = reference.TableF32WeakPointers[l][t];
+                auto *ri = reference.TableI16WeakPointers[l][t];
+                if (!rf)
+                    continue;
+                if (memcmp(rf, wt.TableF32WeakPointers[l][t],
+                           (reference.size >> l) * sizeof(float)) != 0)
+                    return false;
+                if (ri && memcmp(ri, wt.TableI16WeakPointers[l][t],
+                                 ((reference.size >> l) + FIRoffsetI16) * sizeof(short)) != 0)
+                    return false;
+            }
+        }
+        return true;
+    };
+    REQUIRE(matchesReference(oscA.wt));
+
+    SECTION("Building Into A Shared Table Leaves The Others Alone")
+    {
+        surgeA->storage.load_wt_wav_portable("resources/test-data/wav/pluckalgo.wav", &oscA.wt);
+        REQUIRE(!oscA.wt.isShared());
+        REQUIRE(oscA.wt.n_tables == 9);
+        REQUIRE(oscB.wt.isShared());
+        REQUIRE(matchesReference(oscB.wt));
+    }
+
+    SECTION("Copies Share Too")
+    {
+        Wavetable copy;
+        copy.Copy(&oscA.wt);
+        REQUIRE(copy.isShared());
+        REQUIRE(copy.TableF32Data == oscA.wt.TableF32Data);
+    }
+
+    SECTION("The Last Reader Releases The Table")
+    {
+        surgeA->storage.load_wt(other, &oscA.wt, &oscA);
+        surgeB->storage.load_wt(other, &oscB.wt, &oscB);
+
+        bool rebuilt = false;
+        auto again = Surge::Storage::WavetableCache::get(key, [&](Wavetable *wt) {
+            rebuilt = true;
+            return surgeA->storage.load_wt_wt(fn, wt);
+        });
+        REQUIRE(rebuilt);
+        REQUIRE(again);
+        REQUIRE(matchesReference(*again));
+    }
+}
+
+TEST_CASE("Wavetable Mipmap Cache Round Trips", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge.get());
+
+    std::string fn;
+    for (auto q : surge->storage.wt_list)
+        if (q.name == "Sine Power HQ")
+            fn = path_to_string(q.path);
+    REQUIRE(!fn.empty());
+
+    auto dir = path_to_string(fs::temp_directory_path() / "surge-wtmipmap-test");
+    std::error_code ec;
+    fs::remove_all(string_to_path(dir), ec);
+
+    auto key = Surge::Storage::WavetableCache::keyForFile(fn);
+    auto built = std::make_unique<Wavetable>();
+    REQUIRE(surge->storage.load_wt_wt(fn, built.get()));
+
+    auto loaded = std::make_unique<Wavetable>();
+    REQUIRE(!Surge::Storage::WavetableMipmapCache::read(dir, fn, key, loaded.get()));
+    REQUIRE(Surge::Storage::WavetableMipmapCache::write(dir, fn, key, built.get()));
+
+    SECTION("The Table Comes Back As Built")
+    {
+        REQUIRE(Surge::Storage::WavetableMipmapCache::read(dir, fn, key, loaded.get()));
+        REQUIRE(loaded->isShared());
+        REQUIRE(((uintptr_t)loaded->TableF32Data & 15) == 0);
+        REQUIRE(loaded->size == built->size);
+        REQUIRE(loaded->n_tables == built->n_tables);
+        REQUIRE(loaded->size_po2 == built->size_po2);
+        REQUIRE(loaded->flags == built->flags);
+        REQUIRE(loaded->dataSizes == built->dataSizes);
+        REQUIRE(memcmp(loaded->TableF32Data, built->TableF32Data,
+                       built->dataSizes * sizeof(float)) == 0);
+        REQUIRE(memcmp(loaded->TableI16Data, built->TableI16Data,
+                       built->dataSizes * sizeof(short)) == 0);
+        for (int l = 0; l < max_mipmap_levels; ++l)
+        {
+            for (int t = 0; t < max_subtables; ++t)
+            {
+                auto bf = built->TableF32WeakPointers[l][t];
+                auto lf = loaded->TableF32WeakPointers[l][t];
+                REQUIRE((bf == nullptr) == (lf == nullptr));
+                if (bf)
+                    REQUIRE(bf - built->TableF32Data == lf - loaded->TableF32Data);
+            }
+        }
+
+        // Copies keep reading the file after the table they came from is gone
+        Wavetable copy;
+        copy.Copy(loaded.get());
+        loaded.reset();
+        REQUIRE(copy.isShared());
+        REQUIRE(copy.TableF32WeakPointers[0][0][7] == built->TableF32WeakPointers[0][0][7]);
+    }
+
+    SECTION("A Changed Source Misses")
+    {
+        REQUIRE(!Surge::Storage::WavetableMipmapCache::read(dir, fn, key + "x", loaded.get()));
+    }
+
+    SECTION("A Damaged File Misses")
+    {
+        auto cf = string_to_path(Surge::Storage::WavetableMipmapCache::cacheFileFor(dir, fn));
+        {
+            std::fstream f(cf, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(8);
+            uint32_t badVersion = 0xFFFFFFFF;
+            f.write(reinterpret_cast<const char *>(&badVersion), sizeof(badVersion));
+        }
+        REQUIRE(!Surge::Storage::WavetableMipmapCache::read(dir, fn, key, loaded.get()));
+
+        fs::resize_file(cf, 100, ec);
+        REQUIRE(!Surge::Storage::WavetableMipmapCache::read(dir, fn, key, loaded.get()));
+    }
+
+    SECTION("A Layout Which Doesn't Fit Misses")
+    {
+        // size follows the tag, version, byte order and the two element sizes
+        auto cf = string_to_path(Surge::Storage::WavetableMipmapCache::cacheFileFor(dir, fn));
+        for (int32_t badSize : {built->size * 2, built->size + 1, max_wtable_size * 2})
+        {
+            {
+                std::fstream f(cf, std::ios::in | std::ios::out | std::ios::binary);
+                f.seekp(24);
+                f.write(reinterpret_cast<const char *>(&badSize), sizeof(badSize));
+            }
+            REQUIRE(!Surge::Storage::WavetableMipmapCache::read(dir, fn, key, loaded.get()));
+        }
+    }
+
+    loaded.reset();
+    fs::remove_all(string_to_path(dir), ec);
+}
+
+TEST_CASE("Wavetable Mipmap Cache Trims The Least Recently Used", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge.get());
+
+    std::string used, unused;
+    for (auto q : surge->storage.wt_list)
+    {
+        if (q.name == "Sine Power HQ")
+            used = path_to_string(q.path);
+        else if (unused.empty())
+            unused = path_to_string(q.path);
+    }
+    REQUIRE(!used.empty());
+    REQUIRE(!unused.empty());
+
+    auto dir = path_to_string(fs::temp_directory_path() / "surge-wtmipmap-trim-test");
+    std::error_code ec;
+    fs::remove_all(string_to_path(dir), ec);
+
+    using Surge::Storage::WavetableMipmapCache;
+    uint64_t total = 0;
+    auto age = 2;
+    for (const auto &fn : {used, unused})
+    {
+        auto wt = std::make_unique<Wavetable>();
+        REQUIRE(surge->storage.load_wt(fn, wt.get(), nullptr));
+        auto key = Surge::Storage::WavetableCache::keyForFile(fn);
+        REQUIRE(WavetableMipmapCache::write(dir, fn, key, wt.get()));
+
+        // used was written first, so it starts out as the older of the two
+        auto cf = string_to_path(WavetableMipmapCache::cacheFileFor(dir, fn));
+        fs::last_write_time(cf, fs::file_time_type::clock::now() - std::chrono::hours(age--), ec);
+        total += fs::file_size(cf, ec);
+    }
+
+    REQUIRE(WavetableMipmapCache::trim(dir, total) == 0);
+
+    auto loaded = std::make_unique<Wavetable>();
+    REQUIRE(WavetableMipmapCache::read(
+        dir, used, Surge::Storage::WavetableCache::keyForFile(used), loaded.get()));
+    loaded.reset();
+
+    REQUIRE(WavetableMipmapCache::trim(dir, total - 1) == 1);
+    REQUIRE(fs::exists(string_to_path(WavetableMipmapCache::cacheFileFor(dir, used))));
+    REQUIRE(!fs::exists(string_to_path(WavetableMipmapCache::cacheFileFor(dir, unused))));
+
+    fs::remove_all(string_to_path(dir), ec);
+}
+
+TEST_CASE("Library Scans Reuse Unchanged Directories", "[io]")
+{
+    using Surge::Storage::LibraryScanner;
+
+    auto root = fs::temp_directory_path() / "surge-libscan-test";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "a" / "b");
+    fs::create_directories(root / "c");
+    auto touch = [](const fs::path &p) { std::ofstream(p) << "x"; };
+    touch(root / "a" / "x.fxp");
+    touch(root / "a" / "notes.txt");
+    touch(root / "a" / "b" / "z.wt");
+    touch(root / "c" / "w.WAV");
+
+    auto rootS = path_to_string(root);
+    auto manifest = path_to_string(root / "library.manifest");
+    auto key = [&root](const fs::path &rel) { return path_to_string(root / rel); };
+
+    LibraryScanner::Stats stats;
+    auto first = LibraryScanner::scan({key("a"), key("c")}, manifest, {}, &stats);
+    REQUIRE(stats.listed == 3);
+    REQUIRE(stats.reused == 0);
+    REQUIRE(first[key("a")].subdirs == std::vector<std::string>{"b"});
+    REQUIRE(first[key("a")].files == std::vector<std::string>{"x.fxp"});
+    REQUIRE(first[path_to_string(root / "a" / "b")].files == std::vector<std::string>{"z.wt"});
+    REQUIRE(first[key("c")].files == std::vector<std::string>{"w.WAV"});
+
+    auto second = LibraryScanner::scan({key("a"), key("c")}, manifest, {}, &stats);
+    REQUIRE(stats.listed == 0);
+    REQUIRE(stats.reused == 3);
+    REQUIRE(second[key("a")].files == first[key("a")].files);
+
+    SECTION("A Changed Directory Is Listed Again")
+    {
+        touch(root / "a" / "y.fxp");
+        // make sure the time moves even on file systems with coarse timestamps
+        fs::last_write_time(root / "a", fs::last_write_time(root / "a") + std::chrono::hours(1));
+
+        auto third = LibraryScanner::scan({key("a"), key("c")}, manifest, {}, &stats);
+        REQUIRE(stats.listed == 1);
+        REQUIRE(stats.reused == 2);
+        REQUIRE(third[key("a")].files == std::vector<std::string>{"x.fxp", "y.fxp"});
+    }
+
+    SECTION("Skipped Directories Are Left Out")
+    {
+        auto skipped = LibraryScanner::scan({key("a")}, "", {key(fs::path("a") / "b")}, &stats);
+        REQUIRE(stats.listed == 1);
+        REQUIRE(skipped[key("a")].subdirs.empty());
+        REQUIRE(skipped.find(path_to_string(root / "a" / "b")) == skipped.end());
+    }
+
+    fs::remove_all(root, ec);
+}
+
+TEST_CASE("A Synth Plays Before Its Patch List Is In", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100, false);
+    REQUIRE(surge.get());
+    REQUIRE(surge->storage.getPatch().name == "Init Saw");
+    surge->process();
+
+    // a poller sees the scan finish by itself, then publishes the list without waiting
+    for (int i = 0; i < 2000 && !surge->storage.isPatchScanFinished(); ++i)
+        std::this_thread::sleep_for(5ms);
+    REQUIRE(surge->storage.isPatchScanFinished());
+
+    surge->storage.ensurePatchListLoaded();
+    REQUIRE(surge->storage.isPatchListReady());
+    REQUIRE(!surge->storage.patch_list.empty());
+
+    surge->findCurrentPatchInList();
+    REQUIRE(surge->patchid >= 0);
+    auto &p = surge->storage.patch_list[surge->patchid];
+    REQUIRE(p.name == "Init Saw");
+    REQUIRE(surge->storage.patch_category[p.category].name == "Templates");
+}
+
 TEST_CASE("All Patches are Loadable", "[io]")
 {
     auto surge = Surge::Headless::createSurge(44100);
@@ -91,6 +574,225 @@ TEST_CASE("All Patches are Loadable", "[io]")
     }
 }
 
+TEST_CASE("Gapless Patch Switching", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge.get());
+    REQUIRE(surge->storage.patch_list.size() > 2);
+
+    surge->setGaplessPatchSwitching(true);
+    auto loader = surge->shadowPatchLoader.get();
+
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+    surge->playNote(0, 60, 127, 0);
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    int target = surge->storage.patch_list.size() / 2;
+    surge->patch_loaded = false;
+    surge->patchid_queue = target;
+
+    // the old patch plays on while the new one builds; only the dip before the swap is quiet
+    int silentBlocks = 0;
+    for (int i = 0; i < 10000 && !surge->patch_loaded; ++i)
+    {
+        surge->process();
+
+        bool silent = true;
+        for (int s = 0; s < BLOCK_SIZE; ++s)
+            silent = silent && surge->output[0][s] == 0.f && surge->output[1][s] == 0.f;
+        if (silent && !surge->patch_loaded)
+            silentBlocks++;
+
+        if (!loader->isReady())
+            std::this_thread::sleep_for(1ms);
+    }
+
+    REQUIRE(surge->patch_loaded);
+    REQUIRE(silentBlocks <= SurgeSynthesizer::patchSwitchDipBlocks);
+    REQUIRE(loader->switchesCompleted == 1);
+    REQUIRE(surge->patchid == target);
+    loader->waitForPendingLoads();
+
+    // the switch must leave the same patch behind as a plain load does
+    auto ref = Surge::Headless::createSurge(44100);
+    ref->loadPatch(target);
+
+    auto &patch = surge->storage.getPatch();
+    auto &refPatch = ref->storage.getPatch();
+    REQUIRE(patch.name == refPatch.name);
+    REQUIRE(patch.category == refPatch.category);
+    for (int i = 0; i < patch.param_ptr.size(); ++i)
+    {
+        INFO("Parameter " << patch.param_ptr[i]->get_storage_name());
+        REQUIRE(patch.param_ptr[i]->val.i == refPatch.param_ptr[i]->val.i);
+        REQUIRE(patch.param_ptr[i]->ctrltype == refPatch.param_ptr[i]->ctrltype);
+
+        // nothing may be left pointing into the shadow patch
+        auto ud = (char *)patch.param_ptr[i]->user_data;
+        auto sh = (char *)&loader->shadow();
+        REQUIRE(!(ud >= sh && ud < sh + sizeof(SurgePatch)));
+    }
+    REQUIRE(patch.modulation_global.size() == refPatch.modulation_global.size());
+    for (int sc = 0; sc < n_scenes; ++sc)
+    {
+        REQUIRE(patch.scene[sc].modulation_scene.size() ==
+                refPatch.scene[sc].modulation_scene.size());
+        REQUIRE(patch.scene[sc].modulation_voice.size() ==
+                refPatch.scene[sc].modulation_voice.size());
+    }
+    for (int s = 0; s < n_fx_slots; ++s)
+        REQUIRE((bool)surge->fx[s] == (bool)ref->fx[s]);
+
+    surge->playNote(0, 60, 127, 0);
+    for (int i = 0; i < 100; ++i)
+    {
+        surge->process();
+        for (int s = 0; s < BLOCK_SIZE; ++s)
+            REQUIRE(std::isfinite(surge->output[0][s]));
+    }
+}
+
+TEST_CASE("DAW State Restore Off The Audio Thread", "[io]")
+{
+    auto src = Surge::Headless::createSurge(44100);
+    REQUIRE(src->storage.patch_list.size() > 2);
+    src->loadPatch(src->storage.patch_list.size() / 2);
+    src->mpeEnabled = true;
+    src->storage.retuneToScale(Tunings::readSCLFile("resources/test-data/scl/zeus22.scl"));
+    src->populateDawExtraState();
+
+    void *d = nullptr;
+    auto sz = src->saveRaw(&d);
+
+    // what a restore costs when the audio thread does it all
+    auto ref = Surge::Headless::createSurge(44100);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    ref->loadRaw(d, sz, false);
+    ref->loadFromDawExtraState();
+    auto syncMS =
+        std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0)
+            .count();
+
+    auto surge = Surge::Headless::createSurge(44100);
+    auto loader = surge->shadowPatchLoader.get();
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    auto state = malloc(sz);
+    memcpy(state, d, sz);
+    surge->patch_loaded = false;
+    surge->enqueuePatchForLoad(state, sz);
+
+    // the block which swaps the restored patch in is the only one doing any of the work
+    double commitMS = 0;
+    bool sawPrepared = false;
+    for (int i = 0; i < 10000 && !surge->patch_loaded; ++i)
+    {
+        if (loader->isReady())
+        {
+            // the session's scale is parsed and built before the commit, which only swaps it in
+            sawPrepared = true;
+            REQUIRE(loader->tuning.scale.count == 22);
+            REQUIRE(surge->storage.isStandardScale);
+        }
+
+        auto b0 = std::chrono::high_resolution_clock::now();
+        surge->process();
+        auto blockMS =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                      b0)
+                .count();
+        if (surge->patch_loaded)
+            commitMS = blockMS;
+
+        if (!loader->isReady())
+            std::this_thread::sleep_for(1ms);
+    }
+
+    REQUIRE(surge->patch_loaded);
+    REQUIRE(sawPrepared);
+    INFO("Synchronous restore " << syncMS << "ms, commit block " << commitMS << "ms");
+    REQUIRE(commitMS < syncMS);
+
+    loader->waitForPendingLoads();
+    REQUIRE(surge->rawLoadNeedsUIDawExtraState);
+    REQUIRE(surge->mpeEnabled);
+    REQUIRE(surge->storage.currentScale.count == 22);
+    REQUIRE(!surge->storage.isStandardScale);
+    for (int i = 0; i < SurgeStorage::tuning_table_size; ++i)
+        REQUIRE(surge->storage.table_pitch[i] == ref->storage.table_pitch[i]);
+
+    auto &patch = surge->storage.getPatch();
+    auto &refPatch = ref->storage.getPatch();
+    REQUIRE(patch.name == refPatch.name);
+    REQUIRE(patch.category == refPatch.category);
+    for (int i = 0; i < patch.param_ptr.size(); ++i)
+    {
+        INFO("Parameter " << patch.param_ptr[i]->get_storage_name());
+        REQUIRE(patch.param_ptr[i]->val.i == refPatch.param_ptr[i]->val.i);
+    }
+    for (int s = 0; s < n_fx_slots; ++s)
+        REQUIRE((bool)surge->fx[s] == (bool)ref->fx[s]);
+}
+
+TEST_CASE("Gapless Switch Asks About Patch Tuning Before The Commit", "[io][tun]")
+{
+    auto src = Surge::Headless::createSurge(44100);
+    auto &pt = src->storage.getPatch().patchTuning;
+    pt.tuningStoredInPatch = true;
+    std::ifstream scl("resources/test-data/scl/31edo.scl");
+    std::stringstream sclData;
+    sclData << scl.rdbuf();
+    pt.scaleContents = sclData.str();
+    REQUIRE(pt.scaleContents.size() > 1);
+
+    auto fxp = fs::temp_directory_path() / "surge-patch-tuning-test.fxp";
+    src->savePatchToPath(fxp);
+
+    auto surge = Surge::Headless::createSurge(44100);
+    surge->storage.retuneToScale(Tunings::readSCLFile("resources/test-data/scl/zeus22.scl"));
+    surge->setGaplessPatchSwitching(true);
+    auto loader = surge->shadowPatchLoader.get();
+
+    std::atomic<int> asked{0};
+    std::thread::id askedOn;
+    surge->storage.okCancelProvider = [&](const std::string &, const std::string &,
+                                          SurgeStorage::OkCancel) {
+        askedOn = std::this_thread::get_id();
+        asked++;
+        return SurgeStorage::OK;
+    };
+
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    strncpy(surge->patchid_file, path_to_string(fxp).c_str(), FILENAME_MAX - 1);
+    surge->patch_loaded = false;
+    surge->has_patchid_file = true;
+
+    int askedBeforeCommit = -1;
+    for (int i = 0; i < 10000 && !surge->patch_loaded; ++i)
+    {
+        if (loader->isReady())
+            askedBeforeCommit = asked;
+        surge->process();
+        if (!loader->isReady())
+            std::this_thread::sleep_for(1ms);
+    }
+    loader->waitForPendingLoads();
+
+    REQUIRE(surge->patch_loaded);
+    REQUIRE(asked == 1);
+    REQUIRE(askedBeforeCommit == 1);
+    REQUIRE(askedOn != std::this_thread::get_id());
+    REQUIRE(surge->storage.currentScale.count == 31);
+
+    surge->storage.clearOkCancelProvider();
+    fs::remove(fxp);
+}
+
 TEST_CASE("DAW Streaming and Unstreaming", "[io][mpe][tun]")
 {
     // The basic plan of attack is, in a section, set up two surges,
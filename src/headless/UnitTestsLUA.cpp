@@ -330,7 +330,7 @@ std::vector<formulaObservation> runFormula(FormulaModulatorStorage *fs, float dP
     double phase = 0.0;
     int iphase = 0;
     Surge::Formula::EvaluatorState es;
-    Surge::Formula::prepareForEvaluation(fs, es, true);
+    Surge::Formula::prepareForEvaluation(nullptr, fs, es, true);
     es.deform = deform;
     while (phase + iphase < phaseMax)
     {
@@ -428,6 +428,196 @@ end)FN");
     }
 }
 
+TEST_CASE("Batched Formula Evaluation", "[formula]")
+{
+    // Each script runs for a set of states one by one and, with a copy of the script, batched
+    auto surge = Surge::Headless::createSurge(44100);
+    auto compare = [&surge](const std::string &script) {
+        FormulaModulatorStorage fsOne, fsBatch;
+        fsOne.setFormula(script + "\n-- one by one");
+        fsBatch.setFormula(script + "\n-- batched");
+
+        const int nv = 7;
+        Surge::Formula::EvaluatorState one[nv], batch[nv];
+        Surge::Formula::EvaluatorState *bp[nv];
+        for (int i = 0; i < nv; ++i)
+        {
+            Surge::Formula::initEvaluatorState(one[i]);
+            Surge::Formula::initEvaluatorState(batch[i]);
+            Surge::Formula::prepareForEvaluation(&surge->storage, &fsOne, one[i], false);
+            Surge::Formula::prepareForEvaluation(&surge->storage, &fsBatch, batch[i], false);
+            bp[i] = &batch[i];
+        }
+#if LJ_HASFFI
+        // Without its driver valueAtBatch quietly goes through valueAt, which would match anyway
+        REQUIRE(surge->storage.formulaEvaluator->batchRef != LUA_NOREF);
+#endif
+
+        for (int b = 0; b < 30; ++b)
+        {
+            int ip[nv];
+            float ph[nv], ref[nv], out[nv];
+            for (int i = 0; i < nv; ++i)
+            {
+                ip[i] = b / 5 + i;
+                ph[i] = 0.1f * i + 0.037f * b;
+                ph[i] -= (int)ph[i];
+                for (auto *s : {&one[i], &batch[i]})
+                {
+                    s->deform = 0.2f * (i - 3);
+                    s->rate = 1.f + i;
+                    s->songpos = 0.25f * b;
+                }
+                if (b == 10 && i == 2)
+                {
+                    one[i].isvalid = false;
+                    batch[i].isvalid = false;
+                }
+            }
+
+            for (int i = 0; i < nv; ++i)
+                ref[i] = Surge::Formula::valueAt(ip[i], ph[i], &fsOne, &one[i]);
+            Surge::Formula::valueAtBatch(bp, ip, ph, &fsBatch, out, nv);
+
+            for (int i = 0; i < nv; ++i)
+            {
+                INFO("Block " << b << " state " << i);
+                REQUIRE(out[i] == ref[i]);
+                REQUIRE(batch[i].isvalid == one[i].isvalid);
+                REQUIRE(batch[i].useEnvelope == one[i].useEnvelope);
+                REQUIRE(batch[i].retrigger_AEG == one[i].retrigger_AEG);
+                REQUIRE(batch[i].retrigger_FEG == one[i].retrigger_FEG);
+                REQUIRE(batch[i].error == one[i].error);
+            }
+        }
+
+        for (int i = 0; i < nv; ++i)
+        {
+            Surge::Formula::cleanEvaluatorState(one[i]);
+            Surge::Formula::cleanEvaluatorState(batch[i]);
+        }
+    };
+
+    SECTION("Stateful Table")
+    {
+        compare(R"FN(
+function process(modstate)
+    modstate["count"] = (modstate["count"] or 0) + 1
+    modstate["output"] = modstate["phase"] * modstate["deform"] + modstate["intphase"]
+    modstate["retrigger_AEG"] = modstate["count"] % 3 == 0
+    modstate["retrigger_FEG"] = modstate["count"] % 4 == 0
+    modstate["use_envelope"] = modstate["count"] % 2 == 0
+    return modstate
+end)FN");
+    }
+
+    SECTION("New Table")
+    {
+        compare(R"FN(
+function process(modstate)
+    return { output = modstate["phase"] + (modstate["last"] or 0), last = modstate["rate"] }
+end)FN");
+    }
+
+    SECTION("Number")
+    {
+        compare(R"FN(
+function process(modstate)
+    return modstate["phase"] * 2 - 1
+end)FN");
+    }
+
+    SECTION("Missing Output")
+    {
+        compare(R"FN(
+function process(modstate)
+    modstate["output"] = "nope"
+    return modstate
+end)FN");
+    }
+
+    SECTION("Runtime Error")
+    {
+        compare(R"FN(
+function process(modstate)
+    modstate["count"] = (modstate["count"] or 0) + 1
+    if modstate["count"] > 4 and modstate["deform"] > 0 then
+        error("later")
+    end
+    modstate["output"] = modstate["count"]
+    return modstate
+end)FN");
+    }
+}
+
+TEST_CASE("Batched Formula Modulators Match Per Voice", "[formula]")
+{
+    auto make = [](bool batched) {
+        auto surge = Surge::Headless::createSurge(44100);
+        auto &patch = surge->storage.getPatch();
+        auto &sc = patch.scene[0];
+        patch.polylimit.val.i = 16;
+
+        sc.lfo[0].shape.val.i = lt_formula;
+        patch.formulamods[0][0].setFormula(R"FN(
+function process(modstate)
+    modstate["count"] = (modstate["count"] or 0) + 1
+    modstate["output"] = math.sin(modstate["phase"] * 2 * math.pi) * modstate["deform"]
+    modstate["retrigger_FEG"] = modstate["count"] % 37 == 0
+    return modstate
+end)FN");
+        sc.lfo[1].shape.val.i = lt_tri;
+
+        surge->setModulation(sc.lfo[0].deform.id, ms_velocity, 0.5);
+        surge->setModulation(sc.osc[0].pitch.id, ms_lfo1, 0.1);
+        surge->setModulation(sc.filterunit[0].cutoff.id, ms_lfo2, 0.3);
+        surge->setModulation(sc.filterunit[0].cutoff.id, ms_filtereg, 0.4);
+
+        surge->setBatchedModulators(batched);
+        return surge;
+    };
+
+    auto perVoice = make(false);
+    auto batched = make(true);
+
+    int mismatches = 0;
+    float sumAbsOut = 0;
+    for (int b = 0; b < 1000; ++b)
+    {
+        if (b % 15 == 0 && b < 600)
+        {
+            auto n = 36 + (b / 15) % 37;
+            auto vel = 40 + (b * 7) % 87;
+            perVoice->playNote(0, n, vel, 0);
+            batched->playNote(0, n, vel, 0);
+        }
+        if (b % 15 == 7 && b > 200)
+        {
+            auto n = 36 + ((b - 200) / 15) % 37;
+            perVoice->releaseNote(0, n, 0);
+            batched->releaseNote(0, n, 0);
+        }
+
+        perVoice->process();
+        batched->process();
+
+        for (int c = 0; c < 2; ++c)
+            for (int s = 0; s < BLOCK_SIZE; ++s)
+            {
+                if (perVoice->output[c][s] != batched->output[c][s])
+                    mismatches++;
+                sumAbsOut += fabs(perVoice->output[c][s]);
+            }
+    }
+
+    REQUIRE(sumAbsOut > 1);
+    REQUIRE(mismatches == 0);
+
+    // and the batched synth really did evaluate through the driver
+    REQUIRE(perVoice->storage.formulaEvaluator->batchCalls == 0);
+    REQUIRE(batched->storage.formulaEvaluator->batchCalls > 0);
+}
+
 TEST_CASE("WavetableScript", "[formula]")
 {
     SECTION("Just the Sins")
@@ -520,6 +520,74 @@ TEST_CASE("Zero size loops", "[mseg]")
     }
 }
 
+TEST_CASE("Indexed Segment Lookup", "[mseg]")
+{
+    // Every lookup through the cursor and bisection has to agree with the plain scan
+    auto compare = [](MSEGStorage &ms, float dPhase, float releaseAfter) {
+        Surge::MSEG::rebuildCache(&ms);
+        REQUIRE(ms.indexedSegments == ms.n_activeSegments);
+
+        auto scanned = ms;
+        scanned.indexedSegments = -1;
+
+        for (auto deform : {0.f, 0.6f})
+        {
+            auto indexedRun = runMSEG(&ms, dPhase, 6, deform, releaseAfter);
+            auto scannedRun = runMSEG(&scanned, dPhase, 6, deform, releaseAfter);
+            REQUIRE(indexedRun.size() == scannedRun.size());
+            for (int i = 0; i < indexedRun.size(); ++i)
+            {
+                INFO("At phase " << indexedRun[i].phase);
+                REQUIRE(indexedRun[i].v == scannedRun[i].v);
+            }
+        }
+
+        for (int i = 0; i <= 600; ++i)
+        {
+            double t = i * 0.01;
+            for (auto ignoreLoops : {true, false})
+            {
+                float a = -1, b = -1;
+                REQUIRE(Surge::MSEG::timeToSegment(&ms, t, ignoreLoops, a) ==
+                        Surge::MSEG::timeToSegment(&scanned, t, ignoreLoops, b));
+                REQUIRE(a == b);
+            }
+        }
+    };
+
+    SECTION("Maximal LFO")
+    {
+        MSEGStorage ms;
+        ms.editMode = MSEGStorage::LFO;
+        Surge::MSEG::createSinLineMSEG(&ms, max_msegs);
+        compare(ms, 0.0037, -1);
+    }
+
+    SECTION("Maximal Envelope With Gated Loop")
+    {
+        MSEGStorage ms;
+        ms.editMode = MSEGStorage::ENVELOPE;
+        Surge::MSEG::createStepseqMSEG(&ms, max_msegs);
+        Surge::MSEG::scaleDurations(&ms, 1.0 / 64);
+        ms.loopMode = MSEGStorage::GATED_LOOP;
+        ms.loop_start = 20;
+        ms.loop_end = 90;
+        compare(ms, 0.0013, 2.5);
+    }
+
+    SECTION("Zero Length Segments")
+    {
+        MSEGStorage ms;
+        ms.editMode = MSEGStorage::ENVELOPE;
+        Surge::MSEG::createStepseqMSEG(&ms, 16);
+        for (int i = 0; i < 16; ++i)
+            ms.segments[i].duration = (i % 3 == 1) ? 0 : 0.125;
+        ms.loop_start = 4;
+        ms.loop_end = 13;
+        compare(ms, 0.0125, -1);
+    }
+}
+
 /*
  * Tests to add
  * - loop point 0 (start = end + 1)
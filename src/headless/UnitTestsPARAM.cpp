@@ -52,3 +52,70 @@ TEST_CASE("Param String Inversion", "[parm]")
 #endif
     }
 }
+
+TEST_CASE("Scene And Global Data Follow Parameter Changes", "[parm]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    REQUIRE(surge);
+
+    auto &patch = surge->storage.getPatch();
+    auto &vol = patch.scene[0].volume;
+    auto sceneVal = [&]() { return patch.scenedata[0][vol.param_id_in_scene].f; };
+
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    SECTION("Set Through The Synth")
+    {
+        surge->setParameter01(surge->idForParameter(&vol), 0.3);
+        surge->process();
+        REQUIRE(sceneVal() == vol.val.f);
+
+        surge->setParameter01(surge->idForParameter(&patch.volume), 0.7);
+        surge->process();
+        REQUIRE(patch.globaldata[patch.volume.id].f == patch.volume.val.f);
+    }
+
+    SECTION("Written Directly")
+    {
+        auto caught = patch.unmarkedParameterWrites.load();
+
+        // writers of val mark the parameter, and the next block picks it up
+        vol.val.f = vol.val_min.f;
+        vol.markDirty();
+        surge->process();
+        REQUIRE(sceneVal() == vol.val_min.f);
+
+        vol.set_value_f01(0.5);
+        surge->process();
+        REQUIRE(sceneVal() == vol.val.f);
+        REQUIRE(patch.unmarkedParameterWrites == caught);
+
+        // and one which forgets still lands, a little later, and gets counted
+        vol.val.f = vol.val_max.f;
+        for (int i = 0; i <= n_total_params / SurgePatch::paramResyncPerBlock; ++i)
+            surge->process();
+        REQUIRE(sceneVal() == vol.val_max.f);
+        REQUIRE(patch.unmarkedParameterWrites == caught + 1);
+    }
+
+    SECTION("Modulation Does Not Accumulate")
+    {
+        auto base = vol.val.f;
+        surge->setModulation(vol.id, ms_ctrl1, 0.5);
+        SurgeSynthesizer::ID macro;
+        REQUIRE(surge->fromSynthSideId(metaparam_offset, macro));
+        surge->setParameter01(macro, 1.f);
+        for (int i = 0; i < 200; ++i)
+            surge->process();
+        auto modulated = sceneVal();
+        REQUIRE(modulated != base);
+
+        surge->process();
+        REQUIRE(sceneVal() == modulated);
+
+        surge->clearModulation(vol.id, ms_ctrl1);
+        surge->process();
+        REQUIRE(sceneVal() == base);
+    }
+}
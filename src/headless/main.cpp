@@ -23,7 +23,23 @@ int main(int argc, char **argv)
         std::cout << "# Running in non-test mode : " << argv[2] << std::endl;
         if (strcmp(argv[2], "--stats-from-every-patch") == 0)
         {
-            Surge::Headless::NonTest::statsFromPlayingEveryPatch();
+            int jobs = 1;
+            for (int i = 3; i < argc; ++i)
+            {
+                if (strcmp(argv[i], "--jobs") != 0)
+                    continue;
+
+                char *end = nullptr;
+                auto j = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : -1;
+                if (i + 1 >= argc || end == argv[i + 1] || *end != 0 || j < 0 || j > 1024)
+                {
+                    std::cout << "Usage: --stats-from-every-patch [--jobs n], n from 0 (all "
+                                 "cores) to 1024\n";
+                    return 1;
+                }
+                jobs = (int)j;
+            }
+            Surge::Headless::NonTest::statsFromPlayingEveryPatch(jobs);
         }
         if (strcmp(argv[2], "--restream-templates") == 0)
         {
@@ -43,9 +59,55 @@ int main(int argc, char **argv)
             Surge::Headless::NonTest::filterAnalyzer(std::atoi(argv[3]), std::atoi(argv[4]),
                                                      std::cout);
         }
+        if (strcmp(argv[2], "--voice-thread-scaling") == 0)
+        {
+            Surge::Headless::NonTest::voiceThreadScaling(argc > 3 ? std::atoi(argv[3]) : 0);
+        }
+        if (strcmp(argv[2], "--patch-switch-latency") == 0)
+        {
+            Surge::Headless::NonTest::patchSwitchLatency(argc > 3 ? std::atoi(argv[3]) : 0);
+        }
+        if (strcmp(argv[2], "--formula-throughput") == 0)
+        {
+            Surge::Headless::NonTest::formulaThroughput(argc > 3 ? std::atoi(argv[3]) : 0);
+        }
+        if (strcmp(argv[2], "--mseg-throughput") == 0)
+        {
+            Surge::Headless::NonTest::msegThroughput();
+        }
+        if (strcmp(argv[2], "--time-to-first-process") == 0)
+        {
+            Surge::Headless::NonTest::timeToFirstProcess(argc > 3 ? std::atoi(argv[3]) : 0);
+        }
+        if (strcmp(argv[2], "--prewarm-wavetable-cache") == 0)
+        {
+            Surge::Headless::NonTest::prewarmWavetableCache(argc > 3 ? argv[3] : "",
+                                                            argc > 4 ? std::atoi(argv[4]) : 0);
+        }
+        if (strcmp(argv[2], "--benchmark") == 0)
+        {
+            int blocks = 0;
+            std::string only, out;
+            for (int i = 3; i + 1 < argc; ++i)
+            {
+                if (strcmp(argv[i], "--blocks") == 0)
+                    blocks = std::atoi(argv[i + 1]);
+                if (strcmp(argv[i], "--only") == 0)
+                    only = argv[i + 1];
+                if (strcmp(argv[i], "--out") == 0)
+                    out = argv[i + 1];
+            }
+            Surge::Headless::NonTest::benchmark(blocks, only, out);
+        }
+        if (strcmp(argv[2], "--process-profile") == 0)
+        {
+            Surge::Headless::NonTest::processProfileReport(argc > 3 ? argv[3] : "",
+                                                           argc > 4 ? std::atoi(argv[4]) : 0);
+        }
         if (strcmp(argv[2], "--performance") == 0)
         {
-            Surge::Headless::NonTest::performancePlay(argv[3], std::atoi(argv[4]));
+            bool mtScenes = argc > 5 && strcmp(argv[5], "--multithreaded-scenes") == 0;
+            Surge::Headless::NonTest::performancePlay(argv[3], std::atoi(argv[4]), mtScenes);
         }
         return 0;
     }
@@ -58,9 +120,32 @@ int main(int argc, char **argv)
                 << "see the options below. To use utility mode make the first argument "
                    "'--non-test' and\n"
                 << "then use the options below\n\n"
-                << "   --non-test --stats-from-every-patch    # play every patch and show RMS\n"
+                << "   --non-test --stats-from-every-patch [--jobs n]\n"
+                << "                                          # play every patch and show RMS, "
+                   "on n threads\n"
                 << "   --non-test --filter-analyzer ft fst    # analyze filter type/subtype for "
                    "response\n"
+                << "   --non-test --performance patch mode [--multithreaded-scenes]\n"
+                << "                                          # play patch forever, reporting CPU\n"
+                << "   --non-test --voice-thread-scaling [n]  # voice render time with 1..n "
+                   "threads\n"
+                << "   --non-test --patch-switch-latency [n]  # switch time and silent gap, "
+                   "classic vs gapless\n"
+                << "   --non-test --formula-throughput [n]    # formula voices per ms, one by one "
+                   "vs batched\n"
+                << "   --non-test --mseg-throughput           # MSEG lookup time per voice, scan "
+                   "vs index\n"
+                << "   --non-test --time-to-first-process [n] # construct and first block time, "
+                   "n runs\n"
+                << "   --non-test --benchmark [--blocks n] [--only name] [--out file.json]\n"
+                << "                                          # fixed engine scenarios, timed, "
+                   "as JSON\n"
+                << "   --non-test --process-profile [patch] [s]\n"
+                << "                                          # where process() time goes, by "
+                   "stage, FX slot and osc\n"
+                << "   --non-test --prewarm-wavetable-cache [dir] [n]\n"
+                << "                                          # fill the mipmap cache for dir, or "
+                   "all known tables\n"
                 << "\n"
                 << "If you exlude the `--non-test` argument, standard catch2 arguments, below, "
                    "apply\n\n";
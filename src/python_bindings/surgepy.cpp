@@ -2,11 +2,16 @@
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <thread>
+#include <tuple>
 #include <utility>
 
 #include "SurgeSynthesizer.h"
 #include "HeadlessPluginLayerProxy.h"
+#include "ProcessProfiler.h"
 #include "version.h"
 #include "filesystem/import.h"
 
@@ -100,6 +105,36 @@ struct SurgePyModRouting
     float normalizedDepth;
 };
 
+/*
+ * One entry of the event list renderEvents plays. Python builds these as a numpy structured
+ * array with the dtype from surgepy.getEventDtype(), so the layout here is the layout there.
+ * sample counts from the first sample rendered; data1 and data2 mean what they do for the
+ * matching single call (key and velocity for notes, cc and value for controllers, and so on),
+ * each in 0-127 except pitch bend in -8192-8191; param_id and value are only read by ev_param,
+ * value being in the units setParamVal takes.
+ */
+struct SurgePyEvent
+{
+    int64_t sample;
+    int32_t type;
+    int32_t channel;
+    int32_t data1;
+    int32_t data2;
+    int32_t paramId;
+    float value;
+};
+
+enum SurgePyEventType
+{
+    ev_note_on = 1,
+    ev_note_off,
+    ev_pitch_bend,
+    ev_poly_aftertouch,
+    ev_channel_aftertouch,
+    ev_controller,
+    ev_param,
+};
+
 class SurgePyPatchConverter
 {
   public:
@@ -621,7 +656,12 @@ class SurgeSynthesizerWithPythonExtensions : public SurgeSynthesizer
         memset(buf.ptr, 0, 2 * BLOCK_SIZE * nBlocks * sizeof(float));
         return res;
     }
-    void processMultiBlock(const py::array_t<float> &arr, int startBlock = 0, int nBlocks = -1)
+    /*
+     * Check arr can hold the blocks asked for and find where they go, or throw so python sees
+     * what was wrong.
+     */
+    int outputBlocks(const py::array_t<float> &arr, int startBlock, int nBlocks, float *&dL,
+                     float *&dR)
     {
         auto buf = arr.request(true);
 
@@ -675,8 +715,18 @@ class SurgeSynthesizerWithPythonExtensions : public SurgeSynthesizer
         }
 
         auto ptr = static_cast<float *>(buf.ptr);
-        float *dL = ptr + startBlock * BLOCK_SIZE;
-        float *dR = ptr + buf.shape[1] + startBlock * BLOCK_SIZE;
+        dL = ptr + startBlock * BLOCK_SIZE;
+        dR = ptr + buf.shape[1] + startBlock * BLOCK_SIZE;
+        return blockIterations;
+    }
+
+    void processMultiBlock(const py::array_t<float> &arr, int startBlock = 0, int nBlocks = -1)
+    {
+        float *dL, *dR;
+        auto blockIterations = outputBlocks(arr, startBlock, nBlocks, dL, dR);
+
+        // Nothing below touches a python object, so other threads can run their instances
+        py::gil_scoped_release release;
 
         for (auto i = 0; i < blockIterations; ++i)
         {
@@ -689,6 +739,193 @@ class SurgeSynthesizerWithPythonExtensions : public SurgeSynthesizer
         }
     }
 
+    void applyEvent(const SurgePyEvent &e)
+    {
+        switch (e.type)
+        {
+        case ev_note_on:
+            playNote(e.channel, e.data1, e.data2, 0);
+            break;
+        case ev_note_off:
+            releaseNote(e.channel, e.data1, e.data2);
+            break;
+        case ev_pitch_bend:
+            pitchBend(e.channel, e.data1);
+            break;
+        case ev_poly_aftertouch:
+            polyAftertouch(e.channel, e.data1, e.data2);
+            break;
+        case ev_channel_aftertouch:
+            channelAftertouch(e.channel, e.data1);
+            break;
+        case ev_controller:
+            channelController(e.channel, e.data1, e.data2);
+            break;
+        case ev_param:
+        {
+            SurgeSynthesizer::ID id;
+            auto p = storage.getPatch().param_ptr[e.paramId];
+            if (p && fromSynthSideId(e.paramId, id))
+                setParameter01(id, p->value_to_normalized(e.value));
+            break;
+        }
+        }
+    }
+
+    /*
+     * Copy events out of a python event array, checking each as we go and putting them in the
+     * order they play. Needs the GIL.
+     */
+    std::vector<SurgePyEvent> eventsFromArray(
+        const py::array_t<SurgePyEvent, py::array::c_style | py::array::forcecast> &events)
+    {
+        if (events.ndim() != 1)
+        {
+            std::ostringstream oss;
+            oss << "Event array must have 1 dimension; you provided an array with "
+                << events.ndim() << " dimensions";
+            throw std::invalid_argument(oss.str().c_str());
+        }
+
+        auto nParams = (int)storage.getPatch().param_ptr.size();
+        auto midi = [](int32_t v) { return v >= 0 && v <= 127; };
+        std::vector<SurgePyEvent> res(events.data(), events.data() + events.size());
+        for (auto i = 0U; i < res.size(); ++i)
+        {
+            auto &e = res[i];
+            std::string problem;
+            if (e.sample < 0)
+                problem = "has a negative sample";
+            else if (e.type < ev_note_on || e.type > ev_param)
+                problem = "has an unknown type";
+            else if (e.channel < 0 || e.channel > 15)
+                problem = "has a channel outside 0-15";
+            else if (e.type == ev_param && (e.paramId < 0 || e.paramId >= nParams))
+                problem = "has an unknown param_id";
+            else if (e.type == ev_pitch_bend && (e.data1 < -8192 || e.data1 > 8191))
+                problem = "has a pitch bend outside -8192-8191";
+            else if (e.type == ev_channel_aftertouch && !midi(e.data1))
+                problem = "has data1 outside 0-127";
+            else if ((e.type == ev_note_on || e.type == ev_note_off ||
+                      e.type == ev_poly_aftertouch || e.type == ev_controller) &&
+                     !(midi(e.data1) && midi(e.data2)))
+                problem = "has data1 or data2 outside 0-127";
+
+            if (!problem.empty())
+            {
+                std::ostringstream oss;
+                oss << "Event " << i << " " << problem;
+                throw std::invalid_argument(oss.str().c_str());
+            }
+        }
+        std::stable_sort(res.begin(), res.end(),
+                         [](const auto &a, const auto &b) { return a.sample < b.sample; });
+        return res;
+    }
+
+    /*
+     * Surge takes events between blocks, so each one is applied just before the block its sample
+     * falls in; events at the same sample go in the order given, and events past the end of the
+     * render are dropped. Touches no python objects.
+     */
+    void renderSortedEvents(const std::vector<SurgePyEvent> &events, float *dL, float *dR,
+                            int blockIterations)
+    {
+        auto e = events.begin();
+        for (auto i = 0; i < blockIterations; ++i)
+        {
+            while (e != events.end() && e->sample < (int64_t)(i + 1) * BLOCK_SIZE)
+            {
+                applyEvent(*e);
+                ++e;
+            }
+
+            process();
+            memcpy((void *)dL, (void *)(output[0]), BLOCK_SIZE * sizeof(float));
+            memcpy((void *)dR, (void *)(output[1]), BLOCK_SIZE * sizeof(float));
+
+            dL += BLOCK_SIZE;
+            dR += BLOCK_SIZE;
+        }
+    }
+
+    void renderEvents(const py::array_t<float> &arr,
+                      const py::array_t<SurgePyEvent, py::array::c_style | py::array::forcecast>
+                          &events,
+                      int startBlock = 0, int nBlocks = -1)
+    {
+        float *dL, *dR;
+        auto blockIterations = outputBlocks(arr, startBlock, nBlocks, dL, dR);
+        auto todo = eventsFromArray(events);
+
+        py::gil_scoped_release release;
+        renderSortedEvents(todo, dL, dR, blockIterations);
+    }
+
+    /*
+     * Put this instance back to how a fresh one with the patch at path would start, short of
+     * rebuilding it, for reuse by the BatchRenderer. Touches no python objects.
+     */
+    bool resetToPatch(const std::string &path)
+    {
+        allNotesOff();
+        for (int ch = 0; ch < 16; ++ch)
+        {
+            pitchBend(ch, 0);
+            channelAftertouch(ch, 0);
+            channelController(ch, 1, 0);
+        }
+
+        auto name = path_to_string(string_to_path(path).stem());
+        if (!loadPatchByPath(path.c_str(), -1, name.c_str()))
+            return false;
+
+        // Like the headless player, let the load settle before the first block we keep
+        process();
+        return true;
+    }
+
+    /*
+     * The process profile since the last call (or since this instance was made), in ns. Meant to
+     * be called every so often while something else renders.
+     */
+    py::dict pollProcessProfile()
+    {
+        typedef Surge::Profiling::ProcessProfiler prof_t;
+        auto now = storage.processProfiler->poll();
+        auto c = now.since(lastProfilePoll);
+        lastProfilePoll = now;
+
+        auto res = py::dict();
+        res["blocks"] = c.blocks;
+        res["ns"] = c.blockNS;
+
+        auto stages = py::dict();
+        for (int st = 0; st < prof_t::n_stages; ++st)
+            stages[prof_t::stageName(st)] = c.toNS(c.stageTicks[st]);
+        res["stages"] = stages;
+
+        auto slots = py::list();
+        for (int sl = 0; sl < n_fx_slots; ++sl)
+            slots.append(c.toNS(c.fxSlotTicks[sl]));
+        res["fxSlots"] = slots;
+
+        auto oscs = py::dict();
+        for (int ot = 0; ot < n_osc_types; ++ot)
+        {
+            if (!c.oscBlocks[ot])
+                continue;
+            auto o = py::dict();
+            o["ns"] = c.toNS(c.oscTicks[ot]);
+            o["blocks"] = c.oscBlocks[ot];
+            oscs[py::int_(ot)] = o;
+        }
+        res["oscillators"] = oscs;
+        res["filterChain"] = c.toNS(c.filterChainTicks);
+        return res;
+    }
+    Surge::Profiling::ProcessProfiler::Counters lastProfilePoll;
+
     py::dict getPatchAsPy()
     {
         auto pc = SurgePyPatchConverter(this);
@@ -805,7 +1042,7 @@ class SurgeSynthesizerWithPythonExtensions : public SurgeSynthesizer
     void retuneToStandardScale() { storage.retuneTo12TETScale(); }
 };
 
-SurgeSynthesizer *createSurge(float sr)
+SurgeSynthesizerWithPythonExtensions *createSurgePy(float sr)
 {
     if (spysetup_parent == nullptr)
         spysetup_parent = std::make_unique<HeadlessPluginLayerProxy>();
@@ -816,12 +1053,218 @@ SurgeSynthesizer *createSurge(float sr)
     return surge;
 }
 
+SurgeSynthesizer *createSurge(float sr) { return createSurgePy(sr); }
+
+/*
+ * Renders (patch, events, length) jobs on a pool of Surge instances, one thread each. Instances
+ * are made once, up front, and each job reloads its patch into whichever is free, so a batch pays
+ * the startup cost of a synth per thread rather than per job. Finished jobs queue up until python
+ * takes them with next(), in the order they finish, not the order they went in.
+ */
+class SurgePyBatchRenderer
+{
+  public:
+    SurgePyBatchRenderer(float sampleRate, int nInstances)
+    {
+        if (nInstances <= 0)
+            nInstances = std::max(1u, std::thread::hardware_concurrency());
+
+        for (int i = 0; i < nInstances; ++i)
+            synths.emplace_back(createSurgePy(sampleRate));
+        for (auto &s : synths)
+            workers.emplace_back([this, s = s.get()]() { work(s); });
+    }
+
+    ~SurgePyBatchRenderer()
+    {
+        {
+            std::lock_guard<std::mutex> g(jobMutex);
+            stopping = true;
+        }
+        jobCV.notify_all();
+
+        // Workers never take the GIL, so there's no need to drop it while they finish up
+        for (auto &w : workers)
+            w.join();
+    }
+
+    typedef std::tuple<std::string,
+                       py::array_t<SurgePyEvent, py::array::c_style | py::array::forcecast>, int>
+        pyJob_t;
+
+    std::vector<int> submit(const std::vector<pyJob_t> &pyJobs)
+    {
+        // Check the lot before queueing any, so a bad job doesn't leave half a batch running
+        std::vector<Job> batch;
+        for (auto &pj : pyJobs)
+        {
+            Job j;
+            j.patch = std::get<0>(pj);
+            j.events = synths[0]->eventsFromArray(std::get<1>(pj));
+            j.nBlocks = std::get<2>(pj);
+
+            if (!fs::exists(string_to_path(j.patch)))
+            {
+                throw std::invalid_argument((std::string("File not found: ") + j.patch).c_str());
+            }
+            if (j.nBlocks <= 0)
+            {
+                std::ostringstream oss;
+                oss << "Job for " << j.patch << " must render at least one block; you asked for "
+                    << j.nBlocks;
+                throw std::invalid_argument(oss.str().c_str());
+            }
+            batch.push_back(std::move(j));
+        }
+
+        std::vector<int> ids;
+        {
+            std::lock_guard<std::mutex> g(jobMutex);
+            for (auto &j : batch)
+            {
+                j.id = nextId++;
+                ids.push_back(j.id);
+                jobs.push_back(std::move(j));
+            }
+        }
+        outstanding += ids.size();
+        jobCV.notify_all();
+        return ids;
+    }
+
+    /*
+     * Wait for the next job to finish and return (id, audio) with audio shaped like
+     * createMultiBlock(nBlocks). Throws StopIteration once everything submitted has been taken.
+     */
+    py::tuple next()
+    {
+        if (outstanding == 0)
+            throw py::stop_iteration();
+
+        Result r;
+        {
+            py::gil_scoped_release release;
+            std::unique_lock<std::mutex> lk(doneMutex);
+            doneCV.wait(lk, [this]() { return !done.empty(); });
+            r = std::move(done.front());
+            done.pop_front();
+        }
+        outstanding--;
+
+        if (!r.error.empty())
+        {
+            std::ostringstream oss;
+            oss << "Job " << r.id << ": " << r.error;
+            throw std::invalid_argument(oss.str().c_str());
+        }
+
+        // Hand the buffer to numpy rather than copying it
+        auto audio = new std::vector<float>(std::move(r.audio));
+        py::capsule owner(audio, [](void *a) { delete static_cast<std::vector<float> *>(a); });
+        auto nSamples = (int)(audio->size() / 2);
+        auto arr = py::array_t<float>({2, nSamples}, {nSamples * sizeof(float), sizeof(float)},
+                                      audio->data(), owner);
+        return py::make_tuple(r.id, arr);
+    }
+
+    int getNumInstances() const { return (int)synths.size(); }
+    int getPending() const { return outstanding; }
+
+  private:
+    struct Job
+    {
+        int id = -1;
+        std::string patch;
+        std::vector<SurgePyEvent> events;
+        int nBlocks = 0;
+    };
+
+    struct Result
+    {
+        int id = -1;
+        std::vector<float> audio;
+        std::string error;
+    };
+
+    void work(SurgeSynthesizerWithPythonExtensions *s)
+    {
+        while (true)
+        {
+            Job j;
+            {
+                std::unique_lock<std::mutex> lk(jobMutex);
+                jobCV.wait(lk, [this]() { return stopping || !jobs.empty(); });
+                if (stopping)
+                    return;
+                j = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            Result r;
+            r.id = j.id;
+            // Nothing may leave this thread, or it takes the python process down with it
+            try
+            {
+                if (s->resetToPatch(j.patch))
+                {
+                    auto n = (size_t)j.nBlocks * BLOCK_SIZE;
+                    r.audio.resize(2 * n);
+                    s->renderSortedEvents(j.events, r.audio.data(), r.audio.data() + n,
+                                          j.nBlocks);
+                }
+                else
+                {
+                    r.error = "Unable to load patch " + j.patch;
+                }
+            }
+            catch (const std::exception &e)
+            {
+                r.audio.clear();
+                r.error = std::string("Error rendering ") + j.patch + ": " + e.what();
+            }
+            catch (...)
+            {
+                r.audio.clear();
+                r.error = "Unknown error rendering " + j.patch;
+            }
+
+            {
+                std::lock_guard<std::mutex> g(doneMutex);
+                done.push_back(std::move(r));
+            }
+            doneCV.notify_one();
+        }
+    }
+
+    std::vector<std::unique_ptr<SurgeSynthesizerWithPythonExtensions>> synths;
+    std::vector<std::thread> workers;
+
+    std::mutex jobMutex;
+    std::condition_variable jobCV;
+    std::deque<Job> jobs;
+    bool stopping = false;
+    int nextId = 0;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCV;
+    std::deque<Result> done;
+
+    // Submitted but not yet taken by next(); only touched with the GIL held
+    int outstanding = 0;
+};
+
 PYBIND11_MODULE(surgepy, m)
 {
     m.doc() = "Python bindings for Surge Synthesizer";
     m.def("createSurge", &createSurge, "Create a surge instance", py::arg("sampleRate"));
     m.def(
         "getVersion", []() { return Surge::Build::FullVersionStr; }, "Get the version of Surge");
+
+    PYBIND11_NUMPY_DTYPE_EX(SurgePyEvent, sample, "sample", type, "type", channel, "channel", data1,
+                            "data1", data2, "data2", paramId, "param_id", value, "value");
+    m.def(
+        "getEventDtype", []() { return py::dtype::of<SurgePyEvent>(); },
+        "Get the numpy dtype of the event arrays renderEvents takes");
     py::class_<SurgeSynthesizer::ID>(m, "SurgeSynthesizer_ID")
         .def(py::init<>())
         .def("getDawSideIndex", &SurgeSynthesizer::ID::getDawSideIndex)
@@ -929,6 +1372,24 @@ PYBIND11_MODULE(surgepy, m)
              "Either populate the\n"
              "entire array, or starting at startBlock position in the output, populate nBlocks.",
              py::arg("val"), py::arg("startBlock") = 0, py::arg("nBlocks") = -1)
+        .def("renderEvents", &SurgeSynthesizerWithPythonExtensions::renderEvents,
+             "Run the surge engine for multiple blocks like processMultiBlock, applying a numpy "
+             "array of events\n"
+             "(dtype getEventDtype(), types surgepy.constants.ev_*) before the block each falls "
+             "in. The sample of\n"
+             "each event counts from startBlock. Releases the GIL while rendering, so "
+             "instances on different\n"
+             "python threads render in parallel; don't share one instance between threads.",
+             py::arg("val"), py::arg("events"), py::arg("startBlock") = 0,
+             py::arg("nBlocks") = -1)
+
+        .def("pollProcessProfile", &SurgeSynthesizerWithPythonExtensions::pollProcessProfile,
+             "Where process() spent its time since the last poll: a dict of blocks, total ns, ns "
+             "by stage,\n"
+             "ns by FX slot (surgepy.constants.fxslot_*) and, by oscillator type "
+             "(surgepy.constants.ot_*),\n"
+             "ns and oscillator blocks run, and ns in the voices' filter chain. Safe to call while "
+             "another thread renders.")
 
         .def("getPatch", &SurgeSynthesizerWithPythonExtensions::getPatchAsPy,
              "Get a python dictionary with the Surge parameters laid out in the logical patch "
@@ -947,6 +1408,26 @@ PYBIND11_MODULE(surgepy, m)
              &SurgeSynthesizerWithPythonExtensions::remapToStandardKeyboard,
              "Return to standard C centered keyboard mapping");
 
+    py::class_<SurgePyBatchRenderer>(m, "BatchRenderer")
+        .def(py::init<float, int>(),
+             "Create a pool of nInstances Surge instances, each with its own thread, to render "
+             "jobs on. 0 uses one per core.",
+             py::arg("sampleRate"), py::arg("nInstances") = 0)
+        .def("submit", &SurgePyBatchRenderer::submit,
+             "Queue a list of (patch path, event array, nBlocks) jobs, with event arrays as for "
+             "renderEvents,\n"
+             "and return their ids. Each job loads its patch fresh into a free instance.",
+             py::arg("jobs"))
+        .def("next", &SurgePyBatchRenderer::next,
+             "Wait for the next job to finish and return (id, audio), audio being a "
+             "2 x nBlocks*BLOCK_SIZE\n"
+             "numpy array. Jobs come back in the order they finish.")
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", &SurgePyBatchRenderer::next)
+        .def("getNumInstances", &SurgePyBatchRenderer::getNumInstances)
+        .def("getPending", &SurgePyBatchRenderer::getPending,
+             "How many submitted jobs have yet to be returned by next()");
+
     py::class_<SurgePyControlGroup>(m, "SurgeControlGroup")
         .def("getId", &SurgePyControlGroup::getControlGroupId)
         .def("getName", &SurgePyControlGroup::getControlGroupName)
@@ -1042,6 +1523,14 @@ PYBIND11_MODULE(surgepy, m)
     C(ot_FM2);
     C(ot_window);
 
+    C(ev_note_on);
+    C(ev_note_off);
+    C(ev_pitch_bend);
+    C(ev_poly_aftertouch);
+    C(ev_channel_aftertouch);
+    C(ev_controller);
+    C(ev_param);
+
     C(adsr_ampeg);
     C(adsr_filteg);
 
@@ -38,7 +38,6 @@ SurgeSynthProcessor::SurgeSynthProcessor()
               << "  - CPU          : " << Surge::CPUFeatures::cpuBrand() << std::endl;
 
     surge = std::make_unique<SurgeSynthesizer>(this);
-    surge->storage.initializePatchDb(); // In the UI branch we want the patch DB running
 
     std::map<unsigned int, std::vector<std::unique_ptr<juce::AudioProcessorParameter>>> parByGroup;
     for (auto par : surge->storage.getPatch().param_ptr)
@@ -67,6 +66,32 @@ SurgeSynthProcessor::SurgeSynthProcessor()
     }
     addParameterGroup(std::move(parent));
 
+    // The program list and the patch DB want the patch list, so they wait for its scan here
+    if (!ensureProgramList())
+        startTimer(50);
+
+    surge->hostProgram = juce::PluginHostType().getHostDescription();
+    surge->juceWrapperType = getWrapperTypeDescription(wrapperType);
+
+    midiKeyboardState.addListener(this);
+
+    SurgeSynthProcessorSpecificExtensions(this, surge.get());
+}
+
+SurgeSynthProcessor::~SurgeSynthProcessor() { stopTimer(); }
+
+bool SurgeSynthProcessor::ensureProgramList()
+{
+    if (programListBuilt)
+        return true;
+    if (!surge->storage.isPatchScanFinished())
+        return false;
+
+    // publishes what the scan found; it is finished, so this doesn't wait
+    surge->storage.ensurePatchListLoaded();
+    surge->storage.initializePatchDb(); // In the UI branch we want the patch DB running
+    surge->findCurrentPatchInList();
+
     presetOrderToPatchList.clear();
     for (int i = 0; i < surge->storage.firstThirdPartyCategory; i++)
     {
@@ -81,16 +106,19 @@ SurgeSynthProcessor::SurgeSynthProcessor()
         }
     }
 
-    surge->hostProgram = juce::PluginHostType().getHostDescription();
-    surge->juceWrapperType = getWrapperTypeDescription(wrapperType);
+    programListBuilt = true;
+    return true;
+}
 
-    midiKeyboardState.addListener(this);
+void SurgeSynthProcessor::timerCallback()
+{
+    if (!ensureProgramList())
+        return;
 
-    SurgeSynthProcessorSpecificExtensions(this, surge.get());
+    stopTimer();
+    updateHostDisplay();
 }
 
-SurgeSynthProcessor::~SurgeSynthProcessor() {}
-
 //==============================================================================
 const String SurgeSynthProcessor::getName() const { return JucePlugin_Name; }
 
@@ -102,11 +130,16 @@ bool SurgeSynthProcessor::isMidiEffect() const { return false; }
 
 double SurgeSynthProcessor::getTailLengthSeconds() const { return 2.0; }
 
-int SurgeSynthProcessor::getNumPrograms() { return surge->storage.patch_list.size() + 1; }
+int SurgeSynthProcessor::getNumPrograms()
+{
+    if (!ensureProgramList())
+        return 1;
+    return surge->storage.patch_list.size() + 1;
+}
 
 int SurgeSynthProcessor::getCurrentProgram()
 {
-    if (surge->patchid < 0 || surge->patchid > surge->storage.patch_list.size())
+    if (!ensureProgramList() || surge->patchid < 0 || surge->patchid > surge->storage.patch_list.size())
         return 0;
 
     return surge->patchid + 1;
@@ -114,7 +147,7 @@ int SurgeSynthProcessor::getCurrentProgram()
 
 void SurgeSynthProcessor::setCurrentProgram(int index)
 {
-    if (index > 0 && index <= presetOrderToPatchList.size())
+    if (ensureProgramList() && index > 0 && index <= presetOrderToPatchList.size())
     {
         surge->patchid_queue = presetOrderToPatchList[index - 1];
     }
@@ -122,7 +155,7 @@ void SurgeSynthProcessor::setCurrentProgram(int index)
 
 const String SurgeSynthProcessor::getProgramName(int index)
 {
-    if (index == 0)
+    if (index == 0 || !ensureProgramList())
         return "INIT OR DROPPED";
     index--;
     if (index < 0 || index >= presetOrderToPatchList.size())
@@ -194,47 +227,6 @@ void SurgeSynthProcessor::processBlock(AudioBuffer<float> &buffer, MidiBuffer &m
         surge->resetStateFromTimeData();
     }
 
-    for (const MidiMessageMetadata it : midiMessages)
-    {
-        MidiMessage m = it.getMessage();
-        const int ch = m.getChannel() - 1;
-        juce::ScopedValueSetter<bool> midiAdd(isAddingFromMidi, true);
-        midiKeyboardState.processNextMidiEvent(m);
-
-        if (m.isNoteOn())
-        {
-            surge->playNote(ch, m.getNoteNumber(), m.getVelocity(), 0);
-        }
-        else if (m.isNoteOff())
-        {
-            surge->releaseNote(ch, m.getNoteNumber(), m.getVelocity());
-        }
-        else if (m.isChannelPressure())
-        {
-            surge->channelAftertouch(ch, m.getChannelPressureValue());
-        }
-        else if (m.isAftertouch())
-        {
-            surge->polyAftertouch(ch, m.getNoteNumber(), m.getAfterTouchValue());
-        }
-        else if (m.isPitchWheel())
-        {
-            surge->pitchBend(ch, m.getPitchWheelValue() - 8192);
-        }
-        else if (m.isController())
-        {
-            surge->channelController(ch, m.getControllerNumber(), m.getControllerValue());
-        }
-        else if (m.isProgramChange())
-        {
-            // Implement program change in XT
-        }
-        else
-        {
-            // std::cout << "Ignoring message " << std::endl;
-        }
-    }
-
     midiR rec;
     while (midiFromGUI.pop(rec))
     {
@@ -248,7 +240,9 @@ void SurgeSynthProcessor::processBlock(AudioBuffer<float> &buffer, MidiBuffer &m
     auto mb = getBus(false, 0);
     if (mb->getNumberOfChannels() != 2 || !mb->isEnabled())
     {
-        // We have to have a stereo output
+        // We have to have a stereo output. Still consume the MIDI so we don't hang notes.
+        for (const MidiMessageMetadata it : midiMessages)
+            applyMidi(it.getMessage());
         return;
     }
     auto mainOutput = getBusBuffer(buffer, false, 0);
@@ -256,57 +250,130 @@ void SurgeSynthProcessor::processBlock(AudioBuffer<float> &buffer, MidiBuffer &m
     auto mainInput = getBusBuffer(buffer, true, 0);
     auto sceneAOutput = getBusBuffer(buffer, false, 1);
     auto sceneBOutput = getBusBuffer(buffer, false, 2);
-    for (int i = 0; i < buffer.getNumSamples(); i++)
-    {
-        auto outL = mainOutput.getWritePointer(0, i);
-        auto outR = mainOutput.getWritePointer(1, i);
+    bool sceneOutputs = surge->activateExtraOutputs && sceneAOutput.getNumChannels() == 2 &&
+                        sceneBOutput.getNumChannels() == 2;
 
-        surge->time_data.ppqPos += (double)BLOCK_SIZE * surge->time_data.tempo / (60. * samplerate);
+    /*
+     * The engine renders in BLOCK_SIZE chunks, but the host buffer can be any size and
+     * any alignment relative to those chunks. So we walk the host buffer in spans which
+     * end either at the end of the current surge block or at the end of the host buffer.
+     * Whenever we are about to render a new surge block, we apply every MIDI event whose
+     * sample offset lands inside that block, so events are quantized to the block grid
+     * rather than all landing at the start of the host buffer.
+     */
+    const int numSamples = buffer.getNumSamples();
+    auto midiIt = midiMessages.cbegin();
+    const auto midiEnd = midiMessages.cend();
 
-        if (blockPos == 0 && mainInput.getNumChannels() > 0)
+    int pos = 0;
+    while (pos < numSamples)
+    {
+        if (blockPos == 0)
         {
-            auto inL = mainInput.getReadPointer(0, i);
-            auto inR = inL;                     // assume mono
-            if (mainInput.getNumChannels() > 1) // unless its not
+            auto blockEnd = pos + BLOCK_SIZE;
+            while (midiIt != midiEnd && (*midiIt).samplePosition < blockEnd)
             {
-                inR = mainInput.getReadPointer(1, i);
+                applyMidi((*midiIt).getMessage());
+                ++midiIt;
             }
-            surge->process_input = true;
-            memcpy(&(surge->input[0][0]), inL, BLOCK_SIZE * sizeof(float));
-            memcpy(&(surge->input[1][0]), inR, BLOCK_SIZE * sizeof(float));
-        }
-        else
-        {
-            surge->process_input = false;
-        }
-        if (blockPos == 0)
-        {
+
+            if (mainInput.getNumChannels() > 0)
+            {
+                auto avail = std::min(BLOCK_SIZE, numSamples - pos);
+                auto inL = mainInput.getReadPointer(0, pos);
+                auto inR = inL;                     // assume mono
+                if (mainInput.getNumChannels() > 1) // unless its not
+                {
+                    inR = mainInput.getReadPointer(1, pos);
+                }
+                surge->process_input = true;
+                FloatVectorOperations::copy(&(surge->input[0][0]), inL, avail);
+                FloatVectorOperations::copy(&(surge->input[1][0]), inR, avail);
+                if (avail < BLOCK_SIZE)
+                {
+                    FloatVectorOperations::clear(&(surge->input[0][avail]), BLOCK_SIZE - avail);
+                    FloatVectorOperations::clear(&(surge->input[1][avail]), BLOCK_SIZE - avail);
+                }
+            }
+            else
+            {
+                surge->process_input = false;
+            }
+
             surge->process();
+            surge->time_data.ppqPos +=
+                (double)BLOCK_SIZE * surge->time_data.tempo / (60. * samplerate);
         }
-        *outL = surge->output[0][blockPos];
-        *outR = surge->output[1][blockPos];
 
-        if (surge->activateExtraOutputs && sceneAOutput.getNumChannels() == 2 &&
-            sceneBOutput.getNumChannels() == 2)
-        {
-            auto sAL = sceneAOutput.getWritePointer(0, i);
-            auto sAR = sceneAOutput.getWritePointer(1, i);
-            auto sBL = sceneBOutput.getWritePointer(0, i);
-            auto sBR = sceneBOutput.getWritePointer(1, i);
+        auto span = std::min(BLOCK_SIZE - blockPos, numSamples - pos);
 
-            if (sAL && sAR)
-            {
-                *sAL = surge->sceneout[0][0][blockPos];
-                *sAR = surge->sceneout[0][1][blockPos];
-            }
-            if (sBL && sBR)
+        FloatVectorOperations::copy(mainOutput.getWritePointer(0, pos),
+                                    &(surge->output[0][blockPos]), span);
+        FloatVectorOperations::copy(mainOutput.getWritePointer(1, pos),
+                                    &(surge->output[1][blockPos]), span);
+
+        if (sceneOutputs)
+        {
+            for (int sc = 0; sc < n_scenes; ++sc)
             {
-                *sBL = surge->sceneout[1][0][blockPos];
-                *sBR = surge->sceneout[1][1][blockPos];
+                auto &so = (sc == 0 ? sceneAOutput : sceneBOutput);
+                FloatVectorOperations::copy(so.getWritePointer(0, pos),
+                                            &(surge->sceneout[sc][0][blockPos]), span);
+                FloatVectorOperations::copy(so.getWritePointer(1, pos),
+                                            &(surge->sceneout[sc][1][blockPos]), span);
             }
         }
 
-        blockPos = (blockPos + 1) & (BLOCK_SIZE - 1);
+        pos += span;
+        blockPos = (blockPos + span) & (BLOCK_SIZE - 1);
+    }
+
+    // Anything left over (a host handing us events past the end of the buffer) still gets
+    // applied, so we never drop a note off
+    while (midiIt != midiEnd)
+    {
+        applyMidi((*midiIt).getMessage());
+        ++midiIt;
+    }
+}
+
+void SurgeSynthProcessor::applyMidi(const juce::MidiMessage &m)
+{
+    const int ch = m.getChannel() - 1;
+    juce::ScopedValueSetter<bool> midiAdd(isAddingFromMidi, true);
+    midiKeyboardState.processNextMidiEvent(m);
+
+    if (m.isNoteOn())
+    {
+        surge->playNote(ch, m.getNoteNumber(), m.getVelocity(), 0);
+    }
+    else if (m.isNoteOff())
+    {
+        surge->releaseNote(ch, m.getNoteNumber(), m.getVelocity());
+    }
+    else if (m.isChannelPressure())
+    {
+        surge->channelAftertouch(ch, m.getChannelPressureValue());
+    }
+    else if (m.isAftertouch())
+    {
+        surge->polyAftertouch(ch, m.getNoteNumber(), m.getAfterTouchValue());
+    }
+    else if (m.isPitchWheel())
+    {
+        surge->pitchBend(ch, m.getPitchWheelValue() - 8192);
+    }
+    else if (m.isController())
+    {
+        surge->channelController(ch, m.getControllerNumber(), m.getControllerValue());
+    }
+    else if (m.isProgramChange())
+    {
+        // Implement program change in XT
+    }
+    else
+    {
+        // std::cout << "Ignoring message " << std::endl;
     }
 }
 
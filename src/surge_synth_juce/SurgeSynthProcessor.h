@@ -94,7 +94,8 @@ struct SurgeParamToJuceParamAdapter : juce::RangedAudioParameter
 
 class SurgeSynthProcessor : public juce::AudioProcessor,
                             public SurgeSynthesizer::PluginLayer,
-                            public juce::MidiKeyboardState::Listener
+                            public juce::MidiKeyboardState::Listener,
+                            public juce::Timer
 {
   public:
     //==============================================================================
@@ -149,6 +150,9 @@ class SurgeSynthProcessor : public juce::AudioProcessor,
 
     void surgeParameterUpdated(const SurgeSynthesizer::ID &id, float value) override;
 
+    // Waits for the patch scan, then builds what wants its list and tells the host
+    void timerCallback() override;
+
     std::unique_ptr<SurgeSynthesizer> surge;
     std::unordered_map<SurgeSynthesizer::ID, SurgeParamToJuceParamAdapter *> paramsByID;
 
@@ -156,8 +160,16 @@ class SurgeSynthProcessor : public juce::AudioProcessor,
     juce::MidiKeyboardState midiKeyboardState;
 
   private:
+    void applyMidi(const juce::MidiMessage &m);
+
     std::vector<SurgeParamToJuceParamAdapter *> paramAdapters;
 
+    /*
+     * Built once the patch scan is done, which the constructor doesn't wait for. Until then the
+     * host sees just the one INIT OR DROPPED program. Never waits, so false means not yet.
+     */
+    bool ensureProgramList();
+    bool programListBuilt{false};
     std::vector<int> presetOrderToPatchList;
     int blockPos = 0;
 